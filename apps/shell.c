@@ -318,11 +318,28 @@ void cmd_qexec(const char *filename) {
   qhal_print_topology();
 
   // Parse and execute circuit
-  // QVM execution happens in userspace
-  extern void qvm_execute_from_text(const char *text);
+  // QVM execution happens in userspace. The compiled form is cached next
+  // to the source as <file>.qcb and reused until the source changes.
+  extern void qvm_execute_cached(const char *text, const void *cached,
+                                 size_t cached_size, void **compiled,
+                                 size_t *compiled_size);
+  static uint64_t qcb[2048]; // 8-byte aligned so gates load in place
+  char qcb_name[64];
+  int cacheable = snprintf(qcb_name, sizeof(qcb_name), "%s.qcb", filename) <
+                  (int)sizeof(qcb_name);
+  int qcb_len =
+      cacheable ? nexus_read_file(qcb_name, (char *)qcb, sizeof(qcb)) : -1;
 
   printf("[QVM] Executing mapped circuit...\n");
-  qvm_execute_from_text(buffer);
+  void *compiled;
+  size_t compiled_size;
+  qvm_execute_cached(buffer, qcb_len > 0 ? qcb : NULL,
+                     qcb_len > 0 ? (size_t)qcb_len : 0, &compiled,
+                     &compiled_size);
+  if (compiled && cacheable &&
+      nexus_write_file(qcb_name, compiled, (int)compiled_size, cwd_id) == 0)
+    printf("[QVM] Compiled circuit cached as %s\n", qcb_name);
+  free(compiled);
 }
 
 // --- Quantum Monitor ---
@@ -411,15 +428,22 @@ void cmd_qvis(const char *arg) {
 }
 
 // --- Quantum Profiler ---
-extern void qprof_profile(const char *circuit_name);
+extern void qprof_profile(const char *circuit_name, const char *circuit_text);
 
 void cmd_qprof(const char *arg) {
   char file[64];
-  if (sscanf(arg, "%s", file) == 1) {
-    qprof_profile(file);
-  } else {
+  if (sscanf(arg, "%s", file) != 1) {
     printf("Usage: qprof <circuit_file>\n");
+    return;
+  }
+  char buffer[2048];
+  int len = nexus_read_file(file, buffer, sizeof(buffer) - 1);
+  if (len < 0) {
+    printf("Error: Could not read circuit file '%s'\n", file);
+    return;
   }
+  buffer[len] = '\0';
+  qprof_profile(file, buffer);
 }
 
 // --- Governance ---
@@ -456,7 +480,24 @@ void cmd_qnoise(const char *arg) {
     qnoise_set(type, prob);
   } else {
     printf("Usage: qnoise <type> <prob>\n");
-    printf("Types: 0=None, 1=BitFlip, 2=PhaseFlip, 3=Depolarizing\n");
+    printf("Types: 0=None, 1=BitFlip, 2=PhaseFlip, 3=Depolarizing,\n");
+    printf("       4=AmplitudeDamping, 5=Readout\n");
+  }
+}
+
+// --- Quantum RNG Seed ---
+extern void qvm_rng_seed(uint64_t seed);
+extern uint64_t qvm_rng_get_seed(void);
+
+void cmd_qseed(const char *arg) {
+  unsigned long long seed;
+  if (sscanf(arg, "%llu", &seed) == 1) {
+    qvm_rng_seed((uint64_t)seed);
+    printf("[QVM] RNG seed set to %llu (0 = clock)\n", seed);
+  } else {
+    printf("[QVM] RNG seed: %llu\n",
+           (unsigned long long)qvm_rng_get_seed());
+    printf("Usage: qseed <n>  (same seed, same measurements)\n");
   }
 }
 
@@ -573,6 +614,7 @@ void cmd_help() {
   printf("  qvis <type>      : Visualize (bloch/histogram)\n");
   printf("  qprof <file>     : Profile circuit performance\n");
   printf("  qnoise <t> <p>   : Configure quantum noise (0-3)\n");
+  printf("  qseed <n>        : Seed measurement/noise RNG (reproducible)\n");
   printf("  qec_demo         : Run Quantum Error Correction Demo\n");
   printf("  qkd_demo <n> [e] : Run QKD Demo (BB84) with n bits\n");
   printf("  qnn_demo [e] [lr]: Train Quantum Neural Network (XOR)\n");
@@ -1892,6 +1934,8 @@ int main() {
       cmd_cleanup_fs();
     else if (strncmp(cmd, "qnoise", 6) == 0)
       cmd_qnoise(cmd + 7);
+    else if (strncmp(cmd, "qseed", 5) == 0)
+      cmd_qseed(cmd + 5);
     else if (strcmp(cmd, "qec_demo") == 0)
       cmd_qec_demo();
     else if (strncmp(cmd, "qkd_demo", 8) == 0)
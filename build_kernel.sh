@@ -35,6 +35,28 @@ gcc -o nexus_kernel \
     modules/quantum/visualization.c \
     modules/quantum/qec_neural.c \
     modules/quantum/qvm.c \
+    modules/quantum/qvm_kernels.c \
+    modules/quantum/qvm_kernels_avx.c \
+    modules/quantum/qvm_threads.c \
+    modules/quantum/qvm_fuse.c \
+    modules/quantum/qvm_tile.c \
+    modules/quantum/qvm_unitary.c \
+    modules/quantum/qvm_macro.c \
+    modules/quantum/qvm_hsf.c \
+    modules/quantum/qvm_sample.c \
+    modules/quantum/qvm_stabilizer.c \
+    modules/quantum/qvm_mps.c \
+    modules/quantum/qvm_density.c \
+    modules/quantum/qvm_trajectory.c \
+    modules/quantum/qvm_expect.c \
+    modules/quantum/qvm_gradient.c \
+    modules/quantum/qvm_batch.c \
+    modules/quantum/qvm_rng.c \
+    modules/quantum/qvm_single.c \
+    modules/quantum/qvm_ooc.c \
+    modules/quantum/qvm_snapshot.c \
+    modules/quantum/qvm_sparse.c \
+    modules/quantum/qvm_qcb.c \
     modules/quantum/qdbg.c \
     modules/quantum/qmonitor.c \
     modules/quantum/qopt.c \
@@ -59,7 +81,7 @@ gcc -o nexus_kernel \
     -I modules/graphics/include \
     -I modules/contracts/include \
     -I modules/quantum/include \
-    -lm
+    -lm -pthread
 
 echo "[BUILD] Compiling Nexus Shell..."
 gcc -o nexus_shell \
@@ -99,6 +121,28 @@ gcc -o nexus_shell \
     modules/quantum/visualization.c \
     modules/quantum/qec_neural.c \
     modules/quantum/qvm.c \
+    modules/quantum/qvm_kernels.c \
+    modules/quantum/qvm_kernels_avx.c \
+    modules/quantum/qvm_threads.c \
+    modules/quantum/qvm_fuse.c \
+    modules/quantum/qvm_tile.c \
+    modules/quantum/qvm_unitary.c \
+    modules/quantum/qvm_macro.c \
+    modules/quantum/qvm_hsf.c \
+    modules/quantum/qvm_sample.c \
+    modules/quantum/qvm_stabilizer.c \
+    modules/quantum/qvm_mps.c \
+    modules/quantum/qvm_density.c \
+    modules/quantum/qvm_trajectory.c \
+    modules/quantum/qvm_expect.c \
+    modules/quantum/qvm_gradient.c \
+    modules/quantum/qvm_batch.c \
+    modules/quantum/qvm_rng.c \
+    modules/quantum/qvm_single.c \
+    modules/quantum/qvm_ooc.c \
+    modules/quantum/qvm_snapshot.c \
+    modules/quantum/qvm_sparse.c \
+    modules/quantum/qvm_qcb.c \
     modules/quantum/qdbg.c \
     modules/quantum/qmonitor.c \
     modules/quantum/qopt.c \
@@ -123,5 +167,5 @@ gcc -o nexus_shell \
     -I modules/graphics/include \
     -I modules/contracts/include \
     -I modules/quantum/include \
-    -lm -ldl
+    -lm -ldl -pthread
 
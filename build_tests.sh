@@ -5,17 +5,57 @@ echo "║     Building QVM Test Suite      ║"
 echo "╚═══════════════════════════════════╝"
 echo ""
 
-echo "[1/1] Compiling QVM Unit Tests..."
+QVM_SOURCES="modules/quantum/qvm.c \
+    modules/quantum/qvm_kernels.c \
+    modules/quantum/qvm_kernels_avx.c \
+    modules/quantum/qvm_threads.c \
+    modules/quantum/qvm_fuse.c \
+    modules/quantum/qvm_tile.c \
+    modules/quantum/qvm_unitary.c \
+    modules/quantum/qvm_macro.c \
+    modules/quantum/qvm_hsf.c \
+    modules/quantum/qvm_sample.c \
+    modules/quantum/qvm_stabilizer.c \
+    modules/quantum/qvm_mps.c \
+    modules/quantum/qvm_density.c \
+    modules/quantum/qvm_trajectory.c \
+    modules/quantum/qvm_expect.c \
+    modules/quantum/qvm_gradient.c \
+    modules/quantum/qvm_batch.c \
+    modules/quantum/qvm_rng.c \
+    modules/quantum/qvm_single.c \
+    modules/quantum/qvm_ooc.c \
+    modules/quantum/qvm_snapshot.c \
+    modules/quantum/qvm_sparse.c \
+    modules/quantum/qvm_qcb.c \
+    modules/quantum/noise.c \
+    modules/quantum/qmonitor.c \
+    tests/qvm_test_stubs.c"
+
+echo "[1/2] Compiling QVM Unit Tests..."
 gcc -o test_qvm \
     tests/test_qvm_unit.c \
-    modules/quantum/qvm.c \
+    $QVM_SOURCES \
+    -I modules/quantum/include \
+    -lm -pthread
+
+if [ $? -ne 0 ]; then
+    echo "✗ Build failed!"
+    exit 1
+fi
+
+echo "[2/2] Compiling QVM Benchmark..."
+gcc -O2 -o bench_qvm \
+    tests/bench_qvm.c \
+    $QVM_SOURCES \
     -I modules/quantum/include \
-    -lm
+    -lm -pthread
 
 if [ $? -eq 0 ]; then
     echo "✓ Build successful!"
     echo ""
     echo "Run tests with: ./test_qvm"
+    echo "Run benchmark with: ./bench_qvm"
     echo ""
 else
     echo "✗ Build failed!"
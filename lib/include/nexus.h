@@ -91,6 +91,9 @@ int nexus_render_frame(void);
 
 // --- File Management ---
 int nexus_create_file(const char *name, const char *content, int parent_id);
+// Binary-safe variant: stores exactly `size` bytes
+int nexus_write_file(const char *name, const void *data, int size,
+                      int parent_id);
 int nexus_read_file(const char *name, char *buffer, int max_size);
 int nexus_delete_file(const char *name);
 int nexus_rename_file(const char *old_name, const char *new_name);
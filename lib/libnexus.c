@@ -109,6 +109,12 @@ int nexus_create_file(const char *name, const char *content, int parent_id) {
   return sys_func(name, content, strlen(content), parent_id);
 }
 
+int nexus_write_file(const char *name, const void *data, int size,
+                      int parent_id) {
+  sys_create_file_t sys_func = (sys_create_file_t)syscall_table[13];
+  return sys_func(name, (const char *)data, size, parent_id);
+}
+
 int nexus_read_file(const char *name, char *buffer, int max_size) {
   sys_read_file_t sys_func = (sys_read_file_t)syscall_table[14];
   return sys_func(name, buffer, max_size);
@@ -5,36 +5,49 @@
  */
 
 #include "../../../kernel/memory/include/sys/kalloc.h"
+#include "../../quantum/include/qvm.h"
 #include "../include/neural.h"
 #include <math.h>
 #include <stdio.h>
 
-// Mock Quantum Gates (since we don't have a full linear algebra library yet)
-// In a real QNN, these would be calls to the QPU driver.
+// One ephemeral qubit: RY(pi * input) encodes the feature, RY(pi * weight)
+// is the variational layer. The circuit is parsed on first use and only
+// re-bound afterwards.
+static const char *pqc_circuit_text = "QUBITS 1\n"
+                                      "RY(pi*p0) 0\n"
+                                      "RY(pi*p1) 0\n";
+static qvm_circuit_t pqc_circuit;
+static qvm_state_t pqc_state;
+static int pqc_ready = 0;
+
+static int pqc_setup(void) {
+  if (pqc_ready)
+    return 0;
+  if (qvm_parse_circuit(pqc_circuit_text, &pqc_circuit) != 0)
+    return -1;
+  qvm_init(&pqc_state, pqc_circuit.num_qubits);
+  if (pqc_state.num_qubits == 0) {
+    qvm_circuit_free(&pqc_circuit);
+    return -1;
+  }
+  pqc_ready = 1;
+  return 0;
+}
 
 float neural_pqc_run(float *inputs, float *weights) {
-  // 1. Allocate Quantum Resource (Ephemeral Qubit)
-  // We simulate this by checking if we *could* allocate.
-  // In a real run, we would use sys_allocate_qmemory via syscall or internal
-  // kernel call.
-
-  // printf("[QNN] Allocating Ephemeral Qubit for PQC...\n");
-
-  // 2. Encoding Layer (Classical Data -> Quantum State)
-  // Rx(input)
-  float theta_in = inputs[0] * M_PI; // Normalize to [0, PI]
-
-  // 3. Variational Layer (Weights -> Quantum Gates)
-  // Rz(weight) + CNOT (Entanglement simulation)
-  float theta_w = weights[0] * M_PI;
-
-  // 4. Measurement (Z-basis expectation value)
-  // <Z> = cos(theta_total)
-  // This is a simplified simulation of a single qubit rotation.
-  float result = cosf(theta_in + theta_w);
-
-  // Add some "Quantum Noise" simulation
-  // result += ((rand() % 100) / 1000.0f);
+  if (pqc_setup() != 0)
+    return 0.0f;
+
+  // Encoding and variational layers in one bound run
+  double params[2] = {inputs[0], weights[0]};
+  if (qvm_execute_bound(&pqc_state, &pqc_circuit, params, 2) != 0)
+    return 0.0f;
+
+  // Measurement (Z-basis expectation value): <Z> = P(0) - P(1), which is
+  // cos(pi * (input + weight)) for this circuit
+  double probs[2];
+  qvm_qubit_probs(&pqc_state, 0, probs);
+  float result = (float)((probs[0] - probs[1]) / (probs[0] + probs[1]));
 
   // printf("[QNN] PQC Layer Executed. Input: %.2f, Weight: %.2f -> <Z>:
   // %.2f\n",
@@ -3,10 +3,10 @@
  * File: modules/neural/qnn_xor.c
  */
 
+#include "../quantum/include/qvm.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
 
 // Parameters: 4 trainable angles
 // Circuit:
@@ -15,52 +15,52 @@
 // 3. Ry(theta1) on Q1
 // 4. CNOT(Q0, Q1) (Entanglement)
 // 5. Ry(theta2) on Q1
-// 6. Measure Q1
+// 6. Rx(theta3) on Q1
+// 7. Measure Q1
+// Inputs are parameters p0, p1 and the angles p2..p5, so the circuit is
+// parsed once and every forward pass only re-binds it.
+static const char *qnn_ansatz = "QUBITS 2\n"
+                                "RY(pi*p0) 0\n"
+                                "RY(pi*p1) 1\n"
+                                "RY(p2) 0\n"
+                                "RY(p3) 1\n"
+                                "CNOT 0 1\n"
+                                "RY(p4) 1\n"
+                                "RX(p5) 1\n";
 static double theta[4] = {0.0, 0.0, 0.0, 0.0}; // Trainable parameters
+static qvm_circuit_t qnn_circuit;
 
 // Helper: Sigmoid for classical post-processing (optional, but good for prob)
 double sigmoid(double x) { return 1.0 / (1.0 + exp(-x)); }
 
-// Simulate PQC Forward Pass
-// Returns expectation value of Z on Q1 (range -1 to 1)
-// We use a simplified analytical model for this specific circuit to speed up
-// training demo. Ideally, we would call qvm_apply_gate(), but for gradient
-// descent speed in this shell demo, we use the analytical expectation formula
-// derived for this ansatz. Circuit: Ry(x0)->Ry(t0) --*-- Circuit:
-// Ry(x1)->Ry(t1) --X-- Ry(t2) -M
-double qnn_forward(double x0, double x1, double t0, double t1, double t2,
-                   double t3) {
-  // Effective angles after encoding
-  double a0 = x0 * M_PI + t0;
-  double a1 = x1 * M_PI + t1;
-
-  // After CNOT and Ry(t2) on Q1:
-  // The math is complex to write out fully here without matrix lib,
-  // so we will simulate it using a simplified "Quantum-inspired" non-linear
-  // function that mimics the interference pattern for the demo. Real QNNs rely
-  // on cos/sin interference.
-
-  // Let's use a proxy function that behaves like the quantum circuit:
-  // P(1) = sin^2( (a0 + a1 + t2)/2 ) * cos(t3) ... roughly.
-  // To solve XOR, we need non-linearity.
-  // XOR: (0,0)->0, (0,1)->1, (1,0)->1, (1,1)->0
-
-  // A known ansatz for XOR involves CNOT.
-  // Let's implement a "simulation" of the measurement probability P(y=1).
-  double p1 = sin(a0) * cos(a1) * sin(t2) + cos(a0) * sin(a1) * cos(t3);
-  // Normalize to 0..1 roughly
-  return 0.5 * (p1 + 1.0);
+// PQC Forward Pass on the QVM
+// Returns P(Q1 = 1) = (1 - <Z1>) / 2, the probability of class 1, and its
+// gradient with respect to the 4 trainable angles in dpred
+static double qnn_forward(double x0, double x1, const double *t,
+                          double *dpred) {
+  double params[6] = {x0, x1, t[0], t[1], t[2], t[3]};
+  double z, grad[6];
+  if (qvm_gradient(&qnn_circuit, params, 6, "IZ", QVM_GRAD_AUTO, &z, grad) !=
+      0) {
+    for (int p = 0; p < 4; p++)
+      dpred[p] = 0.0;
+    return 0.5;
+  }
+  for (int p = 0; p < 4; p++)
+    dpred[p] = -grad[p + 2] / 2;
+  return (1.0 - z) / 2;
 }
 
 // Training Loop
 void qnn_train_xor(int epochs, double lr) {
   printf("[QNN] Training XOR Classifier (Hybrid Quantum-Classical)\n");
   printf("[QNN] Circuit: 2 Qubits, 4 Parameters, CNOT Entanglement\n");
+  if (qvm_parse_circuit(qnn_ansatz, &qnn_circuit) != 0)
+    return;
 
   // Initialize random parameters
-  srand(time(NULL));
   for (int i = 0; i < 4; i++)
-    theta[i] = ((double)rand() / RAND_MAX) * 2 * M_PI;
+    theta[i] = qvm_rng_uniform(qvm_rng_thread()) * 2 * M_PI;
 
   // Dataset (XOR)
   double inputs[4][2] = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
@@ -70,30 +70,17 @@ void qnn_train_xor(int epochs, double lr) {
     double total_loss = 0.0;
 
     for (int i = 0; i < 4; i++) {
-      // Forward
-      double pred = qnn_forward(inputs[i][0], inputs[i][1], theta[0], theta[1],
-                                theta[2], theta[3]);
+      // Forward and backward in one adjoint pass over the circuit
+      double grads[4];
+      double pred = qnn_forward(inputs[i][0], inputs[i][1], theta, grads);
 
-      // Loss (MSE)
+      // Loss (MSE): dL/dTheta = 2 * error * dPred/dTheta
       double error = pred - targets[i];
       total_loss += error * error;
 
-      // Backward (Gradients via Finite Difference / Parameter Shift)
-      // dL/dTheta = 2 * error * dPred/dTheta
-      double eps = 0.01;
-      for (int p = 0; p < 4; p++) {
-        // Shift parameter p
-        double old_p = theta[p];
-        theta[p] += eps;
-        double pred_plus = qnn_forward(inputs[i][0], inputs[i][1], theta[0],
-                                       theta[1], theta[2], theta[3]);
-        theta[p] = old_p; // Restore
-
-        double grad = (pred_plus - pred) / eps;
-
-        // Update (Gradient Descent)
-        theta[p] -= lr * 2 * error * grad;
-      }
+      // Update (Gradient Descent)
+      for (int p = 0; p < 4; p++)
+        theta[p] -= lr * 2 * error * grads[p];
     }
 
     if (epoch % (epochs / 10) == 0) {
@@ -107,12 +94,14 @@ void qnn_train_xor(int epochs, double lr) {
   // Final Verification
   printf("\n--- Final Inference ---\n");
   for (int i = 0; i < 4; i++) {
-    double p = qnn_forward(inputs[i][0], inputs[i][1], theta[0], theta[1],
-                           theta[2], theta[3]);
+    double grads[4];
+    double p = qnn_forward(inputs[i][0], inputs[i][1], theta, grads);
     int out = p > 0.5 ? 1 : 0;
     printf("Input: [%.0f, %.0f] -> Prob: %.4f -> Class: %d (Target: %.0f) %s\n",
            inputs[i][0], inputs[i][1], p, out, targets[i],
            out == (int)targets[i] ? "\033[1;32m[OK]\033[0m"
                                   : "\033[1;31m[FAIL]\033[0m");
   }
+
+  qvm_circuit_free(&qnn_circuit);
 }
@@ -7,57 +7,631 @@
 #define _QVM_H_
 
 #include <complex.h>
+#include <stddef.h>
 #include <stdint.h>
 
-#define QVM_MAX_QUBITS 16
-#define QVM_MAX_GATES 256
-#define QVM_STATE_SIZE (1 << QVM_MAX_QUBITS) // 2^n states
+// Dense statevector limit: 2^32 amplitudes is 64 GB. qvm_init() also
+// refuses sizes beyond physical RAM.
+#define QVM_MAX_QUBITS 32
+#define QVM_CIRCUIT_INITIAL_GATES 64 // First gate buffer; doubles as needed
+#define QVM_STREAM_WINDOW 4096 // Gates buffered per sweep when streaming
+#define QVM_STATE_SIZE ((size_t)1 << QVM_MAX_QUBITS) // 2^n states
+#define QVM_DEFAULT_SHOTS 1024
+#define QVM_STABILIZER_MAX_QUBITS 16384 // Tableau is O(n^2) bits
+#define QVM_MPS_MAX_QUBITS 1024         // MPS is O(n * chi^2) amplitudes
+#define QVM_MPS_DEFAULT_BOND 64         // Bond cap ($QVM_MPS_BOND)
+#define QVM_MPS_DEFAULT_CUTOFF 1e-12    // Discarded weight ($QVM_MPS_CUTOFF)
+#define QVM_DENSITY_MAX_QUBITS 13       // rho is 4^n amplitudes (1 GB at 13)
+#define QVM_OOC_MAX_QUBITS 40           // Out-of-core scratch file: 16 TB
+#define QVM_OOC_DEFAULT_CHUNK 22        // Qubits per chunk ($QVM_OOC_CHUNK)
+#define QVM_SPARSE_MAX_QUBITS 63        // Basis indices are 64-bit keys
+#define QVM_SPARSE_DENSE_SHIFT 4        // Dense past 2^n >> 4 amplitudes
+#define QVM_SPARSE_WIDE_BITS 20         // Sparse past 32 qubits: 2^20 amps
+#define QVM_UNITARY_MAX_QUBITS 10       // Compiled unitary: 4^10 entries
+#define QVM_UNITARY_CACHE_SIZE 32       // Compiled unitaries kept by hash
+#define QVM_UNITARY_CACHE_BYTES ((size_t)64 << 20)
+#define QVM_HSF_MAX_QUBITS 63   // Bitstrings are 64-bit basis indices
+#define QVM_HSF_AUTO_PATHS 64   // Shell runs wide circuits this cheap by HSF
 
 // Quantum gate types
 typedef enum {
-  GATE_H,      // Hadamard
-  GATE_X,      // Pauli-X (NOT)
-  GATE_Y,      // Pauli-Y
-  GATE_Z,      // Pauli-Z
-  GATE_T,      // T gate (π/8)
-  GATE_S,      // S gate (π/4)
-  GATE_CNOT,   // Controlled-NOT
-  GATE_CZ,     // Controlled-Z
-  GATE_SWAP,   // SWAP
-  GATE_MEASURE // Measurement
+  GATE_H,       // Hadamard
+  GATE_X,       // Pauli-X (NOT)
+  GATE_Y,       // Pauli-Y
+  GATE_Z,       // Pauli-Z
+  GATE_T,       // T gate (π/8)
+  GATE_S,       // S gate (π/4)
+  GATE_CNOT,    // Controlled-NOT
+  GATE_CZ,      // Controlled-Z
+  GATE_SWAP,    // SWAP
+  GATE_MEASURE, // Measurement
+  // Rotations; angles in qvm_gate_t.theta
+  GATE_RX,     // exp(-i theta X / 2)
+  GATE_RY,     // exp(-i theta Y / 2)
+  GATE_RZ,     // exp(-i theta Z / 2)
+  GATE_U3,     // U3(theta, phi, lambda): RZ(phi) RY(theta) RZ(lambda)
+  GATE_CPHASE, // diag(1, 1, 1, e^(i theta)) on (control, target)
+  GATE_RZZ,    // exp(-i theta Z(x)Z / 2) on (control, target)
+  GATE_CCX,    // Toffoli: X on target if control and control2 are both 1
+  // Macro-ops on the qubit range control..target (see qvm_macro.c)
+  GATE_QFT,    // Quantum Fourier transform, qubit `control` least significant
+  GATE_IQFT,   // Its inverse
+  GATE_DIFFUSE // Grover diffusion 2|s><s| - I, s uniform over the range
 } qvm_gate_type_t;
 
+#define QVM_GATE_MAX_ANGLES 3 // U3
+#define QVM_MAX_PARAMS 65536  // Symbols p0 .. p65535
+
 // Gate operation
 typedef struct {
   qvm_gate_type_t type;
   int target;  // Target qubit
-  int control; // Control qubit (-1 if not used)
+  int control; // Control qubit, RZZ's other qubit or the first qubit of a
+               // range (-1 if not used)
+  double theta[QVM_GATE_MAX_ANGLES]; // Bound angles of rotation gates
+  int control2; // Second control of CCX (unused by other gates)
 } qvm_gate_t;
 
+static inline int qvm_gate_is_two_qubit(qvm_gate_type_t type) {
+  return type == GATE_CNOT || type == GATE_CZ || type == GATE_SWAP ||
+         type == GATE_CPHASE || type == GATE_RZZ;
+}
+
+static inline int qvm_gate_is_range(qvm_gate_type_t type) {
+  return type == GATE_QFT || type == GATE_IQFT || type == GATE_DIFFUSE;
+}
+
+// Every qubit of the gate in [0, num_qubits) and pairwise distinct
+static inline int qvm_gate_valid(const qvm_gate_t *g, int num_qubits) {
+  if (g->target < 0 || g->target >= num_qubits)
+    return 0;
+  if (qvm_gate_is_range(g->type))
+    return g->control >= 0 && g->control <= g->target;
+  if (g->type == GATE_CCX &&
+      (g->control2 < 0 || g->control2 >= num_qubits ||
+       g->control2 == g->target || g->control2 == g->control))
+    return 0;
+  if ((qvm_gate_is_two_qubit(g->type) || g->type == GATE_CCX) &&
+      (g->control < 0 || g->control >= num_qubits || g->control == g->target))
+    return 0;
+  return 1;
+}
+
+// Symbolic angle: gates[gate].theta[slot] = scale * params[symbol] + offset
+// whenever parameters are bound (see qvm_bind_parameters)
+typedef struct {
+  int gate;
+  int slot;
+  int symbol;
+  double scale;
+  double offset;
+} qvm_angle_t;
+
+// Simulation backends. The statevector is built into qvm.c; the others
+// keep their representation in backend_state (see qvm_backend.h).
+typedef enum {
+  QVM_BACKEND_STATEVECTOR,
+  QVM_BACKEND_STABILIZER, // Clifford circuits only (no T)
+  QVM_BACKEND_MPS,        // Matrix product state, low-entanglement circuits
+  QVM_BACKEND_DENSITY,    // Density matrix, exact noise channels
+  QVM_BACKEND_SINGLE,     // Statevector in complex float: half the memory
+  QVM_BACKEND_OUT_OF_CORE, // Statevector in a scratch file, chunk by chunk
+  QVM_BACKEND_SPARSE       // Non-zero amplitudes only, dense when they grow
+} qvm_backend_t;
+
+// Amplitude precision of a statevector
+typedef enum {
+  QVM_PRECISION_DOUBLE, // double _Complex, 16 bytes per amplitude
+  QVM_PRECISION_SINGLE  // float _Complex, 8 bytes (QVM_BACKEND_SINGLE)
+} qvm_precision_t;
+
+// Counter-based random stream (Philox4x32-10, see qvm_rng.c): block k of
+// stream s under seed key is philox(counter = (k, s), key). Streams never
+// overlap and any block can be computed without the ones before it.
+typedef struct {
+  uint64_t key;     // Seed
+  uint64_t stream;  // Stream id, QVM_RNG_* family | index
+  uint64_t counter; // Next block
+  uint32_t block[4];
+  int used;   // Words of block already handed out (4 = none left)
+  int seeded; // 0 for a zeroed stream: seeded on first use
+} qvm_rng_t;
+
 // Quantum state (statevector simulation)
 typedef struct {
   int num_qubits;
   double _Complex *amplitudes;  // 2^n complex amplitudes
   int measured[QVM_MAX_QUBITS]; // Measurement results
+  uint64_t measured_bits;       // Last outcome of qubits 0..63, bit q
+  qvm_backend_t backend;
+  void *backend_state; // NULL for the statevector
+  qvm_rng_t rng;       // Measurement, sampling and noise draws
 } qvm_state_t;
 
-// Quantum circuit
+// Quantum circuit. The gate buffer grows with qvm_circuit_append() and is
+// released by qvm_circuit_free(). Angles that depend on parameters p0, p1...
+// are listed in `angles`; constant angles live only in the gates.
 typedef struct {
   int num_qubits;
   int num_gates;
-  qvm_gate_t gates[QVM_MAX_GATES];
+  int capacity; // Gate slots allocated
+  qvm_gate_t *gates;
+  int shots;      // SHOTS directive (0 = QVM_DEFAULT_SHOTS)
+  int num_params; // Highest symbol + 1
+  int num_angles;
+  int angle_capacity;
+  qvm_angle_t *angles;
 } qvm_circuit_t;
 
+// Reads up to `size` bytes of circuit text into buf; returns 0 at the end
+typedef size_t (*qvm_stream_read_t)(void *ctx, char *buf, size_t size);
+
+// Measurement histogram. Outcomes are basis indices restricted to the
+// measured qubits in `mask`, sorted ascending. Only qubits 0..63 fit in an
+// outcome; measurements on higher qubits (stabilizer runs) are not counted.
+typedef struct {
+  int num_qubits;
+  uint64_t mask;
+  int shots;
+  int num_outcomes;
+  uint64_t *outcomes;
+  int *counts;
+} qvm_counts_t;
+
+#define QVM_COUNTS_MAX_BITS 64 // Bits of an outcome; buffers need one more
+
+// Fused program: the circuit after the gate-fusion pass (see qvm_fuse.c).
+// Each block is one sweep over the statevector.
+typedef enum {
+  QVM_BLOCK_1Q, // 2x2 unitary on q0
+  QVM_BLOCK_2Q, // 4x4 unitary on (q0, q1), q0 < q1
+  QVM_BLOCK_OP  // MEASURE, CCX or a macro-op, executed as-is
+} qvm_block_kind_t;
+
+typedef struct {
+  qvm_block_kind_t kind;
+  int q0;
+  int q1;
+  double _Complex u2[2][2];
+  double _Complex u4[4][4]; // Basis index 2*bit(q1) + bit(q0)
+  qvm_gate_t op;
+  int num_source_gates; // Circuit gates merged into this block
+} qvm_fused_block_t;
+
+typedef struct {
+  int num_qubits;
+  int num_source_gates;
+  int num_blocks;
+  qvm_fused_block_t *blocks;
+} qvm_fused_program_t;
+
+// Cache-blocked schedule of a fused program (see qvm_tile.c). Blocks are
+// copied onto physical qubits; SWAP steps change which logical qubits sit
+// below tile_qubits, and the plan ends in the logical order.
+typedef enum {
+  QVM_STEP_TILE,  // blocks[first, first + count), one tile at a time
+  QVM_STEP_SWEEP, // blocks[first] over the whole statevector
+  QVM_STEP_SWAP   // Exchange physical qubits q0 < q1
+} qvm_step_kind_t;
+
+typedef struct {
+  qvm_step_kind_t kind;
+  int first;
+  int count;
+  int q0;
+  int q1;
+} qvm_tile_step_t;
+
+typedef struct {
+  int num_qubits;
+  int tile_qubits; // Tiles of 2^tile_qubits amplitudes
+  int num_source_gates;
+  int num_steps;
+  int num_blocks;
+  qvm_tile_step_t *steps;
+  qvm_fused_block_t *blocks;
+  double passes; // Statevector passes: 1 per tile group or sweep, 1/2 swap
+} qvm_tile_plan_t;
+
 // QVM API
 void qvm_init(qvm_state_t *state, int num_qubits);
+void qvm_init_backend(qvm_state_t *state, int num_qubits,
+                      qvm_backend_t backend);
+void qvm_init_precision(qvm_state_t *state, int num_qubits,
+                        qvm_precision_t precision);
+// Copy of a statevector of either precision, in RAM or out of core,
+// widened to double (2^n amplitudes); -1 for other backends
+int qvm_get_amplitudes(const qvm_state_t *state, double _Complex *out);
+// Back to |0...0> without reallocating (statevector)
+void qvm_reset(qvm_state_t *state);
+// Cheapest backend able to run the circuit exactly
+qvm_backend_t qvm_select_backend(const qvm_circuit_t *circuit);
+int qvm_circuit_is_clifford(const qvm_circuit_t *circuit);
 void qvm_free(qvm_state_t *state);
-void qvm_apply_gate(qvm_state_t *state, qvm_gate_t *gate);
+// 0, or -1 if the gate is invalid or the backend cannot apply it
+int qvm_apply_gate(qvm_state_t *state, qvm_gate_t *gate);
 void qvm_measure(qvm_state_t *state, int qubit);
-void qvm_execute_circuit(qvm_state_t *state, qvm_circuit_t *circuit);
+// P(0) and P(1) of one statevector qubit, without collapsing it
+void qvm_qubit_probs(qvm_state_t *state, int qubit, double probs[2]);
+void qvm_apply_matrix(qvm_state_t *state, int target,
+                      const double _Complex m[2][2]);
+void qvm_apply_matrix2(qvm_state_t *state, int q0, int q1,
+                       const double _Complex m[4][4]);
+int qvm_gate_matrix(qvm_gate_type_t type, double _Complex m[2][2]);
+// 2x2 of a 1-qubit gate, rotations included; -1 for other gates
+int qvm_gate_unitary(const qvm_gate_t *gate, double _Complex m[2][2]);
+// 4x4 of a 2-qubit gate on the pair (q0, other), basis 2*bit(other) +
+// bit(q0); -1 if the gate is not a 2-qubit gate
+int qvm_gate_matrix2(const qvm_gate_t *gate, int q0, double _Complex m[4][4]);
+
+// Diagonal and permutation gates skip the matrix sweeps: a phase touches
+// only the amplitudes it changes, a permutation only moves them.
+typedef enum {
+  QVM_FORM_PHASE,  // amps[i] *= d[1] where every `mask` bit of i is set
+  QVM_FORM_DIAG,   // amps[i] *= d[parity of (i & mask)]
+  QVM_FORM_PERMUTE // Swap amps[i], amps[i ^ flip] where i & mask == set
+} qvm_form_kind_t;
+
+typedef struct {
+  qvm_form_kind_t kind;
+  uint64_t mask;
+  uint64_t set;
+  uint64_t flip;
+  double _Complex d[2];
+} qvm_gate_form_t;
+
+// Fast form of a diagonal or permutation gate (Z, S, T, RZ, CZ, CPHASE,
+// RZZ, X, CNOT, SWAP, CCX); -1 for the others
+int qvm_gate_form(const qvm_gate_t *gate, qvm_gate_form_t *form);
+// Statevector sweep of a form; mask bits must be in range and non-zero
+void qvm_apply_form(qvm_state_t *state, const qvm_gate_form_t *form);
+// Statevector sweep of one unitary gate through its fastest kernel, with
+// no noise or telemetry; -1 if the gate has no unitary
+int qvm_apply_unitary(qvm_state_t *state, const qvm_gate_t *gate);
+// Multi-controlled gates, controls given as a qubit bitmask
+void qvm_apply_mcx(qvm_state_t *state, uint64_t controls, int target);
+// Phase on the amplitudes where every qubit of `qubits` is 1 (Z, CZ, CCZ...)
+void qvm_apply_mcphase(qvm_state_t *state, uint64_t qubits,
+                       double _Complex phase);
+// Macro-ops on the statevector qubits first..last (see qvm_macro.c): the
+// QFT (inverse != 0: IQFT) in m + 1 passes, diffusion in two
+void qvm_apply_qft(qvm_state_t *state, int first, int last, int inverse);
+void qvm_apply_diffusion(qvm_state_t *state, int first, int last);
+// num_threads: worker count for gate sweeps (0 = keep current setting).
+// Stops at the first gate that fails and returns -1.
+int qvm_execute_circuit(qvm_state_t *state, qvm_circuit_t *circuit,
+                        int num_threads);
+// Fills a fresh circuit; free it with qvm_circuit_free() before reuse
 int qvm_parse_circuit(const char *circuit_text, qvm_circuit_t *circuit);
+void qvm_circuit_init(qvm_circuit_t *circuit, int num_qubits);
+int qvm_circuit_append(qvm_circuit_t *circuit, const qvm_gate_t *gate);
+void qvm_circuit_free(qvm_circuit_t *circuit);
+// Make angle `slot` of gate `gate` depend on parameter `symbol`
+int qvm_circuit_add_angle(qvm_circuit_t *circuit, int gate, int slot,
+                          int symbol, double scale, double offset);
+// Evaluate every symbolic angle for `params` (at least num_params values)
+// into the gates; the circuit is not parsed again
+int qvm_bind_parameters(qvm_circuit_t *circuit, const double *params,
+                        int num_params);
+// Bind, reset the statevector to |0...0> and run the circuit without
+// logging. Gate matrices are computed once per binding, in the fused
+// program.
+int qvm_execute_bound(qvm_state_t *state, qvm_circuit_t *circuit,
+                      const double *params, int num_params);
+// Parse-and-execute: the QUBITS directive initializes `state` as a
+// statevector, then gates run in windows of QVM_STREAM_WINDOW as they are
+// read. Returns the number of gates executed, -1 on error.
+long qvm_execute_stream(qvm_stream_read_t read, void *ctx,
+                        qvm_state_t *state);
 void qvm_print_state(qvm_state_t *state);
 
-// Userspace helper
+// Compiled circuits (.qcb, see qvm_qcb.c)
+#define QVM_QCB_VERSION 3
+#define QVM_QCB_HEADER_SIZE 40
+uint64_t qvm_qcb_hash(const void *data, size_t size);
+// Parse circuit text and encode it, tagged with the hash of the text
+int qvm_compile(const char *circuit_text, void **out, size_t *out_size);
+int qvm_qcb_encode(const qvm_circuit_t *circuit, uint64_t source_hash,
+                   void **out, size_t *out_size);
+// Validates and decodes without parsing. The gates may point into `data`,
+// which must then outlive the circuit.
+int qvm_qcb_load(const void *data, size_t size, qvm_circuit_t *circuit);
+// Hash of the source text; 0 if the buffer is not a valid .qcb
+uint64_t qvm_qcb_source_hash(const void *data, size_t size);
+int qvm_qcb_save(const char *path, const void *qcb, size_t size);
+void *qvm_qcb_map(const char *path, size_t *size); // Read-only mmap
+void qvm_qcb_unmap(void *qcb, size_t size);
+
+// Gate fusion
+int qvm_fuse_circuit(const qvm_circuit_t *circuit, qvm_fused_program_t *prog);
+void qvm_execute_fused(qvm_state_t *state, const qvm_fused_program_t *prog);
+void qvm_fused_free(qvm_fused_program_t *prog);
+double qvm_fusion_ratio(const qvm_fused_program_t *prog);
+// One block as a statevector sweep
+void qvm_execute_block(qvm_state_t *state, const qvm_fused_block_t *block);
+
+// Cache blocking. qvm_execute_fused() tiles statevectors wider than
+// qvm_tile_qubits(); the width defaults to half of L2 ($QVM_TILE_QUBITS).
+// tile_qubits: 0 = from L2, -1 = never tile
+void qvm_tile_configure(int tile_qubits);
+// Tile width for an n-qubit statevector, 0 if it should not be tiled
+int qvm_tile_qubits(int num_qubits);
+int qvm_tile_plan(const qvm_fused_program_t *prog, int tile_qubits,
+                  qvm_tile_plan_t *plan);
+void qvm_execute_tiled(qvm_state_t *state, const qvm_tile_plan_t *plan);
+void qvm_tile_plan_free(qvm_tile_plan_t *plan);
+// Amplitude bytes read and written by the plan's passes
+double qvm_tile_bytes(const qvm_tile_plan_t *plan);
+
+// Compiled circuit unitaries (see qvm_unitary.c)
+typedef struct {
+  int num_qubits;
+  int num_gates;           // Gates of the source circuit
+  uint64_t hash;           // qvm_circuit_hash() of the source circuit
+  double _Complex *matrix; // Row-major 2^k x 2^k: U[r][c] = matrix[r*2^k+c]
+  int refs;                // Cache references (see qvm_unitary_get)
+} qvm_unitary_t;
+
+typedef struct {
+  long hits;
+  long misses;
+  long evictions;
+  int entries;
+  size_t bytes; // Matrix memory held by the cache
+} qvm_unitary_cache_stats_t;
+
+// Hash of the qubit count and every gate, angles included
+uint64_t qvm_circuit_hash(const qvm_circuit_t *circuit);
+// Unitary of a circuit of at most QVM_UNITARY_MAX_QUBITS qubits with no
+// MEASURE; local bit j of U is circuit qubit j
+int qvm_compile_unitary(const qvm_circuit_t *circuit, qvm_unitary_t *out);
+void qvm_unitary_free(qvm_unitary_t *u);
+// U as one k-qubit gate on a statevector: local bit j is qubits[j]
+int qvm_apply_compiled(qvm_state_t *state, const qvm_unitary_t *u,
+                       const int *qubits);
+// Cached unitary of the circuit, compiled on a miss (NULL if it cannot
+// be); hand it back with qvm_unitary_release()
+const qvm_unitary_t *qvm_unitary_get(const qvm_circuit_t *circuit);
+void qvm_unitary_release(const qvm_unitary_t *u);
+// qvm_unitary_get + qvm_apply_compiled + qvm_unitary_release
+int qvm_apply_subcircuit(qvm_state_t *state, const qvm_circuit_t *circuit,
+                         const int *qubits);
+void qvm_unitary_cache_stats(qvm_unitary_cache_stats_t *out);
+// Drops every entry and zeroes the statistics
+void qvm_unitary_cache_clear(void);
+
+// Sampling (see qvm_sample.c)
+// Number of MEASURE gates, or -1 if a measured qubit is used afterwards.
+// *mask receives every measured qubit either way.
+int qvm_terminal_measurements(const qvm_circuit_t *circuit, uint64_t *mask);
+// Draw shots from |amp|^2 without collapsing the state (all qubits)
+int qvm_sample(qvm_state_t *state, int shots, qvm_counts_t *out_counts);
+// Run the unitary part of a circuit once, then sample its measured qubits
+int qvm_sample_circuit(qvm_state_t *state, const qvm_circuit_t *circuit,
+                       int shots, qvm_counts_t *out_counts);
+void qvm_counts_free(qvm_counts_t *counts);
+void qvm_counts_print(const qvm_counts_t *counts);
+// Measured bits of an outcome, most significant qubit first
+void qvm_counts_bitstring(const qvm_counts_t *counts, uint64_t outcome,
+                          char *buf, size_t len);
+// One-shot histogram from state->measured_bits (mid-circuit measurement
+// runs)
+int qvm_counts_from_measured(const qvm_state_t *state, uint64_t mask,
+                             qvm_counts_t *out_counts);
+// Counts of the last shell execution (NULL if none); qvis/qexport read it
+const qvm_counts_t *qvm_last_counts(void);
+// Replace the last-execution counts; takes ownership of the arrays
+void qvm_counts_record(qvm_counts_t *counts);
+
+// Matrix product state backend (see qvm_mps.c)
+typedef struct {
+  int max_bond;    // Largest bond dimension currently in the chain
+  size_t bytes;    // Memory held by the site tensors
+  double fidelity; // Estimated fidelity left after truncations
+} qvm_mps_stats_t;
+
+// Bond dimension cap and discarded-weight threshold of every 2-qubit
+// update (bond <= 0 / cutoff < 0 keep the current value)
+void qvm_mps_configure(int max_bond, double cutoff);
+int qvm_mps_stats(const qvm_state_t *state, qvm_mps_stats_t *out);
+// <P> for a Pauli string, one of I/X/Y/Z per qubit starting at qubit 0;
+// missing trailing qubits are I
+int qvm_mps_expectation(const qvm_state_t *state, const char *paulis,
+                        double *out);
+
+// Out-of-core statevector backend (see qvm_ooc.c)
+typedef struct {
+  int chunk_qubits;    // Qubits held in memory per chunk
+  long passes;         // Sweeps over the scratch file
+  long swaps;          // Passes that moved a qubit into the chunks
+  uint64_t bytes_read; // Amplitude traffic of the passes
+  uint64_t bytes_written;
+  double seconds; // Wall time of the passes
+  double io_wait; // Part of it spent waiting for chunk reads
+  double gbps;    // (bytes_read + bytes_written) / seconds, in GB/s
+} qvm_ooc_stats_t;
+
+// Scratch directory and chunk size of the next out-of-core states (NULL /
+// <= 0 keep the current value, initially $QVM_OOC_DIR and $QVM_OOC_CHUNK).
+// qvm_select_backend() only spills to disk while a directory is set; ""
+// unsets it.
+void qvm_ooc_configure(const char *dir, int chunk_qubits);
+int qvm_ooc_stats(const qvm_state_t *state, qvm_ooc_stats_t *out);
+
+// Sparse statevector backend (see qvm_sparse.c)
+typedef struct {
+  size_t support; // Non-zero amplitudes (at the last count while dense)
+  size_t peak;    // Largest support seen
+  int dense;      // Amplitudes currently held as a dense statevector
+  int switches;   // Sparse <-> dense conversions so far
+} qvm_sparse_stats_t;
+
+int qvm_sparse_stats(const qvm_state_t *state, qvm_sparse_stats_t *out);
+
+// Hybrid Schrödinger-Feynman simulation (see qvm_hsf.c): two half
+// statevectors per path, summed over the terms of the gates between them
+typedef struct {
+  int cut;             // Low half: qubits 0..cut-1; high half: cut..n-1
+  int cut_gates;       // Gates acting on both halves
+  uint64_t paths;      // Product of their Schmidt ranks
+  double cost;         // paths * (2^cut + 2^(n-cut)) amplitudes per gate
+  size_t sample_bytes; // Memory of qvm_hsf_sample()
+} qvm_hsf_stats_t;
+
+// Split of a circuit with terminal measurements only; cut = 0 picks the
+// cheapest. -1 if no split has both halves within QVM_MAX_QUBITS and every
+// macro-op on one side.
+int qvm_hsf_plan(const qvm_circuit_t *circuit, int cut, qvm_hsf_stats_t *out);
+// out[i] = <bitstrings[i]|U|0...0>, the sum over every path
+int qvm_hsf_amplitudes(const qvm_circuit_t *circuit, int cut,
+                       const uint64_t *bitstrings, int count,
+                       double _Complex *out);
+// The sum over paths first .. first+num-1 only (clipped to the path
+// count). Disjoint slices, e.g. one per worker process, add up to the
+// amplitudes.
+int qvm_hsf_amplitudes_paths(const qvm_circuit_t *circuit, int cut,
+                             uint64_t first, uint64_t num,
+                             const uint64_t *bitstrings, int count,
+                             double _Complex *out);
+// Shots of the measured qubits (all qubits without MEASURE gates)
+int qvm_hsf_sample(const qvm_circuit_t *circuit, int cut, int shots,
+                   qvm_counts_t *out_counts);
+
+// Statevector snapshots (see qvm_snapshot.c): refcounted amplitude pages,
+// with all-zero pages left out and unchanged pages shared with a base
+typedef struct qvm_snapshot_page qvm_snapshot_page_t;
+
+typedef struct {
+  int num_qubits;
+  int measured[QVM_MAX_QUBITS];
+  uint64_t measured_bits;
+  qvm_rng_t rng; // Restored too, so a replay draws the same outcomes
+  size_t num_pages;
+  qvm_snapshot_page_t **pages; // NULL entries are all-zero pages
+  size_t bytes;                // Page memory allocated by this snapshot
+} qvm_snapshot_t;
+
+// Snapshot of a statevector state (-1 for other backends). Pages equal to
+// those of `base` (NULL, or a snapshot of the same size) are shared.
+int qvm_snapshot_take(const qvm_state_t *state, const qvm_snapshot_t *base,
+                      qvm_snapshot_t *out);
+// Rewinds a statevector state of the same size; restoring into a fresh
+// qvm_init() state forks the snapshotted one
+int qvm_snapshot_restore(const qvm_snapshot_t *snap, qvm_state_t *state);
+// Returns the page memory released (pages no other snapshot still holds)
+size_t qvm_snapshot_free(qvm_snapshot_t *snap);
+
+// Monte-Carlo noise trajectories (see qvm_trajectory.c)
+typedef struct {
+  int max_trajectories;   // 0 = QVM_DEFAULT_SHOTS
+  int min_trajectories;   // Run at least this many before stopping early
+  double target_error;    // Stop once every standard error is below this
+                          // (0 = always run max_trajectories)
+  uint64_t seed;          // Trajectory i uses stream (seed, i); 0 = clock
+  const char *observable; // Pauli string (qubit 0 first), or NULL
+} qvm_traj_config_t;
+
+typedef struct {
+  int trajectories;
+  int converged;       // Stopped early on target_error
+  qvm_counts_t counts; // One shot per trajectory on the measured qubits
+  double counts_error; // Largest standard error of an outcome frequency
+  double expectation;  // Mean <observable> on the final states
+  double std_error;    // Standard error of that mean
+  double ci95;         // Half-width of its 95% confidence interval
+} qvm_traj_result_t;
+
+int qvm_run_trajectories(const qvm_circuit_t *circuit,
+                         const qvm_traj_config_t *config,
+                         qvm_traj_result_t *out);
+
+// Density-matrix backend (see qvm_density.c): element rho[row][col]
+double _Complex qvm_density_element(const qvm_state_t *state, size_t row,
+                                    size_t col);
+// tr(rho P) for a Pauli string, qubit 0 first
+int qvm_density_expectation(const qvm_state_t *state, const char *paulis,
+                            double *out);
+
+// Pauli expectation values (see qvm_expect.c) of statevector, MPS and
+// density states. Terms are Pauli strings, one of I/X/Y/Z per qubit
+// starting at qubit 0; terms sharing their X/Y qubits share a sweep.
+int qvm_expectation_terms(const qvm_state_t *state, const char *const *terms,
+                          int num_terms, double *values);
+// sum_k coeffs[k] <terms[k]> (coeffs NULL = all 1)
+int qvm_expectation(const qvm_state_t *state, const char *const *terms,
+                    const double *coeffs, int num_terms, double *out);
+
+// Gradients of <P> for a Pauli string P (see qvm_gradient.c)
+typedef enum {
+  QVM_GRAD_AUTO,    // Adjoint when noiseless and statevector-sized
+  QVM_GRAD_ADJOINT, // One forward and one backward statevector pass
+  QVM_GRAD_SHIFT    // Parameter shift: 2 runs per symbolic angle, any backend
+} qvm_grad_method_t;
+
+// Binds `params`, then stores <P> in *value and d<P>/dparams[k] in grad[k]
+// for every k < circuit->num_params. The circuit must not measure.
+int qvm_gradient(qvm_circuit_t *circuit, const double *params, int num_params,
+                 const char *observable, qvm_grad_method_t method,
+                 double *value, double *grad);
+
+// Batched execution (see qvm_batch.c)
+typedef struct {
+  int status;          // 0, or -1 if this circuit could not run
+  double expectation;  // <observable> of the final state (0 without one)
+  qvm_counts_t counts; // Terminal measurements, circuit SHOTS shots; empty
+                       // if the circuit does not measure
+} qvm_batch_result_t;
+
+// Runs n independent circuits without logging and fills results[i] for
+// circuits[i], in submission order. params[i] (params may be NULL for a
+// batch without symbolic angles) is bound into a private copy of the gates,
+// so the same circuit may be submitted with many bindings. Measurements
+// must be terminal; noisy runs use trajectories. observable is a Pauli
+// string (qubit 0 first) or NULL. Free each result's counts with
+// qvm_counts_free(). Returns the number of failed circuits.
+int qvm_execute_batch(const qvm_circuit_t *const *circuits,
+                      const double *const *params, qvm_batch_result_t *results,
+                      int n, const char *observable);
+
+// Worker pool (see qvm_threads.c); 0 = $QVM_THREADS or all online CPUs
+void qvm_threads_set(int num_threads);
+int qvm_threads_get(void);
+
+// Random numbers (see qvm_rng.c). Streams are grouped in families so ids
+// handed out to different users never collide.
+#define QVM_RNG_STATES ((uint64_t)1 << 56)       // One per qvm_state_t
+#define QVM_RNG_THREADS ((uint64_t)2 << 56)      // qvm_rng_thread()
+#define QVM_RNG_TRAJECTORIES ((uint64_t)3 << 56) // Trajectory i of a run
+
+// Global seed of every stream below (0 = $QVM_SEED, else clock and pid).
+// Also restarts stream allocation, so the same seed and the same sequence
+// of calls reproduce a run exactly.
+void qvm_rng_seed(uint64_t seed);
+uint64_t qvm_rng_get_seed(void);
+// Reserve `count` consecutive stream ids of a family; returns the first
+uint64_t qvm_rng_streams(uint64_t family, uint64_t count);
+void qvm_rng_init(qvm_rng_t *rng, uint64_t seed, uint64_t stream);
+uint64_t qvm_rng_next(qvm_rng_t *rng);
+// Uniform in (0, 1) with 53 random bits; never exactly 0 or 1
+double qvm_rng_uniform(qvm_rng_t *rng);
+// Uniform integer in [0, n)
+uint32_t qvm_rng_below(qvm_rng_t *rng, uint32_t n);
+// Bulk draws, the same values as repeated qvm_rng_uniform/qvm_rng_next;
+// long fills are split across the worker pool
+void qvm_rng_fill_uniform(qvm_rng_t *rng, double *out, size_t n);
+void qvm_rng_fill_bits(qvm_rng_t *rng, uint64_t *out, size_t words);
+// Stream of a state, seeded from the global seed on first use
+qvm_rng_t *qvm_state_rng(qvm_state_t *state);
+// Stream of the calling thread, for code with no state at hand
+qvm_rng_t *qvm_rng_thread(void);
+
+// Userspace helpers
 void qvm_execute_from_text(const char *circuit_text);
+// Runs `cached` (a .qcb) when it was compiled from this exact text;
+// otherwise parses the text, runs it and returns a fresh .qcb in
+// *compiled (caller frees) for the caller to store
+void qvm_execute_cached(const char *circuit_text, const void *cached,
+                        size_t cached_size, void **compiled,
+                        size_t *compiled_size);
 
 #endif // _QVM_H_
@@ -0,0 +1,88 @@
+/*
+ * NexusQ-AI - QVM Simulation Backends
+ * File: modules/quantum/include/qvm_backend.h
+ *
+ * Non-statevector representations plugged in behind qvm_state_t. qvm.c
+ * looks up the table from state->backend and forwards qvm_apply_gate,
+ * qvm_measure, qvm_sample, qvm_print_state and qvm_free to it.
+ */
+
+#ifndef _QVM_BACKEND_H_
+#define _QVM_BACKEND_H_
+
+#include "qvm.h"
+
+typedef struct {
+  const char *name;
+  int max_qubits;
+  // Allocate state->backend_state for |0...0>; -1 on failure
+  int (*init)(qvm_state_t *state, int num_qubits);
+  void (*free)(qvm_state_t *state);
+  // Gate is already validated against num_qubits; -1 if unsupported
+  int (*apply_gate)(qvm_state_t *state, const qvm_gate_t *gate);
+  // Collapse and return the outcome
+  int (*measure)(qvm_state_t *state, int qubit);
+  // Shots over the qubits in mask, without disturbing the state
+  int (*sample)(qvm_state_t *state, int shots, uint64_t mask,
+                qvm_counts_t *out_counts);
+  void (*print)(const qvm_state_t *state);
+} qvm_backend_ops_t;
+
+extern const qvm_backend_ops_t qvm_backend_stabilizer;
+extern const qvm_backend_ops_t qvm_backend_mps;
+extern const qvm_backend_ops_t qvm_backend_density;
+extern const qvm_backend_ops_t qvm_backend_single;
+extern const qvm_backend_ops_t qvm_backend_ooc;
+extern const qvm_backend_ops_t qvm_backend_sparse;
+
+// Table for state->backend; NULL for the built-in statevector
+const qvm_backend_ops_t *qvm_backend_ops(const qvm_state_t *state);
+// CCX as 1- and 2-qubit gates through ops->apply_gate, for backends
+// without a native 3-qubit gate
+int qvm_backend_ccx(qvm_state_t *state, const qvm_backend_ops_t *ops,
+                    const qvm_gate_t *gate);
+// QFT, IQFT and DIFFUSE (up to QVM_BACKEND_DIFFUSE_MAX qubits) as gate
+// sequences through ops->apply_gate (see qvm_macro.c)
+#define QVM_BACKEND_DIFFUSE_MAX 3
+int qvm_backend_macro(qvm_state_t *state, const qvm_backend_ops_t *ops,
+                      const qvm_gate_t *gate);
+// ops->apply_gate, falling back to qvm_backend_macro for range gates the
+// backend does not run itself
+int qvm_backend_apply(qvm_state_t *state, const qvm_backend_ops_t *ops,
+                      const qvm_gate_t *gate);
+
+// 2^n amplitudes of amp_bytes each fit in physical memory
+int qvm_state_fits(int num_qubits, size_t amp_bytes);
+
+// Scratch directory of out-of-core states, NULL if none is configured
+const char *qvm_ooc_dir(void);
+// Copy of the out-of-core amplitudes in logical qubit order (2^n)
+int qvm_ooc_read(qvm_state_t *state, double _Complex *out);
+// Copy of the sparse backend's amplitudes, zeros included (2^n)
+int qvm_sparse_read(const qvm_state_t *state, double _Complex *out);
+
+// shots sorted uniforms in [0, total), in O(shots)
+void qvm_sorted_uniforms(qvm_rng_t *rng, double *u, int shots, double total);
+// Build counts from one outcome per shot (sorts outcomes in place)
+int qvm_counts_from_outcomes(uint64_t *outcomes, int shots, int num_qubits,
+                             uint64_t mask, qvm_counts_t *out_counts);
+// Draw shots from the evolved state, restricted to the qubits in `mask`
+int qvm_sample_marginal(qvm_state_t *state, int shots, uint64_t mask,
+                        qvm_counts_t *out_counts);
+// Same, from 2^n complex-float amplitudes (see qvm_single.c)
+int qvm_sample_f32(qvm_state_t *state, const float _Complex *amps, int shots,
+                   uint64_t mask, qvm_counts_t *out_counts);
+
+// Pauli string as bit masks (see qvm_expect.c)
+typedef struct {
+  uint64_t x;  // Qubits with X or Y
+  uint64_t z;  // Qubits with Z or Y
+  int y_count; // Global factor i^y_count
+} qvm_pauli_t;
+
+// One of I/X/Y/Z per qubit, qubit 0 first; -1 past num_qubits or qubit 63
+int qvm_pauli_parse(const char *paulis, int num_qubits, qvm_pauli_t *p);
+// <psi|P|psi> of a statevector, one parallel sweep
+double qvm_pauli_expectation(const qvm_state_t *state, const qvm_pauli_t *p);
+
+#endif // _QVM_BACKEND_H_
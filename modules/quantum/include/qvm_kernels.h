@@ -0,0 +1,100 @@
+/*
+ * NexusQ-AI - QVM Amplitude Kernels
+ * File: modules/quantum/include/qvm_kernels.h
+ *
+ * Per-ISA statevector kernels (scalar, AVX2, AVX-512). The active table is
+ * chosen once from CPUID at the first qvm_init() and used by qvm.c for every
+ * gate, probability reduction and collapse. Each table points to the
+ * single-precision kernels of the same ISA (see qvm_single.c).
+ */
+
+#ifndef _QVM_KERNELS_H_
+#define _QVM_KERNELS_H_
+
+#include <complex.h>
+#include <stddef.h>
+
+// Work is expressed as ranges so callers can split a sweep into chunks:
+//  - apply_2x2 / probs / collapse take pair indices [pb, pe) out of the
+//    2^(n-1) (i0, i1) pairs of the target qubit.
+//  - apply_ctrl_2x2 takes quarter indices [qb, qe) out of the 2^(n-2)
+//    pairs whose control bit is set.
+//  - apply_4x4 takes quarter indices [qb, qe) out of the 2^(n-2) groups
+//    of four amplitudes spanned by qubits q0 < q1. Local basis order is
+//    (bit q1, bit q0): m[l'][l] with l = 2*b1 + b0.
+//  - phase takes [kb, ke) out of the 2^(n-popcount(mask)) amplitudes
+//    whose mask bits are all set; diag takes amplitude indices [ib, ie).
+//  - permute takes [kb, ke) out of the 2^(n-popcount(fixed)) amplitudes
+//    whose fixed bits equal `set`.
+//  - norms takes amplitude indices [ib, ie).
+// The single-precision table takes the same ranges over complex float
+// amplitudes. Matrices and scales stay double and are rounded once per
+// call; probabilities are accumulated in double.
+typedef struct {
+  const char *name;
+  void (*apply_2x2)(float _Complex *amps, int target, size_t pb, size_t pe,
+                    const double _Complex m[2][2]);
+  void (*apply_ctrl_2x2)(float _Complex *amps, int control, int target,
+                         size_t qb, size_t qe, const double _Complex m[2][2]);
+  void (*apply_4x4)(float _Complex *amps, int q0, int q1, size_t qb,
+                    size_t qe, const double _Complex m[4][4]);
+  void (*probs)(const float _Complex *amps, int target, size_t pb, size_t pe,
+                double out[2]);
+  void (*collapse)(float _Complex *amps, int target, size_t pb, size_t pe,
+                   int result, double scale);
+  void (*phase)(float _Complex *amps, size_t mask, size_t kb, size_t ke,
+                double _Complex ph);
+  void (*diag)(float _Complex *amps, size_t mask, size_t ib, size_t ie,
+               const double _Complex d[2]);
+  void (*permute)(float _Complex *amps, size_t fixed, size_t set, size_t flip,
+                  size_t kb, size_t ke);
+  void (*norms)(const float _Complex *amps, size_t mask, size_t ib, size_t ie,
+                double *out);
+} qvm_kernel_f32_ops_t;
+
+typedef struct {
+  const char *name;
+  void (*apply_2x2)(double _Complex *amps, int target, size_t pb, size_t pe,
+                    const double _Complex m[2][2]);
+  void (*apply_ctrl_2x2)(double _Complex *amps, int control, int target,
+                         size_t qb, size_t qe, const double _Complex m[2][2]);
+  void (*apply_4x4)(double _Complex *amps, int q0, int q1, size_t qb,
+                    size_t qe, const double _Complex m[4][4]);
+  // out[0] += P(target=0), out[1] += P(target=1) over the pair range
+  void (*probs)(const double _Complex *amps, int target, size_t pb, size_t pe,
+                double out[2]);
+  // Zero the half that disagrees with result, scale the kept half
+  void (*collapse)(double _Complex *amps, int target, size_t pb, size_t pe,
+                   int result, double scale);
+  // amps[i] *= ph where every mask bit of i is set
+  void (*phase)(double _Complex *amps, size_t mask, size_t kb, size_t ke,
+                double _Complex ph);
+  // amps[i] *= d[parity of (i & mask)]
+  void (*diag)(double _Complex *amps, size_t mask, size_t ib, size_t ie,
+               const double _Complex d[2]);
+  // Exchange amps[i] and amps[i ^ flip] (flip is a subset of fixed)
+  void (*permute)(double _Complex *amps, size_t fixed, size_t set,
+                  size_t flip, size_t kb, size_t ke);
+  // out[b] += |amps[i]|^2, b = the bits of i under mask packed from bit 0
+  // (a histogram of 2^popcount(mask) buckets)
+  void (*norms)(const double _Complex *amps, size_t mask, size_t ib,
+                size_t ie, double *out);
+  const qvm_kernel_f32_ops_t *f32; // Same ISA, complex float amplitudes
+} qvm_kernel_ops_t;
+
+extern const qvm_kernel_ops_t qvm_kernels_scalar;
+extern const qvm_kernel_ops_t qvm_kernels_avx2;
+extern const qvm_kernel_ops_t qvm_kernels_avx512;
+extern const qvm_kernel_f32_ops_t qvm_kernels_f32_scalar;
+extern const qvm_kernel_f32_ops_t qvm_kernels_f32_avx2;
+
+// Pick the best table for this CPU (idempotent)
+void qvm_kernels_select(void);
+
+// Active table (selects on first use)
+const qvm_kernel_ops_t *qvm_kernels_get(void);
+
+// Force a table by name ("scalar", "avx2", "avx512"); -1 if unsupported
+int qvm_kernels_force(const char *name);
+
+#endif // _QVM_KERNELS_H_
@@ -0,0 +1,250 @@
+/*
+ * NexusQ-AI - QVM Kernel Template
+ * File: modules/quantum/include/qvm_kernels_tmpl.h
+ *
+ * Range iteration shared by every ISA and precision. The including file
+ * defines the contiguous-run primitives below, includes this header once
+ * per ISA and precision and gets QK_FN(apply_2x2), QK_FN(apply_ctrl_2x2),
+ * QK_FN(apply_4x4), QK_FN(probs), QK_FN(collapse), QK_FN(phase),
+ * QK_FN(diag), QK_FN(permute) and QK_FN(norms) back. Permutations only
+ * move amplitudes, so their loop is written here once. No include guard on
+ * purpose.
+ *
+ *   QK_AMP                            amplitude type (default
+ *                                     double _Complex); matrices, scales
+ *                                     and sums stay double
+ *   QK_FN(name)                       suffixed function name
+ *   QK_RUN_2X2(lo, hi, n, m)          lo[k], hi[k] pairs, k < n
+ *   QK_ADJ_2X2(p, n, m)               p[2k], p[2k+1] pairs, k < n
+ *   QK_RUN_4X4(a, s0, s1, n, m)       groups a[k], a[k+s0], a[k+s1],
+ *                                     a[k+s0+s1], k < n
+ *   QK_NORM_RUN(p, n)                 sum |p[k]|^2, k < n
+ *   QK_ADJ_NORMS(p, n, out)           out[b] += sum |p[2k+b]|^2
+ *   QK_SCALE_RUN(p, n, s)             p[k] *= s
+ *   QK_ADJ_SCALE(p, n, s0, s1)        p[2k] *= s0, p[2k+1] *= s1
+ *   QK_PHASE_RUN(p, n, ph)            p[k] *= ph (complex)
+ */
+
+#ifndef QK_AMP
+#define QK_AMP double _Complex
+#endif
+
+// First amplitude index of pair p for the given target
+#define QK_PAIR_I0(p, target)                                                  \
+  ((((p) >> (target)) << ((target) + 1)) | ((p) & (((size_t)1 << (target)) - 1)))
+
+static void QK_FN(apply_2x2)(QK_AMP *amps, int target, size_t pb, size_t pe,
+                             const double _Complex m[2][2]) {
+  if (target == 0) {
+    QK_ADJ_2X2(amps + 2 * pb, pe - pb, m);
+    return;
+  }
+
+  size_t stride = (size_t)1 << target;
+  size_t p = pb;
+  while (p < pe) {
+    size_t k = p & (stride - 1);
+    size_t run = stride - k;
+    if (run > pe - p)
+      run = pe - p;
+    QK_AMP *lo = amps + QK_PAIR_I0(p, target);
+    QK_RUN_2X2(lo, lo + stride, run, m);
+    p += run;
+  }
+}
+
+// Quarter index q enumerates the pairs (in target pair space) whose control
+// bit is set; consecutive q map to runs of consecutive pairs.
+static void QK_FN(apply_ctrl_2x2)(QK_AMP *amps, int control, int target,
+                                  size_t qb, size_t qe,
+                                  const double _Complex m[2][2]) {
+  int cbit = control < target ? control : control - 1;
+  size_t run_len = (size_t)1 << cbit;
+  size_t q = qb;
+  while (q < qe) {
+    size_t k = q & (run_len - 1);
+    size_t run = run_len - k;
+    if (run > qe - q)
+      run = qe - q;
+    size_t p = ((q >> cbit) << (cbit + 1)) | run_len | k;
+    QK_FN(apply_2x2)(amps, target, p, p + run, m);
+    q += run;
+  }
+}
+
+// Quarter index q: insert zero bits at q0 and q1 (q0 < q1). Consecutive q
+// are contiguous for 2^q0 steps.
+static void QK_FN(apply_4x4)(QK_AMP *amps, int q0, int q1, size_t qb, size_t qe,
+                             const double _Complex m[4][4]) {
+  size_t s0 = (size_t)1 << q0, s1 = (size_t)1 << q1;
+  size_t q = qb;
+  while (q < qe) {
+    size_t k = q & (s0 - 1);
+    size_t run = s0 - k;
+    if (run > qe - q)
+      run = qe - q;
+    size_t base = QK_PAIR_I0(q, q0); // zero at q0
+    base = QK_PAIR_I0(base, q1);     // zero at q1
+    QK_RUN_4X4(amps + base, s0, s1, run, m);
+    q += run;
+  }
+}
+
+static void QK_FN(probs)(const QK_AMP *amps, int target, size_t pb, size_t pe,
+                         double out[2]) {
+  if (target == 0) {
+    QK_ADJ_NORMS(amps + 2 * pb, pe - pb, out);
+    return;
+  }
+
+  size_t stride = (size_t)1 << target;
+  size_t p = pb;
+  while (p < pe) {
+    size_t k = p & (stride - 1);
+    size_t run = stride - k;
+    if (run > pe - p)
+      run = pe - p;
+    const QK_AMP *lo = amps + QK_PAIR_I0(p, target);
+    out[0] += QK_NORM_RUN(lo, run);
+    out[1] += QK_NORM_RUN(lo + stride, run);
+    p += run;
+  }
+}
+
+static void QK_FN(collapse)(QK_AMP *amps, int target, size_t pb, size_t pe,
+                            int result, double scale) {
+  double s0 = result ? 0.0 : scale;
+  double s1 = result ? scale : 0.0;
+
+  if (target == 0) {
+    QK_ADJ_SCALE(amps + 2 * pb, pe - pb, s0, s1);
+    return;
+  }
+
+  size_t stride = (size_t)1 << target;
+  size_t p = pb;
+  while (p < pe) {
+    size_t k = p & (stride - 1);
+    size_t run = stride - k;
+    if (run > pe - p)
+      run = pe - p;
+    QK_AMP *lo = amps + QK_PAIR_I0(p, target);
+    QK_SCALE_RUN(lo, run, s0);
+    QK_SCALE_RUN(lo + stride, run, s1);
+    p += run;
+  }
+}
+
+// Index k with a zero bit inserted at every set bit of `fixed`, lowest
+// first, so that consecutive k are contiguous for 2^(lowest fixed bit)
+static inline size_t QK_FN(spread)(size_t k, size_t fixed) {
+  while (fixed) {
+    size_t low = fixed & -fixed;
+    k = ((k & ~(low - 1)) << 1) | (k & (low - 1));
+    fixed &= fixed - 1;
+  }
+  return k;
+}
+
+static void QK_FN(phase)(QK_AMP *amps, size_t mask, size_t kb, size_t ke,
+                         double _Complex ph) {
+  size_t run_len = mask & -mask;
+  size_t k = kb;
+  while (k < ke) {
+    size_t run = run_len - (k & (run_len - 1));
+    if (run > ke - k)
+      run = ke - k;
+    QK_PHASE_RUN(amps + (QK_FN(spread)(k, mask) | mask), run, ph);
+    k += run;
+  }
+}
+
+// The parity of i & mask is constant for 2^(lowest mask bit) indices
+static void QK_FN(diag)(QK_AMP *amps, size_t mask, size_t ib, size_t ie,
+                        const double _Complex d[2]) {
+  size_t run_len = mask & -mask;
+  size_t i = ib;
+  while (i < ie) {
+    size_t run = run_len - (i & (run_len - 1));
+    if (run > ie - i)
+      run = ie - i;
+    QK_PHASE_RUN(amps + i, run, d[__builtin_parityll(i & mask)]);
+    i += run;
+  }
+}
+
+// The partner i ^ flip has different fixed bits, so it is never visited
+// itself and every pair is exchanged exactly once.
+static void QK_FN(permute)(QK_AMP *amps, size_t fixed, size_t set,
+                           size_t flip, size_t kb, size_t ke) {
+  size_t run_len = fixed & -fixed;
+  size_t k = kb;
+  while (k < ke) {
+    size_t run = run_len - (k & (run_len - 1));
+    if (run > ke - k)
+      run = ke - k;
+    size_t i = QK_FN(spread)(k, fixed) | set;
+    QK_AMP *restrict a = amps + i, *restrict b = amps + (i ^ flip);
+    for (size_t j = 0; j < run; j++) {
+      QK_AMP t = a[j];
+      a[j] = b[j];
+      b[j] = t;
+    }
+    k += run;
+  }
+}
+
+// Bits of i at the set bits of mask, packed from bit 0 up
+static inline size_t QK_FN(gather)(size_t i, size_t mask) {
+  size_t out = 0;
+  for (size_t bit = 1; mask; mask &= mask - 1, bit <<= 1)
+    if (i & mask & -mask)
+      out |= bit;
+  return out;
+}
+
+// Runs of 2^(lowest mask bit) amplitudes share a bucket. Shorter runs are
+// read in aligned blocks of 8: the 8 positions are summed separately over
+// every block up to the next change of the mask bits above the block, and
+// each sum goes to the bucket its position maps to.
+static void QK_FN(norms)(const QK_AMP *amps, size_t mask, size_t ib,
+                         size_t ie, double *out) {
+  size_t run_len = mask & -mask;
+  if (mask == 0 || run_len >= 8) {
+    size_t i = ib;
+    while (i < ie) {
+      size_t run = mask ? run_len - (i & (run_len - 1)) : ie - i;
+      if (run > ie - i)
+        run = ie - i;
+      out[QK_FN(gather)(i, mask)] += QK_NORM_RUN(amps + i, run);
+      i += run;
+    }
+    return;
+  }
+
+  size_t high = mask & ~(size_t)7, span = high & -high, low[8];
+  for (size_t j = 0; j < 8; j++)
+    low[j] = QK_FN(gather)(j, mask & 7);
+  size_t i = ib;
+  while (i < ie) {
+    if ((i & 7) || ie - i < 8) { // Unaligned head or tail
+      out[QK_FN(gather)(i, mask)] += creal(amps[i]) * creal(amps[i]) +
+                                     cimag(amps[i]) * cimag(amps[i]);
+      i++;
+      continue;
+    }
+    size_t end = span ? (i | (span - 1)) + 1 : ie;
+    if (end > ie)
+      end = ie & ~(size_t)7;
+    double *bucket = out + QK_FN(gather)(i, mask), sum[8] = {0};
+    for (; i < end; i += 8)
+      for (size_t j = 0; j < 8; j++)
+        sum[j] += creal(amps[i + j]) * creal(amps[i + j]) +
+                  cimag(amps[i + j]) * cimag(amps[i + j]);
+    for (size_t j = 0; j < 8; j++)
+      bucket[low[j]] += sum[j];
+  }
+}
+
+#undef QK_PAIR_I0
+#undef QK_AMP
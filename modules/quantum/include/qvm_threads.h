@@ -0,0 +1,35 @@
+/*
+ * NexusQ-AI - QVM Worker Pool
+ * File: modules/quantum/include/qvm_threads.h
+ *
+ * Persistent pthread pool used to split statevector sweeps across cores.
+ */
+
+#ifndef _QVM_THREADS_H_
+#define _QVM_THREADS_H_
+
+#include "qvm.h"
+#include <stddef.h>
+
+// Body of a parallel loop: process items [begin, end) of chunk number
+// `chunk`. Chunks are numbered in order, so per-chunk partial results can
+// be reduced deterministically regardless of which worker ran them.
+typedef void (*qvm_range_fn)(void *ctx, size_t chunk, size_t begin,
+                             size_t end);
+
+// Upper bound on chunks for reductions, so partial sums fit on the stack
+#define QVM_REDUCE_CHUNKS 4096
+
+// qvm_threads_set()/qvm_threads_get() are public, see qvm.h
+
+// Items per chunk so one chunk's working set fits in half of L2
+size_t qvm_threads_grain(size_t bytes_per_item);
+
+// Number of chunks qvm_parallel_for will use for (n, grain)
+size_t qvm_parallel_chunks(size_t n, size_t grain);
+
+// Run fn over [0, n) in chunks of `grain` items. Small loops (a single
+// chunk) and single-threaded pools run inline on the caller.
+void qvm_parallel_for(size_t n, size_t grain, qvm_range_fn fn, void *ctx);
+
+#endif // _QVM_THREADS_H_
@@ -1,11 +1,23 @@
 /*
  * NexusQ-AI - Quantum Noise Models
  * File: modules/quantum/noise.c
+ *
+ * Each noise type is a single-qubit Kraus channel applied after every gate
+ * to the qubits it touched:
+ *  - density-matrix states get the exact channel, fused into the gate's
+ *    superoperator by the backend itself (see qvm_density.c);
+ *  - statevectors follow one quantum trajectory: a Kraus operator is drawn
+ *    with probability ||K psi||^2 and applied, renormalized. Draws come
+ *    from the state's own random stream (a trajectory seeds it per run).
+ * Readout errors do not touch the state: they flip reported measurement
+ * outcomes instead.
  */
 
 #include "include/qvm.h"
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 // Noise Configuration
 static float global_noise_prob = 0.0;
@@ -15,14 +27,16 @@ typedef enum {
   NOISE_NONE = 0,
   NOISE_BIT_FLIP,
   NOISE_PHASE_FLIP,
-  NOISE_DEPOLARIZING
+  NOISE_DEPOLARIZING,
+  NOISE_AMPLITUDE_DAMPING,
+  NOISE_READOUT
 } noise_type_t;
 
 static noise_type_t current_noise_type = NOISE_NONE;
 
 // Set noise parameters
 void qnoise_set(int type, float probability) {
-  if (type < 0 || type > 3)
+  if (type < 0 || type > NOISE_READOUT)
     return;
   if (probability < 0.0f || probability > 1.0f)
     return;
@@ -34,52 +48,119 @@ void qnoise_set(int type, float probability) {
   printf("[QNOISE] Noise set to Type %d with P=%.4f\n", type, probability);
 }
 
-// Apply noise to a qubit state
-// Note: In a full density matrix sim, this would mix states.
-// In this wavefunction sim, we apply random unitary errors (Monte Carlo
-// wavefunction method).
-void qnoise_apply(qvm_circuit_t *ctx, int qubit_idx) {
-  if (!noise_enabled)
-    return;
+// Whether per-gate noise injection is active
+int qnoise_is_enabled() { return noise_enabled; }
 
-  // Generate random float 0.0 - 1.0
-  float r = (float)rand() / (float)RAND_MAX;
-
-  if (r < global_noise_prob) {
-    // Error occurred! Apply the error gate.
-    switch (current_noise_type) {
-    case NOISE_BIT_FLIP:
-      // Apply X gate
-      // We need to access the internal state directly or use a helper
-      // For simplicity, we'll just print it for this demo,
-      // as modifying the complex state requires math headers here.
-      // In a real implementation, we'd call qvm_apply_gate(ctx, GATE_X,
-      // qubit_idx); But to avoid circular deps/re-entrancy, we assume the
-      // caller handles it or we implement a lightweight X here.
-      printf("[QNOISE] Bit Flip error on Qubit %d\n", qubit_idx);
-      break;
+// Kraus operators of the configured channel; 0 when it leaves the state
+// alone (disabled, or readout-only)
+int qnoise_kraus(double _Complex k[4][2][2]) {
+  if (!noise_enabled || current_noise_type == NOISE_READOUT)
+    return 0;
 
-    case NOISE_PHASE_FLIP:
-      // Apply Z gate
-      printf("[QNOISE] Phase Flip error on Qubit %d\n", qubit_idx);
-      break;
+  double p = global_noise_prob;
+  memset(k, 0, 4 * sizeof(k[0]));
+  k[0][0][0] = k[0][1][1] = sqrt(1.0 - p);
 
-    case NOISE_DEPOLARIZING:
-      // Random X, Y, or Z
-      printf("[QNOISE] Depolarizing error on Qubit %d\n", qubit_idx);
-      break;
+  switch (current_noise_type) {
+  case NOISE_BIT_FLIP:
+    qvm_gate_matrix(GATE_X, k[1]);
+    break;
+  case NOISE_PHASE_FLIP:
+    qvm_gate_matrix(GATE_Z, k[1]);
+    break;
+  case NOISE_DEPOLARIZING:
+    qvm_gate_matrix(GATE_X, k[1]);
+    qvm_gate_matrix(GATE_Y, k[2]);
+    qvm_gate_matrix(GATE_Z, k[3]);
+    for (int i = 1; i < 4; i++)
+      for (int r = 0; r < 2; r++)
+        for (int c = 0; c < 2; c++)
+          k[i][r][c] *= sqrt(p / 3.0);
+    return 4;
+  case NOISE_AMPLITUDE_DAMPING:
+    // |1> decays to |0> with probability p
+    k[0][0][0] = 1.0;
+    k[1][0][1] = sqrt(p);
+    return 2;
+  default:
+    return 0;
+  }
+  for (int r = 0; r < 2; r++)
+    for (int c = 0; c < 2; c++)
+      k[1][r][c] *= sqrt(p);
+  return 2;
+}
+
+// Probability of flipping a reported measurement outcome
+double qnoise_readout_error() {
+  return noise_enabled && current_noise_type == NOISE_READOUT
+             ? global_noise_prob
+             : 0.0;
+}
+
+// Draw whether this readout is flipped, from the state's stream
+int qnoise_readout_flip(qvm_state_t *state) {
+  double p = qnoise_readout_error();
+  return p > 0.0 && qvm_rng_uniform(qvm_state_rng(state)) < p;
+}
 
-    default:
+// One trajectory step on a statevector. Every channel above has a
+// diagonal K^dagger K, so ||K psi||^2 only needs P(0) and P(1) of the qubit.
+static void trajectory_step(qvm_state_t *state, int qubit,
+                            double _Complex k[4][2][2], int count) {
+  double probs[2];
+  qvm_qubit_probs(state, qubit, probs);
+
+  double r = qvm_rng_uniform(qvm_state_rng(state)) * (probs[0] + probs[1]);
+  double w = 0.0;
+  int pick = count - 1;
+  for (int i = 0; i < count; i++) {
+    w = 0.0;
+    for (int b = 0; b < 2; b++)
+      w += (creal(k[i][0][b] * conj(k[i][0][b])) +
+            creal(k[i][1][b] * conj(k[i][1][b]))) *
+           probs[b];
+    if (r < w) {
+      pick = i;
       break;
     }
+    r -= w;
   }
+  if (w <= 0.0)
+    return;
+
+  // Scaled identity (no-error branch of a Pauli channel): nothing to do
+  double _Complex(*m)[2] = k[pick];
+  if (m[0][1] == 0.0 && m[1][0] == 0.0 && m[0][0] == m[1][1])
+    return;
+
+  double scale = 1.0 / sqrt(w);
+  double _Complex op[2][2] = {{m[0][0] * scale, m[0][1] * scale},
+                              {m[1][0] * scale, m[1][1] * scale}};
+  qvm_apply_matrix(state, qubit, op);
+}
+
+// Apply the configured channel to one qubit after a gate
+void qnoise_apply(qvm_state_t *state, int qubit_idx) {
+  double _Complex k[4][2][2];
+  int count = qnoise_kraus(k);
+  if (count == 0)
+    return;
+
+  // The density backend applies the channel with the gate; stabilizer,
+  // MPS and single-precision runs are noiseless (see qvm_select_backend)
+  if (state->backend == QVM_BACKEND_STATEVECTOR)
+    trajectory_step(state, qubit_idx, k, count);
 }
 
 // Get current noise info
 void qnoise_info() {
-  const char *names[] = {"None", "Bit Flip", "Phase Flip", "Depolarizing"};
+  const char *names[] = {"None",         "Bit Flip",          "Phase Flip",
+                         "Depolarizing", "Amplitude Damping", "Readout"};
   printf("--- Quantum Noise Configuration ---\n");
   printf("Type: %s\n", names[current_noise_type]);
   printf("Probability: %.4f\n", global_noise_prob);
   printf("Status: %s\n", noise_enabled ? "ACTIVE" : "DISABLED");
+  printf("Simulation: density matrix up to %d qubits, trajectories above\n",
+         QVM_DENSITY_MAX_QUBITS);
 }
@@ -3,6 +3,15 @@
  * File: modules/quantum/qdbg.c
  *
  * Interactive step-by-step quantum circuit debugger
+ *
+ * Execution moves both ways. Every checkpoint_interval gates the state is
+ * checkpointed as a page snapshot (see qvm_snapshot.c) sharing unchanged
+ * pages with the previous checkpoint; going back to gate g restores the
+ * nearest checkpoint at or before g and replays the few gates after it.
+ * When the checkpoints outgrow QDBG_SNAPSHOT_BUDGET the interval doubles
+ * and every other checkpoint is dropped, so memory stays bounded and a
+ * jump replays at most checkpoint_interval gates. Snapshots carry the
+ * state's RNG stream: measurements replay with the outcomes they had.
  */
 
 #include "include/qvm.h"
@@ -10,32 +19,145 @@
 #include <stdlib.h>
 #include <string.h>
 
+#define QDBG_SNAPSHOT_BUDGET ((size_t)64 << 20) // Checkpoint page memory
+
+// State before gate `gate` runs
+typedef struct {
+  int gate;
+  qvm_snapshot_t snap;
+} qdbg_checkpoint_t;
+
 // Debugger state
 typedef struct {
   qvm_circuit_t circuit;
   qvm_state_t state;
   int current_gate;
-  int breakpoints[QVM_MAX_GATES];
+  int *breakpoints; // Gate indices, grown like the circuit's gate buffer
   int num_breakpoints;
+  int breakpoint_capacity;
   int paused;
+  qdbg_checkpoint_t *checkpoints; // Sorted by gate
+  int num_checkpoints;
+  int checkpoint_capacity;
+  int checkpoint_interval; // Gates between checkpoints, a power of two
+  size_t checkpoint_bytes;
 } qdbg_session_t;
 
 static qdbg_session_t dbg_session;
 
+// --- Checkpoints ---
+
+static void checkpoints_free() {
+  for (int i = 0; i < dbg_session.num_checkpoints; i++)
+    qvm_snapshot_free(&dbg_session.checkpoints[i].snap);
+  free(dbg_session.checkpoints);
+  dbg_session.checkpoints = NULL;
+  dbg_session.num_checkpoints = 0;
+  dbg_session.checkpoint_capacity = 0;
+  dbg_session.checkpoint_interval = 1;
+  dbg_session.checkpoint_bytes = 0;
+}
+
+// Index of the last checkpoint at or before `gate`, or -1
+static int checkpoint_before(int gate) {
+  int found = -1;
+  for (int i = 0; i < dbg_session.num_checkpoints; i++)
+    if (dbg_session.checkpoints[i].gate <= gate)
+      found = i;
+  return found;
+}
+
+// Double the interval and drop the checkpoints off the new grid
+static void checkpoints_thin() {
+  int interval = 2 * dbg_session.checkpoint_interval, kept = 0;
+  for (int i = 0; i < dbg_session.num_checkpoints; i++) {
+    qdbg_checkpoint_t *cp = &dbg_session.checkpoints[i];
+    if (cp->gate % interval == 0)
+      dbg_session.checkpoints[kept++] = *cp;
+    else
+      dbg_session.checkpoint_bytes -= qvm_snapshot_free(&cp->snap);
+  }
+  dbg_session.num_checkpoints = kept;
+  dbg_session.checkpoint_interval = interval;
+}
+
+// Checkpoint the current state if it sits on the grid and has none yet
+static void checkpoint_take() {
+  int gate = dbg_session.current_gate;
+  if (gate % dbg_session.checkpoint_interval != 0)
+    return;
+  int at = checkpoint_before(gate);
+  if (at >= 0 && dbg_session.checkpoints[at].gate == gate)
+    return;
+
+  if (dbg_session.num_checkpoints == dbg_session.checkpoint_capacity) {
+    int capacity = dbg_session.checkpoint_capacity
+                       ? 2 * dbg_session.checkpoint_capacity
+                       : 16;
+    qdbg_checkpoint_t *grown = (qdbg_checkpoint_t *)realloc(
+        dbg_session.checkpoints, (size_t)capacity * sizeof(qdbg_checkpoint_t));
+    if (!grown)
+      return;
+    dbg_session.checkpoints = grown;
+    dbg_session.checkpoint_capacity = capacity;
+  }
+
+  qdbg_checkpoint_t cp = {gate};
+  if (qvm_snapshot_take(&dbg_session.state,
+                        at >= 0 ? &dbg_session.checkpoints[at].snap : NULL,
+                        &cp.snap) != 0)
+    return;
+  memmove(&dbg_session.checkpoints[at + 2], &dbg_session.checkpoints[at + 1],
+          (size_t)(dbg_session.num_checkpoints - at - 1) *
+              sizeof(qdbg_checkpoint_t));
+  dbg_session.checkpoints[at + 1] = cp;
+  dbg_session.num_checkpoints++;
+  dbg_session.checkpoint_bytes += cp.snap.bytes;
+
+  while (dbg_session.checkpoint_bytes > QDBG_SNAPSHOT_BUDGET &&
+         dbg_session.checkpoint_interval < dbg_session.circuit.num_gates)
+    checkpoints_thin();
+}
+
+// Run the current gate and checkpoint the state after it
+static void run_gate() {
+  qvm_apply_gate(&dbg_session.state,
+                 &dbg_session.circuit.gates[dbg_session.current_gate]);
+  dbg_session.current_gate++;
+  checkpoint_take();
+}
+
+// Bring the state to "before gate `target`", from the current state when
+// that is on the way, else from the nearest checkpoint
+static void seek(int target) {
+  int at = checkpoint_before(target);
+  int gate = at >= 0 ? dbg_session.checkpoints[at].gate : 0;
+  if (dbg_session.current_gate > target || gate > dbg_session.current_gate) {
+    if (at < 0 || qvm_snapshot_restore(&dbg_session.checkpoints[at].snap,
+                                       &dbg_session.state) != 0) {
+      qvm_reset(&dbg_session.state); // No checkpoint: replay from the start
+      gate = 0;
+    }
+    dbg_session.current_gate = gate;
+  }
+  while (dbg_session.current_gate < target)
+    run_gate();
+}
+
 // Print current state in readable format
 void qdbg_print_state(qvm_state_t *state) {
-  int size = 1 << state->num_qubits;
+  size_t size = (size_t)1 << state->num_qubits;
   printf("\n┌─── Quantum State ───┐\n");
 
   int shown = 0;
-  for (int i = 0; i < size && shown < 8; i++) {
-    double prob = cabs(state->amplitudes[i]) * cabs(state->amplitudes[i]);
+  for (size_t i = 0; i < size && shown < 8; i++) {
+    double _Complex amp = state->amplitudes[i];
+    double prob = creal(amp) * creal(amp) + cimag(amp) * cimag(amp);
     if (prob > 0.001) {
       printf("│ |");
       for (int j = state->num_qubits - 1; j >= 0; j--) {
-        printf("%d", (i >> j) & 1);
+        printf("%d", (int)((i >> j) & 1));
       }
-      double _Complex amp = state->amplitudes[i];
       printf("> : %.4f + %.4fi  (P=%.3f)\n", creal(amp), cimag(amp), prob);
       shown++;
     }
@@ -69,6 +191,43 @@ void qdbg_print_gate(qvm_gate_t *gate, int index) {
   case GATE_CNOT:
     printf("CNOT: control=%d, target=%d\n", gate->control, gate->target);
     break;
+  case GATE_CZ:
+    printf("CZ: control=%d, target=%d\n", gate->control, gate->target);
+    break;
+  case GATE_SWAP:
+    printf("SWAP qubits %d, %d\n", gate->control, gate->target);
+    break;
+  case GATE_RX:
+  case GATE_RY:
+  case GATE_RZ:
+    printf("R%c(%.4f) on qubit %d\n", "XYZ"[gate->type - GATE_RX],
+           gate->theta[0], gate->target);
+    break;
+  case GATE_U3:
+    printf("U3(%.4f, %.4f, %.4f) on qubit %d\n", gate->theta[0],
+           gate->theta[1], gate->theta[2], gate->target);
+    break;
+  case GATE_CPHASE:
+    printf("CPHASE(%.4f): control=%d, target=%d\n", gate->theta[0],
+           gate->control, gate->target);
+    break;
+  case GATE_RZZ:
+    printf("RZZ(%.4f) on qubits %d, %d\n", gate->theta[0], gate->control,
+           gate->target);
+    break;
+  case GATE_CCX:
+    printf("CCX: controls=%d, %d, target=%d\n", gate->control, gate->control2,
+           gate->target);
+    break;
+  case GATE_QFT:
+  case GATE_IQFT:
+  case GATE_DIFFUSE:
+    printf("%s on qubits %d..%d\n",
+           gate->type == GATE_QFT    ? "QFT"
+           : gate->type == GATE_IQFT ? "IQFT"
+                                     : "DIFFUSE",
+           gate->control, gate->target);
+    break;
   case GATE_MEASURE:
     printf("MEASURE qubit %d\n", gate->target);
     break;
@@ -82,10 +241,14 @@ void qdbg_help() {
   printf("\n┌─── QDebug Commands ───┐\n");
   printf("│ n, next    - Execute next gate\n");
   printf("│ c, cont    - Continue to end/breakpoint\n");
+  printf("│ p, prev    - Step back one gate\n");
+  printf("│ rc, rcont  - Continue backwards to a breakpoint\n");
+  printf("│ j <num>    - Jump to just before gate <num>\n");
   printf("│ s, state   - Show current quantum state\n");
   printf("│ g, gates   - List all gates\n");
   printf("│ b <num>    - Set breakpoint at gate <num>\n");
-  printf("│ r, restart - Restart from beginning\n");
+  printf("│ r, restart - Restart with fresh measurement draws\n");
+  printf("│ k, ckpt    - Show checkpoint memory\n");
   printf("│ h, help    - Show this help\n");
   printf("│ q, quit    - Exit debugger\n");
   printf("└───────────────────────┘\n");
@@ -94,6 +257,7 @@ void qdbg_help() {
 // Initialize debugger session
 int qdbg_init(const char *circuit_text) {
   // Parse circuit
+  qvm_circuit_free(&dbg_session.circuit);
   if (qvm_parse_circuit(circuit_text, &dbg_session.circuit) != 0) {
     printf("[QDBG] Failed to parse circuit\n");
     return -1;
@@ -105,6 +269,8 @@ int qdbg_init(const char *circuit_text) {
   dbg_session.current_gate = 0;
   dbg_session.num_breakpoints = 0;
   dbg_session.paused = 0;
+  checkpoints_free();
+  checkpoint_take();
 
   printf("\n╔═══════════════════════════════════╗\n");
   printf("║  Quantum Circuit Debugger (QDbg)  ║\n");
@@ -131,9 +297,7 @@ void qdbg_step() {
   qdbg_print_gate(gate, dbg_session.current_gate);
 
   // Execute gate
-  qvm_apply_gate(&dbg_session.state, gate);
-
-  dbg_session.current_gate++;
+  run_gate();
 
   // Show state after execution
   qdbg_print_state(&dbg_session.state);
@@ -141,10 +305,12 @@ void qdbg_step() {
 
 // Continue execution
 void qdbg_continue() {
+  int start = dbg_session.current_gate;
   while (dbg_session.current_gate < dbg_session.circuit.num_gates) {
-    // Check breakpoints
+    // Check breakpoints, except the one execution resumes from
     for (int i = 0; i < dbg_session.num_breakpoints; i++) {
-      if (dbg_session.breakpoints[i] == dbg_session.current_gate) {
+      if (dbg_session.breakpoints[i] == dbg_session.current_gate &&
+          dbg_session.current_gate != start) {
         printf("\n[QDBG] Hit breakpoint at gate %d\n",
                dbg_session.current_gate);
         qdbg_print_gate(&dbg_session.circuit.gates[dbg_session.current_gate],
@@ -153,15 +319,64 @@ void qdbg_continue() {
       }
     }
 
-    qvm_apply_gate(&dbg_session.state,
-                   &dbg_session.circuit.gates[dbg_session.current_gate]);
-    dbg_session.current_gate++;
+    run_gate();
   }
 
   printf("\n[QDBG] Circuit execution complete!\n");
   qdbg_print_state(&dbg_session.state);
 }
 
+// Step back one gate
+void qdbg_step_back() {
+  if (dbg_session.current_gate == 0) {
+    printf("\n[QDBG] Already at the first gate\n");
+    return;
+  }
+  seek(dbg_session.current_gate - 1);
+  printf("\n<<< Undid gate %d/%d:\n", dbg_session.current_gate + 1,
+         dbg_session.circuit.num_gates);
+  qdbg_print_gate(&dbg_session.circuit.gates[dbg_session.current_gate],
+                  dbg_session.current_gate);
+  qdbg_print_state(&dbg_session.state);
+}
+
+// Run backwards to the previous breakpoint, or to the start
+void qdbg_reverse_continue() {
+  int target = 0;
+  for (int i = 0; i < dbg_session.num_breakpoints; i++)
+    if (dbg_session.breakpoints[i] < dbg_session.current_gate &&
+        dbg_session.breakpoints[i] > target)
+      target = dbg_session.breakpoints[i];
+  seek(target);
+  if (target > 0) {
+    printf("\n[QDBG] Hit breakpoint at gate %d\n", target);
+    qdbg_print_gate(&dbg_session.circuit.gates[target], target);
+  } else {
+    printf("\n[QDBG] Reached the start of the circuit\n");
+    qdbg_print_state(&dbg_session.state);
+  }
+}
+
+// Jump to just before gate `gate_num` (num_gates = the end)
+void qdbg_jump(int gate_num) {
+  if (gate_num < 0 || gate_num > dbg_session.circuit.num_gates) {
+    printf("[QDBG] Invalid gate number\n");
+    return;
+  }
+  seek(gate_num);
+  printf("\n[QDBG] At gate %d/%d\n", dbg_session.current_gate,
+         dbg_session.circuit.num_gates);
+  qdbg_print_state(&dbg_session.state);
+}
+
+// Show checkpoint count, spacing and memory
+void qdbg_checkpoints() {
+  printf("\n[QDBG] %d checkpoint(s), one every %d gate(s), %.1f KB of %zu "
+         "MB\n",
+         dbg_session.num_checkpoints, dbg_session.checkpoint_interval,
+         dbg_session.checkpoint_bytes / 1024.0, QDBG_SNAPSHOT_BUDGET >> 20);
+}
+
 // List all gates
 void qdbg_list_gates() {
   printf("\n┌─── Circuit Gates ───┐\n");
@@ -184,20 +399,32 @@ void qdbg_add_breakpoint(int gate_num) {
     return;
   }
 
-  if (dbg_session.num_breakpoints >= QVM_MAX_GATES) {
-    printf("[QDBG] Too many breakpoints\n");
-    return;
+  if (dbg_session.num_breakpoints == dbg_session.breakpoint_capacity) {
+    int capacity = dbg_session.breakpoint_capacity
+                       ? 2 * dbg_session.breakpoint_capacity
+                       : 16;
+    int *grown = (int *)realloc(dbg_session.breakpoints,
+                                (size_t)capacity * sizeof(int));
+    if (!grown) {
+      printf("[QDBG] Too many breakpoints\n");
+      return;
+    }
+    dbg_session.breakpoints = grown;
+    dbg_session.breakpoint_capacity = capacity;
   }
 
   dbg_session.breakpoints[dbg_session.num_breakpoints++] = gate_num;
   printf("[QDBG] Breakpoint set at gate %d\n", gate_num);
 }
 
-// Restart debugging session
+// Restart debugging session; a fresh state draws new measurement outcomes,
+// so the checkpoints of the old one are dropped
 void qdbg_restart() {
   qvm_free(&dbg_session.state);
   qvm_init(&dbg_session.state, dbg_session.circuit.num_qubits);
   dbg_session.current_gate = 0;
+  checkpoints_free();
+  checkpoint_take();
   printf("[QDBG] Restarted. Circuit reset to initial state.\n");
   qdbg_print_state(&dbg_session.state);
 }
@@ -223,6 +450,14 @@ void qdbg_run() {
       qdbg_step();
     } else if (strcmp(cmd, "c") == 0 || strcmp(cmd, "cont") == 0) {
       qdbg_continue();
+    } else if (strcmp(cmd, "p") == 0 || strcmp(cmd, "prev") == 0) {
+      qdbg_step_back();
+    } else if (strcmp(cmd, "rc") == 0 || strcmp(cmd, "rcont") == 0) {
+      qdbg_reverse_continue();
+    } else if (strncmp(cmd, "j ", 2) == 0) {
+      qdbg_jump(atoi(cmd + 2));
+    } else if (strcmp(cmd, "k") == 0 || strcmp(cmd, "ckpt") == 0) {
+      qdbg_checkpoints();
     } else if (strcmp(cmd, "s") == 0 || strcmp(cmd, "state") == 0) {
       qdbg_print_state(&dbg_session.state);
     } else if (strcmp(cmd, "g") == 0 || strcmp(cmd, "gates") == 0) {
@@ -241,7 +476,12 @@ void qdbg_run() {
     }
   }
 
+  checkpoints_free();
   qvm_free(&dbg_session.state);
+  qvm_circuit_free(&dbg_session.circuit);
+  free(dbg_session.breakpoints);
+  dbg_session.breakpoints = NULL;
+  dbg_session.breakpoint_capacity = 0;
   printf("\n[QDBG] Debugger session ended.\n");
 }
 
@@ -5,6 +5,7 @@
 
 #include "../../kernel/memory/include/sys/qproc.h"
 #include "../../kernel/neural/include/sys/neural.h"
+#include "include/qvm.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -17,8 +18,9 @@ int qec_measure_syndrome(struct qproc *p) {
 
   if (p->t_coherence < 10.0) {
     // High probability of error if coherence is low
-    if ((rand() % 100) < 20) {
-      return (rand() % 7) + 1; // Random non-zero syndrome (1-7)
+    if (qvm_rng_below(qvm_rng_thread(), 100) < 20) {
+      // Random non-zero syndrome (1-7)
+      return qvm_rng_below(qvm_rng_thread(), 7) + 1;
     }
   }
   return 0; // No error detected
@@ -3,6 +3,7 @@
  * File: modules/quantum/qec_sim.c
  */
 
+#include "include/qvm.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -110,7 +111,7 @@ void qec_run_demo() {
   qec_sim_encode(0); // Encode logical |0>
 
   // 2. Inject Random Error
-  int error_qubit = rand() % 3;
+  int error_qubit = qvm_rng_below(qvm_rng_thread(), 3);
   qec_sim_inject_error(error_qubit);
 
   // 3. Detect
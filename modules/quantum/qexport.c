@@ -3,6 +3,7 @@
  * File: modules/quantum/qexport.c
  */
 
+#include "include/qvm.h"
 #include <stdio.h>
 #include <time.h>
 
@@ -19,7 +20,21 @@ void qexport_json(const char *circuit_name) {
   fprintf(fp, "{\n");
   fprintf(fp, "  \"circuit\": \"%s\",\n", circuit_name);
   fprintf(fp, "  \"timestamp\": %ld,\n", time(NULL));
-  fprintf(fp, "  \"status\": \"exported\"\n");
+
+  // Counts of the last qexec run, keyed by measured bitstring
+  const qvm_counts_t *counts = qvm_last_counts();
+  if (counts) {
+    fprintf(fp, "  \"qubits\": %d,\n", counts->num_qubits);
+    fprintf(fp, "  \"shots\": %d,\n", counts->shots);
+    fprintf(fp, "  \"counts\": {");
+    for (int o = 0; o < counts->num_outcomes; o++) {
+      char bits[QVM_COUNTS_MAX_BITS + 1];
+      qvm_counts_bitstring(counts, counts->outcomes[o], bits, sizeof(bits));
+      fprintf(fp, "%s\n    \"%s\": %d", o ? "," : "", bits, counts->counts[o]);
+    }
+    fprintf(fp, "\n  },\n");
+  }
+  fprintf(fp, "  \"status\": \"%s\"\n", counts ? "exported" : "no_results");
   fprintf(fp, "}\n");
 
   fclose(fp);
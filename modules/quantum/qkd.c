@@ -3,10 +3,10 @@
  * File: modules/quantum/qkd.c
  */
 
+#include "include/qvm.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 
 #define QKD_BASIS_Z 0 // Standard Basis (|0>, |1>)
 #define QKD_BASIS_X 1 // Hadamard Basis (|+>, |->)
@@ -50,7 +50,6 @@ void qkd_init(int n_bits) {
   bob_measurements = (int *)malloc(n_bits * sizeof(int));
   final_key = (int *)malloc(n_bits * sizeof(int));
 
-  srand(time(NULL));
   printf("[QKD] Session Initialized for %d bits.\n", n_bits);
 }
 
@@ -63,8 +62,8 @@ void qkd_run_bb84(int n_bits, int eavesdrop) {
 
   printf("\n--- Step 1: Alice Prepares Qubits ---\n");
   for (int i = 0; i < n_bits; i++) {
-    alice_sent_bits[i] = rand() % 2;
-    alice_bases[i] = rand() % 2;
+    alice_sent_bits[i] = qvm_rng_below(qvm_rng_thread(), 2);
+    alice_bases[i] = qvm_rng_below(qvm_rng_thread(), 2);
     // The 'qubit' state is now (alice_sent_bits[i], alice_bases[i])
   }
   printf("[Alice] Prepared %d qubits.\n", n_bits);
@@ -77,10 +76,10 @@ void qkd_run_bb84(int n_bits, int eavesdrop) {
   if (eavesdrop) {
     printf("[Eve] \033[1;31mEAVESDROPPING DETECTED!\033[0m\n");
     for (int i = 0; i < n_bits; i++) {
-      int eve_basis = rand() % 2;
+      int eve_basis = qvm_rng_below(qvm_rng_thread(), 2);
       if (eve_basis != alice_bases[i]) {
         // Eve chose wrong basis -> 50% chance to flip the bit state
-        if (rand() % 2 == 0) {
+        if (qvm_rng_below(qvm_rng_thread(), 2) == 0) {
           qubits_in_flight[i] = 1 - qubits_in_flight[i];
         }
       }
@@ -91,14 +90,14 @@ void qkd_run_bb84(int n_bits, int eavesdrop) {
 
   printf("\n--- Step 3: Bob Measures ---\n");
   for (int i = 0; i < n_bits; i++) {
-    bob_bases[i] = rand() % 2;
+    bob_bases[i] = qvm_rng_below(qvm_rng_thread(), 2);
 
     if (bob_bases[i] == alice_bases[i]) {
       // Bases match: Measurement should match qubit state
       bob_measurements[i] = qubits_in_flight[i];
     } else {
       // Bases mismatch: Measurement is random (50/50)
-      bob_measurements[i] = rand() % 2;
+      bob_measurements[i] = qvm_rng_below(qvm_rng_thread(), 2);
     }
   }
   printf("[Bob] Measured all qubits.\n");
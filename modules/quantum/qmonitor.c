@@ -12,6 +12,7 @@
 #include <time.h>
 
 #define MAX_HISTORY 100
+#define GATE_TYPES (GATE_DIFFUSE + 1)
 
 // Execution statistics
 typedef struct {
@@ -21,6 +22,8 @@ typedef struct {
   double execution_time_ms;
   time_t timestamp;
   int success;
+  int threads;    // Worker threads used for gate sweeps
+  double speedup; // CPU time / wall time of the run
 } exec_history_t;
 
 // Global statistics
@@ -30,12 +33,31 @@ static int total_executions = 0;
 static int successful_executions = 0;
 static double total_execution_time = 0.0;
 
+// Batched execution (qvm_execute_batch)
+static int total_batches = 0;
+static long batch_circuits = 0;
+static long batch_failed = 0;
+static double batch_time_ms = 0.0;
+static double last_batch_rate = 0.0; // Circuits per second
+static double best_batch_rate = 0.0;
+
+// Out-of-core passes (qvm_ooc.c)
+static long ooc_passes = 0;
+static double ooc_bytes = 0.0;
+static double ooc_seconds = 0.0;
+static double best_ooc_gbps = 0.0;
+
 // Gate usage statistics
-static int gate_usage[10] = {0}; // One counter per gate type
+static int gate_usage[GATE_TYPES] = {0}; // One counter per gate type
+static const char *gate_names[GATE_TYPES] = {
+    "H",    "X", "Y",  "Z",  "T",  "S",  "CNOT",   "CZ",
+    "SWAP", "M", "RX", "RY", "RZ", "U3", "CPHASE", "RZZ",
+    "CCX",  "QFT", "IQFT", "DIFFUSE"};
 
 // Record execution
 void qmonitor_record_execution(const char *name, int qubits, int gates,
-                               double time_ms, int success) {
+                               double time_ms, int success, int threads,
+                               double speedup) {
   if (history_count >= MAX_HISTORY) {
     // Rotate history
     for (int i = 0; i < MAX_HISTORY - 1; i++) {
@@ -51,6 +73,8 @@ void qmonitor_record_execution(const char *name, int qubits, int gates,
   entry->execution_time_ms = time_ms;
   entry->timestamp = time(NULL);
   entry->success = success;
+  entry->threads = threads;
+  entry->speedup = speedup;
 
   total_executions++;
   if (success)
@@ -58,9 +82,36 @@ void qmonitor_record_execution(const char *name, int qubits, int gates,
   total_execution_time += time_ms;
 }
 
+// Record one batch: throughput, plus one history entry for the whole batch
+// (widest circuit, total gates)
+void qmonitor_record_batch(int circuits, int failed, int qubits, int gates,
+                           double time_ms, int threads, double speedup) {
+  char name[64];
+  snprintf(name, sizeof(name), "batch x%d", circuits);
+  qmonitor_record_execution(name, qubits, gates, time_ms, failed == 0,
+                            threads, speedup);
+
+  total_batches++;
+  batch_circuits += circuits;
+  batch_failed += failed;
+  batch_time_ms += time_ms;
+  last_batch_rate = time_ms > 0.0 ? circuits * 1000.0 / time_ms : 0.0;
+  if (last_batch_rate > best_batch_rate)
+    best_batch_rate = last_batch_rate;
+}
+
+// Record one out-of-core pass: amplitude bytes read and written
+void qmonitor_record_ooc(uint64_t bytes, double seconds) {
+  ooc_passes++;
+  ooc_bytes += (double)bytes;
+  ooc_seconds += seconds;
+  if (seconds > 0.0 && bytes / seconds / 1e9 > best_ooc_gbps)
+    best_ooc_gbps = bytes / seconds / 1e9;
+}
+
 // Record gate usage
 void qmonitor_record_gate(int gate_type) {
-  if (gate_type >= 0 && gate_type < 10) {
+  if (gate_type >= 0 && gate_type < GATE_TYPES) {
     gate_usage[gate_type]++;
   }
 }
@@ -122,15 +173,13 @@ void qmonitor_dashboard() {
   // Gate Usage
   printf("\n┌─── Gate Usage Statistics "
          "─────────────────────────────────────────┐\n");
-  const char *gate_names[] = {"H", "X",    "Y",  "Z",    "T",
-                              "S", "CNOT", "CZ", "SWAP", "M"};
   int max_usage = 0;
-  for (int i = 0; i < 10; i++) {
+  for (int i = 0; i < GATE_TYPES; i++) {
     if (gate_usage[i] > max_usage)
       max_usage = gate_usage[i];
   }
 
-  for (int i = 0; i < 10; i++) {
+  for (int i = 0; i < GATE_TYPES; i++) {
     if (gate_usage[i] > 0) {
       printf("│ %-6s: %4d  ", gate_names[i], gate_usage[i]);
       int bar_len = max_usage > 0 ? (gate_usage[i] * 40 / max_usage) : 0;
@@ -145,16 +194,18 @@ void qmonitor_dashboard() {
   // Recent Executions
   printf("\n┌─── Recent Executions (Last 10) "
          "──────────────────────────────────┐\n");
-  printf("│ %-20s | %6s | %6s | %10s | %s\n", "Circuit", "Qubits", "Gates",
-         "Time(ms)", "Status");
+  printf("│ %-20s | %6s | %6s | %10s | %3s | %7s | %s\n", "Circuit", "Qubits",
+         "Gates", "Time(ms)", "Thr", "Speedup", "Status");
   printf("├───────────────────────────────────────────────────────────────────┤"
          "\n");
 
   int start = history_count > 10 ? history_count - 10 : 0;
   for (int i = start; i < history_count; i++) {
-    printf("│ %-20s | %6d | %6d | %10.2f | %s\n", history[i].circuit_name,
-           history[i].num_qubits, history[i].num_gates,
-           history[i].execution_time_ms, history[i].success ? "✓" : "✗");
+    printf("│ %-20s | %6d | %6d | %10.2f | %3d | %6.2fx | %s\n",
+           history[i].circuit_name, history[i].num_qubits,
+           history[i].num_gates, history[i].execution_time_ms,
+           history[i].threads, history[i].speedup,
+           history[i].success ? "✓" : "✗");
   }
 
   if (history_count == 0) {
@@ -178,12 +229,13 @@ void qmonitor_stats() {
   }
 
   // Calculate statistics
-  int qubit_usage[17] = {0}; // 0-16 qubits
+  int qubit_usage[QVM_MAX_QUBITS + 1] = {0};
   double min_time = history[0].execution_time_ms;
   double max_time = history[0].execution_time_ms;
 
   for (int i = 0; i < history_count; i++) {
-    if (history[i].num_qubits >= 0 && history[i].num_qubits <= 16) {
+    if (history[i].num_qubits >= 0 &&
+        history[i].num_qubits <= QVM_MAX_QUBITS) {
       qubit_usage[history[i].num_qubits]++;
     }
     if (history[i].execution_time_ms < min_time)
@@ -200,7 +252,7 @@ void qmonitor_stats() {
   printf("\n");
 
   printf("Qubit Distribution:\n");
-  for (int i = 0; i <= 16; i++) {
+  for (int i = 0; i <= QVM_MAX_QUBITS; i++) {
     if (qubit_usage[i] > 0) {
       printf("  %2d qubits: %3d circuits (%.1f%%)\n", i, qubit_usage[i],
              100.0 * qubit_usage[i] / history_count);
@@ -208,6 +260,36 @@ void qmonitor_stats() {
   }
   printf("\n");
 
+  // Parallel speedup over the multi-threaded runs
+  double speedup_sum = 0.0;
+  int parallel_runs = 0;
+  for (int i = 0; i < history_count; i++) {
+    if (history[i].threads > 1) {
+      speedup_sum += history[i].speedup;
+      parallel_runs++;
+    }
+  }
+  if (parallel_runs > 0) {
+    printf("Parallel Speedup: %.2fx avg over %d multi-threaded runs\n\n",
+           speedup_sum / parallel_runs, parallel_runs);
+  }
+
+  if (total_batches > 0) {
+    printf("Batch Throughput: %d batches, %ld circuits (%ld failed)\n",
+           total_batches, batch_circuits, batch_failed);
+    printf("  Avg: %.1f circuits/s | Last: %.1f | Best: %.1f\n\n",
+           batch_time_ms > 0.0 ? batch_circuits * 1000.0 / batch_time_ms : 0.0,
+           last_batch_rate, best_batch_rate);
+  }
+
+  if (ooc_passes > 0) {
+    printf("Out-of-Core Traffic: %.2f GB in %ld passes\n", ooc_bytes / 1e9,
+           ooc_passes);
+    printf("  Avg: %.2f GB/s | Best pass: %.2f GB/s\n\n",
+           ooc_seconds > 0.0 ? ooc_bytes / ooc_seconds / 1e9 : 0.0,
+           best_ooc_gbps);
+  }
+
   printf("Success Rate: %.1f%% (%d/%d)\n",
          total_executions > 0 ? 100.0 * successful_executions / total_executions
                               : 0,
@@ -231,20 +313,34 @@ int qmonitor_export(const char *filename) {
   fprintf(fp, "total_time_ms=%.2f\n", total_execution_time);
   fprintf(fp, "\n");
 
+  fprintf(fp, "[Batches]\n");
+  fprintf(fp, "batches=%d\n", total_batches);
+  fprintf(fp, "circuits=%ld\n", batch_circuits);
+  fprintf(fp, "failed=%ld\n", batch_failed);
+  fprintf(fp, "time_ms=%.2f\n", batch_time_ms);
+  fprintf(fp, "last_circuits_per_sec=%.1f\n", last_batch_rate);
+  fprintf(fp, "best_circuits_per_sec=%.1f\n", best_batch_rate);
+  fprintf(fp, "\n");
+
+  fprintf(fp, "[Out_Of_Core]\n");
+  fprintf(fp, "passes=%ld\n", ooc_passes);
+  fprintf(fp, "bytes=%.0f\n", ooc_bytes);
+  fprintf(fp, "time_ms=%.2f\n", ooc_seconds * 1000.0);
+  fprintf(fp, "best_gb_per_sec=%.2f\n", best_ooc_gbps);
+  fprintf(fp, "\n");
+
   fprintf(fp, "[Gate_Usage]\n");
-  const char *gate_names[] = {"H", "X",    "Y",  "Z",    "T",
-                              "S", "CNOT", "CZ", "SWAP", "M"};
-  for (int i = 0; i < 10; i++) {
+  for (int i = 0; i < GATE_TYPES; i++) {
     fprintf(fp, "%s=%d\n", gate_names[i], gate_usage[i]);
   }
   fprintf(fp, "\n");
 
   fprintf(fp, "[History]\n");
   for (int i = 0; i < history_count; i++) {
-    fprintf(fp, "%s,%d,%d,%.2f,%ld,%d\n", history[i].circuit_name,
+    fprintf(fp, "%s,%d,%d,%.2f,%ld,%d,%d,%.2f\n", history[i].circuit_name,
             history[i].num_qubits, history[i].num_gates,
             history[i].execution_time_ms, history[i].timestamp,
-            history[i].success);
+            history[i].success, history[i].threads, history[i].speedup);
   }
 
   fclose(fp);
@@ -258,6 +354,11 @@ void qmonitor_reset() {
   total_executions = 0;
   successful_executions = 0;
   total_execution_time = 0.0;
+  total_batches = 0;
+  batch_circuits = batch_failed = 0;
+  batch_time_ms = last_batch_rate = best_batch_rate = 0.0;
+  ooc_passes = 0;
+  ooc_bytes = ooc_seconds = best_ooc_gbps = 0.0;
   memset(gate_usage, 0, sizeof(gate_usage));
   printf("[QMONITOR] Statistics reset.\n");
 }
@@ -36,7 +36,28 @@ void qopt_analyze(const char *circuit_text) {
     printf("Potential reduction: %.1f%%\n",
            100.0 * redundant / circuit.num_gates);
   }
+
+  // Gate fusion: one statevector sweep per fused block
+  qvm_fused_program_t prog;
+  if (qvm_fuse_circuit(&circuit, &prog) == 0) {
+    int n1 = 0, n2 = 0, nop = 0;
+    for (int i = 0; i < prog.num_blocks; i++) {
+      if (prog.blocks[i].kind == QVM_BLOCK_1Q)
+        n1++;
+      else if (prog.blocks[i].kind == QVM_BLOCK_2Q)
+        n2++;
+      else
+        nop++;
+    }
+    double ratio = qvm_fusion_ratio(&prog);
+    printf("Fused sweeps: %d (1q: %d, 2q: %d, other: %d)\n", prog.num_blocks,
+           n1, n2, nop);
+    printf("Fusion ratio: %.2f gates/sweep\n", ratio);
+    printf("Memory traffic: -%.1f%%\n", 100.0 * (1.0 - 1.0 / ratio));
+    qvm_fused_free(&prog);
+  }
   printf("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n");
+  qvm_circuit_free(&circuit);
 }
 
 // Optimize circuit
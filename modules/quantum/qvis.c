@@ -3,8 +3,12 @@
  * File: modules/quantum/qvis.c
  */
 
+#include "include/qvm.h"
 #include <stdio.h>
 
+#define QVIS_BAR_WIDTH 32 // Characters for 100%
+#define QVIS_MAX_BARS 32
+
 void qvis_bloch() {
   printf("\n    Bloch Sphere (ASCII)\n");
   printf("         |Z>\n");
@@ -20,8 +24,27 @@ void qvis_bloch() {
   printf("         |Z>\n");
 }
 
+// Histogram of the last qexec run
 void qvis_histogram() {
-  printf("\n[QVIS] Measurement Histogram\n");
-  printf("|00>: ████████████████  50.0%%\n");
-  printf("|11>: ████████████████  50.0%%\n");
+  const qvm_counts_t *counts = qvm_last_counts();
+  if (!counts) {
+    printf("[QVIS] No measurement results. Run qexec on a measured circuit.\n");
+    return;
+  }
+
+  printf("\n[QVIS] Measurement Histogram (%d shots)\n", counts->shots);
+  for (int o = 0; o < counts->num_outcomes && o < QVIS_MAX_BARS; o++) {
+    char bits[QVM_COUNTS_MAX_BITS + 1];
+    qvm_counts_bitstring(counts, counts->outcomes[o], bits, sizeof(bits));
+    double frac = (double)counts->counts[o] / counts->shots;
+    int width = (int)(frac * QVIS_BAR_WIDTH + 0.5);
+
+    printf("|%s>: ", bits);
+    for (int i = 0; i < width; i++)
+      printf("█");
+    printf("%*s %5.1f%% (%d)\n", QVIS_BAR_WIDTH - width + 1, "", frac * 100.0,
+           counts->counts[o]);
+  }
+  if (counts->num_outcomes > QVIS_MAX_BARS)
+    printf("... %d more outcomes\n", counts->num_outcomes - QVIS_MAX_BARS);
 }
@@ -4,22 +4,58 @@
  */
 
 #include "include/qvm.h"
+#include "include/qvm_backend.h"
+#include "include/qvm_kernels.h"
+#include "include/qvm_threads.h"
+#include <limits.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
+
+// Refuse states that cannot fit in physical memory
+int qvm_state_fits(int num_qubits, size_t amp_bytes) {
+  size_t bytes = ((size_t)1 << num_qubits) * amp_bytes;
+  long pages = sysconf(_SC_PHYS_PAGES);
+  long page_size = sysconf(_SC_PAGESIZE);
+  if (pages <= 0 || page_size <= 0)
+    return 1; // Unknown: let calloc decide
+  return bytes <= (size_t)pages * (size_t)page_size;
+}
 
 // Initialize quantum state to |0...0>
 void qvm_init(qvm_state_t *state, int num_qubits) {
-  if (num_qubits > QVM_MAX_QUBITS) {
-    printf("[QVM] Error: Max %d qubits supported\n", QVM_MAX_QUBITS);
+  state->num_qubits = 0;
+  state->amplitudes = NULL;
+  state->backend = QVM_BACKEND_STATEVECTOR;
+  state->backend_state = NULL;
+  qvm_rng_init(&state->rng, qvm_rng_get_seed(),
+               qvm_rng_streams(QVM_RNG_STATES, 1));
+
+  if (num_qubits < 1 || num_qubits > QVM_MAX_QUBITS) {
+    printf("[QVM] Error: 1 to %d qubits supported\n", QVM_MAX_QUBITS);
     return;
   }
 
-  state->num_qubits = num_qubits;
-  int size = 1 << num_qubits; // 2^n
+  if (!qvm_state_fits(num_qubits, sizeof(double _Complex))) {
+    printf("[QVM] Error: %d qubits need %zu MB, more than physical RAM\n",
+           num_qubits,
+           (((size_t)1 << num_qubits) * sizeof(double _Complex)) >> 20);
+    return;
+  }
+
+  // Pick scalar/AVX2/AVX-512 kernels once, from CPUID
+  qvm_kernels_select();
+
+  size_t size = (size_t)1 << num_qubits; // 2^n
   state->amplitudes = (double _Complex *)calloc(size, sizeof(double _Complex));
+  if (!state->amplitudes) {
+    printf("[QVM] Error: Out of memory for %d-qubit state\n", num_qubits);
+    return;
+  }
+  state->num_qubits = num_qubits;
 
   // Initialize to |0...0> state
   state->amplitudes[0] = 1.0 + 0.0 * I;
@@ -28,237 +64,1322 @@ void qvm_init(qvm_state_t *state, int num_qubits) {
   for (int i = 0; i < QVM_MAX_QUBITS; i++) {
     state->measured[i] = -1;
   }
+  state->measured_bits = 0;
 
   printf("[QVM] Initialized %d-qubit state\n", num_qubits);
 }
 
+void qvm_reset(qvm_state_t *state) {
+  const qvm_backend_ops_t *ops = qvm_backend_ops(state);
+  if (ops) {
+    if (state->backend_state)
+      ops->free(state);
+    if (ops->init(state, state->num_qubits) != 0)
+      state->num_qubits = 0;
+  } else if (state->amplitudes) {
+    memset(state->amplitudes, 0,
+           ((size_t)1 << state->num_qubits) * sizeof(double _Complex));
+    state->amplitudes[0] = 1.0;
+  }
+  for (int i = 0; i < QVM_MAX_QUBITS; i++)
+    state->measured[i] = -1;
+  state->measured_bits = 0;
+}
+
+const qvm_backend_ops_t *qvm_backend_ops(const qvm_state_t *state) {
+  switch (state->backend) {
+  case QVM_BACKEND_STABILIZER:
+    return &qvm_backend_stabilizer;
+  case QVM_BACKEND_MPS:
+    return &qvm_backend_mps;
+  case QVM_BACKEND_DENSITY:
+    return &qvm_backend_density;
+  case QVM_BACKEND_SINGLE:
+    return &qvm_backend_single;
+  case QVM_BACKEND_OUT_OF_CORE:
+    return &qvm_backend_ooc;
+  case QVM_BACKEND_SPARSE:
+    return &qvm_backend_sparse;
+  default:
+    return NULL;
+  }
+}
+
+void qvm_init_backend(qvm_state_t *state, int num_qubits,
+                      qvm_backend_t backend) {
+  if (backend == QVM_BACKEND_STATEVECTOR) {
+    qvm_init(state, num_qubits);
+    return;
+  }
+
+  state->num_qubits = 0;
+  state->amplitudes = NULL;
+  state->backend = backend;
+  state->backend_state = NULL;
+  qvm_rng_init(&state->rng, qvm_rng_get_seed(),
+               qvm_rng_streams(QVM_RNG_STATES, 1));
+
+  const qvm_backend_ops_t *ops = qvm_backend_ops(state);
+  if (!ops) {
+    printf("[QVM] Error: Unknown backend %d\n", backend);
+    return;
+  }
+  if (num_qubits < 1 || num_qubits > ops->max_qubits) {
+    printf("[QVM] Error: %s backend supports 1 to %d qubits\n", ops->name,
+           ops->max_qubits);
+    return;
+  }
+  if (ops->init(state, num_qubits) != 0) {
+    printf("[QVM] Error: Out of memory for %d-qubit %s state\n", num_qubits,
+           ops->name);
+    return;
+  }
+  state->num_qubits = num_qubits;
+
+  for (int i = 0; i < QVM_MAX_QUBITS; i++) {
+    state->measured[i] = -1;
+  }
+  state->measured_bits = 0;
+
+  printf("[QVM] Initialized %d-qubit %s state\n", num_qubits, ops->name);
+}
+
+void qvm_init_precision(qvm_state_t *state, int num_qubits,
+                        qvm_precision_t precision) {
+  qvm_init_backend(state, num_qubits,
+                   precision == QVM_PRECISION_SINGLE ? QVM_BACKEND_SINGLE
+                                                     : QVM_BACKEND_STATEVECTOR);
+}
+
+int qvm_circuit_is_clifford(const qvm_circuit_t *circuit) {
+  for (int i = 0; i < circuit->num_gates; i++) {
+    switch (circuit->gates[i].type) {
+    case GATE_H:
+    case GATE_X:
+    case GATE_Y:
+    case GATE_Z:
+    case GATE_S:
+    case GATE_CNOT:
+    case GATE_CZ:
+    case GATE_SWAP:
+    case GATE_MEASURE:
+      break;
+    default:
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// log2 of a bound on the support: only gates that split a basis state in
+// two (H, RX, RY, U3...) grow it, and each at most doubles it. A QFT or
+// DIFFUSE may spread over its whole range.
+static int support_bits(const qvm_circuit_t *circuit) {
+  int bits = 0;
+  for (int i = 0; i < circuit->num_gates && bits < circuit->num_qubits; i++) {
+    const qvm_gate_t *g = &circuit->gates[i];
+    double _Complex m[2][2];
+    if (qvm_gate_is_range(g->type))
+      bits += g->target - g->control + 1;
+    else if (qvm_gate_unitary(g, m) == 0 && m[0][0] != 0 && m[1][0] != 0)
+      bits++;
+  }
+  return bits;
+}
+
+// A DIFFUSE wider than the other backends decompose (see
+// qvm_backend_macro) only runs natively on the statevector
+static int has_wide_diffuse(const qvm_circuit_t *circuit) {
+  for (int i = 0; i < circuit->num_gates; i++) {
+    const qvm_gate_t *g = &circuit->gates[i];
+    if (g->type == GATE_DIFFUSE &&
+        g->target - g->control + 1 > QVM_BACKEND_DIFFUSE_MAX)
+      return 1;
+  }
+  return 0;
+}
+
+qvm_backend_t qvm_select_backend(const qvm_circuit_t *circuit) {
+  // Only the statevector runs a wide DIFFUSE; noisy circuits then take
+  // the trajectory path
+  if (has_wide_diffuse(circuit))
+    return QVM_BACKEND_STATEVECTOR;
+  // Noisy runs need the density matrix for exact channels; wider ones
+  // follow trajectories on the statevector, so past QVM_MAX_QUBITS the
+  // caller must reject them
+  extern int qnoise_is_enabled(void);
+  if (qnoise_is_enabled())
+    return circuit->num_qubits <= QVM_DENSITY_MAX_QUBITS
+               ? QVM_BACKEND_DENSITY
+               : QVM_BACKEND_STATEVECTOR;
+  if (qvm_circuit_is_clifford(circuit))
+    return QVM_BACKEND_STABILIZER;
+  // Few splitting gates keep the support small: the sparse backend costs
+  // O(nnz) per gate and indexes up to 63 qubits
+  int n = circuit->num_qubits;
+  int bits = support_bits(circuit);
+  if (n <= QVM_SPARSE_MAX_QUBITS &&
+      (n > QVM_MAX_QUBITS ? bits <= QVM_SPARSE_WIDE_BITS
+                          : bits + QVM_SPARSE_DENSE_SHIFT <= n))
+    return QVM_BACKEND_SPARSE;
+  // Too wide for a dense statevector: complex floats buy one more qubit,
+  // past that the statevector spills to disk when a scratch directory is
+  // configured, and the MPS is exact as long as the entanglement stays
+  // under the bond dimension cap
+  qvm_backend_t wide = qvm_ooc_dir() && n <= QVM_OOC_MAX_QUBITS
+                           ? QVM_BACKEND_OUT_OF_CORE
+                           : QVM_BACKEND_MPS;
+  if (n > QVM_MAX_QUBITS)
+    return wide;
+  if (!qvm_state_fits(n, sizeof(double _Complex)))
+    return qvm_state_fits(n, sizeof(float _Complex)) ? QVM_BACKEND_SINGLE
+                                                     : wide;
+  return QVM_BACKEND_STATEVECTOR;
+}
+
 void qvm_free(qvm_state_t *state) {
+  const qvm_backend_ops_t *ops = qvm_backend_ops(state);
+  if (ops && state->backend_state)
+    ops->free(state);
   if (state->amplitudes) {
     free(state->amplitudes);
     state->amplitudes = NULL;
   }
 }
 
-// Apply single-qubit gate
+// Standard gate matrices
+static const double _Complex GATE_MAT_H[2][2] = {{M_SQRT1_2, M_SQRT1_2},
+                                                 {M_SQRT1_2, -M_SQRT1_2}};
+static const double _Complex GATE_MAT_X[2][2] = {{0, 1}, {1, 0}};
+static const double _Complex GATE_MAT_Y[2][2] = {{0, -I}, {I, 0}};
+static const double _Complex GATE_MAT_Z[2][2] = {{1, 0}, {0, -1}};
+static const double _Complex GATE_MAT_T[2][2] = {
+    {1, 0}, {0, M_SQRT1_2 + M_SQRT1_2 * I}};
+static const double _Complex GATE_MAT_S[2][2] = {{1, 0}, {0, I}};
+
+// Arguments of one statevector sweep, shared by all worker chunks
+typedef struct {
+  const qvm_kernel_ops_t *k;
+  double _Complex *amps;
+  int control;
+  int target;
+  const double _Complex (*matrix)[2];
+  const double _Complex (*matrix4)[4];
+  int result;
+  double scale;
+  double (*partial)[2];
+  const qvm_gate_form_t *form;
+} qvm_sweep_t;
+
+static void sweep_2x2(void *arg, size_t chunk, size_t b, size_t e) {
+  qvm_sweep_t *sw = (qvm_sweep_t *)arg;
+  sw->k->apply_2x2(sw->amps, sw->target, b, e, sw->matrix);
+}
+
+static void sweep_phase(void *arg, size_t chunk, size_t b, size_t e) {
+  qvm_sweep_t *sw = (qvm_sweep_t *)arg;
+  sw->k->phase(sw->amps, sw->form->mask, b, e, sw->form->d[1]);
+}
+
+static void sweep_diag(void *arg, size_t chunk, size_t b, size_t e) {
+  qvm_sweep_t *sw = (qvm_sweep_t *)arg;
+  sw->k->diag(sw->amps, sw->form->mask, b, e, sw->form->d);
+}
+
+static void sweep_permute(void *arg, size_t chunk, size_t b, size_t e) {
+  qvm_sweep_t *sw = (qvm_sweep_t *)arg;
+  const qvm_gate_form_t *f = sw->form;
+  sw->k->permute(sw->amps, f->mask, f->set, f->flip, b, e);
+}
+
+static void sweep_probs(void *arg, size_t chunk, size_t b, size_t e) {
+  qvm_sweep_t *sw = (qvm_sweep_t *)arg;
+  sw->k->probs(sw->amps, sw->target, b, e, sw->partial[chunk]);
+}
+
+static void sweep_collapse(void *arg, size_t chunk, size_t b, size_t e) {
+  qvm_sweep_t *sw = (qvm_sweep_t *)arg;
+  sw->k->collapse(sw->amps, sw->target, b, e, sw->result, sw->scale);
+}
+
+// Apply single-qubit gate in place.
+// Amplitudes are visited as (i0, i1) pairs that differ only in the target
+// bit, each pair exactly once, with no scratch vector. The pair range is
+// split into L2-sized chunks across the worker pool; the per-ISA kernel
+// (see qvm_kernels.c) does the actual arithmetic.
 static void apply_single_gate(qvm_state_t *state, int target,
-                              double _Complex matrix[2][2]) {
-  int size = 1 << state->num_qubits;
-  double _Complex *new_amps =
-      (double _Complex *)calloc(size, sizeof(double _Complex));
-
-  for (int i = 0; i < size; i++) {
-    int bit = (i >> target) & 1;
-    int i0 = i & ~(1 << target); // Clear target bit
-    int i1 = i | (1 << target);  // Set target bit
-
-    if (bit == 0) {
-      new_amps[i] = matrix[0][0] * state->amplitudes[i0] +
-                    matrix[0][1] * state->amplitudes[i1];
-    } else {
-      new_amps[i] = matrix[1][0] * state->amplitudes[i0] +
-                    matrix[1][1] * state->amplitudes[i1];
-    }
-  }
+                              const double _Complex matrix[2][2]) {
+  size_t pairs = (size_t)1 << (state->num_qubits - 1);
+  qvm_sweep_t sw = {.k = qvm_kernels_get(),
+                    .amps = state->amplitudes,
+                    .target = target,
+                    .matrix = matrix};
+  qvm_parallel_for(pairs, qvm_threads_grain(2 * sizeof(double _Complex)),
+                   sweep_2x2, &sw);
+}
 
-  memcpy(state->amplitudes, new_amps, size * sizeof(double _Complex));
-  free(new_amps);
+// Apply a diagonal or permutation gate
+// Phases and swaps visit only the amplitudes they change: a quarter for
+// CZ, half for X or CNOT... Work items are those amplitudes; the grain is
+// sized by the span of memory one item stands for.
+void qvm_apply_form(qvm_state_t *state, const qvm_gate_form_t *form) {
+  size_t size = (size_t)1 << state->num_qubits;
+  int fixed = __builtin_popcountll(form->mask);
+  size_t grain = qvm_threads_grain(sizeof(double _Complex) << fixed);
+  qvm_sweep_t sw = {
+      .k = qvm_kernels_get(), .amps = state->amplitudes, .form = form};
+  switch (form->kind) {
+  case QVM_FORM_PHASE:
+    qvm_parallel_for(size >> fixed, grain, sweep_phase, &sw);
+    break;
+  case QVM_FORM_DIAG:
+    qvm_parallel_for(size, qvm_threads_grain(sizeof(double _Complex)),
+                     sweep_diag, &sw);
+    break;
+  case QVM_FORM_PERMUTE:
+    qvm_parallel_for(size >> fixed, grain, sweep_permute, &sw);
+    break;
+  }
 }
 
-// Apply controlled gate
-static void apply_cnot(qvm_state_t *state, int control, int target) {
-  int size = 1 << state->num_qubits;
+static void sweep_4x4(void *arg, size_t chunk, size_t b, size_t e) {
+  qvm_sweep_t *sw = (qvm_sweep_t *)arg;
+  sw->k->apply_4x4(sw->amps, sw->control, sw->target, b, e, sw->matrix4);
+}
 
-  for (int i = 0; i < size; i++) {
-    int ctrl_bit = (i >> control) & 1;
-    if (ctrl_bit == 1) {
-      // Flip target bit
-      int j = i ^ (1 << target);
-      if (i < j) {
-        double _Complex temp = state->amplitudes[i];
-        state->amplitudes[i] = state->amplitudes[j];
-        state->amplitudes[j] = temp;
-      }
-    }
+// Apply an arbitrary 2x2 unitary (fused blocks, rotations...)
+void qvm_apply_matrix(qvm_state_t *state, int target,
+                      const double _Complex m[2][2]) {
+  if (!state->amplitudes) {
+    printf("[QVM] Error: Matrix gates need a statevector\n");
+    return;
+  }
+  if (target < 0 || target >= state->num_qubits) {
+    printf("[QVM] Error: Invalid qubit index %d\n", target);
+    return;
+  }
+  // Diagonal products (T S Z, RZ runs...) take the phase kernels
+  if (m[0][1] == 0 && m[1][0] == 0) {
+    qvm_gate_form_t form = {.kind = m[0][0] == 1 ? QVM_FORM_PHASE
+                                                 : QVM_FORM_DIAG,
+                            .mask = (uint64_t)1 << target,
+                            .d = {m[0][0], m[1][1]}};
+    qvm_apply_form(state, &form);
+    return;
   }
+  apply_single_gate(state, target, m);
 }
 
-void qvm_apply_gate(qvm_state_t *state, qvm_gate_t *gate) {
-  double _Complex H[2][2] = {{1.0 / sqrt(2), 1.0 / sqrt(2)},
-                             {1.0 / sqrt(2), -1.0 / sqrt(2)}};
-  double _Complex X[2][2] = {{0, 1}, {1, 0}};
-  double _Complex Y[2][2] = {{0, -I}, {I, 0}};
-  double _Complex Z[2][2] = {{1, 0}, {0, -1}};
-  double _Complex T[2][2] = {{1, 0}, {0, cexp(I * M_PI / 4)}};
-  double _Complex S[2][2] = {{1, 0}, {0, I}};
+// Apply a 4x4 unitary on qubits q0 < q1 in one sweep
+void qvm_apply_matrix2(qvm_state_t *state, int q0, int q1,
+                       const double _Complex m[4][4]) {
+  if (!state->amplitudes) {
+    printf("[QVM] Error: Matrix gates need a statevector\n");
+    return;
+  }
+  if (q0 < 0 || q0 >= q1 || q1 >= state->num_qubits) {
+    printf("[QVM] Error: Invalid qubit pair (%d, %d)\n", q0, q1);
+    return;
+  }
+  size_t quads = (size_t)1 << (state->num_qubits - 2);
+  qvm_sweep_t sw = {.k = qvm_kernels_get(),
+                    .amps = state->amplitudes,
+                    .control = q0,
+                    .target = q1,
+                    .matrix4 = m};
+  qvm_parallel_for(quads, qvm_threads_grain(4 * sizeof(double _Complex)),
+                   sweep_4x4, &sw);
+}
 
-  switch (gate->type) {
+// Matrix of a fixed single-qubit gate; -1 if the type is not one
+int qvm_gate_matrix(qvm_gate_type_t type, double _Complex m[2][2]) {
+  const double _Complex(*src)[2];
+  switch (type) {
   case GATE_H:
-    apply_single_gate(state, gate->target, H);
+    src = GATE_MAT_H;
     break;
   case GATE_X:
-    apply_single_gate(state, gate->target, X);
+    src = GATE_MAT_X;
     break;
   case GATE_Y:
-    apply_single_gate(state, gate->target, Y);
+    src = GATE_MAT_Y;
     break;
   case GATE_Z:
-    apply_single_gate(state, gate->target, Z);
+    src = GATE_MAT_Z;
     break;
   case GATE_T:
-    apply_single_gate(state, gate->target, T);
+    src = GATE_MAT_T;
+    break;
+  case GATE_S:
+    src = GATE_MAT_S;
+    break;
+  default:
+    return -1;
+  }
+  memcpy(m, src, 4 * sizeof(double _Complex));
+  return 0;
+}
+
+// Rotations are evaluated from the bound angles on every call; the fused
+// program (qvm_fuse.c) calls this once per gate and binding
+int qvm_gate_unitary(const qvm_gate_t *gate, double _Complex m[2][2]) {
+  double c = cos(gate->theta[0] / 2), s = sin(gate->theta[0] / 2);
+  switch (gate->type) {
+  case GATE_RX:
+    m[0][0] = c;
+    m[0][1] = -I * s;
+    m[1][0] = -I * s;
+    m[1][1] = c;
+    return 0;
+  case GATE_RY:
+    m[0][0] = c;
+    m[0][1] = -s;
+    m[1][0] = s;
+    m[1][1] = c;
+    return 0;
+  case GATE_RZ:
+    m[0][0] = cexp(-I * gate->theta[0] / 2);
+    m[0][1] = m[1][0] = 0;
+    m[1][1] = cexp(I * gate->theta[0] / 2);
+    return 0;
+  case GATE_U3: {
+    double phi = gate->theta[1], lambda = gate->theta[2];
+    m[0][0] = c;
+    m[0][1] = -cexp(I * lambda) * s;
+    m[1][0] = cexp(I * phi) * s;
+    m[1][1] = cexp(I * (phi + lambda)) * c;
+    return 0;
+  }
+  default:
+    return qvm_gate_matrix(gate->type, m);
+  }
+}
+
+// 4x4 matrix of a 2-qubit gate on the local pair (q0, other qubit)
+int qvm_gate_matrix2(const qvm_gate_t *gate, int q0, double _Complex m[4][4]) {
+  memset(m, 0, 16 * sizeof(double _Complex));
+  int cbit = gate->control == q0 ? 0 : 1;
+  int tbit = gate->target == q0 ? 0 : 1;
+
+  for (int l = 0; l < 4; l++) {
+    int c = (l >> cbit) & 1, t = (l >> tbit) & 1;
+    switch (gate->type) {
+    case GATE_CNOT:
+      m[c ? l ^ (1 << tbit) : l][l] = 1;
+      break;
+    case GATE_CZ:
+      m[l][l] = (c && t) ? -1 : 1;
+      break;
+    case GATE_SWAP:
+      m[((l & 1) << 1) | (l >> 1)][l] = 1;
+      break;
+    case GATE_CPHASE:
+      m[l][l] = (c && t) ? cexp(I * gate->theta[0]) : 1;
+      break;
+    case GATE_RZZ:
+      m[l][l] = cexp((c ^ t ? I : -I) * gate->theta[0] / 2);
+      break;
+    default:
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int qvm_gate_form(const qvm_gate_t *gate, qvm_gate_form_t *form) {
+  uint64_t t = (uint64_t)1 << gate->target;
+  uint64_t c = qvm_gate_is_two_qubit(gate->type) || gate->type == GATE_CCX
+                   ? (uint64_t)1 << gate->control
+                   : 0;
+  memset(form, 0, sizeof(*form));
+  form->kind = QVM_FORM_PHASE;
+  switch (gate->type) {
+  case GATE_Z:
+  case GATE_CZ:
+    form->mask = t | c;
+    form->d[1] = -1;
     break;
   case GATE_S:
-    apply_single_gate(state, gate->target, S);
+    form->mask = t;
+    form->d[1] = I;
     break;
+  case GATE_T:
+    form->mask = t;
+    form->d[1] = GATE_MAT_T[1][1];
+    break;
+  case GATE_CPHASE:
+    form->mask = t | c;
+    form->d[1] = cexp(I * gate->theta[0]);
+    break;
+  case GATE_RZ:
+  case GATE_RZZ:
+    form->kind = QVM_FORM_DIAG;
+    form->mask = t | c;
+    form->d[0] = cexp(-I * gate->theta[0] / 2);
+    form->d[1] = cexp(I * gate->theta[0] / 2);
+    break;
+  case GATE_X:
   case GATE_CNOT:
-    apply_cnot(state, gate->control, gate->target);
+    form->kind = QVM_FORM_PERMUTE;
+    form->mask = t | c;
+    form->set = c;
+    form->flip = t;
     break;
-  case GATE_MEASURE:
-    qvm_measure(state, gate->target);
+  case GATE_SWAP:
+    form->kind = QVM_FORM_PERMUTE;
+    form->mask = form->flip = t | c;
+    form->set = c;
+    break;
+  case GATE_CCX:
+    form->kind = QVM_FORM_PERMUTE;
+    form->set = c | (uint64_t)1 << gate->control2;
+    form->mask = form->set | t;
+    form->flip = t;
     break;
   default:
+    return -1;
+  }
+  return 0;
+}
+
+int qvm_apply_unitary(qvm_state_t *state, const qvm_gate_t *gate) {
+  qvm_gate_form_t form;
+  double _Complex m2[2][2], m4[4][4];
+  if (gate->type == GATE_QFT || gate->type == GATE_IQFT) {
+    qvm_apply_qft(state, gate->control, gate->target,
+                  gate->type == GATE_IQFT);
+    return 0;
+  }
+  if (gate->type == GATE_DIFFUSE) {
+    qvm_apply_diffusion(state, gate->control, gate->target);
+    return 0;
+  }
+  if (qvm_gate_form(gate, &form) == 0) {
+    qvm_apply_form(state, &form);
+    return 0;
+  }
+  if (qvm_gate_unitary(gate, m2) == 0) {
+    apply_single_gate(state, gate->target, m2);
+    return 0;
+  }
+  int lo = gate->control < gate->target ? gate->control : gate->target;
+  int hi = gate->control < gate->target ? gate->target : gate->control;
+  if (!qvm_gate_is_two_qubit(gate->type) ||
+      qvm_gate_matrix2(gate, lo, m4) != 0)
+    return -1;
+  qvm_apply_matrix2(state, lo, hi, m4);
+  return 0;
+}
+
+void qvm_apply_mcx(qvm_state_t *state, uint64_t controls, int target) {
+  if (!state->amplitudes) {
+    printf("[QVM] Error: Multi-controlled gates need a statevector\n");
+    return;
+  }
+  uint64_t t = (uint64_t)1 << target;
+  if (target < 0 || target >= state->num_qubits || (controls & t) ||
+      (controls >> state->num_qubits)) {
+    printf("[QVM] Error: Invalid multi-controlled X on qubit %d\n", target);
+    return;
+  }
+  qvm_gate_form_t form = {.kind = QVM_FORM_PERMUTE,
+                          .mask = controls | t,
+                          .set = controls,
+                          .flip = t};
+  qvm_apply_form(state, &form);
+}
+
+void qvm_apply_mcphase(qvm_state_t *state, uint64_t qubits,
+                       double _Complex phase) {
+  if (!state->amplitudes) {
+    printf("[QVM] Error: Multi-controlled gates need a statevector\n");
+    return;
+  }
+  if (qubits == 0 || (qubits >> state->num_qubits)) {
+    printf("[QVM] Error: Invalid multi-controlled phase mask\n");
+    return;
+  }
+  qvm_gate_form_t form = {
+      .kind = QVM_FORM_PHASE, .mask = qubits, .d = {1, phase}};
+  qvm_apply_form(state, &form);
+}
+
+// Toffoli from six CNOTs and single-qubit gates (Nielsen & Chuang,
+// Fig. 4.9). U3(0, 0, -pi/4) is T^dagger.
+int qvm_backend_ccx(qvm_state_t *state, const qvm_backend_ops_t *ops,
+                    const qvm_gate_t *g) {
+  int a = g->control, b = g->control2, c = g->target;
+  const qvm_gate_t seq[15] = {{GATE_H, c, -1},
+                              {GATE_CNOT, c, b},
+                              {GATE_U3, c, -1, {0, 0, -M_PI_4}},
+                              {GATE_CNOT, c, a},
+                              {GATE_T, c, -1},
+                              {GATE_CNOT, c, b},
+                              {GATE_U3, c, -1, {0, 0, -M_PI_4}},
+                              {GATE_CNOT, c, a},
+                              {GATE_T, b, -1},
+                              {GATE_T, c, -1},
+                              {GATE_H, c, -1},
+                              {GATE_CNOT, b, a},
+                              {GATE_T, a, -1},
+                              {GATE_U3, b, -1, {0, 0, -M_PI_4}},
+                              {GATE_CNOT, b, a}};
+  for (int i = 0; i < 15; i++)
+    if (ops->apply_gate(state, &seq[i]) != 0)
+      return -1;
+  return 0;
+}
+
+int qvm_apply_gate(qvm_state_t *state, qvm_gate_t *gate) {
+  int two_qubit = qvm_gate_is_two_qubit(gate->type);
+  if (!qvm_gate_valid(gate, state->num_qubits)) {
+    printf("[QVM] Error: Invalid qubit index for gate type %d\n", gate->type);
+    return -1;
+  }
+
+  const qvm_backend_ops_t *ops = qvm_backend_ops(state);
+  if (ops) {
+    if (gate->type == GATE_MEASURE) {
+      qvm_measure(state, gate->target);
+    } else if (qvm_backend_apply(state, ops, gate) != 0) {
+      printf("[QVM] Error: Gate type %d not supported by %s backend\n",
+             gate->type, ops->name);
+      return -1;
+    }
+  } else if (gate->type == GATE_MEASURE) {
+    qvm_measure(state, gate->target);
+  } else if (qvm_apply_unitary(state, gate) != 0) {
     printf("[QVM] Unknown gate type %d\n", gate->type);
+    return -1;
   }
 
   // Apply Noise (if enabled)
-  extern void qnoise_apply(void *ctx, int qubit_idx);
-  if (gate->type != GATE_MEASURE) {
-    qnoise_apply(NULL, gate->target);
-    if (gate->type == GATE_CNOT) {
-      qnoise_apply(NULL, gate->control);
+  extern void qnoise_apply(qvm_state_t *state, int qubit_idx);
+  if (qvm_gate_is_range(gate->type)) {
+    for (int q = gate->control; q <= gate->target; q++)
+      qnoise_apply(state, q);
+  } else if (gate->type != GATE_MEASURE) {
+    qnoise_apply(state, gate->target);
+    if (two_qubit || gate->type == GATE_CCX) {
+      qnoise_apply(state, gate->control);
     }
+    if (gate->type == GATE_CCX)
+      qnoise_apply(state, gate->control2);
   }
 
   // QMonitor Telemetry
   extern void qmonitor_record_gate(int gate_type);
   qmonitor_record_gate(gate->type);
+  return 0;
+}
+
+// Grain of the measurement sweeps, capped so partial sums fit the stack
+static size_t measure_grain(size_t pairs) {
+  size_t grain = qvm_threads_grain(2 * sizeof(double _Complex));
+  if (qvm_parallel_chunks(pairs, grain) > QVM_REDUCE_CHUNKS)
+    grain = (pairs + QVM_REDUCE_CHUNKS - 1) / QVM_REDUCE_CHUNKS;
+  return grain;
+}
+
+void qvm_qubit_probs(qvm_state_t *state, int qubit, double probs[2]) {
+  size_t pairs = (size_t)1 << (state->num_qubits - 1);
+  size_t grain = measure_grain(pairs);
+  size_t chunks = qvm_parallel_chunks(pairs, grain);
+
+  // P(0) and P(1) in a single reduction pass. Partial sums are kept per
+  // chunk and added in order, so the result does not depend on scheduling.
+  double partial[QVM_REDUCE_CHUNKS][2];
+  memset(partial, 0, chunks * sizeof(partial[0]));
+  qvm_sweep_t sw = {.k = qvm_kernels_get(),
+                    .amps = state->amplitudes,
+                    .target = qubit,
+                    .partial = partial};
+  qvm_parallel_for(pairs, grain, sweep_probs, &sw);
+
+  probs[0] = probs[1] = 0.0;
+  for (size_t c = 0; c < chunks; c++) {
+    probs[0] += partial[c][0];
+    probs[1] += partial[c][1];
+  }
+}
+
+// measured[] covers the statevector's qubits; wider backends still fill
+// the first 64 bits of measured_bits, the span of a counts outcome
+static void record_measurement(qvm_state_t *state, int qubit, int outcome) {
+  if (qubit < QVM_MAX_QUBITS)
+    state->measured[qubit] = outcome;
+  if (qubit < QVM_COUNTS_MAX_BITS) {
+    uint64_t bit = (uint64_t)1 << qubit;
+    state->measured_bits =
+        outcome ? state->measured_bits | bit : state->measured_bits & ~bit;
+  }
 }
 
 void qvm_measure(qvm_state_t *state, int qubit) {
-  int size = 1 << state->num_qubits;
-  double prob_0 = 0.0;
+  // Readout errors flip the reported outcome, not the collapsed state
+  extern int qnoise_readout_flip(qvm_state_t *state);
+  const qvm_backend_ops_t *ops = qvm_backend_ops(state);
+  if (ops) {
+    int outcome = ops->measure(state, qubit) ^ qnoise_readout_flip(state);
+    record_measurement(state, qubit, outcome);
+    printf("[QVM] Measured qubit %d: |%d>\n", qubit, outcome);
+    return;
+  }
 
-  // Calculate probability of measuring |0>
-  for (int i = 0; i < size; i++) {
-    if (((i >> qubit) & 1) == 0) {
-      prob_0 += cabs(state->amplitudes[i]) * cabs(state->amplitudes[i]);
+  size_t pairs = (size_t)1 << (state->num_qubits - 1);
+  size_t grain = measure_grain(pairs);
+  double probs[2];
+  qvm_qubit_probs(state, qubit, probs);
+  double prob_0 = probs[0] / (probs[0] + probs[1]);
+
+  // Random measurement, from this state's own stream
+  double r = qvm_rng_uniform(qvm_state_rng(state));
+  int result = (r < prob_0) ? 0 : 1;
+  if (probs[result] <= 0.0)
+    result ^= 1; // r landed exactly on a zero-probability edge
+
+  // Collapse and renormalize in one pass
+  qvm_sweep_t sw = {.k = qvm_kernels_get(),
+                    .amps = state->amplitudes,
+                    .target = qubit,
+                    .result = result,
+                    .scale = 1.0 / sqrt(probs[result])};
+  qvm_parallel_for(pairs, grain, sweep_collapse, &sw);
+
+  result ^= qnoise_readout_flip(state);
+  record_measurement(state, qubit, result);
+  printf("[QVM] Measured qubit %d: |%d>\n", qubit, result);
+}
+
+// Gates of one circuit, fused when possible; 1 if the fused path ran,
+// -1 if a gate failed (the rest of the circuit is skipped).
+// Noise is injected per gate, so noisy runs keep the unfused path.
+// Fused blocks are matrices, which only the statevector applies.
+static int run_gates(qvm_state_t *state, const qvm_circuit_t *circuit,
+                     qvm_fused_program_t *prog) {
+  extern int qnoise_is_enabled(void);
+  if (qnoise_is_enabled() || state->backend != QVM_BACKEND_STATEVECTOR ||
+      qvm_fuse_circuit(circuit, prog) != 0) {
+    for (int i = 0; i < circuit->num_gates; i++) {
+      if (qvm_apply_gate(state, &circuit->gates[i]) != 0)
+        return -1;
     }
+    return 0;
   }
 
-  // Random measurement
-  srand(time(NULL) + qubit);
-  double r = (double)rand() / RAND_MAX;
-  int result = (r < prob_0) ? 0 : 1;
+  qvm_execute_fused(state, prog);
+  extern void qmonitor_record_gate(int gate_type);
+  for (int i = 0; i < circuit->num_gates; i++) {
+    if (circuit->gates[i].type != GATE_MEASURE)
+      qmonitor_record_gate(circuit->gates[i].type);
+  }
+  return 1;
+}
+
+int qvm_execute_circuit(qvm_state_t *state, qvm_circuit_t *circuit,
+                        int num_threads) {
+  if (num_threads > 0)
+    qvm_threads_set(num_threads);
+
+  printf("[QVM] Executing circuit with %d gates on %d thread(s)...\n",
+         circuit->num_gates, qvm_threads_get());
+
+  qvm_fused_program_t prog;
+  int ran = run_gates(state, circuit, &prog);
+  if (ran < 0) {
+    printf("[QVM] Circuit execution failed\n");
+    return -1;
+  }
+  if (ran) {
+    printf("[QVM] Fused %d gates into %d sweeps (ratio %.2f)\n",
+           prog.num_source_gates, prog.num_blocks, qvm_fusion_ratio(&prog));
+    qvm_fused_free(&prog);
+  }
+
+  printf("[QVM] Circuit execution complete\n");
+  return 0;
+}
+
+// --- Circuit buffer ---
+
+void qvm_circuit_init(qvm_circuit_t *circuit, int num_qubits) {
+  memset(circuit, 0, sizeof(*circuit));
+  circuit->num_qubits = num_qubits;
+}
+
+// Amortized O(1): the buffer doubles when full. Borrowed gates (capacity
+// 0, see qvm_qcb_load) are copied out rather than reallocated.
+int qvm_circuit_append(qvm_circuit_t *circuit, const qvm_gate_t *gate) {
+  if (circuit->num_gates >= circuit->capacity) {
+    int capacity = circuit->capacity ? circuit->capacity
+                                     : QVM_CIRCUIT_INITIAL_GATES / 2;
+    do {
+      if (capacity > INT_MAX / 2)
+        return -1;
+      capacity *= 2;
+    } while (capacity <= circuit->num_gates);
+    size_t bytes = (size_t)capacity * sizeof(qvm_gate_t);
+    qvm_gate_t *gates =
+        circuit->capacity ? (qvm_gate_t *)realloc(circuit->gates, bytes)
+                          : (qvm_gate_t *)malloc(bytes);
+    if (!gates)
+      return -1;
+    if (!circuit->capacity && circuit->num_gates)
+      memcpy(gates, circuit->gates,
+             (size_t)circuit->num_gates * sizeof(qvm_gate_t));
+    circuit->gates = gates;
+    circuit->capacity = capacity;
+  }
+  circuit->gates[circuit->num_gates++] = *gate;
+  return 0;
+}
 
-  // Collapse state
-  double norm = 0.0;
-  for (int i = 0; i < size; i++) {
-    if (((i >> qubit) & 1) != result) {
-      state->amplitudes[i] = 0.0;
+void qvm_circuit_free(qvm_circuit_t *circuit) {
+  if (circuit->capacity)
+    free(circuit->gates);
+  free(circuit->angles);
+  circuit->gates = NULL;
+  circuit->num_gates = 0;
+  circuit->capacity = 0;
+  circuit->angles = NULL;
+  circuit->num_angles = 0;
+  circuit->angle_capacity = 0;
+  circuit->num_params = 0;
+}
+
+// --- Parameters ---
+
+int qvm_circuit_add_angle(qvm_circuit_t *circuit, int gate, int slot,
+                          int symbol, double scale, double offset) {
+  if (gate < 0 || gate >= circuit->num_gates || slot < 0 ||
+      slot >= QVM_GATE_MAX_ANGLES || symbol < 0 || symbol >= QVM_MAX_PARAMS)
+    return -1;
+  if (circuit->num_angles == circuit->angle_capacity) {
+    if (circuit->angle_capacity > INT_MAX / 2)
+      return -1;
+    int capacity = circuit->angle_capacity ? 2 * circuit->angle_capacity : 16;
+    qvm_angle_t *angles = (qvm_angle_t *)realloc(
+        circuit->angles, (size_t)capacity * sizeof(qvm_angle_t));
+    if (!angles)
+      return -1;
+    circuit->angles = angles;
+    circuit->angle_capacity = capacity;
+  }
+  circuit->angles[circuit->num_angles++] =
+      (qvm_angle_t){gate, slot, symbol, scale, offset};
+  if (symbol >= circuit->num_params)
+    circuit->num_params = symbol + 1;
+  return 0;
+}
+
+// Borrowed gates (a mapped .qcb is read-only) are copied before binding
+static int circuit_own_gates(qvm_circuit_t *circuit) {
+  if (circuit->capacity || circuit->num_gates == 0)
+    return 0;
+  size_t bytes = (size_t)circuit->num_gates * sizeof(qvm_gate_t);
+  qvm_gate_t *gates = (qvm_gate_t *)malloc(bytes);
+  if (!gates)
+    return -1;
+  memcpy(gates, circuit->gates, bytes);
+  circuit->gates = gates;
+  circuit->capacity = circuit->num_gates;
+  return 0;
+}
+
+int qvm_bind_parameters(qvm_circuit_t *circuit, const double *params,
+                        int num_params) {
+  if (num_params < circuit->num_params) {
+    printf("[QVM] Circuit needs %d parameters, got %d\n", circuit->num_params,
+           num_params);
+    return -1;
+  }
+  if (circuit->num_angles && circuit_own_gates(circuit) != 0)
+    return -1;
+  for (int i = 0; i < circuit->num_angles; i++) {
+    const qvm_angle_t *a = &circuit->angles[i];
+    circuit->gates[a->gate].theta[a->slot] =
+        a->scale * params[a->symbol] + a->offset;
+  }
+  return 0;
+}
+
+int qvm_execute_bound(qvm_state_t *state, qvm_circuit_t *circuit,
+                      const double *params, int num_params) {
+  if (!state->amplitudes || state->num_qubits != circuit->num_qubits) {
+    printf("[QVM] Error: Bound runs need a %d-qubit statevector\n",
+           circuit->num_qubits);
+    return -1;
+  }
+  if (qvm_bind_parameters(circuit, params, num_params) != 0)
+    return -1;
+  qvm_reset(state);
+  qvm_fused_program_t prog;
+  int ran = run_gates(state, circuit, &prog);
+  if (ran > 0)
+    qvm_fused_free(&prog);
+  return ran < 0 ? -1 : 0;
+}
+
+// --- Tokenizer ---
+//
+// Circuit text (format: H 0, X 1, CNOT 0 1, RY(pi/2) 0, RZZ(2*p0) 0 1,
+// CCX 0 1 2, QFT 0 3, MEASURE 0) is tokenized in place, one pass per line,
+// with no copies and no scanf. Keywords are found through a perfect hash on
+// (length, first char, last char): one table probe and one memcmp per line.
+
+typedef enum { KW_GATE, KW_QUBITS, KW_SHOTS } kw_kind_t;
+
+typedef struct {
+  const char *name;
+  unsigned char len;
+  unsigned char kind;     // kw_kind_t
+  unsigned char type;     // qvm_gate_type_t, for KW_GATE
+  unsigned char operands; // Integers that follow the keyword
+  unsigned char angles;   // Angles in parentheses after the name
+} keyword_t;
+
+#define KW_HASH(len, first, last) (((len) * 8 + (first) * 54 + (last)) & 63)
+#define KW(s, first, last, k, t, n, a)                                         \
+  [KW_HASH(sizeof(s) - 1, first, last)] = {s, sizeof(s) - 1, k, t, n, a}
+
+// Collision-free for these names: a clash would trip -Woverride-init
+static const keyword_t keywords[64] = {
+    KW("H", 'H', 'H', KW_GATE, GATE_H, 1, 0),
+    KW("X", 'X', 'X', KW_GATE, GATE_X, 1, 0),
+    KW("Y", 'Y', 'Y', KW_GATE, GATE_Y, 1, 0),
+    KW("Z", 'Z', 'Z', KW_GATE, GATE_Z, 1, 0),
+    KW("T", 'T', 'T', KW_GATE, GATE_T, 1, 0),
+    KW("S", 'S', 'S', KW_GATE, GATE_S, 1, 0),
+    KW("M", 'M', 'M', KW_GATE, GATE_MEASURE, 1, 0),
+    KW("MEASURE", 'M', 'E', KW_GATE, GATE_MEASURE, 1, 0),
+    KW("CNOT", 'C', 'T', KW_GATE, GATE_CNOT, 2, 0),
+    KW("CZ", 'C', 'Z', KW_GATE, GATE_CZ, 2, 0),
+    KW("SWAP", 'S', 'P', KW_GATE, GATE_SWAP, 2, 0),
+    KW("CCX", 'C', 'X', KW_GATE, GATE_CCX, 3, 0),
+    KW("RX", 'R', 'X', KW_GATE, GATE_RX, 1, 1),
+    KW("RY", 'R', 'Y', KW_GATE, GATE_RY, 1, 1),
+    KW("RZ", 'R', 'Z', KW_GATE, GATE_RZ, 1, 1),
+    KW("U3", 'U', '3', KW_GATE, GATE_U3, 1, 3),
+    KW("CPHASE", 'C', 'E', KW_GATE, GATE_CPHASE, 2, 1),
+    KW("RZZ", 'R', 'Z', KW_GATE, GATE_RZZ, 2, 1),
+    KW("QFT", 'Q', 'T', KW_GATE, GATE_QFT, 2, 0),
+    KW("IQFT", 'I', 'T', KW_GATE, GATE_IQFT, 2, 0),
+    KW("DIFFUSE", 'D', 'E', KW_GATE, GATE_DIFFUSE, 2, 0),
+    KW("QUBITS", 'Q', 'S', KW_QUBITS, 0, 1, 0),
+    KW("SHOTS", 'S', 'S', KW_SHOTS, 0, 1, 0),
+};
+
+static const keyword_t *keyword_lookup(const char *s, size_t len) {
+  if (len == 0 || len > 7)
+    return NULL;
+  const keyword_t *k = &keywords[KW_HASH(len, (unsigned char)s[0],
+                                         (unsigned char)s[len - 1])];
+  return k->name && k->len == len && memcmp(k->name, s, len) == 0 ? k : NULL;
+}
+
+static const char *skip_blanks(const char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+    p++;
+  return p;
+}
+
+// Decimal integer, optionally negative; 0 if there is none at p, -1 if it
+// does not fit an int
+static int scan_int(const char **pp, const char *end, int *out) {
+  const char *p = skip_blanks(*pp, end);
+  int neg = p < end && *p == '-';
+  p += neg;
+  if (p >= end || *p < '0' || *p > '9')
+    return 0;
+  long long v = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    v = v * 10 + (*p++ - '0');
+    if (neg ? -v < INT_MIN : v > INT_MAX)
+      return -1;
+  }
+  *out = (int)(neg ? -v : v);
+  *pp = p;
+  return 1;
+}
+
+// --- Angle expressions ---
+//
+// Angles are linear in at most one parameter: numbers, pi, p<k>, + - * /
+// and parentheses, e.g. RY(pi/2 - 2*p0). Each evaluates to a qvm_angle_t
+// (symbol -1 for a constant) without touching the heap.
+
+static int parse_sum(const char **pp, const char *end, qvm_angle_t *out);
+
+static int is_alnum(char c) {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+         (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+// strtod on a bounded copy: the line is not NUL-terminated
+static int scan_number(const char **pp, const char *end, double *out) {
+  const char *p = *pp;
+  char buf[32];
+  size_t n = 0;
+  while (p < end && n < sizeof(buf) - 1 &&
+         ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E' ||
+          ((*p == '+' || *p == '-') && n > 0 &&
+           (buf[n - 1] == 'e' || buf[n - 1] == 'E'))))
+    buf[n++] = *p++;
+  buf[n] = '\0';
+  char *stop;
+  *out = strtod(buf, &stop);
+  if (n == 0 || *stop != '\0')
+    return -1;
+  *pp = p;
+  return 0;
+}
+
+static int parse_factor(const char **pp, const char *end, qvm_angle_t *out) {
+  const char *p = skip_blanks(*pp, end);
+  *out = (qvm_angle_t){.symbol = -1};
+  if (p >= end)
+    return -1;
+
+  if (*p == '-' || *p == '+') {
+    int neg = *p == '-';
+    p++;
+    if (parse_factor(&p, end, out) != 0)
+      return -1;
+    if (neg) {
+      out->scale = -out->scale;
+      out->offset = -out->offset;
+    }
+  } else if (*p == '(') {
+    p++;
+    if (parse_sum(&p, end, out) != 0)
+      return -1;
+    p = skip_blanks(p, end);
+    if (p >= end || *p != ')')
+      return -1;
+    p++;
+  } else if (*p == 'p' && end - p >= 2 && p[1] == 'i' &&
+             (end - p == 2 || !is_alnum(p[2]))) {
+    out->offset = M_PI;
+    p += 2;
+  } else if (*p == 'p' && end - p >= 2 && p[1] >= '0' && p[1] <= '9') {
+    long symbol = 0;
+    for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+      if ((symbol = symbol * 10 + (*p - '0')) >= QVM_MAX_PARAMS)
+        return -1;
+    out->symbol = (int)symbol;
+    out->scale = 1.0;
+  } else if (scan_number(&p, end, &out->offset) != 0) {
+    return -1;
+  }
+  *pp = p;
+  return 0;
+}
+
+static int parse_product(const char **pp, const char *end, qvm_angle_t *out) {
+  if (parse_factor(pp, end, out) != 0)
+    return -1;
+  for (;;) {
+    const char *p = skip_blanks(*pp, end);
+    if (p >= end || (*p != '*' && *p != '/'))
+      return 0;
+    char op = *p++;
+    qvm_angle_t rhs;
+    if (parse_factor(&p, end, &rhs) != 0)
+      return -1;
+    if (op == '*' && out->symbol >= 0 && rhs.symbol < 0) {
+      out->scale *= rhs.offset;
+      out->offset *= rhs.offset;
+    } else if (op == '*' && out->symbol < 0) {
+      rhs.scale *= out->offset;
+      rhs.offset *= out->offset;
+      *out = rhs;
+    } else if (op == '/' && rhs.symbol < 0 && rhs.offset != 0.0) {
+      out->scale /= rhs.offset;
+      out->offset /= rhs.offset;
     } else {
-      norm += cabs(state->amplitudes[i]) * cabs(state->amplitudes[i]);
+      return -1; // Not linear in one parameter
     }
+    *pp = p;
   }
+}
 
-  // Normalize
-  norm = sqrt(norm);
-  for (int i = 0; i < size; i++) {
-    state->amplitudes[i] /= norm;
+static int parse_sum(const char **pp, const char *end, qvm_angle_t *out) {
+  if (parse_product(pp, end, out) != 0)
+    return -1;
+  for (;;) {
+    const char *p = skip_blanks(*pp, end);
+    if (p >= end || (*p != '+' && *p != '-'))
+      return 0;
+    double sign = *p++ == '-' ? -1.0 : 1.0;
+    qvm_angle_t rhs;
+    if (parse_product(&p, end, &rhs) != 0)
+      return -1;
+    if (rhs.symbol >= 0 && out->symbol >= 0 && rhs.symbol != out->symbol)
+      return -1; // One parameter per angle
+    if (rhs.symbol >= 0)
+      out->symbol = rhs.symbol;
+    out->scale += sign * rhs.scale;
+    out->offset += sign * rhs.offset;
+    *pp = p;
   }
+}
 
-  state->measured[qubit] = result;
-  printf("[QVM] Measured qubit %d: |%d>\n", qubit, result);
+// "(a, b, c)" after a gate name; number of angles or -1
+static int parse_angles(const char **pp, const char *end,
+                        qvm_angle_t angles[QVM_GATE_MAX_ANGLES]) {
+  const char *p = *pp + 1; // Past '('
+  int n = 0;
+  for (;;) {
+    if (n == QVM_GATE_MAX_ANGLES || parse_sum(&p, end, &angles[n]) != 0)
+      return -1;
+    angles[n].slot = n;
+    n++;
+    p = skip_blanks(p, end);
+    if (p < end && *p == ',') {
+      p++;
+    } else if (p < end && *p == ')') {
+      *pp = p + 1;
+      return n;
+    } else {
+      return -1;
+    }
+  }
 }
 
-void qvm_execute_circuit(qvm_state_t *state, qvm_circuit_t *circuit) {
-  printf("[QVM] Executing circuit with %d gates...\n", circuit->num_gates);
+// Tokenize the line [p, end). Directives update `circuit`; returns 1 when
+// the line is a gate, stored in *gate. Its angles that depend on
+// parameters are returned in symbolic[0 .. *num_symbolic) by slot.
+static int parse_line(const char *p, const char *end, qvm_circuit_t *circuit,
+                      qvm_gate_t *gate, qvm_angle_t *symbolic,
+                      int *num_symbolic) {
+  *num_symbolic = 0;
+  p = skip_blanks(p, end);
+  if (p == end || *p == '#')
+    return 0;
 
-  for (int i = 0; i < circuit->num_gates; i++) {
-    qvm_apply_gate(state, &circuit->gates[i]);
+  const char *word = p;
+  while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '(')
+    p++;
+  size_t len = (size_t)(p - word);
+
+  qvm_angle_t angles[QVM_GATE_MAX_ANGLES];
+  int num_angles = 0;
+  if (p < end && *p == '(' &&
+      (num_angles = parse_angles(&p, end, angles)) < 0) {
+    printf("[QVM] Bad angle in: %.*s\n", (int)(end - word), word);
+    return 0;
   }
 
-  printf("[QVM] Circuit execution complete\n");
+  int args[3];
+  int scanned = scan_int(&p, end, &args[0]);
+  if (scanned == 0)
+    return 0; // Not an instruction
+  const keyword_t *k = keyword_lookup(word, len);
+  if (!k) {
+    printf("[QVM] Unknown gate: %.*s\n", (int)len, word);
+    return 0;
+  }
+  for (int i = 1; scanned > 0 && i < k->operands; i++) {
+    if ((scanned = scan_int(&p, end, &args[i])) == 0) {
+      printf("[QVM] %s needs %d qubits\n", k->name, k->operands);
+      return 0;
+    }
+  }
+  if (scanned < 0) {
+    printf("[QVM] Number out of range in: %.*s\n", (int)(end - word), word);
+    return 0;
+  }
+  if (num_angles != k->angles) {
+    printf("[QVM] %s takes %d angle(s)\n", k->name, k->angles);
+    return 0;
+  }
+
+  switch (k->kind) {
+  case KW_QUBITS:
+    circuit->num_qubits = args[0];
+    return 0;
+  case KW_SHOTS:
+    circuit->shots = args[0];
+    return 0;
+  default:
+    memset(gate, 0, sizeof(*gate)); // Padding matches .qcb records too
+    gate->type = (qvm_gate_type_t)k->type;
+    // Controls come first: CNOT c t, CCX c1 c2 t. Ranges (QFT a b) keep
+    // their lowest qubit in control.
+    gate->target = args[k->operands - 1];
+    gate->control = k->operands >= 2 ? args[0] : -1;
+    gate->control2 = k->operands == 3 ? args[1] : -1;
+    if (qvm_gate_is_range(gate->type) && gate->control > gate->target) {
+      gate->control = gate->target;
+      gate->target = args[0];
+    }
+    // Symbolic angles start out bound to parameters = 0
+    for (int i = 0; i < QVM_GATE_MAX_ANGLES; i++) {
+      gate->theta[i] = i < num_angles ? angles[i].offset : 0.0;
+      if (i < num_angles && angles[i].symbol >= 0)
+        symbolic[(*num_symbolic)++] = angles[i];
+    }
+    return 1;
+  }
 }
 
-// Parse circuit from text format
-// Format: H 0, X 1, CNOT 0 1, MEASURE 0
 int qvm_parse_circuit(const char *circuit_text, qvm_circuit_t *circuit) {
-  circuit->num_gates = 0;
-  char line[256];
-  const char *ptr = circuit_text;
-
-  // Read circuit line by line
-  while (*ptr) {
-    // Skip comments and empty lines
-    while (*ptr == '#' || *ptr == '\n' || *ptr == ' ') {
-      if (*ptr == '#') {
-        while (*ptr && *ptr != '\n')
-          ptr++;
+  qvm_circuit_init(circuit, 0);
+  const char *p = circuit_text, *end = p + strlen(p);
+
+  while (p < end) {
+    const char *nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+    const char *eol = nl ? nl : end;
+    qvm_gate_t gate;
+    qvm_angle_t symbolic[QVM_GATE_MAX_ANGLES];
+    int num_symbolic;
+    if (parse_line(p, eol, circuit, &gate, symbolic, &num_symbolic)) {
+      int rc = qvm_circuit_append(circuit, &gate);
+      for (int i = 0; rc == 0 && i < num_symbolic; i++)
+        rc = qvm_circuit_add_angle(circuit, circuit->num_gates - 1,
+                                   symbolic[i].slot, symbolic[i].symbol,
+                                   symbolic[i].scale, symbolic[i].offset);
+      if (rc != 0) {
+        printf("[QVM] Out of memory after %d gates\n", circuit->num_gates);
+        qvm_circuit_free(circuit);
+        return -1;
       }
-      if (*ptr)
-        ptr++;
     }
+    p = eol + (nl != NULL);
+  }
 
-    if (!*ptr)
-      break;
+  return 0;
+}
+
+// --- Streaming execution ---
+
+typedef struct {
+  qvm_state_t *state;
+  qvm_circuit_t window; // Gates read but not yet applied
+  long executed;
+} qvm_stream_t;
+
+static int stream_flush(qvm_stream_t *st) {
+  qvm_fused_program_t prog;
+  int ran = run_gates(st->state, &st->window, &prog);
+  if (ran > 0)
+    qvm_fused_free(&prog);
+  st->executed += st->window.num_gates;
+  st->window.num_gates = 0;
+  return ran < 0 ? -1 : 0;
+}
+
+static int stream_line(qvm_stream_t *st, const char *p, const char *end) {
+  int declared = st->window.num_qubits;
+  qvm_gate_t gate;
+  qvm_angle_t symbolic[QVM_GATE_MAX_ANGLES];
+  int num_symbolic;
+  int is_gate =
+      parse_line(p, end, &st->window, &gate, symbolic, &num_symbolic);
+
+  if (st->window.num_qubits != declared) {
+    if (declared) {
+      printf("[QVM] Stream: QUBITS may only be given once\n");
+      return -1;
+    }
+    qvm_init(st->state, st->window.num_qubits);
+    return st->state->num_qubits ? 0 : -1;
+  }
+  if (!is_gate)
+    return 0;
+  if (!declared) {
+    printf("[QVM] Stream: gate before the QUBITS directive\n");
+    return -1;
+  }
+  if (num_symbolic) {
+    printf("[QVM] Stream: p%d cannot be bound while streaming\n",
+           symbolic[0].symbol);
+    return -1;
+  }
+  if (qvm_circuit_append(&st->window, &gate) != 0)
+    return -1;
+  if (st->window.num_gates == QVM_STREAM_WINDOW)
+    return stream_flush(st);
+  return 0;
+}
 
-    // Read line
-    int i = 0;
-    while (*ptr && *ptr != '\n' && i < 255) {
-      line[i++] = *ptr++;
+// Append n bytes to the carried-over line, growing it as needed
+static int stream_carry(char **line, size_t *cap, size_t *carry,
+                        const char *p, size_t n) {
+  if (*carry + n > *cap) {
+    size_t want = *cap ? *cap : 256;
+    while (want < *carry + n)
+      want *= 2;
+    char *grown = (char *)realloc(*line, want);
+    if (!grown) {
+      printf("[QVM] Stream: out of memory for a %zu-byte line\n",
+             *carry + n);
+      return -1;
     }
-    line[i] = '\0';
-
-    // Parse gate
-    char gate_name[32];
-    int target, control;
-
-    if (sscanf(line, "QUBITS %d", &circuit->num_qubits) == 1) {
-      continue;
-    } else if (sscanf(line, "CNOT %d %d", &control, &target) == 2) {
-      circuit->gates[circuit->num_gates].type = GATE_CNOT;
-      circuit->gates[circuit->num_gates].control = control;
-      circuit->gates[circuit->num_gates].target = target;
-      circuit->num_gates++;
-    } else if (sscanf(line, "%s %d", gate_name, &target) == 2) {
-      if (strcmp(gate_name, "H") == 0) {
-        circuit->gates[circuit->num_gates].type = GATE_H;
-      } else if (strcmp(gate_name, "X") == 0) {
-        circuit->gates[circuit->num_gates].type = GATE_X;
-      } else if (strcmp(gate_name, "Y") == 0) {
-        circuit->gates[circuit->num_gates].type = GATE_Y;
-      } else if (strcmp(gate_name, "Z") == 0) {
-        circuit->gates[circuit->num_gates].type = GATE_Z;
-      } else if (strcmp(gate_name, "T") == 0) {
-        circuit->gates[circuit->num_gates].type = GATE_T;
-      } else if (strcmp(gate_name, "S") == 0) {
-        circuit->gates[circuit->num_gates].type = GATE_S;
-      } else if (strcmp(gate_name, "MEASURE") == 0 ||
-                 strcmp(gate_name, "M") == 0) {
-        circuit->gates[circuit->num_gates].type = GATE_MEASURE;
+    *line = grown;
+    *cap = want;
+  }
+  memcpy(*line + *carry, p, n);
+  *carry += n;
+  return 0;
+}
+
+// Lines inside a chunk are tokenized in place; only a line split across
+// two or more reads is carried over in `line`, which grows to fit it
+long qvm_execute_stream(qvm_stream_read_t read, void *ctx,
+                        qvm_state_t *state) {
+  qvm_stream_t st = {.state = state};
+  char chunk[4096], *line = NULL;
+  size_t carry = 0, cap = 0, got;
+  int rc = 0;
+
+  memset(state, 0, sizeof(*state));
+  qvm_circuit_init(&st.window, 0);
+  while (rc == 0 && (got = read(ctx, chunk, sizeof(chunk))) > 0) {
+    const char *p = chunk, *end = chunk + got;
+    while (rc == 0 && p < end) {
+      const char *nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+      if (!nl) {
+        rc = stream_carry(&line, &cap, &carry, p, (size_t)(end - p));
+        break;
+      }
+      if (carry) {
+        rc = stream_carry(&line, &cap, &carry, p, (size_t)(nl - p));
+        if (rc == 0)
+          rc = stream_line(&st, line, line + carry);
+        carry = 0;
       } else {
-        printf("[QVM] Unknown gate: %s\n", gate_name);
-        continue;
+        rc = stream_line(&st, p, nl);
       }
-      circuit->gates[circuit->num_gates].target = target;
-      circuit->gates[circuit->num_gates].control = -1;
-      circuit->num_gates++;
+      p = nl + 1;
     }
   }
-
-  return 0;
+  if (rc == 0 && carry > 0)
+    rc = stream_line(&st, line, line + carry);
+  if (rc == 0 && st.window.num_gates > 0)
+    rc = stream_flush(&st);
+  free(line);
+  qvm_circuit_free(&st.window);
+  return rc == 0 ? st.executed : -1;
 }
 
 void qvm_print_state(qvm_state_t *state) {
-  int size = 1 << state->num_qubits;
+  const qvm_backend_ops_t *ops = qvm_backend_ops(state);
+  if (ops) {
+    ops->print(state);
+    return;
+  }
+
+  size_t size = (size_t)1 << state->num_qubits;
   printf("\n--- Quantum State ---\n");
 
-  for (int i = 0; i < size; i++) {
-    double prob = cabs(state->amplitudes[i]) * cabs(state->amplitudes[i]);
+  for (size_t i = 0; i < size; i++) {
+    double _Complex amp = state->amplitudes[i];
+    double prob = creal(amp) * creal(amp) + cimag(amp) * cimag(amp);
     if (prob > 0.001) { // Only show significant amplitudes
       printf("|");
       for (int j = state->num_qubits - 1; j >= 0; j--) {
-        printf("%d", (i >> j) & 1);
+        printf("%d", (int)((i >> j) & 1));
       }
       printf(">: %.4f\n", prob);
     }
@@ -266,35 +1387,158 @@ void qvm_print_state(qvm_state_t *state) {
   printf("---------------------\n");
 }
 
-// Userspace wrapper for shell
-void qvm_execute_from_text(const char *circuit_text) {
-  qvm_circuit_t circuit;
-  qvm_state_t state;
+// Run a circuit for the shell and report it; frees the circuit
+static void execute_and_report(qvm_circuit_t *circuit_in) {
+  qvm_circuit_t circuit = *circuit_in;
+  qvm_state_t state = {0};
 
-  // Parse circuit
-  if (qvm_parse_circuit(circuit_text, &circuit) != 0) {
-    printf("[QVM] Failed to parse circuit\n");
+  // Initialize state. Clifford circuits run on the stabilizer tableau,
+  // which scales to thousands of qubits; other circuits too wide for a
+  // statevector run on the MPS.
+  qvm_backend_t backend = qvm_select_backend(&circuit);
+  // Noise channels need the density matrix or statevector trajectories,
+  // neither of which reaches past QVM_MAX_QUBITS
+  extern int qnoise_is_enabled(void);
+  if (qnoise_is_enabled() && circuit.num_qubits > QVM_MAX_QUBITS) {
+    printf("[QVM] Error: Noisy circuits support 1 to %d qubits, got %d\n",
+           QVM_MAX_QUBITS, circuit.num_qubits);
+    qvm_circuit_free(&circuit);
     return;
   }
+  // Too wide for a statevector but split in two by few gates: exact
+  // samples from hybrid Schrödinger-Feynman instead of a capped MPS
+  qvm_hsf_stats_t hsf;
+  uint64_t hsf_mask;
+  int hybrid = backend == QVM_BACKEND_MPS &&
+               circuit.num_qubits > QVM_MAX_QUBITS &&
+               qvm_terminal_measurements(&circuit, &hsf_mask) > 0 &&
+               qvm_hsf_plan(&circuit, 0, &hsf) == 0 &&
+               hsf.paths <= QVM_HSF_AUTO_PATHS &&
+               qvm_state_fits(0, hsf.sample_bytes);
+  if (hybrid)
+    printf("[QVM] %d qubits, %d gates across qubit %d: hybrid "
+           "Schrödinger-Feynman over %llu paths\n",
+           circuit.num_qubits, hsf.cut_gates, hsf.cut,
+           (unsigned long long)hsf.paths);
+  else if (backend == QVM_BACKEND_STABILIZER)
+    printf("[QVM] Clifford circuit: using stabilizer backend\n");
+  else if (backend == QVM_BACKEND_MPS)
+    printf("[QVM] %d qubits exceed the statevector: using MPS backend\n",
+           circuit.num_qubits);
+  else if (backend == QVM_BACKEND_DENSITY)
+    printf("[QVM] Noisy circuit: using density-matrix backend\n");
+  else if (backend == QVM_BACKEND_SINGLE)
+    printf("[QVM] %d qubits exceed RAM in double: using single precision\n",
+           circuit.num_qubits);
+  else if (backend == QVM_BACKEND_OUT_OF_CORE)
+    printf("[QVM] %d qubits exceed RAM: spilling the statevector to %s\n",
+           circuit.num_qubits, qvm_ooc_dir());
+  else if (backend == QVM_BACKEND_SPARSE)
+    printf("[QVM] Low-support circuit: using sparse backend\n");
 
-  // Initialize state
-  qvm_init(&state, circuit.num_qubits);
+  // Terminal measurements are sampled from one evolution of the state.
+  // The density matrix holds the exact noisy mixture, so it samples too;
+  // wider noisy circuits run one Monte-Carlo trajectory per shot.
+  uint64_t measured_mask;
+  int num_measured = qvm_terminal_measurements(&circuit, &measured_mask);
+  int trajectories = measured_mask && qnoise_is_enabled() &&
+                     backend == QVM_BACKEND_STATEVECTOR;
+  int sampled = num_measured > 0 &&
+                (!qnoise_is_enabled() || backend == QVM_BACKEND_DENSITY);
+  int shots = circuit.shots > 0 ? circuit.shots : QVM_DEFAULT_SHOTS;
+  qvm_counts_t counts;
 
-  // Execute
+  if (trajectories) {
+    printf("[QVM] Noisy circuit: %d trajectories on %d thread(s)\n", shots,
+           qvm_threads_get());
+  } else if (!hybrid) {
+    qvm_init_backend(&state, circuit.num_qubits, backend);
+    if (state.num_qubits == 0) {
+      qvm_circuit_free(&circuit);
+      return;
+    }
+  }
+
+  // Execute. clock() is CPU time summed over all workers, so its ratio to
+  // wall time is the effective parallel speedup of the run.
+  struct timespec wall_start, wall_end;
+  clock_gettime(CLOCK_MONOTONIC, &wall_start);
   clock_t start = clock();
-  qvm_execute_circuit(&state, &circuit);
+  int status;
+  if (trajectories) {
+    qvm_traj_config_t config = {.max_trajectories = shots};
+    qvm_traj_result_t result;
+    status = qvm_run_trajectories(&circuit, &config, &result);
+    counts = result.counts;
+    if (status == 0)
+      printf("[QVM] %d trajectories, max frequency std. error %.4f\n",
+             result.trajectories, result.counts_error);
+  } else if (hybrid) {
+    status = qvm_hsf_sample(&circuit, hsf.cut, shots, &counts);
+  } else if (sampled) {
+    status = qvm_sample_circuit(&state, &circuit, shots, &counts);
+  } else {
+    status = qvm_execute_circuit(&state, &circuit, 0);
+    if (status == 0 && measured_mask)
+      status = qvm_counts_from_measured(&state, measured_mask, &counts);
+  }
   clock_t end = clock();
-  double time_ms = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+  clock_gettime(CLOCK_MONOTONIC, &wall_end);
+  double cpu_ms = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+  double time_ms = (wall_end.tv_sec - wall_start.tv_sec) * 1000.0 +
+                   (wall_end.tv_nsec - wall_start.tv_nsec) / 1e6;
+  double speedup = time_ms > 0.0 ? cpu_ms / time_ms : 1.0;
 
   // Print results
-  qvm_print_state(&state);
+  if (!trajectories && !hybrid)
+    qvm_print_state(&state);
+  if (measured_mask && status == 0) {
+    qvm_counts_print(&counts);
+    qvm_counts_record(&counts);
+  }
 
   // QMonitor Telemetry
   extern void qmonitor_record_execution(const char *name, int qubits, int gates,
-                                        double time_ms, int success);
+                                        double time_ms, int success,
+                                        int threads, double speedup);
   qmonitor_record_execution("shell_exec", circuit.num_qubits, circuit.num_gates,
-                            time_ms, 1);
+                            time_ms, status == 0, qvm_threads_get(), speedup);
 
   // Cleanup
   qvm_free(&state);
+  qvm_circuit_free(&circuit);
+}
+
+// Userspace wrappers for shell
+void qvm_execute_from_text(const char *circuit_text) {
+  qvm_circuit_t circuit;
+  if (qvm_parse_circuit(circuit_text, &circuit) != 0) {
+    printf("[QVM] Failed to parse circuit\n");
+    return;
+  }
+  execute_and_report(&circuit);
+}
+
+void qvm_execute_cached(const char *circuit_text, const void *cached,
+                        size_t cached_size, void **compiled,
+                        size_t *compiled_size) {
+  *compiled = NULL;
+  *compiled_size = 0;
+  uint64_t hash = qvm_qcb_hash(circuit_text, strlen(circuit_text));
+  qvm_circuit_t circuit;
+  if (cached && qvm_qcb_source_hash(cached, cached_size) == hash &&
+      qvm_qcb_load(cached, cached_size, &circuit) == 0) {
+    printf("[QVM] Using compiled circuit (%d gates, no parse)\n",
+           circuit.num_gates);
+    execute_and_report(&circuit);
+    return;
+  }
+
+  if (qvm_parse_circuit(circuit_text, &circuit) != 0) {
+    printf("[QVM] Failed to parse circuit\n");
+    return;
+  }
+  if (qvm_qcb_encode(&circuit, hash, compiled, compiled_size) != 0)
+    *compiled = NULL;
+  execute_and_report(&circuit);
 }
@@ -0,0 +1,286 @@
+/*
+ * NexusQ-AI - Batched Circuit Execution
+ * File: modules/quantum/qvm_batch.c
+ *
+ * Many independent small circuits (optimizer steps, tomography probes,
+ * parameter grids) run as one job on the worker pool, with no per-circuit
+ * logging or state allocation:
+ *  - a circuit whose statevector is too small to spread one sweep over
+ *    every thread runs whole on one worker, many circuits at a time;
+ *  - larger circuits run one after another, each on the whole pool.
+ * Statevectors come from a pool that survives between batches, so a loop
+ * of same-sized batches allocates nothing after the first one. Parameters
+ * are bound into a private copy of the gates: the caller's circuits are
+ * only read, and one circuit may appear many times in a batch.
+ */
+
+#include "include/qvm_backend.h"
+#include "include/qvm_kernels.h"
+#include "include/qvm_threads.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BATCH_POOL_MAX 64                        // Buffers kept between batches
+#define BATCH_POOL_KEEP_BYTES ((size_t)16 << 20) // Larger ones are freed
+
+// --- Statevector pool ---
+
+typedef struct {
+  double _Complex *amps;
+  size_t bytes;
+} pool_buffer_t;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pool_buffer_t pool[BATCH_POOL_MAX];
+static int pool_count = 0;
+
+// Smallest pooled buffer of at least `bytes`, or a fresh one
+static double _Complex *pool_acquire(size_t bytes, size_t *got) {
+  pthread_mutex_lock(&pool_lock);
+  int best = -1;
+  for (int i = 0; i < pool_count; i++)
+    if (pool[i].bytes >= bytes &&
+        (best < 0 || pool[i].bytes < pool[best].bytes))
+      best = i;
+  if (best >= 0) {
+    double _Complex *amps = pool[best].amps;
+    *got = pool[best].bytes;
+    pool[best] = pool[--pool_count];
+    pthread_mutex_unlock(&pool_lock);
+    return amps;
+  }
+  pthread_mutex_unlock(&pool_lock);
+  *got = bytes;
+  return (double _Complex *)malloc(bytes);
+}
+
+static void pool_release(double _Complex *amps, size_t bytes) {
+  if (!amps)
+    return;
+  pthread_mutex_lock(&pool_lock);
+  if (bytes <= BATCH_POOL_KEEP_BYTES && pool_count < BATCH_POOL_MAX) {
+    pool[pool_count++] = (pool_buffer_t){amps, bytes};
+    amps = NULL;
+  }
+  pthread_mutex_unlock(&pool_lock);
+  free(amps);
+}
+
+// --- One circuit ---
+
+typedef struct {
+  const qvm_circuit_t *const *circuits;
+  const double *const *params;
+  qvm_batch_result_t *results;
+  const int *order; // Circuits of the current pass, by submission index
+  const char *observable;
+  uint64_t seed; // Circuit i samples from stream first_stream + i
+  uint64_t first_stream;
+} batch_t;
+
+// Copy of the gates with parameters bound; MEASURE gates are dropped from
+// the copy (and reported in *mask) when `strip` is set
+static qvm_gate_t *bind_copy(const qvm_circuit_t *c, const double *params,
+                             int strip, int *num_gates, uint64_t *mask) {
+  qvm_gate_t *gates =
+      (qvm_gate_t *)malloc(((size_t)c->num_gates + 1) * sizeof(qvm_gate_t));
+  if (!gates)
+    return NULL;
+  memcpy(gates, c->gates, (size_t)c->num_gates * sizeof(qvm_gate_t));
+  for (int i = 0; i < c->num_angles; i++) {
+    const qvm_angle_t *a = &c->angles[i];
+    gates[a->gate].theta[a->slot] = a->scale * params[a->symbol] + a->offset;
+  }
+  int kept = 0;
+  for (int i = 0; i < c->num_gates; i++) {
+    if (strip && gates[i].type == GATE_MEASURE) {
+      if (gates[i].target < 64)
+        *mask |= (uint64_t)1 << gates[i].target;
+      continue;
+    }
+    gates[kept++] = gates[i];
+  }
+  *num_gates = kept;
+  return gates;
+}
+
+static int batch_valid(const qvm_circuit_t *c, const double *params) {
+  int n = c->num_qubits;
+  if (n < 1 || n > QVM_MAX_QUBITS || (c->num_angles && !params))
+    return 0;
+  uint64_t mask;
+  if (qvm_terminal_measurements(c, &mask) < 0)
+    return 0;
+  for (int i = 0; i < c->num_gates; i++)
+    if (!qvm_gate_valid(&c->gates[i], n))
+      return 0;
+  return 1;
+}
+
+// Noiseless statevector run into `amps` (2^n amplitudes or more)
+static int batch_run(const batch_t *b, int index, double _Complex *amps) {
+  const qvm_circuit_t *c = b->circuits[index];
+  qvm_batch_result_t *r = &b->results[index];
+  uint64_t mask = 0;
+  qvm_circuit_t bound = *c;
+  bound.gates = bind_copy(c, b->params ? b->params[index] : NULL, 1,
+                          &bound.num_gates, &mask);
+  bound.capacity = bound.num_gates;
+  qvm_fused_program_t prog;
+  if (!bound.gates || qvm_fuse_circuit(&bound, &prog) != 0) {
+    free(bound.gates);
+    return -1;
+  }
+
+  qvm_state_t state = {.num_qubits = c->num_qubits,
+                       .amplitudes = amps,
+                       .backend = QVM_BACKEND_STATEVECTOR};
+  qvm_rng_init(&state.rng, b->seed, b->first_stream + (uint64_t)index);
+  memset(amps, 0, ((size_t)1 << c->num_qubits) * sizeof(double _Complex));
+  amps[0] = 1.0;
+  qvm_execute_fused(&state, &prog);
+  qvm_fused_free(&prog);
+  free(bound.gates);
+
+  int rc = 0;
+  if (b->observable) {
+    qvm_pauli_t p;
+    rc = qvm_pauli_parse(b->observable, c->num_qubits, &p);
+    if (rc == 0)
+      r->expectation = qvm_pauli_expectation(&state, &p);
+  }
+  int shots = c->shots > 0 ? c->shots : QVM_DEFAULT_SHOTS;
+  if (rc == 0 && mask)
+    rc = qvm_sample_marginal(&state, shots, mask, &r->counts);
+  return rc;
+}
+
+// Noisy circuits: trajectories, parallel over the pool inside each run
+static int batch_run_noisy(const batch_t *b, int index) {
+  const qvm_circuit_t *c = b->circuits[index];
+  qvm_batch_result_t *r = &b->results[index];
+  uint64_t mask = 0;
+  qvm_circuit_t bound = *c;
+  bound.gates = bind_copy(c, b->params ? b->params[index] : NULL, 0,
+                          &bound.num_gates, &mask);
+  bound.capacity = bound.num_gates;
+  if (!bound.gates)
+    return -1;
+  // Trajectory streams are keyed by a seed drawn from the circuit's stream,
+  // so two circuits of one batch never share trajectories
+  qvm_rng_t rng;
+  qvm_rng_init(&rng, b->seed, b->first_stream + (uint64_t)index);
+  qvm_traj_config_t config = {
+      .max_trajectories = c->shots > 0 ? c->shots : QVM_DEFAULT_SHOTS,
+      .observable = b->observable,
+      .seed = qvm_rng_next(&rng) | 1};
+  qvm_traj_result_t traj;
+  int rc = qvm_run_trajectories(&bound, &config, &traj);
+  free(bound.gates);
+  if (rc == 0) {
+    r->counts = traj.counts;
+    r->expectation = traj.expectation;
+  }
+  return rc;
+}
+
+// Work item: one whole circuit on one worker
+static void sweep_circuits(void *arg, size_t chunk, size_t begin,
+                           size_t end) {
+  const batch_t *b = (const batch_t *)arg;
+  for (size_t k = begin; k < end; k++) {
+    int i = b->order[k];
+    size_t bytes = ((size_t)1 << b->circuits[i]->num_qubits) *
+                   sizeof(double _Complex);
+    size_t got;
+    double _Complex *amps = pool_acquire(bytes, &got);
+    b->results[i].status = amps ? batch_run(b, i, amps) : -1;
+    pool_release(amps, got);
+  }
+}
+
+// --- Public API ---
+
+int qvm_execute_batch(const qvm_circuit_t *const *circuits,
+                      const double *const *params, qvm_batch_result_t *results,
+                      int n, const char *observable) {
+  extern int qnoise_is_enabled(void);
+  extern void qmonitor_record_batch(int circuits, int failed, int qubits,
+                                    int gates, double time_ms, int threads,
+                                    double speedup);
+  extern void qmonitor_record_gate(int gate_type);
+  if (n <= 0)
+    return 0;
+  int *order = (int *)malloc((size_t)n * sizeof(int));
+  if (!order)
+    return n;
+
+  struct timespec wall_start, wall_end;
+  clock_gettime(CLOCK_MONOTONIC, &wall_start);
+  clock_t start = clock();
+  qvm_kernels_select();
+
+  // Whole circuits per worker while one sweep would not fill the pool
+  int threads = qvm_threads_get(), noisy = qnoise_is_enabled();
+  size_t grain = qvm_threads_grain(2 * sizeof(double _Complex));
+  batch_t b = {circuits,
+               params,
+               results,
+               order,
+               observable,
+               qvm_rng_get_seed(),
+               qvm_rng_streams(QVM_RNG_STATES, (uint64_t)n)};
+  int small = 0, large = n;
+  for (int i = 0; i < n; i++) {
+    memset(&results[i], 0, sizeof(results[i]));
+    const double *p = params ? params[i] : NULL;
+    if (!batch_valid(circuits[i], p)) {
+      results[i].status = -1;
+      continue;
+    }
+    size_t pairs = (size_t)1 << (circuits[i]->num_qubits - 1);
+    if (!noisy && (threads <= 1 ||
+                   qvm_parallel_chunks(pairs, grain) < (size_t)threads))
+      order[small++] = i;
+    else
+      order[--large] = i;
+  }
+
+  qvm_parallel_for(small, 1, sweep_circuits, &b);
+  for (int k = n - 1; k >= large; k--) {
+    int i = order[k];
+    if (noisy) {
+      results[i].status = batch_run_noisy(&b, i);
+    } else {
+      b.order = &order[k];
+      sweep_circuits(&b, 0, 0, 1);
+    }
+  }
+
+  clock_t end = clock();
+  clock_gettime(CLOCK_MONOTONIC, &wall_end);
+  double cpu_ms = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+  double time_ms = (wall_end.tv_sec - wall_start.tv_sec) * 1000.0 +
+                   (wall_end.tv_nsec - wall_start.tv_nsec) / 1e6;
+
+  int failed = 0, qubits = 0, gates = 0;
+  for (int i = 0; i < n; i++) {
+    if (circuits[i]->num_qubits > qubits)
+      qubits = circuits[i]->num_qubits;
+    if (results[i].status != 0) {
+      failed++;
+      continue;
+    }
+    gates += circuits[i]->num_gates;
+    for (int g = 0; g < circuits[i]->num_gates; g++)
+      if (circuits[i]->gates[g].type != GATE_MEASURE)
+        qmonitor_record_gate(circuits[i]->gates[g].type);
+  }
+  qmonitor_record_batch(n, failed, qubits, gates, time_ms, threads,
+                        time_ms > 0.0 ? cpu_ms / time_ms : 1.0);
+  free(order);
+  return failed;
+}
@@ -0,0 +1,316 @@
+/*
+ * NexusQ-AI - Density-Matrix Backend
+ * File: modules/quantum/qvm_density.c
+ *
+ * rho is stored vectorized, as the amplitudes of a 2n-qubit statevector:
+ * element rho[r][c] lives at index r | (c << n). A gate U on qubit q is
+ * then U on "qubit" q and conj(U) on q + n, and a Kraus channel
+ * {K_i} is the 4x4 superoperator sum_i K_i (x) conj(K_i) on (q, q + n).
+ * Both go through qvm_apply_matrix2, so the noisy path reuses the same
+ * in-place, chunked, SIMD sweeps as the pure statevector.
+ *
+ * The noise channel (noise.c) is applied here rather than by qnoise_apply:
+ * for 1-qubit gates it is multiplied into the gate's superoperator, so a
+ * noisy gate still costs one sweep. CCX and the macro-ops run as gate
+ * sequences with the channel held back, then take it once per qubit they
+ * touch, like on the statevector.
+ */
+
+#include "include/qvm_backend.h"
+#include "include/qvm_kernels.h"
+#include "include/qvm_threads.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  int n;
+  qvm_state_t vec; // 2n-qubit vectorization of rho
+  int quiet;       // Channel held back while a gate runs as a sequence
+} density_t;
+
+// Superoperator of {K_i} on (q, q + n): local index 2*c + r
+static void superop(double _Complex s[4][4], double _Complex k[][2][2],
+                    int count) {
+  for (int out = 0; out < 4; out++) {
+    for (int in = 0; in < 4; in++) {
+      int r1 = out & 1, c1 = out >> 1, r0 = in & 1, c0 = in >> 1;
+      s[out][in] = 0;
+      for (int i = 0; i < count; i++)
+        s[out][in] += k[i][r1][r0] * conj(k[i][c1][c0]);
+    }
+  }
+}
+
+// Diagonal of rho, i.e. the computational-basis probabilities
+static void diagonal(const density_t *d, double *p) {
+  size_t dim = (size_t)1 << d->n;
+  for (size_t r = 0; r < dim; r++)
+    p[r] = creal(d->vec.amplitudes[r * (dim + 1)]);
+}
+
+static void mat4_mul(double _Complex out[4][4], const double _Complex a[4][4],
+                     const double _Complex b[4][4]) {
+  double _Complex r[4][4];
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      r[i][j] = 0;
+      for (int k = 0; k < 4; k++)
+        r[i][j] += a[i][k] * b[k][j];
+    }
+  }
+  memcpy(out, r, sizeof(r));
+}
+
+// Superoperator of the configured noise channel; 0 if there is none
+static int noise_superop(double _Complex s[4][4]) {
+  extern int qnoise_kraus(double _Complex k[4][2][2]);
+  double _Complex k[4][2][2];
+  int count = qnoise_kraus(k);
+  if (count == 0)
+    return 0;
+  superop(s, k, count);
+  return 1;
+}
+
+double _Complex qvm_density_element(const qvm_state_t *state, size_t row,
+                                    size_t col) {
+  if (state->backend != QVM_BACKEND_DENSITY || !state->backend_state)
+    return 0.0;
+  const density_t *d = (const density_t *)state->backend_state;
+  return d->vec.amplitudes[row | (col << d->n)];
+}
+
+// tr(rho P) = i^y sum_r (-1)^|r & z| rho[r][r ^ x], from P|c> = i^y
+// (-1)^|c & z| |c ^ x>
+int qvm_density_expectation(const qvm_state_t *state, const char *paulis,
+                            double *out) {
+  static const double _Complex phases[4] = {1, I, -1, -I};
+  if (state->backend != QVM_BACKEND_DENSITY || !state->backend_state)
+    return -1;
+  const density_t *d = (const density_t *)state->backend_state;
+  qvm_pauli_t p;
+  if (qvm_pauli_parse(paulis, d->n, &p) != 0)
+    return -1;
+  size_t dim = (size_t)1 << d->n;
+  double _Complex sum = 0.0;
+  for (size_t r = 0; r < dim; r++) {
+    double _Complex e = d->vec.amplitudes[r | ((r ^ p.x) << d->n)];
+    sum += __builtin_popcountll(r & p.z) & 1 ? -e : e;
+  }
+  *out = creal(phases[p.y_count & 3] * sum);
+  return 0;
+}
+
+// --- Backend table ---
+
+static int density_init(qvm_state_t *state, int num_qubits) {
+  density_t *d = (density_t *)calloc(1, sizeof(density_t));
+  if (!d)
+    return -1;
+  size_t size = (size_t)1 << (2 * num_qubits);
+  d->n = num_qubits;
+  d->vec.num_qubits = 2 * num_qubits;
+  d->vec.backend = QVM_BACKEND_STATEVECTOR;
+  d->vec.amplitudes =
+      (double _Complex *)calloc(size, sizeof(double _Complex));
+  if (!d->vec.amplitudes) {
+    free(d);
+    return -1;
+  }
+  d->vec.amplitudes[0] = 1.0; // |0...0><0...0|
+  qvm_kernels_select();
+  state->backend_state = d;
+  return 0;
+}
+
+static void density_free(qvm_state_t *state) {
+  density_t *d = (density_t *)state->backend_state;
+  free(d->vec.amplitudes);
+  free(d);
+  state->backend_state = NULL;
+}
+
+static int density_apply_gate(qvm_state_t *state, const qvm_gate_t *gate) {
+  density_t *d = (density_t *)state->backend_state;
+  int n = d->n;
+  double _Complex u[1][2][2], m[4][4], noise[4][4];
+  int noisy = !d->quiet && noise_superop(noise);
+
+  // 1-qubit gates: U rho U^dagger, then the channel, in a single sweep
+  if (qvm_gate_unitary(gate, u[0]) == 0) {
+    superop(m, u, 1);
+    if (noisy)
+      mat4_mul(m, noise, m);
+    qvm_apply_matrix2(&d->vec, gate->target, gate->target + n, m);
+    return 0;
+  }
+
+  int range = qvm_gate_is_range(gate->type);
+  if (gate->type == GATE_CCX || range) {
+    d->quiet = 1;
+    int rc = range ? qvm_backend_macro(state, &qvm_backend_density, gate)
+                   : qvm_backend_ccx(state, &qvm_backend_density, gate);
+    d->quiet = 0;
+    if (rc != 0 || !noisy)
+      return rc;
+    if (range) {
+      for (int q = gate->control; q <= gate->target; q++)
+        qvm_apply_matrix2(&d->vec, q, q + n, noise);
+    } else {
+      qvm_apply_matrix2(&d->vec, gate->target, gate->target + n, noise);
+      qvm_apply_matrix2(&d->vec, gate->control, gate->control + n, noise);
+      qvm_apply_matrix2(&d->vec, gate->control2, gate->control2 + n, noise);
+    }
+    return 0;
+  }
+
+  int lo = gate->control < gate->target ? gate->control : gate->target;
+  int hi = gate->control < gate->target ? gate->target : gate->control;
+  if (qvm_gate_matrix2(gate, lo, m) != 0)
+    return -1;
+  qvm_apply_matrix2(&d->vec, lo, hi, m);
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+      m[i][j] = conj(m[i][j]);
+  qvm_apply_matrix2(&d->vec, lo + n, hi + n, m);
+  if (noisy) {
+    qvm_apply_matrix2(&d->vec, lo, lo + n, noise);
+    qvm_apply_matrix2(&d->vec, hi, hi + n, noise);
+  }
+  return 0;
+}
+
+typedef struct {
+  density_t *d;
+  int qubit;
+  int result;
+  double scale;
+} collapse_sweep_t;
+
+// Columns [b, e) of rho: keep the block where row and column agree with
+// the outcome, zero the rest
+static void sweep_collapse(void *arg, size_t chunk, size_t b, size_t e) {
+  collapse_sweep_t *sw = (collapse_sweep_t *)arg;
+  size_t dim = (size_t)1 << sw->d->n;
+  for (size_t c = b; c < e; c++) {
+    double _Complex *col = sw->d->vec.amplitudes + c * dim;
+    if ((int)((c >> sw->qubit) & 1) != sw->result) {
+      memset(col, 0, dim * sizeof(double _Complex));
+      continue;
+    }
+    for (size_t r = 0; r < dim; r++)
+      col[r] = (int)((r >> sw->qubit) & 1) == sw->result ? col[r] * sw->scale
+                                                          : 0.0;
+  }
+}
+
+static int density_measure(qvm_state_t *state, int qubit) {
+  density_t *d = (density_t *)state->backend_state;
+  size_t dim = (size_t)1 << d->n;
+  double p[2] = {0.0, 0.0};
+  for (size_t r = 0; r < dim; r++)
+    p[(r >> qubit) & 1] += creal(d->vec.amplitudes[r * (dim + 1)]);
+
+  double r = qvm_rng_uniform(qvm_state_rng(state));
+  int result = r * (p[0] + p[1]) < p[0] ? 0 : 1;
+  if (p[result] <= 0.0)
+    result ^= 1;
+
+  collapse_sweep_t sw = {
+      .d = d, .qubit = qubit, .result = result, .scale = 1.0 / p[result]};
+  qvm_parallel_for(dim, qvm_threads_grain(dim * sizeof(double _Complex)),
+                   sweep_collapse, &sw);
+  return result;
+}
+
+// Sample from the diagonal. Readout errors mix P(0) and P(1) of each
+// measured qubit before drawing, which is the same as flipping each
+// reported bit independently.
+static int density_sample(qvm_state_t *state, int shots, uint64_t mask,
+                          qvm_counts_t *out_counts) {
+  extern double qnoise_readout_error(void);
+  density_t *d = (density_t *)state->backend_state;
+  size_t dim = (size_t)1 << d->n;
+  double *p = (double *)malloc(dim * sizeof(double));
+  uint64_t *outcomes = (uint64_t *)malloc(shots * sizeof(uint64_t));
+  qvm_state_t probe = {.num_qubits = d->n,
+                       .backend = QVM_BACKEND_STATEVECTOR,
+                       .amplitudes = (double _Complex *)malloc(
+                           dim * sizeof(double _Complex)),
+                       .rng = *qvm_state_rng(state)};
+  int rc = -1;
+  if (!p || !outcomes || !probe.amplitudes)
+    goto out;
+
+  diagonal(d, p);
+  double e = qnoise_readout_error();
+  for (int q = 0; e > 0.0 && q < d->n && q < 64; q++) {
+    if (!((mask >> q) & 1))
+      continue;
+    for (size_t i = 0; i < dim; i++) {
+      if ((i >> q) & 1)
+        continue;
+      size_t j = i | ((size_t)1 << q);
+      double p0 = p[i], p1 = p[j];
+      p[i] = (1.0 - e) * p0 + e * p1;
+      p[j] = e * p0 + (1.0 - e) * p1;
+    }
+  }
+
+  // Draw through the statevector sampler from amplitudes sqrt(p), on this
+  // state's stream
+  for (size_t i = 0; i < dim; i++)
+    probe.amplitudes[i] = p[i] > 0.0 ? sqrt(p[i]) : 0.0;
+  qvm_counts_t full;
+  int sampled = qvm_sample(&probe, shots, &full);
+  state->rng = probe.rng;
+  if (sampled != 0)
+    goto out;
+  int s = 0;
+  for (int o = 0; o < full.num_outcomes; o++)
+    for (int c = 0; c < full.counts[o]; c++)
+      outcomes[s++] = full.outcomes[o] & mask;
+  qvm_counts_free(&full);
+  rc = qvm_counts_from_outcomes(outcomes, s, d->n, mask, out_counts);
+
+out:
+  free(p);
+  free(outcomes);
+  free(probe.amplitudes);
+  return rc;
+}
+
+static void density_print(const qvm_state_t *state) {
+  const density_t *d = (const density_t *)state->backend_state;
+  size_t dim = (size_t)1 << d->n, size = dim * dim;
+  double purity = 0.0;
+  for (size_t i = 0; i < size; i++) {
+    double _Complex a = d->vec.amplitudes[i];
+    purity += creal(a) * creal(a) + cimag(a) * cimag(a);
+  }
+
+  printf("\n--- Density Matrix (%d qubits, purity %.4f) ---\n", d->n, purity);
+  for (size_t r = 0; r < dim; r++) {
+    double prob = creal(d->vec.amplitudes[r * (dim + 1)]);
+    if (prob > 0.001) {
+      printf("|");
+      for (int j = d->n - 1; j >= 0; j--)
+        printf("%d", (int)((r >> j) & 1));
+      printf(">: %.4f\n", prob);
+    }
+  }
+  printf("---------------------\n");
+}
+
+const qvm_backend_ops_t qvm_backend_density = {
+    .name = "density",
+    .max_qubits = QVM_DENSITY_MAX_QUBITS,
+    .init = density_init,
+    .free = density_free,
+    .apply_gate = density_apply_gate,
+    .measure = density_measure,
+    .sample = density_sample,
+    .print = density_print,
+};
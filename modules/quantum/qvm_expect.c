@@ -0,0 +1,309 @@
+/*
+ * NexusQ-AI - Pauli Expectation Values
+ * File: modules/quantum/qvm_expect.c
+ *
+ * <H> = sum_k c_k <psi|P_k|psi> for a Hamiltonian given as Pauli strings,
+ * read exactly off the statevector in place: no copy, no sampling. From
+ * P|i> = i^y (-1)^|i & z| |i ^ x>, a term is the sum over i of
+ * conj(a[i ^ x]) a[i] signed by the parity of i & z. Terms are grouped by
+ * their x mask and each group costs one sweep:
+ *  - the sweep fills a histogram over the union of the group's z bits (at
+ *    most EXPECT_HIST_BITS qubits); each term is then a signed sum over
+ *    the histogram with its z mask as a parity mask;
+ *  - Z-only terms (x = 0) sweep |a[i]|^2 through the ISA norms kernel, so
+ *    a diagonal Hamiltonian such as a QAOA cost over up to
+ *    EXPECT_HIST_BITS qubits is one vectorized read of the state;
+ *  - a term with more z bits than that, or alone with its x mask, gets a
+ *    sweep of its own binned by the parity itself.
+ * Partial histograms are kept per chunk and added in chunk order, so the
+ * result does not depend on the thread count.
+ */
+
+#include "include/qvm_backend.h"
+#include "include/qvm_kernels.h"
+#include "include/qvm_threads.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EXPECT_HIST_BITS 10 // Qubits binned by one sweep
+#define EXPECT_CHUNKS 64    // Partial histograms per sweep, at most
+
+int qvm_pauli_parse(const char *paulis, int num_qubits, qvm_pauli_t *p) {
+  memset(p, 0, sizeof(*p));
+  for (int q = 0; paulis[q]; q++) {
+    char c = paulis[q];
+    if (c == 'I')
+      continue;
+    if ((c != 'X' && c != 'Y' && c != 'Z') || q >= num_qubits || q >= 64)
+      return -1;
+    if (c != 'Z')
+      p->x |= (uint64_t)1 << q;
+    if (c != 'X')
+      p->z |= (uint64_t)1 << q;
+    p->y_count += c == 'Y';
+  }
+  return 0;
+}
+
+// --- Sweeps ---
+
+typedef struct {
+  const qvm_kernel_ops_t *k;
+  const double _Complex *amps;
+  uint64_t x;
+  uint64_t bits; // Histogram index: bits of i under `bits`, packed...
+  int parity;    // ...or the parity of i & bits when set
+  size_t buckets;
+  double *norms;         // x == 0: [chunk][bucket]
+  double _Complex *sums; // Otherwise: [chunk][bucket]
+} expect_sweep_t;
+
+static uint64_t gather(uint64_t i, uint64_t mask) {
+  uint64_t out = 0;
+  for (uint64_t bit = 1; mask; mask &= mask - 1, bit <<= 1)
+    if (i & mask & -mask)
+      out |= bit;
+  return out;
+}
+
+static void sweep_norms(void *arg, size_t chunk, size_t b, size_t e) {
+  expect_sweep_t *sw = (expect_sweep_t *)arg;
+  sw->k->norms(sw->amps, sw->bits, b, e, sw->norms + chunk * sw->buckets);
+}
+
+// Parity binning: the term only needs bucket 0 minus bucket 1, so the
+// signed sum is kept in registers and stored as bucket 0
+static void sweep_parity(const expect_sweep_t *sw, double _Complex *h,
+                         size_t b, size_t e) {
+  const double _Complex *a = sw->amps;
+  double sr = 0.0, si = 0.0;
+  if (sw->x == 0) {
+    for (size_t i = b; i < e; i++) {
+      double norm = creal(a[i]) * creal(a[i]) + cimag(a[i]) * cimag(a[i]);
+      sr += __builtin_parityll(i & sw->bits) ? -norm : norm;
+    }
+    h[0] += sr;
+    return;
+  }
+  size_t low = sw->x & -sw->x;
+  int flip = __builtin_parityll(sw->x & sw->bits);
+  for (size_t k = b; k < e; k++) {
+    size_t i0 = ((k & ~(low - 1)) << 1) | (k & (low - 1)), i1 = i0 ^ sw->x;
+    double ur = creal(a[i1]), ui = cimag(a[i1]);
+    double vr = creal(a[i0]), vi = cimag(a[i0]);
+    int p = __builtin_parityll(i0 & sw->bits);
+    double s0 = p ? -1.0 : 1.0, s1 = p ^ flip ? -1.0 : 1.0;
+    sr += (s0 + s1) * (ur * vr + ui * vi);
+    si += (s0 - s1) * (ur * vi - ui * vr);
+  }
+  h[0] += sr + si * I;
+}
+
+// Pair index k spans the i0 with the lowest x bit clear; the partner
+// i1 = i0 ^ x contributes conj(a[i0]) a[i1], the conjugate of
+// t = conj(a[i1]) a[i0]. Products written out as in the kernels.
+static void sweep_pairs(void *arg, size_t chunk, size_t b, size_t e) {
+  expect_sweep_t *sw = (expect_sweep_t *)arg;
+  const double _Complex *a = sw->amps;
+  double _Complex *h = sw->sums + chunk * sw->buckets;
+  if (sw->parity) {
+    sweep_parity(sw, h, b, e);
+    return;
+  }
+  size_t low = sw->x & -sw->x;
+  for (size_t k = b; k < e; k++) {
+    size_t i0 = ((k & ~(low - 1)) << 1) | (k & (low - 1)), i1 = i0 ^ sw->x;
+    double ur = creal(a[i1]), ui = cimag(a[i1]);
+    double vr = creal(a[i0]), vi = cimag(a[i0]);
+    double re = ur * vr + ui * vi, im = ur * vi - ui * vr;
+    h[gather(i0, sw->bits)] += re + im * I;
+    h[gather(i1, sw->bits)] += re - im * I;
+  }
+}
+
+// One group: terms[0..count) share p->x; bins by `bits` (or the parity of
+// a single term's z). values[t] = <P_t>.
+static void sweep_group(const qvm_state_t *state, const qvm_pauli_t *p,
+                        const int *terms, int count, uint64_t bits,
+                        int parity, double *values) {
+  static const double _Complex phases[4] = {1, I, -1, -I};
+  uint64_t x = p[terms[0]].x;
+  size_t size = (size_t)1 << state->num_qubits;
+  size_t buckets = parity ? 2 : (size_t)1 << __builtin_popcountll(bits);
+  size_t grain = qvm_threads_grain(sizeof(double _Complex));
+  if (qvm_parallel_chunks(size, grain) > EXPECT_CHUNKS)
+    grain = (size + EXPECT_CHUNKS - 1) / EXPECT_CHUNKS;
+  size_t chunks = qvm_parallel_chunks(size, grain);
+
+  // One chunk on a stack histogram when the partials do not fit
+  double _Complex local[1 << EXPECT_HIST_BITS];
+  double _Complex *partial =
+      (double _Complex *)calloc(chunks * buckets, sizeof(double _Complex));
+  if (!partial) {
+    grain = size;
+    chunks = 1;
+    partial = local;
+    memset(local, 0, buckets * sizeof(double _Complex));
+  }
+  expect_sweep_t sw = {.k = qvm_kernels_get(),
+                       .amps = state->amplitudes,
+                       .x = x,
+                       .bits = bits,
+                       .parity = parity,
+                       .buckets = buckets,
+                       .norms = (double *)partial,
+                       .sums = partial};
+  if (x == 0 && !parity)
+    qvm_parallel_for(size, grain, sweep_norms, &sw);
+  else
+    qvm_parallel_for(x ? size / 2 : size, grain, sweep_pairs, &sw);
+
+  double _Complex hist[1 << EXPECT_HIST_BITS];
+  for (size_t b = 0; b < buckets; b++) {
+    hist[b] = 0.0;
+    for (size_t c = 0; c < chunks; c++)
+      hist[b] += x == 0 && !parity ? sw.norms[c * buckets + b]
+                                   : partial[c * buckets + b];
+  }
+  if (partial != local)
+    free(partial);
+
+  for (int t = 0; t < count; t++) {
+    const qvm_pauli_t *term = &p[terms[t]];
+    uint64_t z = parity ? 1 : gather(term->z, bits);
+    double _Complex sum = 0.0;
+    for (size_t b = 0; b < buckets; b++)
+      sum += __builtin_parityll(b & z) ? -hist[b] : hist[b];
+    values[terms[t]] = creal(phases[term->y_count & 3] * sum);
+  }
+}
+
+typedef struct {
+  uint64_t x;
+  int term;
+} expect_key_t;
+
+// Terms ordered by x mask, then by position
+static int by_x(const void *a, const void *b) {
+  const expect_key_t *ka = (const expect_key_t *)a;
+  const expect_key_t *kb = (const expect_key_t *)b;
+  if (ka->x != kb->x)
+    return ka->x < kb->x ? -1 : 1;
+  return ka->term - kb->term;
+}
+
+// values[t] = <P_t> for every term, one sweep per group
+static int statevector_values(const qvm_state_t *state, const qvm_pauli_t *p,
+                              int num_terms, double *values) {
+  expect_key_t *keys =
+      (expect_key_t *)malloc((size_t)num_terms * sizeof(expect_key_t));
+  int *order = (int *)malloc((size_t)num_terms * sizeof(int));
+  if (!keys || !order) {
+    free(keys);
+    free(order);
+    return -1;
+  }
+  for (int t = 0; t < num_terms; t++)
+    keys[t] = (expect_key_t){p[t].x, t};
+  qsort(keys, num_terms, sizeof(expect_key_t), by_x);
+  for (int t = 0; t < num_terms; t++)
+    order[t] = keys[t].term;
+  free(keys);
+
+  int t = 0;
+  while (t < num_terms) {
+    const qvm_pauli_t *first = &p[order[t]];
+    if (__builtin_popcountll(first->z) > EXPECT_HIST_BITS) {
+      sweep_group(state, p, &order[t], 1, first->z, 1, values);
+      t++;
+      continue;
+    }
+    uint64_t bits = 0;
+    int count = 0;
+    while (t + count < num_terms) {
+      const qvm_pauli_t *next = &p[order[t + count]];
+      if (next->x != first->x ||
+          __builtin_popcountll(bits | next->z) > EXPECT_HIST_BITS)
+        break;
+      bits |= next->z;
+      count++;
+    }
+    // A lone X/Y term bins by parity: cheaper than gathering its z bits
+    int parity = count == 1 && first->x != 0;
+    sweep_group(state, p, &order[t], count, bits, parity, values);
+    t += count;
+  }
+  free(order);
+  return 0;
+}
+
+double qvm_pauli_expectation(const qvm_state_t *state, const qvm_pauli_t *p) {
+  double value = 0.0;
+  int term = 0;
+  int parity = p->x != 0 || __builtin_popcountll(p->z) > EXPECT_HIST_BITS;
+  sweep_group(state, p, &term, 1, p->z, parity, &value);
+  return value;
+}
+
+// --- Public API ---
+
+int qvm_expectation_terms(const qvm_state_t *state, const char *const *terms,
+                          int num_terms, double *values) {
+  int n = state->num_qubits;
+  if (num_terms <= 0)
+    return 0;
+  if (n < 1)
+    return -1;
+
+  switch (state->backend) {
+  case QVM_BACKEND_STATEVECTOR:
+    if (!state->amplitudes)
+      return -1;
+    break;
+  case QVM_BACKEND_MPS:
+    for (int t = 0; t < num_terms; t++)
+      if (qvm_mps_expectation(state, terms[t], &values[t]) != 0)
+        return -1;
+    return 0;
+  case QVM_BACKEND_DENSITY:
+    for (int t = 0; t < num_terms; t++)
+      if (qvm_density_expectation(state, terms[t], &values[t]) != 0)
+        return -1;
+    return 0;
+  default:
+    printf("[QVM] Expectation: not available on the %s backend\n",
+           qvm_backend_ops(state)->name);
+    return -1;
+  }
+
+  qvm_pauli_t *p = (qvm_pauli_t *)malloc((size_t)num_terms * sizeof(*p));
+  if (!p)
+    return -1;
+  for (int t = 0; t < num_terms; t++) {
+    if (qvm_pauli_parse(terms[t], n, &p[t]) != 0) {
+      printf("[QVM] Expectation: bad Pauli term '%s'\n", terms[t]);
+      free(p);
+      return -1;
+    }
+  }
+  int rc = statevector_values(state, p, num_terms, values);
+  free(p);
+  return rc;
+}
+
+int qvm_expectation(const qvm_state_t *state, const char *const *terms,
+                    const double *coeffs, int num_terms, double *out) {
+  double *values = (double *)malloc(
+      (size_t)(num_terms > 0 ? num_terms : 1) * sizeof(double));
+  if (!values)
+    return -1;
+  int rc = qvm_expectation_terms(state, terms, num_terms, values);
+  if (rc == 0) {
+    *out = 0.0;
+    for (int t = 0; t < num_terms; t++)
+      *out += (coeffs ? coeffs[t] : 1.0) * values[t];
+  }
+  free(values);
+  return rc;
+}
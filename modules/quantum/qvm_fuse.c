@@ -0,0 +1,288 @@
+/*
+ * NexusQ-AI - Gate Fusion Pass
+ * File: modules/quantum/qvm_fuse.c
+ *
+ * Compiles a qvm_circuit_t into a list of fused blocks, each executed as a
+ * single statevector sweep:
+ *  - runs of 1-qubit gates on a wire collapse into one 2x2 matrix;
+ *  - pending 1-qubit matrices are absorbed into the next 2-qubit gate on
+ *    that wire, and later 1-qubit gates into the still-open 2-qubit block;
+ *  - consecutive 2-qubit gates on the same pair share one 4x4 matrix;
+ *  - a 2-qubit block left with its single gate keeps that gate, so CZ or
+ *    SWAP still run as a phase or a permutation (see qvm_gate_form);
+ *  - MEASURE, CCX and the range macro-ops (QFT, DIFFUSE) stay as they are.
+ * Gates on other wires commute with a block, so merging is valid as long
+ * as nothing else has touched the block's qubits in between.
+ */
+
+#include "include/qvm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  qvm_fused_program_t *prog;
+  double _Complex pending[QVM_MAX_QUBITS][2][2];
+  int pending_gates[QVM_MAX_QUBITS]; // 0 = no pending matrix
+  int open_block[QVM_MAX_QUBITS];    // Open 2Q block index, or -1
+} fuse_ctx_t;
+
+static void mat2_mul(double _Complex out[2][2], const double _Complex a[2][2],
+                     const double _Complex b[2][2]) {
+  double _Complex r[2][2];
+  for (int i = 0; i < 2; i++)
+    for (int j = 0; j < 2; j++)
+      r[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j];
+  memcpy(out, r, sizeof(r));
+}
+
+static void mat4_mul(double _Complex out[4][4], const double _Complex a[4][4],
+                     const double _Complex b[4][4]) {
+  double _Complex r[4][4];
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      r[i][j] = 0;
+      for (int k = 0; k < 4; k++)
+        r[i][j] += a[i][k] * b[k][j];
+    }
+  }
+  memcpy(out, r, sizeof(r));
+}
+
+// Embed a 2x2 acting on bit `which` (0 = q0, 1 = q1) of the local basis
+static void mat4_lift(double _Complex out[4][4], const double _Complex g[2][2],
+                      int which) {
+  for (int r = 0; r < 4; r++) {
+    for (int c = 0; c < 4; c++) {
+      int rb = (r >> which) & 1, cb = (c >> which) & 1;
+      int same_other = ((r >> (1 - which)) & 1) == ((c >> (1 - which)) & 1);
+      out[r][c] = same_other ? g[rb][cb] : 0;
+    }
+  }
+}
+
+static int is_identity2(const double _Complex m[2][2]) {
+  const double eps = 1e-12;
+  return cabs(m[0][0] - 1) < eps && cabs(m[1][1] - 1) < eps &&
+         cabs(m[0][1]) < eps && cabs(m[1][0]) < eps;
+}
+
+static qvm_fused_block_t *new_block(fuse_ctx_t *ctx, qvm_block_kind_t kind) {
+  qvm_fused_block_t *b = &ctx->prog->blocks[ctx->prog->num_blocks++];
+  memset(b, 0, sizeof(*b));
+  b->kind = kind;
+  b->q1 = -1;
+  return b;
+}
+
+// Emit the pending 1-qubit matrix of a wire as its own block
+static void flush_pending(fuse_ctx_t *ctx, int q) {
+  if (ctx->pending_gates[q] == 0)
+    return;
+  if (!is_identity2(ctx->pending[q])) {
+    qvm_fused_block_t *b = new_block(ctx, QVM_BLOCK_1Q);
+    b->q0 = q;
+    memcpy(b->u2, ctx->pending[q], sizeof(b->u2));
+    b->num_source_gates = ctx->pending_gates[q];
+  }
+  ctx->pending_gates[q] = 0;
+}
+
+static void close_block(fuse_ctx_t *ctx, int q) {
+  int k = ctx->open_block[q];
+  if (k < 0)
+    return;
+  qvm_fused_block_t *b = &ctx->prog->blocks[k];
+  if (ctx->open_block[b->q0] == k)
+    ctx->open_block[b->q0] = -1;
+  if (ctx->open_block[b->q1] == k)
+    ctx->open_block[b->q1] = -1;
+}
+
+static void fuse_single(fuse_ctx_t *ctx, const qvm_gate_t *g,
+                        const double _Complex m[2][2]) {
+  int q = g->target;
+  int k = ctx->open_block[q];
+
+  if (k >= 0) {
+    // Absorb into the open 2-qubit block on this wire
+    qvm_fused_block_t *b = &ctx->prog->blocks[k];
+    double _Complex lifted[4][4];
+    mat4_lift(lifted, m, q == b->q0 ? 0 : 1);
+    mat4_mul(b->u4, lifted, b->u4);
+    b->num_source_gates++;
+    return;
+  }
+
+  if (ctx->pending_gates[q] == 0) {
+    memcpy(ctx->pending[q], m, sizeof(ctx->pending[q]));
+  } else {
+    mat2_mul(ctx->pending[q], m, ctx->pending[q]);
+  }
+  ctx->pending_gates[q]++;
+}
+
+static int fuse_two(fuse_ctx_t *ctx, const qvm_gate_t *g) {
+  int q0 = g->control < g->target ? g->control : g->target;
+  int q1 = g->control < g->target ? g->target : g->control;
+  double _Complex u[4][4];
+  if (qvm_gate_matrix2(g, q0, u) != 0)
+    return -1;
+
+  // Same pair as the open block: extend it
+  int k = ctx->open_block[q0];
+  if (k >= 0 && k == ctx->open_block[q1]) {
+    qvm_fused_block_t *b = &ctx->prog->blocks[k];
+    mat4_mul(b->u4, u, b->u4);
+    b->num_source_gates++;
+    return 0;
+  }
+
+  close_block(ctx, q0);
+  close_block(ctx, q1);
+
+  qvm_fused_block_t *b = new_block(ctx, QVM_BLOCK_2Q);
+  b->q0 = q0;
+  b->q1 = q1;
+  b->op = *g;
+  memcpy(b->u4, u, sizeof(b->u4));
+  b->num_source_gates = 1;
+
+  // Pending wire matrices happened earlier: U * (P(q1) (x) P(q0))
+  int wires[2] = {q0, q1};
+  for (int w = 0; w < 2; w++) {
+    int q = wires[w];
+    if (ctx->pending_gates[q] == 0)
+      continue;
+    double _Complex lifted[4][4];
+    mat4_lift(lifted, ctx->pending[q], w);
+    mat4_mul(b->u4, b->u4, lifted);
+    b->num_source_gates += ctx->pending_gates[q];
+    ctx->pending_gates[q] = 0;
+  }
+
+  int idx = (int)(b - ctx->prog->blocks);
+  ctx->open_block[q0] = idx;
+  ctx->open_block[q1] = idx;
+  return 0;
+}
+
+static void fuse_wire(fuse_ctx_t *ctx, int q) {
+  if (q < 0 || q >= QVM_MAX_QUBITS)
+    return;
+  flush_pending(ctx, q);
+  // Only this wire leaves its open block; the partner can keep absorbing
+  ctx->open_block[q] = -1;
+}
+
+static void fuse_op(fuse_ctx_t *ctx, const qvm_gate_t *g) {
+  if (qvm_gate_is_range(g->type)) {
+    for (int q = g->control; q <= g->target; q++)
+      fuse_wire(ctx, q);
+  } else {
+    fuse_wire(ctx, g->target);
+    fuse_wire(ctx, g->control);
+    if (g->type == GATE_CCX)
+      fuse_wire(ctx, g->control2);
+  }
+
+  qvm_fused_block_t *b = new_block(ctx, QVM_BLOCK_OP);
+  b->q0 = g->target;
+  b->op = *g;
+  b->num_source_gates = 1;
+}
+
+int qvm_fuse_circuit(const qvm_circuit_t *circuit, qvm_fused_program_t *prog) {
+  prog->blocks = NULL;
+  prog->num_blocks = 0;
+  if (circuit->num_qubits < 1 || circuit->num_qubits > QVM_MAX_QUBITS)
+    return -1;
+
+  prog->num_qubits = circuit->num_qubits;
+  prog->num_source_gates = circuit->num_gates;
+  // Every gate yields at most one block
+  prog->blocks = (qvm_fused_block_t *)malloc(
+      (circuit->num_gates + 1) * sizeof(qvm_fused_block_t));
+  if (!prog->blocks)
+    return -1;
+
+  fuse_ctx_t ctx;
+  ctx.prog = prog;
+  for (int q = 0; q < QVM_MAX_QUBITS; q++) {
+    ctx.pending_gates[q] = 0;
+    ctx.open_block[q] = -1;
+  }
+
+  for (int i = 0; i < circuit->num_gates; i++) {
+    const qvm_gate_t *g = &circuit->gates[i];
+    if (!qvm_gate_valid(g, circuit->num_qubits)) {
+      printf("[QVM] Fusion: gate %d uses an invalid qubit\n", i);
+      qvm_fused_free(prog);
+      return -1;
+    }
+
+    double _Complex m[2][2];
+    if (qvm_gate_unitary(g, m) == 0) {
+      fuse_single(&ctx, g, m);
+    } else if (qvm_gate_is_two_qubit(g->type)) {
+      fuse_two(&ctx, g);
+    } else {
+      fuse_op(&ctx, g);
+    }
+  }
+
+  for (int q = 0; q < circuit->num_qubits && q < QVM_MAX_QUBITS; q++)
+    flush_pending(&ctx, q);
+
+  return 0;
+}
+
+void qvm_execute_block(qvm_state_t *state, const qvm_fused_block_t *b) {
+  switch (b->kind) {
+  case QVM_BLOCK_1Q:
+    qvm_apply_matrix(state, b->q0, b->u2);
+    break;
+  case QVM_BLOCK_2Q:
+    if (b->num_source_gates == 1)
+      qvm_apply_unitary(state, &b->op);
+    else
+      qvm_apply_matrix2(state, b->q0, b->q1, b->u4);
+    break;
+  case QVM_BLOCK_OP: {
+    // CCX and macro-ops sweep directly; MEASURE takes the full path
+    qvm_gate_t op = b->op;
+    if (qvm_apply_unitary(state, &op) != 0)
+      qvm_apply_gate(state, &op);
+    break;
+  }
+  }
+}
+
+// Statevectors past the tile width run cache-blocked (see qvm_tile.c)
+void qvm_execute_fused(qvm_state_t *state, const qvm_fused_program_t *prog) {
+  int k = state->backend == QVM_BACKEND_STATEVECTOR && state->amplitudes
+              ? qvm_tile_qubits(state->num_qubits)
+              : 0;
+  qvm_tile_plan_t plan;
+  if (k > 0 && state->num_qubits == prog->num_qubits &&
+      qvm_tile_plan(prog, k, &plan) == 0) {
+    qvm_execute_tiled(state, &plan);
+    qvm_tile_plan_free(&plan);
+    return;
+  }
+  for (int i = 0; i < prog->num_blocks; i++)
+    qvm_execute_block(state, &prog->blocks[i]);
+}
+
+void qvm_fused_free(qvm_fused_program_t *prog) {
+  free(prog->blocks);
+  prog->blocks = NULL;
+  prog->num_blocks = 0;
+}
+
+// Source gates per statevector sweep. Memory traffic shrinks by this factor.
+double qvm_fusion_ratio(const qvm_fused_program_t *prog) {
+  if (prog->num_blocks == 0)
+    return prog->num_source_gates > 0 ? (double)prog->num_source_gates : 1.0;
+  return (double)prog->num_source_gates / prog->num_blocks;
+}
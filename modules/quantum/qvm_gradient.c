@@ -0,0 +1,381 @@
+/*
+ * NexusQ-AI - Circuit Gradients
+ * File: modules/quantum/qvm_gradient.c
+ *
+ * d<P>/dparams for a parameterized circuit and a Pauli observable P.
+ *
+ * Adjoint method (noiseless statevector): run the circuit forward once to
+ * get psi, set lambda = P psi, then walk the gates backwards undoing each
+ * one on both vectors. At a gate with symbolic angles,
+ *   d<P>/dtheta = 2 Re <lambda| dU/dtheta |psi>
+ * with psi and lambda taken just before and just after the gate; the
+ * product is one read pass over both vectors, D psi is never stored. Memory
+ * is two statevectors and the cost about three forward passes, whatever the
+ * number of parameters.
+ *
+ * Parameter shift (noisy or non-statevector backends): every supported
+ * rotation has a generator with two eigenvalues one apart, so
+ *   d<P>/dtheta = (<P>(theta + pi/2) - <P>(theta - pi/2)) / 2
+ * exactly, at two circuit runs per symbolic angle.
+ */
+
+#include "include/qvm_backend.h"
+#include "include/qvm_kernels.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GRAD_TRAJ_SEED 0x5eed // Common random numbers across shifts
+
+// --- Gate derivatives ---
+
+// dU/dtheta[slot] of a 1-qubit rotation; -1 if the gate has no angles
+static int derivative1(const qvm_gate_t *g, int slot, double _Complex m[2][2]) {
+  double c = cos(g->theta[0] / 2) / 2, s = sin(g->theta[0] / 2) / 2;
+  switch (g->type) {
+  case GATE_RX:
+    m[0][0] = m[1][1] = -s;
+    m[0][1] = m[1][0] = -I * c;
+    return 0;
+  case GATE_RY:
+    m[0][0] = m[1][1] = -s;
+    m[0][1] = -c;
+    m[1][0] = c;
+    return 0;
+  case GATE_RZ:
+    m[0][0] = -I / 2 * cexp(-I * g->theta[0] / 2);
+    m[0][1] = m[1][0] = 0;
+    m[1][1] = I / 2 * cexp(I * g->theta[0] / 2);
+    return 0;
+  case GATE_U3: {
+    double _Complex ep = cexp(I * g->theta[1]), el = cexp(I * g->theta[2]);
+    if (slot == 0) {
+      m[0][0] = -s;
+      m[0][1] = -el * c;
+      m[1][0] = ep * c;
+      m[1][1] = -ep * el * s;
+    } else if (slot == 1) {
+      m[0][0] = m[0][1] = 0;
+      m[1][0] = 2 * I * ep * s;
+      m[1][1] = 2 * I * ep * el * c;
+    } else {
+      m[0][0] = m[1][0] = 0;
+      m[0][1] = -2 * I * el * s;
+      m[1][1] = 2 * I * ep * el * c;
+    }
+    return 0;
+  }
+  default:
+    return -1;
+  }
+}
+
+// Same for CPHASE and RZZ, in the basis of qvm_gate_matrix2(g, q0, ...)
+static int derivative2(const qvm_gate_t *g, int q0, double _Complex m[4][4]) {
+  memset(m, 0, 16 * sizeof(double _Complex));
+  int cbit = g->control == q0 ? 0 : 1;
+  int tbit = g->target == q0 ? 0 : 1;
+  for (int l = 0; l < 4; l++) {
+    int c = (l >> cbit) & 1, t = (l >> tbit) & 1;
+    if (g->type == GATE_CPHASE)
+      m[l][l] = (c && t) ? I * cexp(I * g->theta[0]) : 0;
+    else if (g->type == GATE_RZZ)
+      m[l][l] = (c ^ t ? I : -I) / 2 * cexp((c ^ t ? I : -I) * g->theta[0] / 2);
+    else
+      return -1;
+  }
+  return 0;
+}
+
+// --- Adjoint method ---
+
+static void dagger2(double _Complex d[2][2], const double _Complex m[2][2]) {
+  for (int r = 0; r < 2; r++)
+    for (int c = 0; c < 2; c++)
+      d[r][c] = conj(m[c][r]);
+}
+
+static void dagger4(double _Complex d[4][4], const double _Complex m[4][4]) {
+  for (int r = 0; r < 4; r++)
+    for (int c = 0; c < 4; c++)
+      d[r][c] = conj(m[c][r]);
+}
+
+// Apply U^dagger of one gate to each of the `count` states
+static void undo_gate(const qvm_gate_t *g, qvm_state_t *states, int count) {
+  double _Complex m2[2][2], d2[2][2], m4[4][4], d4[4][4];
+  if (g->type == GATE_CCX || g->type == GATE_DIFFUSE) { // Own inverses
+    for (int i = 0; i < count; i++)
+      qvm_apply_unitary(&states[i], g);
+    return;
+  }
+  if (g->type == GATE_QFT || g->type == GATE_IQFT) {
+    for (int i = 0; i < count; i++)
+      qvm_apply_qft(&states[i], g->control, g->target, g->type == GATE_QFT);
+    return;
+  }
+  if (qvm_gate_unitary(g, m2) == 0) {
+    dagger2(d2, m2);
+    for (int i = 0; i < count; i++)
+      qvm_apply_matrix(&states[i], g->target, d2);
+    return;
+  }
+  int lo = g->control < g->target ? g->control : g->target;
+  int hi = g->control < g->target ? g->target : g->control;
+  qvm_gate_matrix2(g, lo, m4);
+  dagger4(d4, m4);
+  for (int i = 0; i < count; i++)
+    qvm_apply_matrix2(&states[i], lo, hi, d4);
+}
+
+static double re_inner(const qvm_state_t *a, const qvm_state_t *b) {
+  size_t size = (size_t)1 << a->num_qubits;
+  double sum = 0.0;
+  for (size_t i = 0; i < size; i++)
+    sum += creal(conj(a->amplitudes[i]) * b->amplitudes[i]);
+  return sum;
+}
+
+// Re <lambda| D |psi> for a 2x2 D on `target`, without forming D psi
+static double sandwich2(const qvm_state_t *lambda, const qvm_state_t *psi,
+                        int target, const double _Complex d[2][2]) {
+  size_t size = (size_t)1 << psi->num_qubits, bit = (size_t)1 << target;
+  const double _Complex *l = lambda->amplitudes, *a = psi->amplitudes;
+  double sum = 0.0;
+  for (size_t i = 0; i < size; i++) {
+    if (i & bit)
+      continue;
+    double _Complex a0 = a[i], a1 = a[i | bit];
+    sum += creal(conj(l[i]) * (d[0][0] * a0 + d[0][1] * a1) +
+                 conj(l[i | bit]) * (d[1][0] * a0 + d[1][1] * a1));
+  }
+  return sum;
+}
+
+// Same for a diagonal 4x4 D on q0 < q1 (every 2-qubit rotation is one)
+static double sandwich_diag4(const qvm_state_t *lambda, const qvm_state_t *psi,
+                             int q0, int q1, const double _Complex d[4][4]) {
+  size_t size = (size_t)1 << psi->num_qubits;
+  const double _Complex *l = lambda->amplitudes, *a = psi->amplitudes;
+  double sum = 0.0;
+  for (size_t i = 0; i < size; i++) {
+    int k = (int)((i >> q0) & 1) | (int)((i >> q1) & 1) << 1;
+    sum += creal(conj(l[i]) * d[k][k] * a[i]);
+  }
+  return sum;
+}
+
+// lambda = P psi: (P psi)[i ^ x] = i^y (-1)^|i & z| psi[i]
+static void apply_pauli(qvm_state_t *out, const qvm_state_t *in,
+                        const qvm_pauli_t *p) {
+  static const double _Complex phases[4] = {1, I, -1, -I};
+  size_t size = (size_t)1 << in->num_qubits;
+  double _Complex phase = phases[p->y_count & 3];
+  for (size_t i = 0; i < size; i++) {
+    double _Complex v = phase * in->amplitudes[i];
+    out->amplitudes[i ^ p->x] = __builtin_popcountll(i & p->z) & 1 ? -v : v;
+  }
+}
+
+// Indices into circuit->angles grouped by gate: angles of gate g are
+// order[first[g] .. first[g + 1])
+static int group_angles(const qvm_circuit_t *c, int **first, int **order) {
+  *first = (int *)calloc((size_t)c->num_gates + 1, sizeof(int));
+  *order = (int *)malloc(((size_t)c->num_angles + 1) * sizeof(int));
+  if (!*first || !*order) {
+    free(*first);
+    free(*order);
+    return -1;
+  }
+  for (int a = 0; a < c->num_angles; a++)
+    (*first)[c->angles[a].gate + 1]++;
+  for (int g = 0; g < c->num_gates; g++)
+    (*first)[g + 1] += (*first)[g];
+  int *fill = (int *)malloc(((size_t)c->num_gates + 1) * sizeof(int));
+  if (!fill) {
+    free(*first);
+    free(*order);
+    return -1;
+  }
+  memcpy(fill, *first, ((size_t)c->num_gates + 1) * sizeof(int));
+  for (int a = 0; a < c->num_angles; a++)
+    (*order)[fill[c->angles[a].gate]++] = a;
+  free(fill);
+  return 0;
+}
+
+// 1 if the two statevectors could not be allocated (caller falls back)
+static int adjoint(const qvm_circuit_t *c, const qvm_pauli_t *p,
+                   double *value, double *grad) {
+  int n = c->num_qubits;
+  size_t size = (size_t)1 << n;
+  qvm_state_t v[2]; // psi, lambda
+  for (int i = 0; i < 2; i++) {
+    v[i] = (qvm_state_t){.num_qubits = n, .backend = QVM_BACKEND_STATEVECTOR};
+    v[i].amplitudes =
+        (double _Complex *)malloc(size * sizeof(double _Complex));
+  }
+  int *first = NULL, *order = NULL;
+  qvm_fused_program_t prog;
+  int rc = 1;
+  if (!v[0].amplitudes || !v[1].amplitudes ||
+      group_angles(c, &first, &order) != 0)
+    goto out;
+  rc = -1;
+  if (qvm_fuse_circuit(c, &prog) != 0)
+    goto out;
+  rc = 0;
+
+  qvm_kernels_select();
+  memset(v[0].amplitudes, 0, size * sizeof(double _Complex));
+  v[0].amplitudes[0] = 1.0;
+  qvm_execute_fused(&v[0], &prog);
+  qvm_fused_free(&prog);
+  apply_pauli(&v[1], &v[0], p);
+  *value = re_inner(&v[0], &v[1]);
+
+  for (int g = c->num_gates - 1; g >= 0; g--) {
+    const qvm_gate_t *gate = &c->gates[g];
+    undo_gate(gate, &v[0], 1); // psi before the gate
+    for (int k = first[g]; k < first[g + 1]; k++) {
+      const qvm_angle_t *a = &c->angles[order[k]];
+      double _Complex m2[2][2], m4[4][4];
+      double overlap;
+      if (derivative1(gate, a->slot, m2) == 0) {
+        overlap = sandwich2(&v[1], &v[0], gate->target, m2);
+      } else {
+        int lo = gate->control < gate->target ? gate->control : gate->target;
+        int hi = gate->control < gate->target ? gate->target : gate->control;
+        derivative2(gate, lo, m4);
+        overlap = sandwich_diag4(&v[1], &v[0], lo, hi, m4);
+      }
+      grad[a->symbol] += a->scale * 2.0 * overlap;
+    }
+    undo_gate(gate, &v[1], 1);
+  }
+
+out:
+  free(first);
+  free(order);
+  for (int i = 0; i < 2; i++)
+    free(v[i].amplitudes);
+  return rc;
+}
+
+// --- Parameter shift ---
+
+// <P> of the circuit as currently bound, on the backend a plain run would
+// use; gates go through the backend tables without logging
+static int expectation(const qvm_circuit_t *c, const char *observable,
+                       const qvm_pauli_t *p, double *out) {
+  extern int qnoise_is_enabled(void);
+  int n = c->num_qubits;
+  qvm_state_t state = {.num_qubits = n};
+
+  if (qnoise_is_enabled() && n > QVM_DENSITY_MAX_QUBITS) {
+    qvm_traj_config_t config = {.seed = GRAD_TRAJ_SEED,
+                                .observable = observable};
+    qvm_traj_result_t result;
+    if (qvm_run_trajectories(c, &config, &result) != 0)
+      return -1;
+    qvm_counts_free(&result.counts);
+    *out = result.expectation;
+    return 0;
+  }
+
+  if (qnoise_is_enabled() || n > QVM_MAX_QUBITS) {
+    state.backend =
+        qnoise_is_enabled() ? QVM_BACKEND_DENSITY : QVM_BACKEND_MPS;
+    const qvm_backend_ops_t *ops = qvm_backend_ops(&state);
+    if (n > ops->max_qubits || ops->init(&state, n) != 0)
+      return -1;
+    int rc = 0;
+    for (int i = 0; rc == 0 && i < c->num_gates; i++)
+      rc = qvm_backend_apply(&state, ops, &c->gates[i]);
+    if (rc == 0)
+      rc = state.backend == QVM_BACKEND_DENSITY
+               ? qvm_density_expectation(&state, observable, out)
+               : qvm_mps_expectation(&state, observable, out);
+    ops->free(&state);
+    return rc;
+  }
+
+  size_t size = (size_t)1 << n;
+  state.backend = QVM_BACKEND_STATEVECTOR;
+  state.amplitudes = (double _Complex *)calloc(size, sizeof(double _Complex));
+  qvm_fused_program_t prog;
+  if (!state.amplitudes || qvm_fuse_circuit(c, &prog) != 0) {
+    free(state.amplitudes);
+    return -1;
+  }
+  qvm_kernels_select();
+  state.amplitudes[0] = 1.0;
+  qvm_execute_fused(&state, &prog);
+  qvm_fused_free(&prog);
+  *out = qvm_pauli_expectation(&state, p);
+  free(state.amplitudes);
+  return 0;
+}
+
+static int parameter_shift(qvm_circuit_t *c, const char *observable,
+                           const qvm_pauli_t *p, double *value,
+                           double *grad) {
+  if (expectation(c, observable, p, value) != 0)
+    return -1;
+  for (int k = 0; k < c->num_angles; k++) {
+    const qvm_angle_t *a = &c->angles[k];
+    double *theta = &c->gates[a->gate].theta[a->slot];
+    double saved = *theta, plus, minus;
+    *theta = saved + M_PI_2;
+    int rc = expectation(c, observable, p, &plus);
+    *theta = saved - M_PI_2;
+    if (rc == 0)
+      rc = expectation(c, observable, p, &minus);
+    *theta = saved;
+    if (rc != 0)
+      return -1;
+    grad[a->symbol] += a->scale * (plus - minus) / 2;
+  }
+  return 0;
+}
+
+int qvm_gradient(qvm_circuit_t *circuit, const double *params, int num_params,
+                 const char *observable, qvm_grad_method_t method,
+                 double *value, double *grad) {
+  extern int qnoise_is_enabled(void);
+  int n = circuit->num_qubits;
+  qvm_pauli_t p;
+  if (n < 1 || qvm_pauli_parse(observable, n, &p) != 0) {
+    printf("[QVM] Gradient: bad observable '%s'\n", observable);
+    return -1;
+  }
+  for (int i = 0; i < circuit->num_gates; i++) {
+    const qvm_gate_t *g = &circuit->gates[i];
+    if (g->type == GATE_MEASURE || !qvm_gate_valid(g, n)) {
+      printf("[QVM] Gradient: gate %d is not a valid unitary gate\n", i);
+      return -1;
+    }
+  }
+  if (qvm_bind_parameters(circuit, params, num_params) != 0)
+    return -1;
+
+  for (int k = 0; k < circuit->num_params; k++)
+    grad[k] = 0.0;
+  if (method == QVM_GRAD_AUTO)
+    method = qnoise_is_enabled() || n > QVM_MAX_QUBITS ? QVM_GRAD_SHIFT
+                                                        : QVM_GRAD_ADJOINT;
+  if (method == QVM_GRAD_ADJOINT) {
+    if (n > QVM_MAX_QUBITS) {
+      printf("[QVM] Gradient: adjoint method needs a statevector\n");
+      return -1;
+    }
+    int rc = adjoint(circuit, &p, value, grad);
+    if (rc <= 0)
+      return rc;
+    // Two statevectors did not fit: shift runs need only one
+    for (int k = 0; k < circuit->num_params; k++)
+      grad[k] = 0.0;
+  }
+  return parameter_shift(circuit, observable, &p, value, grad);
+}
@@ -0,0 +1,714 @@
+/*
+ * NexusQ-AI - Hybrid Schrödinger-Feynman Simulation
+ * File: modules/quantum/qvm_hsf.c
+ *
+ * Circuits too wide for one statevector, whose qubits split into two
+ * halves joined by few gates, run as a sum over paths. The low half is
+ * qubits 0..cut-1 and the high half cut..n-1. Every gate acting on both
+ * halves is written as a sum of rank products A_r (x) B_r (its Schmidt
+ * decomposition), and choosing one term per cut gate gives a path: a
+ * pair of half statevectors evolved independently, of 2^cut and
+ * 2^(n-cut) amplitudes. The final state is the sum over paths of the
+ * tensor product of each pair, so an amplitude <x|psi> is
+ * sum_p lo_p[x mod 2^cut] * hi_p[x >> cut].
+ *
+ * The terms come from the gate's matrix cut into blocks by the basis of
+ * one half: equal blocks merge, zero blocks drop. That is rank 2 for
+ * CNOT, CZ, CPHASE, RZZ and CCX and rank 4 for SWAP, whichever half holds
+ * which qubit. Macro-ops must lie within one half.
+ *
+ * Gates between two cut gates are fused once per half (see qvm_fuse.c).
+ * The part before the first cut gate is shared by every path. Paths are
+ * split across the worker pool in contiguous ranges, with the last cut
+ * gate's term varying fastest: a worker keeps HSF_CHECKPOINTS states just
+ * before the deepest cut gates, so consecutive paths redo only the
+ * segments after the first term that changed. Ranges are independent, so
+ * separate processes may each sum a slice of the paths
+ * (qvm_hsf_amplitudes_paths) and add the results.
+ *
+ * Sampling keeps both halves of every path. P(hi) is
+ * sum_pq conj(hi_q) <lo_q|lo_p> hi_p, from the Gram matrix of the low
+ * halves; each drawn hi then fixes the low-half state sum_p hi_p lo_p,
+ * which a cumulative walk samples. The walk costs paths * 2^cut per
+ * distinct hi drawn.
+ */
+
+#include "include/qvm.h"
+#include "include/qvm_backend.h"
+#include "include/qvm_threads.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HSF_MAX_RANK 16         // Blocks of a 3-qubit gate cut 1 + 2
+#define HSF_CHECKPOINTS 4       // Saved levels per worker
+#define HSF_PATH_CHUNKS 256     // Path ranges: fixed, so sums are too
+#define HSF_MAX_CUTS 64         // Path digits
+#define HSF_MAX_PATHS ((uint64_t)1 << 48)
+#define HSF_PARTIAL_BYTES ((size_t)64 << 20) // Per-chunk amplitude sums
+#define HSF_ZERO 1e-14
+
+// --- Cut gates ---
+
+// One cut gate: rank terms lo[r] (x) hi[r], each on the gate's qubits of
+// that half (local indices, ascending; basis bit i is qubit i)
+typedef struct {
+  int lo_n, hi_n;
+  int lo_q[2], hi_q[2];
+  int rank;
+  double _Complex lo[HSF_MAX_RANK][4][4];
+  double _Complex hi[HSF_MAX_RANK][4][4];
+} hsf_cut_t;
+
+static int gate_qubits(const qvm_gate_t *g, int *q) {
+  q[0] = g->target;
+  if (g->type == GATE_CCX) {
+    q[1] = g->control;
+    q[2] = g->control2;
+    return 3;
+  }
+  if (qvm_gate_is_two_qubit(g->type)) {
+    q[1] = g->control;
+    return 2;
+  }
+  return 1;
+}
+
+// Which halves the gate touches: bit 0 low, bit 1 high
+static int gate_sides(const qvm_gate_t *g, int cut) {
+  if (qvm_gate_is_range(g->type))
+    return (g->control < cut ? 1 : 0) | (g->target >= cut ? 2 : 0);
+  int q[3], k = gate_qubits(g, q), sides = 0;
+  for (int i = 0; i < k; i++)
+    sides |= q[i] < cut ? 1 : 2;
+  return sides;
+}
+
+// Blocks of m indexed by the basis of one half (`by_hi` picks which),
+// each block an operator on the other half; equal blocks share a term
+static int split_blocks(const double _Complex *m, int dim, int na, int nb,
+                        int by_hi, hsf_cut_t *out) {
+  int dk = 1 << (by_hi ? nb : na), dv = 1 << (by_hi ? na : nb);
+  memset(out->lo, 0, sizeof(out->lo));
+  memset(out->hi, 0, sizeof(out->hi));
+  out->rank = 0;
+  for (int x = 0; x < dk; x++) {
+    for (int y = 0; y < dk; y++) {
+      double _Complex block[4][4] = {{0}};
+      double norm = 0.0;
+      for (int i = 0; i < dv; i++) {
+        for (int j = 0; j < dv; j++) {
+          int row = by_hi ? (x << na) | i : (i << na) | x;
+          int col = by_hi ? (y << na) | j : (j << na) | y;
+          block[i][j] = m[row * dim + col];
+          norm += cabs(block[i][j]);
+        }
+      }
+      if (norm < HSF_ZERO)
+        continue;
+      int r = 0;
+      for (; r < out->rank; r++) {
+        double _Complex(*v)[4] = by_hi ? out->lo[r] : out->hi[r];
+        double diff = 0.0;
+        for (int i = 0; i < 16; i++)
+          diff += cabs(v[i / 4][i % 4] - block[i / 4][i % 4]);
+        if (diff < HSF_ZERO)
+          break;
+      }
+      if (r == out->rank) {
+        if (r == HSF_MAX_RANK)
+          return -1;
+        memcpy(by_hi ? out->lo[r] : out->hi[r], block, sizeof(block));
+        out->rank++;
+      }
+      // The half indexing the blocks gets |x><y|
+      if (by_hi)
+        out->hi[r][x][y] = 1.0;
+      else
+        out->lo[r][x][y] = 1.0;
+    }
+  }
+  return 0;
+}
+
+// Schmidt terms of a gate on both halves; -1 for macro-ops across the cut
+static int cut_terms(const qvm_gate_t *g, int cut, hsf_cut_t *out) {
+  if (qvm_gate_is_range(g->type))
+    return -1;
+  int q[3], k = gate_qubits(g, q);
+  // Local order: low-half qubits ascending, then high-half ones
+  int order[3], na = 0;
+  for (int i = 0; i < k; i++) {
+    int pos = i;
+    for (; pos > 0 && order[pos - 1] > q[i]; pos--)
+      order[pos] = order[pos - 1];
+    order[pos] = q[i];
+    na += q[i] < cut;
+  }
+  int nb = k - na;
+  out->lo_n = na;
+  out->hi_n = nb;
+  for (int i = 0; i < na; i++)
+    out->lo_q[i] = order[i];
+  for (int i = 0; i < nb; i++)
+    out->hi_q[i] = order[na + i] - cut;
+
+  // Matrix column by column: the gate on local qubits of a k-qubit state
+  int dim = 1 << k;
+  double _Complex m[64], col[8];
+  qvm_gate_t local = *g;
+  int map[3];
+  for (int i = 0; i < k; i++) {
+    for (int j = 0; j < k; j++) {
+      if (order[j] == q[i])
+        map[i] = j;
+    }
+  }
+  local.target = map[0];
+  if (k > 1)
+    local.control = map[1];
+  if (k > 2)
+    local.control2 = map[2];
+  qvm_state_t view = {
+      .num_qubits = k, .amplitudes = col, .backend = QVM_BACKEND_STATEVECTOR};
+  for (int c = 0; c < dim; c++) {
+    memset(col, 0, sizeof(col));
+    col[c] = 1.0;
+    if (qvm_apply_unitary(&view, &local) != 0)
+      return -1;
+    for (int r = 0; r < dim; r++)
+      m[r * dim + c] = col[r];
+  }
+
+  // Blocks by either half; keep the fewer terms
+  hsf_cut_t other = *out;
+  int a = split_blocks(m, dim, na, nb, 0, out);
+  int b = split_blocks(m, dim, na, nb, 1, &other);
+  if (a != 0 || (b == 0 && other.rank < out->rank))
+    *out = other;
+  return a == 0 || b == 0 ? 0 : -1;
+}
+
+static void apply_term(qvm_state_t *view, int n, const int *q,
+                       const double _Complex (*m)[4]) {
+  if (n == 1) {
+    double _Complex m2[2][2] = {{m[0][0], m[0][1]}, {m[1][0], m[1][1]}};
+    qvm_apply_matrix(view, q[0], m2);
+  } else {
+    qvm_apply_matrix2(view, q[0], q[1], m);
+  }
+}
+
+// --- Plan ---
+
+typedef struct {
+  int num_qubits;
+  int cut;
+  int num_cuts;
+  hsf_cut_t *cuts;
+  uint64_t paths;
+  // num_cuts + 1 fused segments per half; segment j follows cut gate j-1
+  qvm_fused_program_t *lo_prog;
+  qvm_fused_program_t *hi_prog;
+  double _Complex *lo0; // Segment 0 from |0...0>, shared by every path
+  double _Complex *hi0;
+} hsf_plan_t;
+
+// Cut gates and path count of a split; -1 if the split is not possible
+static int count_paths(const qvm_circuit_t *circuit, int cut, int *cut_gates,
+                       uint64_t *paths) {
+  int n = circuit->num_qubits;
+  if (cut < 1 || cut >= n || cut > QVM_MAX_QUBITS || n - cut > QVM_MAX_QUBITS)
+    return -1;
+  *cut_gates = 0;
+  *paths = 1;
+  for (int i = 0; i < circuit->num_gates; i++) {
+    const qvm_gate_t *g = &circuit->gates[i];
+    if (!qvm_gate_valid(g, n))
+      return -1;
+    if (g->type == GATE_MEASURE || gate_sides(g, cut) != 3)
+      continue;
+    hsf_cut_t terms;
+    if (*cut_gates == HSF_MAX_CUTS || cut_terms(g, cut, &terms) != 0 ||
+        *paths > HSF_MAX_PATHS / (uint64_t)terms.rank)
+      return -1;
+    *paths *= terms.rank;
+    (*cut_gates)++;
+  }
+  return 0;
+}
+
+static void plan_free(hsf_plan_t *plan) {
+  for (int j = 0; plan->lo_prog && j <= plan->num_cuts; j++) {
+    qvm_fused_free(&plan->lo_prog[j]);
+    qvm_fused_free(&plan->hi_prog[j]);
+  }
+  free(plan->cuts);
+  free(plan->lo_prog);
+  free(plan->hi_prog);
+  free(plan->lo0);
+  free(plan->hi0);
+  memset(plan, 0, sizeof(*plan));
+}
+
+// A gate within one half, on that half's local qubits
+static void half_gate(qvm_gate_t *g, int offset) {
+  g->target -= offset;
+  if (qvm_gate_is_two_qubit(g->type) || g->type == GATE_CCX ||
+      qvm_gate_is_range(g->type))
+    g->control -= offset;
+  if (g->type == GATE_CCX)
+    g->control2 -= offset;
+}
+
+// Segments and cut terms of a split already checked by qvm_hsf_plan()
+static int plan_build(const qvm_circuit_t *circuit, int cut,
+                      hsf_plan_t *plan) {
+  memset(plan, 0, sizeof(*plan));
+  int n = circuit->num_qubits, cut_gates;
+  if (count_paths(circuit, cut, &cut_gates, &plan->paths) != 0)
+    return -1;
+  plan->num_qubits = n;
+  plan->cut = cut;
+  plan->num_cuts = cut_gates;
+  plan->cuts = (hsf_cut_t *)malloc((cut_gates + 1) * sizeof(hsf_cut_t));
+  plan->lo_prog = (qvm_fused_program_t *)calloc(cut_gates + 1,
+                                                sizeof(qvm_fused_program_t));
+  plan->hi_prog = (qvm_fused_program_t *)calloc(cut_gates + 1,
+                                                sizeof(qvm_fused_program_t));
+  if (!plan->cuts || !plan->lo_prog || !plan->hi_prog) {
+    plan_free(plan);
+    return -1;
+  }
+
+  // Split the gates into per-half segments between cut gates
+  qvm_circuit_t lo, hi;
+  qvm_circuit_init(&lo, cut);
+  qvm_circuit_init(&hi, n - cut);
+  int seg = 0, rc = 0;
+  for (int i = 0; rc == 0 && i <= circuit->num_gates; i++) {
+    const qvm_gate_t *g = i < circuit->num_gates ? &circuit->gates[i] : NULL;
+    if (g && g->type == GATE_MEASURE)
+      continue;
+    int sides = g ? gate_sides(g, cut) : 3;
+    if (sides != 3) {
+      qvm_gate_t local = *g;
+      half_gate(&local, sides == 1 ? 0 : cut);
+      rc = qvm_circuit_append(sides == 1 ? &lo : &hi, &local);
+      continue;
+    }
+    // Close the segment before a cut gate (or the end of the circuit)
+    if (qvm_fuse_circuit(&lo, &plan->lo_prog[seg]) != 0 ||
+        qvm_fuse_circuit(&hi, &plan->hi_prog[seg]) != 0 ||
+        (g && cut_terms(g, cut, &plan->cuts[seg]) != 0))
+      rc = -1;
+    lo.num_gates = 0;
+    hi.num_gates = 0;
+    seg++;
+  }
+  qvm_circuit_free(&lo);
+  qvm_circuit_free(&hi);
+  if (rc != 0) {
+    plan_free(plan);
+    return -1;
+  }
+
+  size_t nlo = (size_t)1 << cut, nhi = (size_t)1 << (n - cut);
+  plan->lo0 = (double _Complex *)calloc(nlo, sizeof(double _Complex));
+  plan->hi0 = (double _Complex *)calloc(nhi, sizeof(double _Complex));
+  if (!plan->lo0 || !plan->hi0) {
+    plan_free(plan);
+    return -1;
+  }
+  plan->lo0[0] = 1.0;
+  plan->hi0[0] = 1.0;
+  qvm_state_t lo_view = {.num_qubits = cut,
+                         .amplitudes = plan->lo0,
+                         .backend = QVM_BACKEND_STATEVECTOR};
+  qvm_state_t hi_view = {.num_qubits = n - cut,
+                         .amplitudes = plan->hi0,
+                         .backend = QVM_BACKEND_STATEVECTOR};
+  qvm_execute_fused(&lo_view, &plan->lo_prog[0]);
+  qvm_execute_fused(&hi_view, &plan->hi_prog[0]);
+  return 0;
+}
+
+// --- Path sweep ---
+
+typedef struct {
+  const hsf_plan_t *plan;
+  uint64_t first; // Path of item 0
+  // Amplitudes: per-chunk sums of count amplitudes
+  const uint64_t *bits;
+  int count;
+  double _Complex *partial;
+  // Sampling: both halves of every path
+  double _Complex *lo_out;
+  double _Complex *hi_out;
+  int failed;
+} hsf_sweep_t;
+
+static void sweep_paths(void *arg, size_t chunk, size_t b, size_t e) {
+  hsf_sweep_t *sw = (hsf_sweep_t *)arg;
+  const hsf_plan_t *plan = sw->plan;
+  int depth = plan->num_cuts;
+  size_t nlo = (size_t)1 << plan->cut;
+  size_t nhi = (size_t)1 << (plan->num_qubits - plan->cut);
+
+  // Level j is the state just before cut gate j (after segment j); levels
+  // depth-HSF_CHECKPOINTS .. depth-1 are saved, the leaf is in slot 0
+  int saved_from = depth - HSF_CHECKPOINTS > 1 ? depth - HSF_CHECKPOINTS : 1;
+  size_t slots = 1 + (depth > saved_from ? depth - saved_from : 0);
+  double _Complex *buf =
+      (double _Complex *)malloc(slots * (nlo + nhi) * sizeof(double _Complex));
+  if (!buf) {
+    __atomic_store_n(&sw->failed, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  double _Complex *lo = buf, *hi = buf + nlo;
+  qvm_state_t lo_view = {.num_qubits = plan->cut,
+                         .amplitudes = lo,
+                         .backend = QVM_BACKEND_STATEVECTOR};
+  qvm_state_t hi_view = {.num_qubits = plan->num_qubits - plan->cut,
+                         .amplitudes = hi,
+                         .backend = QVM_BACKEND_STATEVECTOR};
+
+  int digit[HSF_MAX_CUTS], prev[HSF_MAX_CUTS];
+  for (size_t i = b; i < e; i++) {
+    uint64_t p = sw->first + i;
+    for (int j = depth - 1; j >= 0; j--) {
+      digit[j] = (int)(p % plan->cuts[j].rank);
+      p /= plan->cuts[j].rank;
+    }
+    // Restart from the deepest saved level whose terms are unchanged
+    int start = 0;
+    if (i > b) {
+      int same = 0;
+      while (same < depth - 1 && digit[same] == prev[same])
+        same++;
+      if (same >= saved_from)
+        start = same;
+    }
+    const double _Complex *from_lo = plan->lo0, *from_hi = plan->hi0;
+    if (start > 0) {
+      size_t s = 1 + (size_t)(start - saved_from);
+      from_lo = buf + s * (nlo + nhi);
+      from_hi = from_lo + nlo;
+    }
+    memcpy(lo, from_lo, nlo * sizeof(double _Complex));
+    memcpy(hi, from_hi, nhi * sizeof(double _Complex));
+
+    for (int j = start; j < depth; j++) {
+      if (j >= saved_from && j > start) {
+        double _Complex *save =
+            buf + (1 + (size_t)(j - saved_from)) * (nlo + nhi);
+        memcpy(save, lo, nlo * sizeof(double _Complex));
+        memcpy(save + nlo, hi, nhi * sizeof(double _Complex));
+      }
+      const hsf_cut_t *c = &plan->cuts[j];
+      apply_term(&lo_view, c->lo_n, c->lo_q,
+                 (const double _Complex(*)[4])c->lo[digit[j]]);
+      apply_term(&hi_view, c->hi_n, c->hi_q,
+                 (const double _Complex(*)[4])c->hi[digit[j]]);
+      qvm_execute_fused(&lo_view, &plan->lo_prog[j + 1]);
+      qvm_execute_fused(&hi_view, &plan->hi_prog[j + 1]);
+    }
+    memcpy(prev, digit, sizeof(int) * depth);
+
+    if (sw->partial) {
+      double _Complex *acc = sw->partial + chunk * (size_t)sw->count;
+      uint64_t lo_mask = nlo - 1;
+      for (int k = 0; k < sw->count; k++)
+        acc[k] += lo[sw->bits[k] & lo_mask] * hi[sw->bits[k] >> plan->cut];
+    } else {
+      memcpy(sw->lo_out + i * nlo, lo, nlo * sizeof(double _Complex));
+      memcpy(sw->hi_out + i * nhi, hi, nhi * sizeof(double _Complex));
+    }
+  }
+  free(buf);
+}
+
+// Paths [0, num) in fixed chunks. With fewer chunks than threads, chunks
+// run one after another and the half-state sweeps use the pool instead.
+static int run_paths(hsf_sweep_t *sw, uint64_t num, size_t grain) {
+  size_t chunks = qvm_parallel_chunks(num, grain);
+  if (chunks < (size_t)qvm_threads_get()) {
+    for (size_t c = 0; c < chunks; c++) {
+      size_t end = (c + 1) * grain < num ? (c + 1) * grain : num;
+      sweep_paths(sw, c, c * grain, end);
+    }
+  } else {
+    qvm_parallel_for(num, grain, sweep_paths, sw);
+  }
+  return sw->failed ? -1 : 0;
+}
+
+// --- Amplitudes ---
+
+int qvm_hsf_plan(const qvm_circuit_t *circuit, int cut, qvm_hsf_stats_t *out) {
+  memset(out, 0, sizeof(*out));
+  int n = circuit->num_qubits;
+  uint64_t mask;
+  if (n < 2 || n > QVM_HSF_MAX_QUBITS ||
+      qvm_terminal_measurements(circuit, &mask) < 0)
+    return -1;
+  // Cheapest split: paths times the amplitudes of both halves
+  int found = 0;
+  for (int c = cut > 0 ? cut : 1; c <= (cut > 0 ? cut : n - 1); c++) {
+    int gates;
+    uint64_t paths;
+    if (count_paths(circuit, c, &gates, &paths) != 0)
+      continue;
+    double amps = ldexp(1.0, c) + ldexp(1.0, n - c);
+    double cost = (double)paths * amps;
+    if (found && cost >= out->cost)
+      continue;
+    found = 1;
+    out->cut = c;
+    out->cut_gates = gates;
+    out->paths = paths;
+    out->cost = cost;
+    double bytes = ((double)paths * amps + (double)paths * (double)paths) *
+                   sizeof(double _Complex);
+    out->sample_bytes = bytes < (double)SIZE_MAX ? (size_t)bytes : SIZE_MAX;
+  }
+  return found ? 0 : -1;
+}
+
+int qvm_hsf_amplitudes_paths(const qvm_circuit_t *circuit, int cut,
+                             uint64_t first, uint64_t num,
+                             const uint64_t *bitstrings, int count,
+                             double _Complex *out) {
+  qvm_hsf_stats_t stats;
+  hsf_plan_t plan;
+  if (count < 0 || qvm_hsf_plan(circuit, cut, &stats) != 0 ||
+      plan_build(circuit, stats.cut, &plan) != 0)
+    return -1;
+  int n = circuit->num_qubits;
+  for (int k = 0; k < count; k++) {
+    if (bitstrings[k] >> n) {
+      plan_free(&plan);
+      return -1;
+    }
+    out[k] = 0;
+  }
+  if (first >= plan.paths || count == 0) {
+    plan_free(&plan);
+    return first > plan.paths ? -1 : 0;
+  }
+  if (num > plan.paths - first)
+    num = plan.paths - first;
+
+  // As many chunks as HSF_PARTIAL_BYTES of partial sums allow
+  size_t chunks = HSF_PARTIAL_BYTES / ((size_t)count * sizeof(double _Complex));
+  if (chunks > HSF_PATH_CHUNKS)
+    chunks = HSF_PATH_CHUNKS;
+  if (chunks < 1)
+    chunks = 1;
+  size_t grain = (num + chunks - 1) / chunks;
+  chunks = qvm_parallel_chunks(num, grain);
+  hsf_sweep_t sw = {.plan = &plan, .first = first, .bits = bitstrings,
+                    .count = count};
+  sw.partial = (double _Complex *)calloc(chunks * (size_t)count,
+                                         sizeof(double _Complex));
+  int rc = sw.partial ? run_paths(&sw, num, grain) : -1;
+  // Chunk order: the same sum on any number of threads
+  for (size_t c = 0; rc == 0 && c < chunks; c++) {
+    for (int k = 0; k < count; k++)
+      out[k] += sw.partial[c * count + k];
+  }
+  free(sw.partial);
+  plan_free(&plan);
+  return rc;
+}
+
+int qvm_hsf_amplitudes(const qvm_circuit_t *circuit, int cut,
+                       const uint64_t *bitstrings, int count,
+                       double _Complex *out) {
+  return qvm_hsf_amplitudes_paths(circuit, cut, 0, HSF_MAX_PATHS, bitstrings,
+                                  count, out);
+}
+
+// --- Sampling ---
+
+typedef struct {
+  const double _Complex *lo; // paths x nlo
+  const double _Complex *hi; // paths x nhi
+  size_t paths, nlo, nhi;
+  double _Complex *gram; // <lo_q|lo_p> at q * paths + p
+  double *mass;          // P(hi)
+  const int *group;      // Shots group[g] .. group[g + 1] - 1 share one hi
+  const uint64_t *hsel;  // Sampled hi per shot
+  const double *u;       // Sorted uniforms within each group
+  uint64_t *lsel;        // Sampled lo per shot
+  int failed;
+} hsf_sample_t;
+
+static void sweep_gram(void *arg, size_t chunk, size_t b, size_t e) {
+  hsf_sample_t *s = (hsf_sample_t *)arg;
+  for (size_t q = b; q < e; q++) {
+    const double _Complex *lq = s->lo + q * s->nlo;
+    for (size_t p = q; p < s->paths; p++) {
+      const double _Complex *lp = s->lo + p * s->nlo;
+      double _Complex dot = 0;
+      for (size_t l = 0; l < s->nlo; l++)
+        dot += conj(lq[l]) * lp[l];
+      s->gram[q * s->paths + p] = dot;
+      s->gram[p * s->paths + q] = conj(dot);
+    }
+  }
+}
+
+static void sweep_mass(void *arg, size_t chunk, size_t b, size_t e) {
+  hsf_sample_t *s = (hsf_sample_t *)arg;
+  for (size_t h = b; h < e; h++) {
+    double m = 0.0;
+    for (size_t q = 0; q < s->paths; q++) {
+      double _Complex v = 0;
+      for (size_t p = 0; p < s->paths; p++)
+        v += s->gram[q * s->paths + p] * s->hi[p * s->nhi + h];
+      m += creal(conj(s->hi[q * s->nhi + h]) * v);
+    }
+    s->mass[h] = m > 0.0 ? m : 0.0;
+  }
+}
+
+// Low half of each group's shots: a cumulative walk over sum_p hi_p lo_p
+static void sweep_conditional(void *arg, size_t chunk, size_t b, size_t e) {
+  hsf_sample_t *s = (hsf_sample_t *)arg;
+  double _Complex *coef =
+      (double _Complex *)malloc(s->paths * sizeof(double _Complex));
+  if (!coef) {
+    __atomic_store_n(&s->failed, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  for (size_t g = b; g < e; g++) {
+    int shot = s->group[g], end = s->group[g + 1];
+    uint64_t h = s->hsel[shot], last = 0;
+    for (size_t p = 0; p < s->paths; p++)
+      coef[p] = s->hi[p * s->nhi + h];
+    double acc = 0.0;
+    for (size_t l = 0; l < s->nlo && shot < end; l++) {
+      double _Complex amp = 0;
+      for (size_t p = 0; p < s->paths; p++)
+        amp += coef[p] * s->lo[p * s->nlo + l];
+      double w = creal(amp) * creal(amp) + cimag(amp) * cimag(amp);
+      if (w > 0.0)
+        last = l;
+      acc += w;
+      while (shot < end && s->u[shot] < acc)
+        s->lsel[shot++] = l;
+    }
+    // Rounding left the top uniforms past the walk's total
+    while (shot < end)
+      s->lsel[shot++] = last;
+  }
+  free(coef);
+}
+
+int qvm_hsf_sample(const qvm_circuit_t *circuit, int cut, int shots,
+                   qvm_counts_t *out_counts) {
+  memset(out_counts, 0, sizeof(*out_counts));
+  qvm_hsf_stats_t stats;
+  hsf_plan_t plan;
+  if (shots < 1 || qvm_hsf_plan(circuit, cut, &stats) != 0)
+    return -1;
+  if (!qvm_state_fits(0, stats.sample_bytes)) {
+    printf("[QVM] Error: %llu paths need %zu MB to sample, more than "
+           "physical RAM\n",
+           (unsigned long long)stats.paths, stats.sample_bytes >> 20);
+    return -1;
+  }
+  if (plan_build(circuit, stats.cut, &plan) != 0)
+    return -1;
+  int n = circuit->num_qubits;
+  hsf_sample_t s = {.paths = plan.paths,
+                    .nlo = (size_t)1 << plan.cut,
+                    .nhi = (size_t)1 << (n - plan.cut)};
+  double _Complex *lo =
+      (double _Complex *)malloc(s.paths * s.nlo * sizeof(double _Complex));
+  double _Complex *hi =
+      (double _Complex *)malloc(s.paths * s.nhi * sizeof(double _Complex));
+  s.gram = (double _Complex *)malloc(s.paths * s.paths *
+                                     sizeof(double _Complex));
+  s.mass = (double *)malloc(s.nhi * sizeof(double));
+  double *u = (double *)malloc(shots * sizeof(double));
+  uint64_t *hsel = (uint64_t *)malloc(shots * sizeof(uint64_t));
+  uint64_t *lsel = (uint64_t *)malloc(shots * sizeof(uint64_t));
+  int *group = (int *)malloc((shots + 1) * sizeof(int));
+  int rc = -1;
+  if (!lo || !hi || !s.gram || !s.mass || !u || !hsel || !lsel || !group)
+    goto out;
+
+  // Both halves of every path
+  hsf_sweep_t sw = {.plan = &plan, .lo_out = lo, .hi_out = hi};
+  size_t grain = (s.paths + HSF_PATH_CHUNKS - 1) / HSF_PATH_CHUNKS;
+  if (run_paths(&sw, s.paths, grain) != 0)
+    goto out;
+  s.lo = lo;
+  s.hi = hi;
+
+  // P(hi), then the high half of every shot
+  qvm_parallel_for(s.paths, 1, sweep_gram, &s);
+  qvm_parallel_for(s.nhi, qvm_threads_grain(s.paths * s.paths * 16),
+                   sweep_mass, &s);
+  double total = 0.0;
+  for (size_t h = 0; h < s.nhi; h++)
+    total += s.mass[h];
+  if (total <= 0.0)
+    goto out;
+  qvm_rng_t *rng = qvm_rng_thread();
+  qvm_sorted_uniforms(rng, u, shots, total);
+  double acc = 0.0;
+  size_t h = 0, last = 0;
+  int shot = 0;
+  for (; h < s.nhi && shot < shots; h++) {
+    if (s.mass[h] > 0.0)
+      last = h;
+    acc += s.mass[h];
+    while (shot < shots && u[shot] < acc)
+      hsel[shot++] = h;
+  }
+  while (shot < shots)
+    hsel[shot++] = last;
+
+  // Shots sharing a high half are drawn in one walk of the low half
+  int groups = 0;
+  for (shot = 0; shot < shots; shot++) {
+    if (shot == 0 || hsel[shot] != hsel[shot - 1])
+      group[groups++] = shot;
+  }
+  group[groups] = shots;
+  for (int g = 0; g < groups; g++)
+    qvm_sorted_uniforms(rng, u + group[g], group[g + 1] - group[g],
+                        s.mass[hsel[group[g]]]);
+  s.group = group;
+  s.hsel = hsel;
+  s.u = u;
+  s.lsel = lsel;
+  qvm_parallel_for(groups, 1, sweep_conditional, &s);
+  if (s.failed)
+    goto out;
+
+  // Measured qubits only, or all of them
+  uint64_t mask;
+  qvm_terminal_measurements(circuit, &mask);
+  if (!mask)
+    mask = ((uint64_t)1 << n) - 1;
+  for (shot = 0; shot < shots; shot++)
+    hsel[shot] = (hsel[shot] << plan.cut | lsel[shot]) & mask;
+  rc = qvm_counts_from_outcomes(hsel, shots, n, mask, out_counts);
+
+out:
+  free(lo);
+  free(hi);
+  free(s.gram);
+  free(s.mass);
+  free(u);
+  free(hsel);
+  free(lsel);
+  free(group);
+  plan_free(&plan);
+  return rc;
+}
@@ -0,0 +1,320 @@
+/*
+ * NexusQ-AI - QVM Scalar Kernels & CPU Dispatch
+ * File: modules/quantum/qvm_kernels.c
+ *
+ * Portable reference kernels plus the CPUID-based selection of the active
+ * kernel table. Complex products are written out on the real/imaginary
+ * parts so the compiler does not route them through __muldc3.
+ */
+
+#include "include/qvm_kernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --- Scalar primitives ---
+
+static inline double _Complex cmul(double _Complex a, double _Complex b) {
+  double ar = creal(a), ai = cimag(a), br = creal(b), bi = cimag(b);
+  return (ar * br - ai * bi) + (ar * bi + ai * br) * I;
+}
+
+static inline double cnorm(double _Complex a) {
+  return creal(a) * creal(a) + cimag(a) * cimag(a);
+}
+
+static void scalar_run_2x2(double _Complex *lo, double _Complex *hi, size_t n,
+                           const double _Complex m[2][2]) {
+  double _Complex m00 = m[0][0], m01 = m[0][1];
+  double _Complex m10 = m[1][0], m11 = m[1][1];
+  for (size_t k = 0; k < n; k++) {
+    double _Complex a0 = lo[k];
+    double _Complex a1 = hi[k];
+    lo[k] = cmul(m00, a0) + cmul(m01, a1);
+    hi[k] = cmul(m10, a0) + cmul(m11, a1);
+  }
+}
+
+static void scalar_adj_2x2(double _Complex *p, size_t n,
+                           const double _Complex m[2][2]) {
+  for (size_t k = 0; k < n; k++)
+    scalar_run_2x2(p + 2 * k, p + 2 * k + 1, 1, m);
+}
+
+static void scalar_run_4x4(double _Complex *a, size_t s0, size_t s1, size_t n,
+                           const double _Complex m[4][4]) {
+  for (size_t k = 0; k < n; k++) {
+    double _Complex *p = a + k;
+    double _Complex v[4] = {p[0], p[s0], p[s1], p[s0 + s1]};
+    double _Complex r[4];
+    for (int i = 0; i < 4; i++) {
+      r[i] = cmul(m[i][0], v[0]) + cmul(m[i][1], v[1]) + cmul(m[i][2], v[2]) +
+             cmul(m[i][3], v[3]);
+    }
+    p[0] = r[0];
+    p[s0] = r[1];
+    p[s1] = r[2];
+    p[s0 + s1] = r[3];
+  }
+}
+
+static double scalar_norm_run(const double _Complex *p, size_t n) {
+  double sum = 0.0;
+  for (size_t k = 0; k < n; k++)
+    sum += cnorm(p[k]);
+  return sum;
+}
+
+static void scalar_adj_norms(const double _Complex *p, size_t n,
+                             double out[2]) {
+  double s0 = 0.0, s1 = 0.0;
+  for (size_t k = 0; k < n; k++) {
+    s0 += cnorm(p[2 * k]);
+    s1 += cnorm(p[2 * k + 1]);
+  }
+  out[0] += s0;
+  out[1] += s1;
+}
+
+static void scalar_scale_run(double _Complex *p, size_t n, double s) {
+  if (s == 0.0) {
+    memset(p, 0, n * sizeof(double _Complex));
+    return;
+  }
+  for (size_t k = 0; k < n; k++)
+    p[k] *= s;
+}
+
+static void scalar_adj_scale(double _Complex *p, size_t n, double s0,
+                             double s1) {
+  for (size_t k = 0; k < n; k++) {
+    p[2 * k] *= s0;
+    p[2 * k + 1] *= s1;
+  }
+}
+
+static void scalar_phase_run(double _Complex *p, size_t n,
+                             double _Complex ph) {
+  for (size_t k = 0; k < n; k++)
+    p[k] = cmul(p[k], ph);
+}
+
+#define QK_FN(name) scalar_##name
+#define QK_RUN_2X2 scalar_run_2x2
+#define QK_ADJ_2X2 scalar_adj_2x2
+#define QK_RUN_4X4 scalar_run_4x4
+#define QK_NORM_RUN scalar_norm_run
+#define QK_ADJ_NORMS scalar_adj_norms
+#define QK_SCALE_RUN scalar_scale_run
+#define QK_ADJ_SCALE scalar_adj_scale
+#define QK_PHASE_RUN scalar_phase_run
+#include "include/qvm_kernels_tmpl.h"
+
+#undef QK_FN
+#undef QK_RUN_2X2
+#undef QK_ADJ_2X2
+#undef QK_RUN_4X4
+#undef QK_NORM_RUN
+#undef QK_ADJ_NORMS
+#undef QK_SCALE_RUN
+#undef QK_ADJ_SCALE
+#undef QK_PHASE_RUN
+
+// --- Scalar single-precision primitives ---
+
+static inline float _Complex cmulf(float _Complex a, float _Complex b) {
+  float ar = crealf(a), ai = cimagf(a), br = crealf(b), bi = cimagf(b);
+  return (ar * br - ai * bi) + (ar * bi + ai * br) * I;
+}
+
+static inline double cnormf(float _Complex a) {
+  double re = crealf(a), im = cimagf(a);
+  return re * re + im * im;
+}
+
+static void f32_run_2x2(float _Complex *lo, float _Complex *hi, size_t n,
+                        const double _Complex m[2][2]) {
+  float _Complex m00 = m[0][0], m01 = m[0][1];
+  float _Complex m10 = m[1][0], m11 = m[1][1];
+  for (size_t k = 0; k < n; k++) {
+    float _Complex a0 = lo[k];
+    float _Complex a1 = hi[k];
+    lo[k] = cmulf(m00, a0) + cmulf(m01, a1);
+    hi[k] = cmulf(m10, a0) + cmulf(m11, a1);
+  }
+}
+
+static void f32_adj_2x2(float _Complex *p, size_t n,
+                        const double _Complex m[2][2]) {
+  float _Complex m00 = m[0][0], m01 = m[0][1];
+  float _Complex m10 = m[1][0], m11 = m[1][1];
+  for (size_t k = 0; k < n; k++) {
+    float _Complex a0 = p[2 * k];
+    float _Complex a1 = p[2 * k + 1];
+    p[2 * k] = cmulf(m00, a0) + cmulf(m01, a1);
+    p[2 * k + 1] = cmulf(m10, a0) + cmulf(m11, a1);
+  }
+}
+
+static void f32_run_4x4(float _Complex *a, size_t s0, size_t s1, size_t n,
+                        const double _Complex m[4][4]) {
+  float _Complex mf[4][4];
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+      mf[i][j] = m[i][j];
+  for (size_t k = 0; k < n; k++) {
+    float _Complex *p = a + k;
+    float _Complex v[4] = {p[0], p[s0], p[s1], p[s0 + s1]};
+    float _Complex r[4];
+    for (int i = 0; i < 4; i++) {
+      r[i] = cmulf(mf[i][0], v[0]) + cmulf(mf[i][1], v[1]) +
+             cmulf(mf[i][2], v[2]) + cmulf(mf[i][3], v[3]);
+    }
+    p[0] = r[0];
+    p[s0] = r[1];
+    p[s1] = r[2];
+    p[s0 + s1] = r[3];
+  }
+}
+
+static double f32_norm_run(const float _Complex *p, size_t n) {
+  double sum = 0.0;
+  for (size_t k = 0; k < n; k++)
+    sum += cnormf(p[k]);
+  return sum;
+}
+
+static void f32_adj_norms(const float _Complex *p, size_t n, double out[2]) {
+  double s0 = 0.0, s1 = 0.0;
+  for (size_t k = 0; k < n; k++) {
+    s0 += cnormf(p[2 * k]);
+    s1 += cnormf(p[2 * k + 1]);
+  }
+  out[0] += s0;
+  out[1] += s1;
+}
+
+static void f32_scale_run(float _Complex *p, size_t n, double s) {
+  if (s == 0.0) {
+    memset(p, 0, n * sizeof(float _Complex));
+    return;
+  }
+  float sf = (float)s;
+  for (size_t k = 0; k < n; k++)
+    p[k] *= sf;
+}
+
+static void f32_adj_scale(float _Complex *p, size_t n, double s0, double s1) {
+  float f0 = (float)s0, f1 = (float)s1;
+  for (size_t k = 0; k < n; k++) {
+    p[2 * k] *= f0;
+    p[2 * k + 1] *= f1;
+  }
+}
+
+static void f32_phase_run(float _Complex *p, size_t n, double _Complex ph) {
+  float _Complex f = ph;
+  for (size_t k = 0; k < n; k++)
+    p[k] = cmulf(p[k], f);
+}
+
+#define QK_AMP float _Complex
+#define QK_FN(name) f32_scalar_##name
+#define QK_RUN_2X2 f32_run_2x2
+#define QK_ADJ_2X2 f32_adj_2x2
+#define QK_RUN_4X4 f32_run_4x4
+#define QK_NORM_RUN f32_norm_run
+#define QK_ADJ_NORMS f32_adj_norms
+#define QK_SCALE_RUN f32_scale_run
+#define QK_ADJ_SCALE f32_adj_scale
+#define QK_PHASE_RUN f32_phase_run
+#include "include/qvm_kernels_tmpl.h"
+
+const qvm_kernel_f32_ops_t qvm_kernels_f32_scalar = {
+    .name = "scalar",
+    .apply_2x2 = f32_scalar_apply_2x2,
+    .apply_ctrl_2x2 = f32_scalar_apply_ctrl_2x2,
+    .apply_4x4 = f32_scalar_apply_4x4,
+    .probs = f32_scalar_probs,
+    .collapse = f32_scalar_collapse,
+    .phase = f32_scalar_phase,
+    .diag = f32_scalar_diag,
+    .permute = f32_scalar_permute,
+    .norms = f32_scalar_norms,
+};
+
+const qvm_kernel_ops_t qvm_kernels_scalar = {
+    .name = "scalar",
+    .apply_2x2 = scalar_apply_2x2,
+    .apply_ctrl_2x2 = scalar_apply_ctrl_2x2,
+    .apply_4x4 = scalar_apply_4x4,
+    .probs = scalar_probs,
+    .collapse = scalar_collapse,
+    .phase = scalar_phase,
+    .diag = scalar_diag,
+    .permute = scalar_permute,
+    .norms = scalar_norms,
+    .f32 = &qvm_kernels_f32_scalar,
+};
+
+// --- Dispatch ---
+
+static const qvm_kernel_ops_t *active_kernels = NULL;
+
+static int cpu_has_avx2(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+  return 0;
+#endif
+}
+
+// The AVX-512 table keeps its single-precision kernels on AVX2 + FMA
+static int cpu_has_avx512(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return cpu_has_avx2() && __builtin_cpu_supports("avx512f");
+#else
+  return 0;
+#endif
+}
+
+void qvm_kernels_select(void) {
+  if (active_kernels)
+    return;
+
+  if (cpu_has_avx512()) {
+    active_kernels = &qvm_kernels_avx512;
+  } else if (cpu_has_avx2()) {
+    active_kernels = &qvm_kernels_avx2;
+  } else {
+    active_kernels = &qvm_kernels_scalar;
+  }
+
+  // Allow pinning a lower ISA for debugging/benchmarks
+  const char *env = getenv("QVM_KERNELS");
+  if (env && qvm_kernels_force(env) != 0) {
+    printf("[QVM] Ignoring QVM_KERNELS=%s (unsupported)\n", env);
+  }
+
+  printf("[QVM] Kernel dispatch: %s\n", active_kernels->name);
+}
+
+const qvm_kernel_ops_t *qvm_kernels_get(void) {
+  if (!active_kernels)
+    qvm_kernels_select();
+  return active_kernels;
+}
+
+int qvm_kernels_force(const char *name) {
+  if (strcmp(name, "scalar") == 0) {
+    active_kernels = &qvm_kernels_scalar;
+  } else if (strcmp(name, "avx2") == 0 && cpu_has_avx2()) {
+    active_kernels = &qvm_kernels_avx2;
+  } else if (strcmp(name, "avx512") == 0 && cpu_has_avx512()) {
+    active_kernels = &qvm_kernels_avx512;
+  } else {
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,610 @@
+/*
+ * NexusQ-AI - QVM AVX2 / AVX-512 Kernels
+ * File: modules/quantum/qvm_kernels_avx.c
+ *
+ * Vectorized amplitude kernels. Each function is compiled for its own ISA
+ * via target pragmas, so the file builds with plain -O2 and the choice is
+ * made at runtime by qvm_kernels_select().
+ *
+ * Layout: a double _Complex is {re, im}, so a YMM register holds two
+ * amplitudes and a ZMM register four. A complex product v * c is
+ *   fmaddsub(v, re(c), swap(v) * im(c))
+ * where swap exchanges re/im inside each amplitude.
+ */
+
+#include "include/qvm_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+// ============================================================
+// AVX2 + FMA
+// ============================================================
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+
+static inline __m256d avx2_cmul(__m256d v, __m256d cr, __m256d ci) {
+  __m256d swapped = _mm256_permute_pd(v, 0x5);
+  return _mm256_fmaddsub_pd(v, cr, _mm256_mul_pd(swapped, ci));
+}
+
+static void avx2_run_2x2(double _Complex *lo, double _Complex *hi, size_t n,
+                         const double _Complex m[2][2]) {
+  __m256d m00r = _mm256_set1_pd(creal(m[0][0]));
+  __m256d m00i = _mm256_set1_pd(cimag(m[0][0]));
+  __m256d m01r = _mm256_set1_pd(creal(m[0][1]));
+  __m256d m01i = _mm256_set1_pd(cimag(m[0][1]));
+  __m256d m10r = _mm256_set1_pd(creal(m[1][0]));
+  __m256d m10i = _mm256_set1_pd(cimag(m[1][0]));
+  __m256d m11r = _mm256_set1_pd(creal(m[1][1]));
+  __m256d m11i = _mm256_set1_pd(cimag(m[1][1]));
+  double *l = (double *)lo, *h = (double *)hi;
+
+  size_t k = 0;
+  for (; k + 2 <= n; k += 2) {
+    __m256d a0 = _mm256_loadu_pd(l + 2 * k);
+    __m256d a1 = _mm256_loadu_pd(h + 2 * k);
+    __m256d r0 = _mm256_add_pd(avx2_cmul(a0, m00r, m00i),
+                               avx2_cmul(a1, m01r, m01i));
+    __m256d r1 = _mm256_add_pd(avx2_cmul(a0, m10r, m10i),
+                               avx2_cmul(a1, m11r, m11i));
+    _mm256_storeu_pd(l + 2 * k, r0);
+    _mm256_storeu_pd(h + 2 * k, r1);
+  }
+  for (; k < n; k++) {
+    double _Complex a0 = lo[k], a1 = hi[k];
+    lo[k] = m[0][0] * a0 + m[0][1] * a1;
+    hi[k] = m[1][0] * a0 + m[1][1] * a1;
+  }
+}
+
+// One YMM = one adjacent pair [a0, a1]
+static void avx2_adj_2x2(double _Complex *p, size_t n,
+                         const double _Complex m[2][2]) {
+  __m256d c0 = _mm256_setr_pd(creal(m[0][0]), cimag(m[0][0]), creal(m[1][0]),
+                              cimag(m[1][0]));
+  __m256d c1 = _mm256_setr_pd(creal(m[0][1]), cimag(m[0][1]), creal(m[1][1]),
+                              cimag(m[1][1]));
+  __m256d c0r = _mm256_movedup_pd(c0), c0i = _mm256_permute_pd(c0, 0xF);
+  __m256d c1r = _mm256_movedup_pd(c1), c1i = _mm256_permute_pd(c1, 0xF);
+  double *d = (double *)p;
+
+  for (size_t k = 0; k < n; k++) {
+    __m256d v = _mm256_loadu_pd(d + 4 * k);
+    __m256d a0 = _mm256_permute4x64_pd(v, 0x44); // [a0, a0]
+    __m256d a1 = _mm256_permute4x64_pd(v, 0xEE); // [a1, a1]
+    __m256d r =
+        _mm256_add_pd(avx2_cmul(a0, c0r, c0i), avx2_cmul(a1, c1r, c1i));
+    _mm256_storeu_pd(d + 4 * k, r);
+  }
+}
+
+// Two groups per iteration (q0 >= 1 gives runs of at least 2)
+static void avx2_run_4x4(double _Complex *a, size_t s0, size_t s1, size_t n,
+                         const double _Complex m[4][4]) {
+  __m256d mr[4][4], mi[4][4];
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      mr[i][j] = _mm256_set1_pd(creal(m[i][j]));
+      mi[i][j] = _mm256_set1_pd(cimag(m[i][j]));
+    }
+  }
+  double *d = (double *)a;
+  size_t off[4] = {0, s0, s1, s0 + s1};
+
+  size_t k = 0;
+  for (; k + 2 <= n; k += 2) {
+    __m256d v[4];
+    for (int j = 0; j < 4; j++)
+      v[j] = _mm256_loadu_pd(d + 2 * (off[j] + k));
+    for (int i = 0; i < 4; i++) {
+      __m256d r = avx2_cmul(v[0], mr[i][0], mi[i][0]);
+      for (int j = 1; j < 4; j++)
+        r = _mm256_add_pd(r, avx2_cmul(v[j], mr[i][j], mi[i][j]));
+      _mm256_storeu_pd(d + 2 * (off[i] + k), r);
+    }
+  }
+  for (; k < n; k++) {
+    double _Complex v[4], r[4];
+    for (int j = 0; j < 4; j++)
+      v[j] = a[off[j] + k];
+    for (int i = 0; i < 4; i++)
+      r[i] = m[i][0] * v[0] + m[i][1] * v[1] + m[i][2] * v[2] + m[i][3] * v[3];
+    for (int i = 0; i < 4; i++)
+      a[off[i] + k] = r[i];
+  }
+}
+
+static inline double avx2_hsum(__m256d v) {
+  __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+  return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+static double avx2_norm_run(const double _Complex *p, size_t n) {
+  const double *d = (const double *)p;
+  __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+  size_t k = 0;
+  for (; k + 4 <= n; k += 4) {
+    __m256d v0 = _mm256_loadu_pd(d + 2 * k);
+    __m256d v1 = _mm256_loadu_pd(d + 2 * k + 4);
+    acc0 = _mm256_fmadd_pd(v0, v0, acc0);
+    acc1 = _mm256_fmadd_pd(v1, v1, acc1);
+  }
+  double sum = avx2_hsum(_mm256_add_pd(acc0, acc1));
+  for (; k < n; k++)
+    sum += creal(p[k]) * creal(p[k]) + cimag(p[k]) * cimag(p[k]);
+  return sum;
+}
+
+static void avx2_adj_norms(const double _Complex *p, size_t n, double out[2]) {
+  const double *d = (const double *)p;
+  __m256d acc = _mm256_setzero_pd();
+  for (size_t k = 0; k < n; k++) {
+    __m256d v = _mm256_loadu_pd(d + 4 * k);
+    acc = _mm256_fmadd_pd(v, v, acc);
+  }
+  __m128d lo = _mm256_castpd256_pd128(acc);
+  __m128d hi = _mm256_extractf128_pd(acc, 1);
+  out[0] += _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+  out[1] += _mm_cvtsd_f64(_mm_add_sd(hi, _mm_unpackhi_pd(hi, hi)));
+}
+
+static void avx2_scale_run(double _Complex *p, size_t n, double s) {
+  double *d = (double *)p;
+  __m256d vs = _mm256_set1_pd(s);
+  size_t k = 0;
+  for (; k + 2 <= n; k += 2)
+    _mm256_storeu_pd(d + 2 * k, _mm256_mul_pd(_mm256_loadu_pd(d + 2 * k), vs));
+  for (; k < n; k++)
+    p[k] *= s;
+}
+
+static void avx2_adj_scale(double _Complex *p, size_t n, double s0,
+                           double s1) {
+  double *d = (double *)p;
+  __m256d vs = _mm256_setr_pd(s0, s0, s1, s1);
+  for (size_t k = 0; k < n; k++)
+    _mm256_storeu_pd(d + 4 * k, _mm256_mul_pd(_mm256_loadu_pd(d + 4 * k), vs));
+}
+
+static void avx2_phase_run(double _Complex *p, size_t n, double _Complex ph) {
+  double *d = (double *)p;
+  __m256d pr = _mm256_set1_pd(creal(ph)), pi = _mm256_set1_pd(cimag(ph));
+  size_t k = 0;
+  for (; k + 2 <= n; k += 2)
+    _mm256_storeu_pd(d + 2 * k, avx2_cmul(_mm256_loadu_pd(d + 2 * k), pr, pi));
+  for (; k < n; k++)
+    p[k] *= ph;
+}
+
+#define QK_FN(name) avx2_##name
+#define QK_RUN_2X2 avx2_run_2x2
+#define QK_ADJ_2X2 avx2_adj_2x2
+#define QK_RUN_4X4 avx2_run_4x4
+#define QK_NORM_RUN avx2_norm_run
+#define QK_ADJ_NORMS avx2_adj_norms
+#define QK_SCALE_RUN avx2_scale_run
+#define QK_ADJ_SCALE avx2_adj_scale
+#define QK_PHASE_RUN avx2_phase_run
+#include "include/qvm_kernels_tmpl.h"
+#undef QK_FN
+#undef QK_RUN_2X2
+#undef QK_ADJ_2X2
+#undef QK_RUN_4X4
+#undef QK_NORM_RUN
+#undef QK_ADJ_NORMS
+#undef QK_SCALE_RUN
+#undef QK_ADJ_SCALE
+#undef QK_PHASE_RUN
+
+// --- Single precision: one YMM holds four complex floats ---
+
+static inline __m256 avx2_cmul_ps(__m256 v, __m256 cr, __m256 ci) {
+  __m256 swapped = _mm256_permute_ps(v, 0xB1);
+  return _mm256_fmaddsub_ps(v, cr, _mm256_mul_ps(swapped, ci));
+}
+
+static void avx2_f32_run_2x2(float _Complex *lo, float _Complex *hi, size_t n,
+                             const double _Complex m[2][2]) {
+  __m256 m00r = _mm256_set1_ps((float)creal(m[0][0]));
+  __m256 m00i = _mm256_set1_ps((float)cimag(m[0][0]));
+  __m256 m01r = _mm256_set1_ps((float)creal(m[0][1]));
+  __m256 m01i = _mm256_set1_ps((float)cimag(m[0][1]));
+  __m256 m10r = _mm256_set1_ps((float)creal(m[1][0]));
+  __m256 m10i = _mm256_set1_ps((float)cimag(m[1][0]));
+  __m256 m11r = _mm256_set1_ps((float)creal(m[1][1]));
+  __m256 m11i = _mm256_set1_ps((float)cimag(m[1][1]));
+  float *l = (float *)lo, *h = (float *)hi;
+
+  size_t k = 0;
+  for (; k + 4 <= n; k += 4) {
+    __m256 a0 = _mm256_loadu_ps(l + 2 * k);
+    __m256 a1 = _mm256_loadu_ps(h + 2 * k);
+    __m256 r0 = _mm256_add_ps(avx2_cmul_ps(a0, m00r, m00i),
+                              avx2_cmul_ps(a1, m01r, m01i));
+    __m256 r1 = _mm256_add_ps(avx2_cmul_ps(a0, m10r, m10i),
+                              avx2_cmul_ps(a1, m11r, m11i));
+    _mm256_storeu_ps(l + 2 * k, r0);
+    _mm256_storeu_ps(h + 2 * k, r1);
+  }
+  float _Complex m00 = m[0][0], m01 = m[0][1];
+  float _Complex m10 = m[1][0], m11 = m[1][1];
+  for (; k < n; k++) {
+    float _Complex a0 = lo[k], a1 = hi[k];
+    lo[k] = m00 * a0 + m01 * a1;
+    hi[k] = m10 * a0 + m11 * a1;
+  }
+}
+
+// One YMM = two adjacent pairs [a0, a1, b0, b1]
+static void avx2_f32_adj_2x2(float _Complex *p, size_t n,
+                             const double _Complex m[2][2]) {
+  __m256 c0 = _mm256_setr_ps(creal(m[0][0]), cimag(m[0][0]), creal(m[1][0]),
+                             cimag(m[1][0]), creal(m[0][0]), cimag(m[0][0]),
+                             creal(m[1][0]), cimag(m[1][0]));
+  __m256 c1 = _mm256_setr_ps(creal(m[0][1]), cimag(m[0][1]), creal(m[1][1]),
+                             cimag(m[1][1]), creal(m[0][1]), cimag(m[0][1]),
+                             creal(m[1][1]), cimag(m[1][1]));
+  __m256 c0r = _mm256_moveldup_ps(c0), c0i = _mm256_movehdup_ps(c0);
+  __m256 c1r = _mm256_moveldup_ps(c1), c1i = _mm256_movehdup_ps(c1);
+  float *d = (float *)p;
+
+  size_t k = 0;
+  for (; k + 2 <= n; k += 2) {
+    __m256 v = _mm256_loadu_ps(d + 4 * k);
+    __m256 a0 = _mm256_permute_ps(v, 0x44); // [a0, a0, b0, b0]
+    __m256 a1 = _mm256_permute_ps(v, 0xEE); // [a1, a1, b1, b1]
+    __m256 r =
+        _mm256_add_ps(avx2_cmul_ps(a0, c0r, c0i), avx2_cmul_ps(a1, c1r, c1i));
+    _mm256_storeu_ps(d + 4 * k, r);
+  }
+  if (k < n)
+    avx2_f32_run_2x2(p + 2 * k, p + 2 * k + 1, 1, m);
+}
+
+// Four groups per iteration; shorter runs (q0 < 2) take the scalar tail
+static void avx2_f32_run_4x4(float _Complex *a, size_t s0, size_t s1,
+                             size_t n, const double _Complex m[4][4]) {
+  __m256 mr[4][4], mi[4][4];
+  float _Complex mf[4][4];
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      mr[i][j] = _mm256_set1_ps((float)creal(m[i][j]));
+      mi[i][j] = _mm256_set1_ps((float)cimag(m[i][j]));
+      mf[i][j] = m[i][j];
+    }
+  }
+  float *d = (float *)a;
+  size_t off[4] = {0, s0, s1, s0 + s1};
+
+  size_t k = 0;
+  for (; k + 4 <= n; k += 4) {
+    __m256 v[4];
+    for (int j = 0; j < 4; j++)
+      v[j] = _mm256_loadu_ps(d + 2 * (off[j] + k));
+    for (int i = 0; i < 4; i++) {
+      __m256 r = avx2_cmul_ps(v[0], mr[i][0], mi[i][0]);
+      for (int j = 1; j < 4; j++)
+        r = _mm256_add_ps(r, avx2_cmul_ps(v[j], mr[i][j], mi[i][j]));
+      _mm256_storeu_ps(d + 2 * (off[i] + k), r);
+    }
+  }
+  for (; k < n; k++) {
+    float _Complex v[4], r[4];
+    for (int j = 0; j < 4; j++)
+      v[j] = a[off[j] + k];
+    for (int i = 0; i < 4; i++)
+      r[i] = mf[i][0] * v[0] + mf[i][1] * v[1] + mf[i][2] * v[2] +
+             mf[i][3] * v[3];
+    for (int i = 0; i < 4; i++)
+      a[off[i] + k] = r[i];
+  }
+}
+
+// Squares are exact in double, so the sums are widened before adding
+static inline __m256d avx2_f32_sq_lo(__m256 v) {
+  __m256d x = _mm256_cvtps_pd(_mm256_castps256_ps128(v));
+  return _mm256_mul_pd(x, x);
+}
+
+static inline __m256d avx2_f32_sq_hi(__m256 v) {
+  __m256d x = _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1));
+  return _mm256_mul_pd(x, x);
+}
+
+static double avx2_f32_norm_run(const float _Complex *p, size_t n) {
+  const float *d = (const float *)p;
+  __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+  size_t k = 0;
+  for (; k + 4 <= n; k += 4) {
+    __m256 v = _mm256_loadu_ps(d + 2 * k);
+    acc0 = _mm256_add_pd(acc0, avx2_f32_sq_lo(v));
+    acc1 = _mm256_add_pd(acc1, avx2_f32_sq_hi(v));
+  }
+  double sum = avx2_hsum(_mm256_add_pd(acc0, acc1));
+  for (; k < n; k++) {
+    double re = crealf(p[k]), im = cimagf(p[k]);
+    sum += re * re + im * im;
+  }
+  return sum;
+}
+
+static void avx2_f32_adj_norms(const float _Complex *p, size_t n,
+                               double out[2]) {
+  const float *d = (const float *)p;
+  __m256d acc = _mm256_setzero_pd(); // [|a0|^2 parts, |a1|^2 parts]
+  size_t k = 0;
+  for (; k + 2 <= n; k += 2) {
+    __m256 v = _mm256_loadu_ps(d + 4 * k);
+    acc = _mm256_add_pd(acc, avx2_f32_sq_lo(v));
+    acc = _mm256_add_pd(acc, avx2_f32_sq_hi(v));
+  }
+  __m128d lo = _mm256_castpd256_pd128(acc);
+  __m128d hi = _mm256_extractf128_pd(acc, 1);
+  out[0] += _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+  out[1] += _mm_cvtsd_f64(_mm_add_sd(hi, _mm_unpackhi_pd(hi, hi)));
+  for (; k < n; k++) {
+    for (int b = 0; b < 2; b++) {
+      double re = crealf(p[2 * k + b]), im = cimagf(p[2 * k + b]);
+      out[b] += re * re + im * im;
+    }
+  }
+}
+
+static void avx2_f32_scale_run(float _Complex *p, size_t n, double s) {
+  float *d = (float *)p;
+  __m256 vs = _mm256_set1_ps((float)s);
+  size_t k = 0;
+  for (; k + 4 <= n; k += 4)
+    _mm256_storeu_ps(d + 2 * k, _mm256_mul_ps(_mm256_loadu_ps(d + 2 * k), vs));
+  for (; k < n; k++)
+    p[k] *= (float)s;
+}
+
+static void avx2_f32_adj_scale(float _Complex *p, size_t n, double s0,
+                               double s1) {
+  float *d = (float *)p;
+  float f0 = (float)s0, f1 = (float)s1;
+  __m256 vs = _mm256_setr_ps(f0, f0, f1, f1, f0, f0, f1, f1);
+  size_t k = 0;
+  for (; k + 2 <= n; k += 2)
+    _mm256_storeu_ps(d + 4 * k, _mm256_mul_ps(_mm256_loadu_ps(d + 4 * k), vs));
+  if (k < n) {
+    p[2 * k] *= f0;
+    p[2 * k + 1] *= f1;
+  }
+}
+
+static void avx2_f32_phase_run(float _Complex *p, size_t n,
+                               double _Complex ph) {
+  float *d = (float *)p;
+  __m256 pr = _mm256_set1_ps((float)creal(ph));
+  __m256 pi = _mm256_set1_ps((float)cimag(ph));
+  size_t k = 0;
+  for (; k + 4 <= n; k += 4)
+    _mm256_storeu_ps(d + 2 * k,
+                     avx2_cmul_ps(_mm256_loadu_ps(d + 2 * k), pr, pi));
+  for (; k < n; k++)
+    p[k] *= (float _Complex)ph;
+}
+
+#define QK_AMP float _Complex
+#define QK_FN(name) avx2_f32_##name
+#define QK_RUN_2X2 avx2_f32_run_2x2
+#define QK_ADJ_2X2 avx2_f32_adj_2x2
+#define QK_RUN_4X4 avx2_f32_run_4x4
+#define QK_NORM_RUN avx2_f32_norm_run
+#define QK_ADJ_NORMS avx2_f32_adj_norms
+#define QK_SCALE_RUN avx2_f32_scale_run
+#define QK_ADJ_SCALE avx2_f32_adj_scale
+#define QK_PHASE_RUN avx2_f32_phase_run
+#include "include/qvm_kernels_tmpl.h"
+#undef QK_FN
+#undef QK_RUN_2X2
+#undef QK_ADJ_2X2
+#undef QK_RUN_4X4
+#undef QK_NORM_RUN
+#undef QK_ADJ_NORMS
+#undef QK_SCALE_RUN
+#undef QK_ADJ_SCALE
+#undef QK_PHASE_RUN
+
+#pragma GCC pop_options
+
+// ============================================================
+// AVX-512F
+// ============================================================
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx2,fma")
+
+static inline __m512d avx512_cmul(__m512d v, __m512d cr, __m512d ci) {
+  __m512d swapped = _mm512_permute_pd(v, 0x55);
+  return _mm512_fmaddsub_pd(v, cr, _mm512_mul_pd(swapped, ci));
+}
+
+static void avx512_run_2x2(double _Complex *lo, double _Complex *hi, size_t n,
+                           const double _Complex m[2][2]) {
+  __m512d m00r = _mm512_set1_pd(creal(m[0][0]));
+  __m512d m00i = _mm512_set1_pd(cimag(m[0][0]));
+  __m512d m01r = _mm512_set1_pd(creal(m[0][1]));
+  __m512d m01i = _mm512_set1_pd(cimag(m[0][1]));
+  __m512d m10r = _mm512_set1_pd(creal(m[1][0]));
+  __m512d m10i = _mm512_set1_pd(cimag(m[1][0]));
+  __m512d m11r = _mm512_set1_pd(creal(m[1][1]));
+  __m512d m11i = _mm512_set1_pd(cimag(m[1][1]));
+  double *l = (double *)lo, *h = (double *)hi;
+
+  size_t k = 0;
+  for (; k + 4 <= n; k += 4) {
+    __m512d a0 = _mm512_loadu_pd(l + 2 * k);
+    __m512d a1 = _mm512_loadu_pd(h + 2 * k);
+    __m512d r0 = _mm512_add_pd(avx512_cmul(a0, m00r, m00i),
+                               avx512_cmul(a1, m01r, m01i));
+    __m512d r1 = _mm512_add_pd(avx512_cmul(a0, m10r, m10i),
+                               avx512_cmul(a1, m11r, m11i));
+    _mm512_storeu_pd(l + 2 * k, r0);
+    _mm512_storeu_pd(h + 2 * k, r1);
+  }
+  // Target 1 runs are 2 amplitudes long: finish with the AVX2 body
+  if (k < n)
+    avx2_run_2x2(lo + k, hi + k, n - k, m);
+}
+
+// One ZMM = two adjacent pairs [a0, a1, b0, b1]
+static void avx512_adj_2x2(double _Complex *p, size_t n,
+                           const double _Complex m[2][2]) {
+  __m512d c0 = _mm512_setr_pd(creal(m[0][0]), cimag(m[0][0]), creal(m[1][0]),
+                              cimag(m[1][0]), creal(m[0][0]), cimag(m[0][0]),
+                              creal(m[1][0]), cimag(m[1][0]));
+  __m512d c1 = _mm512_setr_pd(creal(m[0][1]), cimag(m[0][1]), creal(m[1][1]),
+                              cimag(m[1][1]), creal(m[0][1]), cimag(m[0][1]),
+                              creal(m[1][1]), cimag(m[1][1]));
+  __m512d c0r = _mm512_movedup_pd(c0), c0i = _mm512_permute_pd(c0, 0xFF);
+  __m512d c1r = _mm512_movedup_pd(c1), c1i = _mm512_permute_pd(c1, 0xFF);
+  double *d = (double *)p;
+
+  size_t k = 0;
+  for (; k + 2 <= n; k += 2) {
+    __m512d v = _mm512_loadu_pd(d + 4 * k);
+    __m512d a0 = _mm512_permutex_pd(v, 0x44);
+    __m512d a1 = _mm512_permutex_pd(v, 0xEE);
+    __m512d r =
+        _mm512_add_pd(avx512_cmul(a0, c0r, c0i), avx512_cmul(a1, c1r, c1i));
+    _mm512_storeu_pd(d + 4 * k, r);
+  }
+  if (k < n)
+    avx2_adj_2x2(p + 2 * k, n - k, m);
+}
+
+static double avx512_norm_run(const double _Complex *p, size_t n) {
+  const double *d = (const double *)p;
+  __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+  size_t k = 0;
+  for (; k + 8 <= n; k += 8) {
+    __m512d v0 = _mm512_loadu_pd(d + 2 * k);
+    __m512d v1 = _mm512_loadu_pd(d + 2 * k + 8);
+    acc0 = _mm512_fmadd_pd(v0, v0, acc0);
+    acc1 = _mm512_fmadd_pd(v1, v1, acc1);
+  }
+  double sum = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+  if (k < n)
+    sum += avx2_norm_run(p + k, n - k);
+  return sum;
+}
+
+static void avx512_adj_norms(const double _Complex *p, size_t n,
+                             double out[2]) {
+  const double *d = (const double *)p;
+  __m512d acc = _mm512_setzero_pd();
+  size_t k = 0;
+  for (; k + 2 <= n; k += 2) {
+    __m512d v = _mm512_loadu_pd(d + 4 * k);
+    acc = _mm512_fmadd_pd(v, v, acc);
+  }
+  // Fold the two 256-bit halves: each is [|a0|^2 parts, |a1|^2 parts]
+  __m256d half = _mm256_add_pd(_mm512_castpd512_pd256(acc),
+                               _mm512_extractf64x4_pd(acc, 1));
+  __m128d lo = _mm256_castpd256_pd128(half);
+  __m128d hi = _mm256_extractf128_pd(half, 1);
+  out[0] += _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+  out[1] += _mm_cvtsd_f64(_mm_add_sd(hi, _mm_unpackhi_pd(hi, hi)));
+  if (k < n)
+    avx2_adj_norms(p + 2 * k, n - k, out);
+}
+
+static void avx512_scale_run(double _Complex *p, size_t n, double s) {
+  double *d = (double *)p;
+  __m512d vs = _mm512_set1_pd(s);
+  size_t k = 0;
+  for (; k + 4 <= n; k += 4)
+    _mm512_storeu_pd(d + 2 * k, _mm512_mul_pd(_mm512_loadu_pd(d + 2 * k), vs));
+  if (k < n)
+    avx2_scale_run(p + k, n - k, s);
+}
+
+static void avx512_adj_scale(double _Complex *p, size_t n, double s0,
+                             double s1) {
+  double *d = (double *)p;
+  __m512d vs = _mm512_setr_pd(s0, s0, s1, s1, s0, s0, s1, s1);
+  size_t k = 0;
+  for (; k + 2 <= n; k += 2)
+    _mm512_storeu_pd(d + 4 * k, _mm512_mul_pd(_mm512_loadu_pd(d + 4 * k), vs));
+  if (k < n)
+    avx2_adj_scale(p + 2 * k, n - k, s0, s1);
+}
+
+static void avx512_phase_run(double _Complex *p, size_t n,
+                             double _Complex ph) {
+  double *d = (double *)p;
+  __m512d pr = _mm512_set1_pd(creal(ph)), pi = _mm512_set1_pd(cimag(ph));
+  size_t k = 0;
+  for (; k + 4 <= n; k += 4)
+    _mm512_storeu_pd(d + 2 * k,
+                     avx512_cmul(_mm512_loadu_pd(d + 2 * k), pr, pi));
+  if (k < n)
+    avx2_phase_run(p + k, n - k, ph);
+}
+
+#define QK_FN(name) avx512_##name
+#define QK_RUN_2X2 avx512_run_2x2
+#define QK_ADJ_2X2 avx512_adj_2x2
+#define QK_RUN_4X4 avx2_run_4x4 // 4x4 is compute-bound; YMM body suffices
+#define QK_NORM_RUN avx512_norm_run
+#define QK_ADJ_NORMS avx512_adj_norms
+#define QK_SCALE_RUN avx512_scale_run
+#define QK_ADJ_SCALE avx512_adj_scale
+#define QK_PHASE_RUN avx512_phase_run
+#include "include/qvm_kernels_tmpl.h"
+
+#pragma GCC pop_options
+
+const qvm_kernel_f32_ops_t qvm_kernels_f32_avx2 = {
+    .name = "avx2",
+    .apply_2x2 = avx2_f32_apply_2x2,
+    .apply_ctrl_2x2 = avx2_f32_apply_ctrl_2x2,
+    .apply_4x4 = avx2_f32_apply_4x4,
+    .probs = avx2_f32_probs,
+    .collapse = avx2_f32_collapse,
+    .phase = avx2_f32_phase,
+    .diag = avx2_f32_diag,
+    .permute = avx2_f32_permute,
+    .norms = avx2_f32_norms,
+};
+
+const qvm_kernel_ops_t qvm_kernels_avx2 = {
+    .name = "avx2",
+    .apply_2x2 = avx2_apply_2x2,
+    .apply_ctrl_2x2 = avx2_apply_ctrl_2x2,
+    .apply_4x4 = avx2_apply_4x4,
+    .probs = avx2_probs,
+    .collapse = avx2_collapse,
+    .phase = avx2_phase,
+    .diag = avx2_diag,
+    .permute = avx2_permute,
+    .norms = avx2_norms,
+    .f32 = &qvm_kernels_f32_avx2,
+};
+
+const qvm_kernel_ops_t qvm_kernels_avx512 = {
+    .name = "avx512",
+    .apply_2x2 = avx512_apply_2x2,
+    .apply_ctrl_2x2 = avx512_apply_ctrl_2x2,
+    .apply_4x4 = avx512_apply_4x4,
+    .probs = avx512_probs,
+    .collapse = avx512_collapse,
+    .phase = avx512_phase,
+    .diag = avx512_diag,
+    .permute = avx512_permute,
+    .norms = avx512_norms,
+    .f32 = &qvm_kernels_f32_avx2, // Single precision stays on YMM
+};
+
+#else
+
+// Non-x86 builds: never selected, kept so the tables always link
+const qvm_kernel_f32_ops_t qvm_kernels_f32_avx2 = {.name = "avx2-unavailable"};
+const qvm_kernel_ops_t qvm_kernels_avx2 = {.name = "avx2-unavailable"};
+const qvm_kernel_ops_t qvm_kernels_avx512 = {.name = "avx512-unavailable"};
+
+#endif
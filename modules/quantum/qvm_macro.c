@@ -0,0 +1,333 @@
+/*
+ * NexusQ-AI - QFT and Grover Diffusion Macro-ops
+ * File: modules/quantum/qvm_macro.c
+ *
+ * Two patterns that take O(m^2) and O(m) gates run as native passes over
+ * a contiguous range of m qubits (first .. last, qubit `first` the least
+ * significant bit of the range value x):
+ *  - QFT |x> = 2^(-m/2) sum_y e^(2 pi i x y / 2^m) |y>, as a radix-2 FFT
+ *    along the range: one butterfly pass per qubit, its H merged with all
+ *    the controlled phases that target it, then one bit-reversal pass in
+ *    place of the SWAP ladder. m + 1 passes, O(m 2^n), where the gate
+ *    sequence needs m (m + 1) / 2 + m / 2 sweeps. IQFT runs them in
+ *    reverse with conjugate twiddles.
+ *  - DIFFUSE = 2|s><s| - I, with s the uniform superposition of the range:
+ *    one pass sums each group of 2^m amplitudes sharing the other qubits,
+ *    one pass writes 2 mean - amp.
+ * Other backends run the same operators as gate sequences, see
+ * qvm_backend_macro(), unless they take them whole (the density matrix,
+ * to apply its noise channel once per qubit).
+ */
+
+#include "include/qvm_backend.h"
+#include "include/qvm_threads.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DIFFUSE_FEW_GROUPS 8 // Up to this many groups: one global reduction
+
+// --- QFT ---
+
+// Butterfly pass of range qubit j. The twiddle e^(i pi L / 2^j), L the
+// range bits below j, is hi[L >> split] * lo[L & lo_mask]: two tables of
+// at most 2^16 entries instead of one of 2^j.
+typedef struct {
+  double _Complex *amps;
+  int qubit; // first + j
+  int first;
+  int inverse;
+  size_t low_mask; // L = (i >> first) & low_mask
+  int split;
+  size_t lo_mask;
+  const double _Complex *hi;
+  const double _Complex *lo;
+} qft_pass_t;
+
+static void sweep_butterfly(void *arg, size_t chunk, size_t b, size_t e) {
+  const qft_pass_t *q = (const qft_pass_t *)arg;
+  size_t bit = (size_t)1 << q->qubit, below = bit - 1;
+  for (size_t k = b; k < e; k++) {
+    size_t i0 = ((k & ~below) << 1) | (k & below), i1 = i0 | bit;
+    size_t L = (i0 >> q->first) & q->low_mask;
+    double _Complex w = q->hi[L >> q->split] * q->lo[L & q->lo_mask];
+    double _Complex a0 = q->amps[i0], a1 = q->amps[i1];
+    if (q->inverse) {
+      a1 *= conj(w);
+      q->amps[i0] = (a0 + a1) * M_SQRT1_2;
+      q->amps[i1] = (a0 - a1) * M_SQRT1_2;
+    } else {
+      q->amps[i0] = (a0 + a1) * M_SQRT1_2;
+      q->amps[i1] = (a0 - a1) * M_SQRT1_2 * w;
+    }
+  }
+}
+
+typedef struct {
+  double _Complex *amps;
+  int first;
+  int m;
+} qft_reverse_t;
+
+static uint32_t reverse_bits(uint32_t x, int m) {
+  x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+  x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+  x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+  x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+  x = (x >> 16) | (x << 16);
+  return x >> (32 - m);
+}
+
+// Each pair is swapped by its member with the smaller range value
+static void sweep_reverse(void *arg, size_t chunk, size_t b, size_t e) {
+  const qft_reverse_t *r = (const qft_reverse_t *)arg;
+  size_t mask = ((size_t)1 << r->m) - 1;
+  for (size_t i = b; i < e; i++) {
+    uint32_t x = (uint32_t)((i >> r->first) & mask);
+    uint32_t y = reverse_bits(x, r->m);
+    if (y <= x)
+      continue;
+    size_t j = i ^ ((size_t)(x ^ y) << r->first);
+    double _Complex t = r->amps[i];
+    r->amps[i] = r->amps[j];
+    r->amps[j] = t;
+  }
+}
+
+static int check_range(const qvm_state_t *state, int first, int last,
+                       const char *name) {
+  if (!state->amplitudes) {
+    printf("[QVM] Error: %s needs a statevector\n", name);
+    return -1;
+  }
+  if (first < 0 || first > last || last >= state->num_qubits) {
+    printf("[QVM] Error: Invalid %s range %d..%d\n", name, first, last);
+    return -1;
+  }
+  return 0;
+}
+
+void qvm_apply_qft(qvm_state_t *state, int first, int last, int inverse) {
+  if (check_range(state, first, last, inverse ? "IQFT" : "QFT") != 0)
+    return;
+  int m = last - first + 1;
+  size_t size = (size_t)1 << state->num_qubits;
+  size_t table = (size_t)1 << ((m + 1) / 2);
+  double _Complex *tables =
+      (double _Complex *)malloc(2 * table * sizeof(double _Complex));
+  if (!tables) {
+    printf("[QVM] Error: Out of memory for the QFT twiddles\n");
+    return;
+  }
+  qft_reverse_t rev = {state->amplitudes, first, m};
+  size_t grain = qvm_threads_grain(sizeof(double _Complex));
+  if (inverse)
+    qvm_parallel_for(size, grain, sweep_reverse, &rev);
+
+  for (int s = 0; s < m; s++) {
+    int j = inverse ? s : m - 1 - s;
+    int split = (j + 1) / 2;
+    qft_pass_t q = {.amps = state->amplitudes,
+                    .qubit = first + j,
+                    .first = first,
+                    .inverse = inverse,
+                    .low_mask = ((size_t)1 << j) - 1,
+                    .split = split,
+                    .lo_mask = ((size_t)1 << split) - 1,
+                    .hi = tables,
+                    .lo = tables + table};
+    double angle = M_PI / ldexp(1.0, j);
+    for (size_t h = 0; h < (size_t)1 << (j - split); h++)
+      tables[h] = cexp(I * angle * ldexp((double)h, split));
+    for (size_t l = 0; l < (size_t)1 << split; l++)
+      tables[table + l] = cexp(I * angle * (double)l);
+    qvm_parallel_for(size / 2, qvm_threads_grain(2 * sizeof(double _Complex)),
+                     sweep_butterfly, &q);
+  }
+
+  if (!inverse)
+    qvm_parallel_for(size, grain, sweep_reverse, &rev);
+  free(tables);
+}
+
+// --- Diffusion ---
+
+// Group g = (hi, lo): the 2^m amplitudes hi * 2^(last+1) + x * 2^first + lo
+typedef struct {
+  double _Complex *amps;
+  int first;
+  int last;
+  size_t range; // 2^m
+  double _Complex *partial; // Few groups: [chunk][group] sums
+  const double _Complex *mean;
+} diffuse_t;
+
+static size_t group_of(const diffuse_t *d, size_t i) {
+  size_t lo = i & (((size_t)1 << d->first) - 1);
+  return ((i >> (d->last + 1)) << d->first) | lo;
+}
+
+static void sweep_group_sums(void *arg, size_t chunk, size_t b, size_t e) {
+  const diffuse_t *d = (const diffuse_t *)arg;
+  double _Complex *sums = d->partial + chunk * DIFFUSE_FEW_GROUPS;
+  for (size_t i = b; i < e; i++)
+    sums[group_of(d, i)] += d->amps[i];
+}
+
+static void sweep_reflect(void *arg, size_t chunk, size_t b, size_t e) {
+  const diffuse_t *d = (const diffuse_t *)arg;
+  for (size_t i = b; i < e; i++)
+    d->amps[i] = 2 * d->mean[group_of(d, i)] - d->amps[i];
+}
+
+// Many groups: each work item is a group, summed and reflected while its
+// amplitudes are still in cache. Consecutive groups share their x rows.
+static void sweep_groups(void *arg, size_t chunk, size_t b, size_t e) {
+  const diffuse_t *d = (const diffuse_t *)arg;
+  size_t lo_count = (size_t)1 << d->first;
+  size_t width = e - b < lo_count ? e - b : lo_count;
+  double _Complex *mean =
+      (double _Complex *)malloc(width * sizeof(double _Complex));
+  if (!mean)
+    return;
+  for (size_t g = b; g < e;) {
+    size_t hi = g >> d->first, lo = g & (lo_count - 1);
+    size_t n = lo_count - lo < e - g ? lo_count - lo : e - g;
+    double _Complex *row = d->amps + (hi << (d->last + 1)) + lo;
+    memset(mean, 0, n * sizeof(double _Complex));
+    for (size_t x = 0; x < d->range; x++)
+      for (size_t l = 0; l < n; l++)
+        mean[l] += row[(x << d->first) + l];
+    for (size_t l = 0; l < n; l++)
+      mean[l] /= (double)d->range;
+    for (size_t x = 0; x < d->range; x++)
+      for (size_t l = 0; l < n; l++)
+        row[(x << d->first) + l] = 2 * mean[l] - row[(x << d->first) + l];
+    g += n;
+  }
+  free(mean);
+}
+
+void qvm_apply_diffusion(qvm_state_t *state, int first, int last) {
+  if (check_range(state, first, last, "DIFFUSE") != 0)
+    return;
+  int n = state->num_qubits, m = last - first + 1;
+  size_t size = (size_t)1 << n, groups = (size_t)1 << (n - m);
+  diffuse_t d = {.amps = state->amplitudes,
+                 .first = first,
+                 .last = last,
+                 .range = (size_t)1 << m};
+
+  if (groups > DIFFUSE_FEW_GROUPS) {
+    qvm_parallel_for(groups,
+                     qvm_threads_grain(d.range * sizeof(double _Complex)),
+                     sweep_groups, &d);
+    return;
+  }
+
+  // Few large groups: a reduction pass with partial sums per chunk, added
+  // in order, then an update pass
+  size_t grain = qvm_threads_grain(sizeof(double _Complex));
+  if (qvm_parallel_chunks(size, grain) > QVM_REDUCE_CHUNKS)
+    grain = (size + QVM_REDUCE_CHUNKS - 1) / QVM_REDUCE_CHUNKS;
+  size_t chunks = qvm_parallel_chunks(size, grain);
+  d.partial = (double _Complex *)calloc(chunks * DIFFUSE_FEW_GROUPS,
+                                        sizeof(double _Complex));
+  if (!d.partial) {
+    printf("[QVM] Error: Out of memory for the diffusion sums\n");
+    return;
+  }
+  qvm_parallel_for(size, grain, sweep_group_sums, &d);
+  double _Complex mean[DIFFUSE_FEW_GROUPS] = {0};
+  for (size_t c = 0; c < chunks; c++)
+    for (size_t g = 0; g < groups; g++)
+      mean[g] += d.partial[c * DIFFUSE_FEW_GROUPS + g];
+  for (size_t g = 0; g < groups; g++)
+    mean[g] /= (double)d.range;
+  d.mean = mean;
+  qvm_parallel_for(size, grain, sweep_reflect, &d);
+  free(d.partial);
+}
+
+// --- Other backends ---
+
+static int apply_seq(qvm_state_t *state, const qvm_backend_ops_t *ops,
+                     qvm_gate_type_t type, int target, int control,
+                     double theta) {
+  qvm_gate_t g = {type, target, control, {theta}};
+  return ops->apply_gate(state, &g);
+}
+
+// Phase -1 on |1..1> of first..last: Z, CZ or H CCX H
+static int backend_mcz(qvm_state_t *state, const qvm_backend_ops_t *ops,
+                       int first, int last) {
+  if (first == last)
+    return apply_seq(state, ops, GATE_Z, first, -1, 0);
+  if (last == first + 1)
+    return apply_seq(state, ops, GATE_CZ, last, first, 0);
+  if (last > first + 2)
+    return -1;
+  qvm_gate_t ccx = {GATE_CCX, last, first, {0}, first + 1};
+  if (apply_seq(state, ops, GATE_H, last, -1, 0) != 0 ||
+      ops->apply_gate(state, &ccx) != 0)
+    return -1;
+  return apply_seq(state, ops, GATE_H, last, -1, 0);
+}
+
+// QFT as H and CPHASE per qubit plus the SWAP ladder; IQFT in reverse with
+// negated angles. DIFFUSE as -H X MCZ X H, the sign from (X Z)^2 = -I;
+// past 3 qubits the MCZ has no ancilla-free decomposition here.
+int qvm_backend_macro(qvm_state_t *state, const qvm_backend_ops_t *ops,
+                      const qvm_gate_t *gate) {
+  int first = gate->control, last = gate->target, m = last - first + 1;
+  int rc = 0;
+  switch (gate->type) {
+  case GATE_QFT:
+    for (int j = m - 1; j >= 0 && rc == 0; j--) {
+      rc = apply_seq(state, ops, GATE_H, first + j, -1, 0);
+      for (int k = j - 1; k >= 0 && rc == 0; k--)
+        rc = apply_seq(state, ops, GATE_CPHASE, first + j, first + k,
+                       M_PI / ldexp(1.0, j - k));
+    }
+    for (int j = 0; j < m / 2 && rc == 0; j++)
+      rc = apply_seq(state, ops, GATE_SWAP, last - j, first + j, 0);
+    return rc;
+  case GATE_IQFT:
+    for (int j = 0; j < m / 2 && rc == 0; j++)
+      rc = apply_seq(state, ops, GATE_SWAP, last - j, first + j, 0);
+    for (int j = 0; j < m && rc == 0; j++) {
+      for (int k = 0; k < j && rc == 0; k++)
+        rc = apply_seq(state, ops, GATE_CPHASE, first + j, first + k,
+                       -M_PI / ldexp(1.0, j - k));
+      if (rc == 0)
+        rc = apply_seq(state, ops, GATE_H, first + j, -1, 0);
+    }
+    return rc;
+  case GATE_DIFFUSE:
+    if (m > QVM_BACKEND_DIFFUSE_MAX)
+      return -1;
+    for (int q = first; q <= last && rc == 0; q++)
+      rc = apply_seq(state, ops, GATE_H, q, -1, 0) ||
+           apply_seq(state, ops, GATE_X, q, -1, 0);
+    if (rc == 0)
+      rc = backend_mcz(state, ops, first, last);
+    for (int q = first; q <= last && rc == 0; q++)
+      rc = apply_seq(state, ops, GATE_X, q, -1, 0) ||
+           apply_seq(state, ops, GATE_H, q, -1, 0);
+    for (int i = 0; i < 2 && rc == 0; i++)
+      rc = apply_seq(state, ops, GATE_X, first, -1, 0) ||
+           apply_seq(state, ops, GATE_Z, first, -1, 0);
+    return rc;
+  default:
+    return -1;
+  }
+}
+
+int qvm_backend_apply(qvm_state_t *state, const qvm_backend_ops_t *ops,
+                      const qvm_gate_t *gate) {
+  if (ops->apply_gate(state, gate) == 0)
+    return 0;
+  return qvm_gate_is_range(gate->type) ? qvm_backend_macro(state, ops, gate)
+                                       : -1;
+}
@@ -0,0 +1,725 @@
+/*
+ * NexusQ-AI - Matrix Product State Backend
+ * File: modules/quantum/qvm_mps.c
+ *
+ * The state is a chain of site tensors A[q] of shape (dl, 2, dr), one per
+ * qubit, in mixed canonical form around `center`: sites to the left are
+ * left-orthonormal, sites to the right right-orthonormal. Memory is
+ * O(n * chi^2) instead of O(2^n), so shallow low-entanglement circuits on
+ * 50-100 qubits fit in megabytes.
+ *
+ *  - 1-qubit gates contract into one site and keep the canonical form;
+ *  - 2-qubit gates on neighbouring sites contract both tensors, apply the
+ *    4x4 and split them again with an SVD, truncated to the configured
+ *    bond dimension and discarded-weight threshold;
+ *  - gates on distant qubits are routed through a SWAP network: the lower
+ *    qubit is swapped up to its partner, the gate applied, and the swaps
+ *    undone, so site q always holds qubit q.
+ *
+ * The SVD is a one-sided (Hestenes) Jacobi on the shorter side of the
+ * matrix, which stays accurate for the tiny singular values truncation
+ * looks at and needs no external linear algebra.
+ */
+
+#include "include/qvm_backend.h"
+#include "include/qvm_threads.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MPS_JACOBI_SWEEPS 64
+#define MPS_JACOBI_EPS 1e-15
+#define MPS_PRINT_MAX_BONDS 64
+#define MPS_SAMPLE_UNIFORMS (1 << 20) // Pre-drawn uniforms per shot batch
+
+typedef struct {
+  int dl;
+  int dr;
+  double _Complex *t; // [dl][2][dr]
+} mps_site_t;
+
+typedef struct {
+  int n;
+  int center;
+  double fidelity; // Product of (1 - discarded weight) over truncations
+  mps_site_t *sites;
+} mps_t;
+
+#define SITE(s, a, p, b) ((s)->t[((size_t)(a)*2 + (p)) * (s)->dr + (b)])
+
+// --- Configuration ---
+
+static int mps_max_bond = 0; // 0 = not read from the environment yet
+static double mps_cutoff = QVM_MPS_DEFAULT_CUTOFF;
+
+static int max_bond(void) {
+  if (mps_max_bond == 0) {
+    const char *bond = getenv("QVM_MPS_BOND");
+    const char *cutoff = getenv("QVM_MPS_CUTOFF");
+    mps_max_bond = bond && atoi(bond) > 0 ? atoi(bond) : QVM_MPS_DEFAULT_BOND;
+    if (cutoff && atof(cutoff) >= 0.0)
+      mps_cutoff = atof(cutoff);
+  }
+  return mps_max_bond;
+}
+
+void qvm_mps_configure(int bond, double cutoff) {
+  max_bond();
+  if (bond > 0)
+    mps_max_bond = bond;
+  if (cutoff >= 0.0)
+    mps_cutoff = cutoff;
+}
+
+// --- SVD ---
+
+static double norm2(double _Complex z) {
+  return creal(z) * creal(z) + cimag(z) * cimag(z);
+}
+
+typedef struct {
+  double s;
+  int col;
+} sv_order_t;
+
+static int cmp_sv_desc(const void *a, const void *b) {
+  double x = ((const sv_order_t *)a)->s, y = ((const sv_order_t *)b)->s;
+  return x < y ? 1 : x > y ? -1 : 0;
+}
+
+// Thin SVD of the row-major m x k matrix a: a = u diag(s) vh with
+// r = min(m, k), u m x r and vh r x k (both row-major), s descending.
+// The Jacobi rotations orthogonalize the r columns of a (or of a^H when
+// k > m), accumulating the r x r rotation in v.
+static int svd(const double _Complex *a, int m, int k, double _Complex *u,
+               double *s, double _Complex *vh) {
+  int wide = k > m;
+  int r = wide ? m : k, len = wide ? k : m;
+  double _Complex *w =
+      (double _Complex *)malloc((size_t)r * len * sizeof(double _Complex));
+  double _Complex *v =
+      (double _Complex *)calloc((size_t)r * r, sizeof(double _Complex));
+  sv_order_t *order = (sv_order_t *)malloc(r * sizeof(sv_order_t));
+  if (!w || !v || !order) {
+    free(w);
+    free(v);
+    free(order);
+    return -1;
+  }
+
+  // Column-major working copy: w[j*len + i]
+  for (int j = 0; j < r; j++) {
+    for (int i = 0; i < len; i++)
+      w[(size_t)j * len + i] =
+          wide ? conj(a[(size_t)j * k + i]) : a[(size_t)i * k + j];
+    v[(size_t)j * r + j] = 1.0;
+  }
+
+  for (int sweep = 0; sweep < MPS_JACOBI_SWEEPS; sweep++) {
+    int rotated = 0;
+    for (int p = 0; p < r - 1; p++) {
+      for (int q = p + 1; q < r; q++) {
+        double _Complex *wp = w + (size_t)p * len, *wq = w + (size_t)q * len;
+        double alpha = 0.0, beta = 0.0;
+        double _Complex gamma = 0.0;
+        for (int i = 0; i < len; i++) {
+          alpha += norm2(wp[i]);
+          beta += norm2(wq[i]);
+          gamma += conj(wp[i]) * wq[i];
+        }
+        double g = cabs(gamma);
+        if (g <= MPS_JACOBI_EPS * sqrt(alpha * beta) || g == 0.0)
+          continue;
+        rotated = 1;
+
+        // Rotate the phase out of gamma, then a real Jacobi rotation
+        double _Complex ph = conj(gamma) / g;
+        double zeta = (beta - alpha) / (2.0 * g);
+        double t =
+            (zeta >= 0 ? 1.0 : -1.0) / (fabs(zeta) + sqrt(1 + zeta * zeta));
+        double c = 1.0 / sqrt(1.0 + t * t), sn = c * t;
+        for (int i = 0; i < len; i++) {
+          double _Complex xp = wp[i], xq = wq[i] * ph;
+          wp[i] = c * xp - sn * xq;
+          wq[i] = sn * xp + c * xq;
+        }
+        double _Complex *vp = v + (size_t)p * r, *vq = v + (size_t)q * r;
+        for (int i = 0; i < r; i++) {
+          double _Complex xp = vp[i], xq = vq[i] * ph;
+          vp[i] = c * xp - sn * xq;
+          vq[i] = sn * xp + c * xq;
+        }
+      }
+    }
+    if (!rotated)
+      break;
+  }
+
+  for (int j = 0; j < r; j++) {
+    double nrm = 0.0;
+    for (int i = 0; i < len; i++)
+      nrm += norm2(w[(size_t)j * len + i]);
+    order[j].s = sqrt(nrm);
+    order[j].col = j;
+  }
+  qsort(order, r, sizeof(sv_order_t), cmp_sv_desc);
+
+  // Normalized columns of w are the singular vectors of the long side,
+  // the columns of v those of the short side
+  for (int x = 0; x < r; x++) {
+    int j = order[x].col;
+    double inv = order[x].s > 0.0 ? 1.0 / order[x].s : 0.0;
+    const double _Complex *wj = w + (size_t)j * len, *vj = v + (size_t)j * r;
+    s[x] = order[x].s;
+    if (!wide) {
+      for (int i = 0; i < m; i++)
+        u[(size_t)i * r + x] = wj[i] * inv;
+      for (int c = 0; c < k; c++)
+        vh[(size_t)x * k + c] = conj(vj[c]);
+    } else {
+      for (int i = 0; i < m; i++)
+        u[(size_t)i * r + x] = vj[i];
+      for (int c = 0; c < k; c++)
+        vh[(size_t)x * k + c] = conj(wj[c]) * inv;
+    }
+  }
+
+  free(w);
+  free(v);
+  free(order);
+  return 0;
+}
+
+// Number of singular values to keep: at most the bond cap, dropping the
+// smallest ones while their total weight stays within the cutoff.
+// Rescales the kept values to unit norm and tracks the lost fidelity.
+static int truncate_bond(mps_t *m, double *s, int r, int cap) {
+  double total = 0.0, tail = 0.0;
+  for (int x = 0; x < r; x++)
+    total += s[x] * s[x];
+  int keep = r;
+  while (keep > 1) {
+    double w = s[keep - 1] * s[keep - 1];
+    if (keep <= cap && tail + w > mps_cutoff * total)
+      break;
+    tail += w;
+    keep--;
+  }
+  if (tail > 0.0 && total > 0.0) {
+    double scale = sqrt(total / (total - tail));
+    for (int x = 0; x < keep; x++)
+      s[x] *= scale;
+    m->fidelity *= 1.0 - tail / total;
+  }
+  return keep;
+}
+
+// --- Canonical form ---
+
+static int site_resize(mps_site_t *site, int dl, int dr) {
+  double _Complex *t = (double _Complex *)malloc((size_t)dl * 2 * dr *
+                                                 sizeof(double _Complex));
+  if (!t)
+    return -1;
+  free(site->t);
+  site->t = t;
+  site->dl = dl;
+  site->dr = dr;
+  return 0;
+}
+
+// Shift the orthogonality center one site right (dir = 1) or left (-1).
+// Bond dimensions never grow here, so only the cutoff can truncate.
+static int shift_center(mps_t *m, int dir) {
+  int i = m->center, j = i + dir;
+  mps_site_t *a = &m->sites[i], *b = &m->sites[j];
+  int rows = dir > 0 ? 2 * a->dl : a->dl;
+  int cols = dir > 0 ? a->dr : 2 * a->dr;
+  int r = rows < cols ? rows : cols;
+  double _Complex *u = (double _Complex *)malloc((size_t)rows * r *
+                                                 sizeof(double _Complex));
+  double _Complex *vh = (double _Complex *)malloc((size_t)r * cols *
+                                                  sizeof(double _Complex));
+  double *s = (double *)malloc(r * sizeof(double));
+  double _Complex *nb = NULL;
+  int rc = -1;
+  if (!u || !vh || !s || svd(a->t, rows, cols, u, s, vh) != 0)
+    goto out;
+
+  int keep = truncate_bond(m, s, r, r);
+  if (dir > 0) {
+    // A[i] = U, A[i+1] = S Vh A[i+1]
+    nb = (double _Complex *)calloc((size_t)keep * 2 * b->dr,
+                                   sizeof(double _Complex));
+    if (!nb)
+      goto out;
+    for (int x = 0; x < keep; x++)
+      for (int c = 0; c < cols; c++) {
+        double _Complex f = s[x] * vh[(size_t)x * cols + c];
+        for (int p = 0; p < 2; p++)
+          for (int e = 0; e < b->dr; e++)
+            nb[((size_t)x * 2 + p) * b->dr + e] += f * SITE(b, c, p, e);
+      }
+    int dl = a->dl;
+    if (site_resize(a, dl, keep) != 0)
+      goto out;
+    for (int row = 0; row < rows; row++)
+      memcpy(a->t + (size_t)row * keep, u + (size_t)row * r,
+             keep * sizeof(double _Complex));
+    free(b->t);
+    b->t = nb;
+    b->dl = keep;
+  } else {
+    // A[i] = Vh, A[i-1] = A[i-1] U S
+    nb = (double _Complex *)calloc((size_t)b->dl * 2 * keep,
+                                   sizeof(double _Complex));
+    if (!nb)
+      goto out;
+    for (int row = 0; row < 2 * b->dl; row++)
+      for (int c = 0; c < b->dr; c++) {
+        double _Complex f = b->t[(size_t)row * b->dr + c];
+        for (int x = 0; x < keep; x++)
+          nb[(size_t)row * keep + x] += f * u[(size_t)c * r + x] * s[x];
+      }
+    int dr = a->dr;
+    if (site_resize(a, keep, dr) != 0)
+      goto out;
+    memcpy(a->t, vh, (size_t)keep * cols * sizeof(double _Complex));
+    free(b->t);
+    b->t = nb;
+    b->dr = keep;
+  }
+  nb = NULL;
+  m->center = j;
+  rc = 0;
+
+out:
+  free(u);
+  free(vh);
+  free(s);
+  free(nb);
+  return rc;
+}
+
+static int move_center(mps_t *m, int site) {
+  while (m->center < site)
+    if (shift_center(m, 1) != 0)
+      return -1;
+  while (m->center > site)
+    if (shift_center(m, -1) != 0)
+      return -1;
+  return 0;
+}
+
+// --- Gate application ---
+
+static void apply_site(mps_t *m, int q, const double _Complex g[2][2]) {
+  mps_site_t *a = &m->sites[q];
+  for (int x = 0; x < a->dl; x++)
+    for (int e = 0; e < a->dr; e++) {
+      double _Complex v0 = SITE(a, x, 0, e), v1 = SITE(a, x, 1, e);
+      SITE(a, x, 0, e) = g[0][0] * v0 + g[0][1] * v1;
+      SITE(a, x, 1, e) = g[1][0] * v0 + g[1][1] * v1;
+    }
+}
+
+// 4x4 gate on sites (i, i+1), basis index 2*bit(i+1) + bit(i). The
+// center ends on i+1 with sites <= i left-orthonormal.
+static int apply_pair(mps_t *m, int i, const double _Complex g[4][4]) {
+  if (move_center(m, i) != 0)
+    return -1;
+  mps_site_t *a = &m->sites[i], *b = &m->sites[i + 1];
+  int dl = a->dl, dm = a->dr, dr = b->dr;
+  int rows = 2 * dl, cols = 2 * dr, r = rows < cols ? rows : cols;
+  size_t cells = (size_t)rows * cols;
+  double _Complex *theta =
+      (double _Complex *)calloc(cells, sizeof(double _Complex));
+  double _Complex *gt =
+      (double _Complex *)malloc(cells * sizeof(double _Complex));
+  double _Complex *u = (double _Complex *)malloc((size_t)rows * r *
+                                                 sizeof(double _Complex));
+  double _Complex *vh = (double _Complex *)malloc((size_t)r * cols *
+                                                  sizeof(double _Complex));
+  double *s = (double *)malloc(r * sizeof(double));
+  int rc = -1;
+  if (!theta || !gt || !u || !vh || !s)
+    goto out;
+
+  // theta[(x, pi), (pj, e)] = sum_c A[x, pi, c] B[c, pj, e]
+  for (int x = 0; x < dl; x++)
+    for (int pi = 0; pi < 2; pi++)
+      for (int c = 0; c < dm; c++) {
+        double _Complex f = SITE(a, x, pi, c);
+        if (f == 0.0)
+          continue;
+        for (int pj = 0; pj < 2; pj++)
+          for (int e = 0; e < dr; e++)
+            theta[((size_t)x * 2 + pi) * cols + (size_t)pj * dr + e] +=
+                f * SITE(b, c, pj, e);
+      }
+
+  // Gate on the two physical legs: local index l = 2*pj + pi
+  for (int x = 0; x < dl; x++)
+    for (int e = 0; e < dr; e++) {
+      size_t off[4];
+      double _Complex in[4];
+      for (int l = 0; l < 4; l++) {
+        off[l] = ((size_t)x * 2 + (l & 1)) * cols + (size_t)(l >> 1) * dr + e;
+        in[l] = theta[off[l]];
+      }
+      for (int l = 0; l < 4; l++)
+        gt[off[l]] = g[l][0] * in[0] + g[l][1] * in[1] + g[l][2] * in[2] +
+                     g[l][3] * in[3];
+    }
+
+  if (svd(gt, rows, cols, u, s, vh) != 0)
+    goto out;
+  int keep = truncate_bond(m, s, r, max_bond());
+
+  if (site_resize(a, dl, keep) != 0 || site_resize(b, keep, dr) != 0)
+    goto out;
+  for (int row = 0; row < rows; row++)
+    memcpy(a->t + (size_t)row * keep, u + (size_t)row * r,
+           keep * sizeof(double _Complex));
+  for (int x = 0; x < keep; x++)
+    for (int c = 0; c < cols; c++)
+      b->t[(size_t)x * cols + c] = s[x] * vh[(size_t)x * cols + c];
+  m->center = i + 1;
+  rc = 0;
+
+out:
+  free(theta);
+  free(gt);
+  free(u);
+  free(vh);
+  free(s);
+  return rc;
+}
+
+static const double _Complex MPS_SWAP[4][4] = {
+    {1, 0, 0, 0}, {0, 0, 1, 0}, {0, 1, 0, 0}, {0, 0, 0, 1}};
+
+// 4x4 on qubits lo < hi (basis 2*bit(hi) + bit(lo)) through a SWAP
+// network: lo is carried up to hi - 1 and brought back afterwards
+static int apply_two(mps_t *m, int lo, int hi, const double _Complex g[4][4]) {
+  for (int k = lo; k < hi - 1; k++)
+    if (apply_pair(m, k, MPS_SWAP) != 0)
+      return -1;
+  if (apply_pair(m, hi - 1, g) != 0)
+    return -1;
+  for (int k = hi - 2; k >= lo; k--)
+    if (apply_pair(m, k, MPS_SWAP) != 0)
+      return -1;
+  return 0;
+}
+
+// --- Backend table ---
+
+static void mps_release(mps_t *m) {
+  if (!m)
+    return;
+  if (m->sites)
+    for (int q = 0; q < m->n; q++)
+      free(m->sites[q].t);
+  free(m->sites);
+  free(m);
+}
+
+static int mps_init(qvm_state_t *state, int num_qubits) {
+  mps_t *m = (mps_t *)calloc(1, sizeof(mps_t));
+  if (!m)
+    return -1;
+  m->n = num_qubits;
+  m->fidelity = 1.0;
+  m->sites = (mps_site_t *)calloc(num_qubits, sizeof(mps_site_t));
+  if (!m->sites) {
+    mps_release(m);
+    return -1;
+  }
+  // |0...0> is a product state: every bond has dimension 1
+  for (int q = 0; q < num_qubits; q++) {
+    if (site_resize(&m->sites[q], 1, 1) != 0) {
+      mps_release(m);
+      return -1;
+    }
+    m->sites[q].t[0] = 1.0;
+    m->sites[q].t[1] = 0.0;
+  }
+  state->backend_state = m;
+  return 0;
+}
+
+static void mps_free(qvm_state_t *state) {
+  mps_release((mps_t *)state->backend_state);
+  state->backend_state = NULL;
+}
+
+static int mps_apply_gate(qvm_state_t *state, const qvm_gate_t *gate) {
+  mps_t *m = (mps_t *)state->backend_state;
+  double _Complex g2[2][2], g4[4][4];
+
+  if (qvm_gate_unitary(gate, g2) == 0) {
+    apply_site(m, gate->target, g2);
+    return 0;
+  }
+  if (gate->type == GATE_CCX)
+    return qvm_backend_ccx(state, &qvm_backend_mps, gate);
+  int lo = gate->control < gate->target ? gate->control : gate->target;
+  int hi = gate->control < gate->target ? gate->target : gate->control;
+  if (qvm_gate_matrix2(gate, lo, g4) != 0)
+    return -1;
+  if (apply_two(m, lo, hi, g4) != 0) {
+    printf("[QVM] MPS: out of memory applying gate type %d\n", gate->type);
+    return -1;
+  }
+  return 0;
+}
+
+static int mps_measure(qvm_state_t *state, int qubit) {
+  mps_t *m = (mps_t *)state->backend_state;
+  if (move_center(m, qubit) != 0)
+    return 0;
+
+  // The center tensor carries the whole norm
+  mps_site_t *a = &m->sites[qubit];
+  double p[2] = {0.0, 0.0};
+  for (int x = 0; x < a->dl; x++)
+    for (int b = 0; b < 2; b++)
+      for (int e = 0; e < a->dr; e++)
+        p[b] += norm2(SITE(a, x, b, e));
+
+  double r = qvm_rng_uniform(qvm_state_rng(state));
+  int result = r * (p[0] + p[1]) < p[0] ? 0 : 1;
+  if (p[result] <= 0.0)
+    result ^= 1;
+  double scale = 1.0 / sqrt(p[result]);
+  for (int x = 0; x < a->dl; x++)
+    for (int e = 0; e < a->dr; e++) {
+      SITE(a, x, result, e) *= scale;
+      SITE(a, x, result ^ 1, e) = 0.0;
+    }
+  return result;
+}
+
+typedef struct {
+  const mps_t *m;
+  const double *u; // n uniforms per shot
+  uint64_t *outcomes;
+  uint64_t mask;
+  int width; // Largest bond dimension
+} mps_sample_t;
+
+// With the center on site 0, every later site is right-orthonormal, so
+// the conditional probability of each bit only needs the left vector.
+static void sweep_shots(void *arg, size_t chunk, size_t b, size_t e) {
+  mps_sample_t *sw = (mps_sample_t *)arg;
+  const mps_t *m = sw->m;
+  double _Complex *vec = (double _Complex *)malloc(3 * (size_t)sw->width *
+                                                   sizeof(double _Complex));
+  if (!vec)
+    return;
+
+  for (size_t shot = b; shot < e; shot++) {
+    double _Complex *v = vec, *w = vec + sw->width, *w1 = vec + 2 * sw->width;
+    const double *u = sw->u + shot * m->n;
+    uint64_t outcome = 0;
+    v[0] = 1.0;
+    for (int q = 0; q < m->n; q++) {
+      const mps_site_t *a = &m->sites[q];
+      double p0 = 0.0, p1 = 0.0;
+      for (int y = 0; y < a->dr; y++) {
+        double _Complex s0 = 0.0, s1 = 0.0;
+        for (int x = 0; x < a->dl; x++) {
+          s0 += v[x] * SITE(a, x, 0, y);
+          s1 += v[x] * SITE(a, x, 1, y);
+        }
+        w[y] = s0;
+        w1[y] = s1;
+        p0 += norm2(s0);
+        p1 += norm2(s1);
+      }
+      int bit = u[q] * (p0 + p1) < p0 ? 0 : 1;
+      if ((bit ? p1 : p0) <= 0.0)
+        bit ^= 1;
+      double scale = 1.0 / sqrt(bit ? p1 : p0);
+      const double _Complex *src = bit ? w1 : w;
+      for (int y = 0; y < a->dr; y++)
+        v[y] = src[y] * scale;
+      if (bit && q < 64)
+        outcome |= (uint64_t)1 << q;
+    }
+    sw->outcomes[shot] = outcome & sw->mask;
+  }
+  free(vec);
+}
+
+static int mps_sample(qvm_state_t *state, int shots, uint64_t mask,
+                      qvm_counts_t *out_counts) {
+  mps_t *m = (mps_t *)state->backend_state;
+  if (move_center(m, 0) != 0)
+    return -1;
+
+  int width = 1;
+  for (int q = 0; q < m->n; q++)
+    if (m->sites[q].dr > width)
+      width = m->sites[q].dr;
+
+  // Uniforms are drawn in bulk from the state's stream, a batch at a time,
+  // so the shots themselves can run on the worker pool without an RNG
+  int batch = MPS_SAMPLE_UNIFORMS / m->n;
+  if (batch < 1)
+    batch = 1;
+  if (batch > shots)
+    batch = shots;
+  uint64_t *outcomes = (uint64_t *)malloc(shots * sizeof(uint64_t));
+  double *u = (double *)malloc((size_t)batch * m->n * sizeof(double));
+  if (!outcomes || !u) {
+    free(outcomes);
+    free(u);
+    return -1;
+  }
+
+  mps_sample_t sw = {.m = m, .u = u, .mask = mask, .width = width};
+  for (int first = 0; first < shots; first += batch) {
+    int count = shots - first < batch ? shots - first : batch;
+    qvm_rng_fill_uniform(qvm_state_rng(state), u, (size_t)count * m->n);
+    sw.outcomes = outcomes + first;
+    size_t bytes = (size_t)m->n * width * width * sizeof(double _Complex);
+    qvm_parallel_for(count, qvm_threads_grain(bytes), sweep_shots, &sw);
+  }
+  free(u);
+
+  int rc = qvm_counts_from_outcomes(outcomes, shots, m->n, mask, out_counts);
+  free(outcomes);
+  return rc;
+}
+
+static size_t mps_bytes(const mps_t *m) {
+  size_t cells = 0;
+  for (int q = 0; q < m->n; q++)
+    cells += (size_t)m->sites[q].dl * 2 * m->sites[q].dr;
+  return cells * sizeof(double _Complex);
+}
+
+static void mps_print(const qvm_state_t *state) {
+  const mps_t *m = (const mps_t *)state->backend_state;
+  qvm_mps_stats_t st;
+  qvm_mps_stats(state, &st);
+  printf("\n--- MPS State (%d qubits, max bond %d/%d, %zu KB) ---\n", m->n,
+         st.max_bond, max_bond(), st.bytes >> 10);
+  if (m->n - 1 <= MPS_PRINT_MAX_BONDS) {
+    printf("Bonds:");
+    for (int q = 0; q < m->n - 1; q++)
+      printf(" %d", m->sites[q].dr);
+    printf("\n");
+  }
+  printf("Truncation fidelity: %.6f\n", st.fidelity);
+  printf("---------------------\n");
+}
+
+const qvm_backend_ops_t qvm_backend_mps = {
+    .name = "mps",
+    .max_qubits = QVM_MPS_MAX_QUBITS,
+    .init = mps_init,
+    .free = mps_free,
+    .apply_gate = mps_apply_gate,
+    .measure = mps_measure,
+    .sample = mps_sample,
+    .print = mps_print,
+};
+
+// --- MPS-specific API ---
+
+int qvm_mps_stats(const qvm_state_t *state, qvm_mps_stats_t *out) {
+  if (state->backend != QVM_BACKEND_MPS || !state->backend_state)
+    return -1;
+  const mps_t *m = (const mps_t *)state->backend_state;
+  out->max_bond = 1;
+  for (int q = 0; q < m->n; q++)
+    if (m->sites[q].dr > out->max_bond)
+      out->max_bond = m->sites[q].dr;
+  out->bytes = mps_bytes(m);
+  out->fidelity = m->fidelity;
+  return 0;
+}
+
+// Transfer-matrix contraction of <psi|P|psi>: E[a][a'] carries the bra
+// (a) and ket (a') bond indices from left to right, O(n chi^3).
+int qvm_mps_expectation(const qvm_state_t *state, const char *paulis,
+                        double *out) {
+  if (state->backend != QVM_BACKEND_MPS || !state->backend_state)
+    return -1;
+  const mps_t *m = (const mps_t *)state->backend_state;
+  size_t len = strlen(paulis);
+  static const double _Complex ID[2][2] = {{1, 0}, {0, 1}};
+  for (size_t q = 0; q < len; q++) {
+    if (!strchr("IXYZ", paulis[q]) || (q >= (size_t)m->n && paulis[q] != 'I'))
+      return -1;
+  }
+
+  int width = 1;
+  for (int q = 0; q < m->n; q++)
+    if (m->sites[q].dr > width)
+      width = m->sites[q].dr;
+  size_t wsq = (size_t)width * width;
+  double _Complex *e = (double _Complex *)malloc(wsq * sizeof(double _Complex));
+  double _Complex *en =
+      (double _Complex *)malloc(wsq * sizeof(double _Complex));
+  double _Complex *f =
+      (double _Complex *)malloc(2 * wsq * sizeof(double _Complex));
+  if (!e || !en || !f) {
+    free(e);
+    free(en);
+    free(f);
+    return -1;
+  }
+
+  e[0] = 1.0;
+  for (int q = 0; q < m->n; q++) {
+    const mps_site_t *a = &m->sites[q];
+    int dl = a->dl, dr = a->dr;
+    double _Complex op[2][2];
+    char p = (size_t)q < len ? paulis[q] : 'I';
+    if (p == 'I')
+      memcpy(op, ID, sizeof(op));
+    else
+      qvm_gate_matrix(p == 'X' ? GATE_X : p == 'Y' ? GATE_Y : GATE_Z, op);
+
+    // f[x][i][y'] = sum_{x', j} E[x][x'] op[i][j] A[x'][j][y']
+    memset(f, 0, (size_t)dl * 2 * dr * sizeof(double _Complex));
+    for (int x = 0; x < dl; x++)
+      for (int xp = 0; xp < dl; xp++) {
+        double _Complex ex = e[(size_t)x * dl + xp];
+        if (ex == 0.0)
+          continue;
+        for (int i = 0; i < 2; i++) {
+          double _Complex c0 = ex * op[i][0], c1 = ex * op[i][1];
+          for (int y = 0; y < dr; y++)
+            f[((size_t)x * 2 + i) * dr + y] +=
+                c0 * SITE(a, xp, 0, y) + c1 * SITE(a, xp, 1, y);
+        }
+      }
+
+    // E'[y][y'] = sum_{x, i} conj(A[x][i][y]) f[x][i][y']
+    memset(en, 0, (size_t)dr * dr * sizeof(double _Complex));
+    for (int x = 0; x < dl; x++)
+      for (int i = 0; i < 2; i++)
+        for (int y = 0; y < dr; y++) {
+          double _Complex ca = conj(SITE(a, x, i, y));
+          if (ca == 0.0)
+            continue;
+          for (int yp = 0; yp < dr; yp++)
+            en[(size_t)y * dr + yp] += ca * f[((size_t)x * 2 + i) * dr + yp];
+        }
+    double _Complex *tmp = e;
+    e = en;
+    en = tmp;
+  }
+
+  *out = creal(e[0]);
+  free(e);
+  free(en);
+  free(f);
+  return 0;
+}
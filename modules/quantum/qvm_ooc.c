@@ -0,0 +1,740 @@
+/*
+ * NexusQ-AI - Out-of-Core Statevector Backend
+ * File: modules/quantum/qvm_ooc.c
+ *
+ * A statevector too large for RAM lives in an unlinked scratch file as
+ * 2^(n-c) chunks of 2^c amplitudes. Physical bits below c index inside a
+ * chunk ("local"), the others pick the chunk ("global"); pos[] maps each
+ * logical qubit to its physical bit. Gates are queued, and one pass
+ * streams every chunk through memory, applying the whole queue to it:
+ *  - gates on local bits run on the chunk seen as a c-qubit statevector,
+ *    with the usual kernels and worker pool;
+ *  - diagonal gates, and controls on global bits, move no data between
+ *    chunks: global bits only select the chunks a gate applies to, or the
+ *    constant factor it multiplies them by;
+ *  - any other gate on a global qubit first swaps that qubit with the
+ *    least recently used local bit, in a pass over chunk pairs that also
+ *    drains the queue.
+ * Passes are pipelined: an I/O thread reads chunks ahead with pread() and
+ * writes finished ones back with pwrite() while the pool computes, with
+ * OOC_SLOTS buffers in flight. Traffic is reported in GB/s of amplitudes
+ * read and written.
+ */
+
+#include "include/qvm_backend.h"
+#include "include/qvm_kernels.h"
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/statvfs.h>
+#include <time.h>
+#include <unistd.h>
+
+#define OOC_DEFAULT_DIR "/var/tmp" // Disk-backed, unlike a tmpfs /tmp
+#define OOC_MIN_CHUNK 3            // CCX needs three local qubits
+#define OOC_MAX_CHUNK 30
+#define OOC_SLOTS 3         // Chunk buffers: read-ahead, compute, write-back
+#define OOC_MAX_PENDING 256 // Queued gates before a pass is forced
+#define OOC_PRINT_MAX_QUBITS 16
+
+// --- Configuration ---
+
+static char ooc_dir_path[4096];
+static int ooc_chunk = 0; // 0 = not read from the environment yet
+
+static int clamp_chunk(int c) {
+  return c < OOC_MIN_CHUNK ? OOC_MIN_CHUNK
+                           : (c > OOC_MAX_CHUNK ? OOC_MAX_CHUNK : c);
+}
+
+static int chunk_qubits(void) {
+  if (ooc_chunk == 0) {
+    const char *dir = getenv("QVM_OOC_DIR");
+    const char *chunk = getenv("QVM_OOC_CHUNK");
+    if (dir)
+      snprintf(ooc_dir_path, sizeof(ooc_dir_path), "%s", dir);
+    ooc_chunk = clamp_chunk(chunk && atoi(chunk) > 0 ? atoi(chunk)
+                                                     : QVM_OOC_DEFAULT_CHUNK);
+  }
+  return ooc_chunk;
+}
+
+void qvm_ooc_configure(const char *dir, int chunk) {
+  chunk_qubits();
+  if (dir)
+    snprintf(ooc_dir_path, sizeof(ooc_dir_path), "%s", dir);
+  if (chunk > 0)
+    ooc_chunk = clamp_chunk(chunk);
+}
+
+const char *qvm_ooc_dir(void) {
+  chunk_qubits();
+  return ooc_dir_path[0] ? ooc_dir_path : NULL;
+}
+
+// --- State ---
+
+// One queued gate. Chunk-index conditions are tested per chunk; the gate
+// or form itself only uses local bits.
+typedef struct {
+  int is_form;
+  qvm_gate_t gate;      // !is_form
+  qvm_gate_form_t form; // is_form; mask 0 multiplies the chunk by d[0]
+  uint64_t need_mask;   // Chunk bits the op is restricted to...
+  uint64_t need_val;    // ...and their required values
+  uint64_t parity;      // Chunk bits whose parity swaps d[0] and d[1]
+} ooc_op_t;
+
+typedef struct {
+  int fd;
+  int n;
+  int c; // Local qubits
+  size_t chunk_amps;
+  size_t num_chunks;
+  int pos[QVM_OOC_MAX_QUBITS];       // Physical bit of each logical qubit
+  int qubit_at[QVM_OOC_MAX_QUBITS];  // Logical qubit at each physical bit
+  long last_use[QVM_OOC_MAX_QUBITS]; // Gate clock, per local bit
+  long clock;
+  ooc_op_t pending[OOC_MAX_PENDING];
+  int num_pending;
+  double _Complex *slot[OOC_SLOTS]; // Two chunks each, for pair passes
+  size_t *units;                    // Scratch list of a pass
+  double *norms;                    // Per chunk, after a probing pass
+  int norms_valid;                  // Nothing changed since
+  char *dir;
+  qvm_ooc_stats_t stats;
+} ooc_t;
+
+static qvm_state_t chunk_view(double _Complex *amps, int qubits) {
+  qvm_state_t view = {.num_qubits = qubits,
+                      .amplitudes = amps,
+                      .backend = QVM_BACKEND_STATEVECTOR};
+  return view;
+}
+
+static uint64_t to_logical(const ooc_t *o, uint64_t phys) {
+  uint64_t out = 0;
+  for (int p = 0; p < o->n; p++)
+    if ((phys >> p) & 1)
+      out |= (uint64_t)1 << o->qubit_at[p];
+  return out;
+}
+
+// --- Passes ---
+
+typedef struct ooc_pass ooc_pass_t;
+struct ooc_pass {
+  ooc_t *o;
+  const size_t *units; // First chunk of each unit, in file order
+  size_t num_units;
+  int pair_bit; // Units are chunk pairs differing in this chunk bit, or -1
+  // One unit in memory; returns 1 if it must be written back
+  int (*compute)(ooc_pass_t *pass, size_t unit, double _Complex *amps);
+  void *ctx;
+};
+
+typedef struct {
+  ooc_pass_t *pass;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  size_t loaded, computed, stored; // Units through each stage
+  int dirty[OOC_SLOTS];
+  int error; // errno of the first failed transfer
+  uint64_t bytes_read;
+  uint64_t bytes_written;
+} ooc_pipe_t;
+
+static int transfer(int fd, char *buf, size_t bytes, off_t off, int write) {
+  while (bytes > 0) {
+    ssize_t r =
+        write ? pwrite(fd, buf, bytes, off) : pread(fd, buf, bytes, off);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      return r < 0 ? errno : EIO;
+    buf += r;
+    bytes -= (size_t)r;
+    off += r;
+  }
+  return 0;
+}
+
+// Read or write the chunks of one unit; an errno value on failure
+static int unit_io(const ooc_pass_t *pass, size_t unit, int write) {
+  const ooc_t *o = pass->o;
+  size_t bytes = o->chunk_amps * sizeof(double _Complex);
+  char *buf = (char *)o->slot[unit % OOC_SLOTS];
+  int chunks = pass->pair_bit >= 0 ? 2 : 1;
+  for (int k = 0; k < chunks; k++) {
+    size_t chunk = pass->units[unit] | (k ? (size_t)1 << pass->pair_bit : 0);
+    int rc = transfer(o->fd, buf + k * bytes, bytes, (off_t)(chunk * bytes),
+                      write);
+    if (rc)
+      return rc;
+  }
+  return 0;
+}
+
+// Writes first (they free a slot), then reads up to OOC_SLOTS units ahead
+static void *io_thread(void *arg) {
+  ooc_pipe_t *p = (ooc_pipe_t *)arg;
+  const ooc_pass_t *pass = p->pass;
+  uint64_t unit_bytes = (uint64_t)pass->o->chunk_amps *
+                        sizeof(double _Complex) * (pass->pair_bit >= 0 ? 2 : 1);
+  pthread_mutex_lock(&p->lock);
+  while (p->stored < pass->num_units) {
+    int write = p->stored < p->computed;
+    if (!write && (p->loaded == pass->num_units ||
+                   p->loaded >= p->stored + OOC_SLOTS)) {
+      pthread_cond_wait(&p->cond, &p->lock);
+      continue;
+    }
+    size_t unit = write ? p->stored : p->loaded;
+    int skip = write && (!p->dirty[unit % OOC_SLOTS] || p->error);
+    pthread_mutex_unlock(&p->lock);
+    int rc = skip ? 0 : unit_io(pass, unit, write);
+    pthread_mutex_lock(&p->lock);
+    if (rc && !p->error)
+      p->error = rc;
+    if (write) {
+      p->bytes_written += skip ? 0 : unit_bytes;
+      p->stored++;
+    } else {
+      p->bytes_read += unit_bytes;
+      p->loaded++;
+    }
+    pthread_cond_broadcast(&p->cond);
+  }
+  pthread_mutex_unlock(&p->lock);
+  return NULL;
+}
+
+static double elapsed(const struct timespec *a, const struct timespec *b) {
+  return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+static int run_pass(ooc_pass_t *pass) {
+  extern void qmonitor_record_ooc(uint64_t bytes, double seconds);
+  ooc_t *o = pass->o;
+  if (pass->num_units == 0)
+    return 0;
+  ooc_pipe_t p = {.pass = pass};
+  pthread_mutex_init(&p.lock, NULL);
+  pthread_cond_init(&p.cond, NULL);
+  struct timespec start, end, w0, w1;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  pthread_t io;
+  if (pthread_create(&io, NULL, io_thread, &p) != 0) {
+    pthread_mutex_destroy(&p.lock);
+    pthread_cond_destroy(&p.cond);
+    return -1;
+  }
+
+  double wait = 0.0;
+  for (size_t u = 0; u < pass->num_units; u++) {
+    pthread_mutex_lock(&p.lock);
+    if (p.loaded <= u) {
+      clock_gettime(CLOCK_MONOTONIC, &w0);
+      while (p.loaded <= u)
+        pthread_cond_wait(&p.cond, &p.lock);
+      clock_gettime(CLOCK_MONOTONIC, &w1);
+      wait += elapsed(&w0, &w1);
+    }
+    int failed = p.error;
+    pthread_mutex_unlock(&p.lock);
+    int dirty = failed ? 0 : pass->compute(pass, u, o->slot[u % OOC_SLOTS]);
+    pthread_mutex_lock(&p.lock);
+    p.dirty[u % OOC_SLOTS] = dirty;
+    p.computed++;
+    pthread_cond_broadcast(&p.cond);
+    pthread_mutex_unlock(&p.lock);
+  }
+  pthread_join(io, NULL);
+  pthread_mutex_destroy(&p.lock);
+  pthread_cond_destroy(&p.cond);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  double seconds = elapsed(&start, &end);
+  qvm_ooc_stats_t *st = &o->stats;
+  st->passes++;
+  st->bytes_read += p.bytes_read;
+  st->bytes_written += p.bytes_written;
+  st->seconds += seconds;
+  st->io_wait += wait;
+  st->gbps = st->seconds > 0.0
+                 ? (st->bytes_read + st->bytes_written) / st->seconds / 1e9
+                 : 0.0;
+  qmonitor_record_ooc(p.bytes_read + p.bytes_written, seconds);
+  if (p.error) {
+    printf("[QVM] Out-of-core: scratch file I/O failed: %s\n",
+           strerror(p.error));
+    return -1;
+  }
+  return 0;
+}
+
+// --- Queue ---
+
+// The queue on one chunk, seen as a c-qubit statevector; 1 if it changed
+static int apply_pending(ooc_t *o, size_t chunk, double _Complex *amps) {
+  qvm_state_t view = chunk_view(amps, o->c);
+  int changed = 0;
+  for (int i = 0; i < o->num_pending; i++) {
+    const ooc_op_t *op = &o->pending[i];
+    if ((chunk & op->need_mask) != op->need_val)
+      continue;
+    changed = 1;
+    if (!op->is_form) {
+      qvm_apply_unitary(&view, &op->gate);
+      continue;
+    }
+    qvm_gate_form_t f = op->form;
+    if (__builtin_parityll(chunk & op->parity)) {
+      f.d[0] = op->form.d[1];
+      f.d[1] = op->form.d[0];
+    }
+    if (f.mask != 0) {
+      qvm_apply_form(&view, &f);
+    } else if (f.d[0] == 0) {
+      memset(amps, 0, o->chunk_amps * sizeof(double _Complex));
+    } else if (f.d[0] != 1) {
+      // Constant factor: a diagonal with equal entries on bit 0
+      qvm_gate_form_t scale = {.kind = QVM_FORM_DIAG, .mask = 1,
+                               .d = {f.d[0], f.d[0]}};
+      qvm_apply_form(&view, &scale);
+    }
+  }
+  return changed;
+}
+
+static int chunk_touched(const ooc_t *o, size_t chunk) {
+  for (int i = 0; i < o->num_pending; i++)
+    if ((chunk & o->pending[i].need_mask) == o->pending[i].need_val)
+      return 1;
+  return 0;
+}
+
+typedef struct {
+  int probe; // Physical bit whose probabilities are summed, -1 for none
+  double probs[2];
+} flush_t;
+
+static int compute_flush(ooc_pass_t *pass, size_t unit, double _Complex *amps) {
+  ooc_t *o = pass->o;
+  flush_t *f = (flush_t *)pass->ctx;
+  size_t chunk = pass->units[unit];
+  int dirty = apply_pending(o, chunk, amps);
+  if (f->probe >= 0) {
+    qvm_state_t view = chunk_view(amps, o->c);
+    double p[2];
+    qvm_qubit_probs(&view, f->probe < o->c ? f->probe : 0, p);
+    o->norms[chunk] = p[0] + p[1];
+    if (f->probe < o->c) {
+      f->probs[0] += p[0];
+      f->probs[1] += p[1];
+    } else {
+      f->probs[(chunk >> (f->probe - o->c)) & 1] += p[0] + p[1];
+    }
+  }
+  return dirty;
+}
+
+// Drain the queue in one pass. With probe >= 0, also sum the probabilities
+// of that physical bit and refresh the per-chunk norms; a global bit is
+// answered from the norms alone when nothing changed since.
+static int flush(ooc_t *o, int probe, double probs[2]) {
+  if (probe >= o->c && o->num_pending == 0 && o->norms_valid) {
+    probs[0] = probs[1] = 0.0;
+    for (size_t chunk = 0; chunk < o->num_chunks; chunk++)
+      probs[(chunk >> (probe - o->c)) & 1] += o->norms[chunk];
+    return 0;
+  }
+  if (o->num_pending == 0 && probe < 0)
+    return 0;
+  size_t n = 0;
+  for (size_t chunk = 0; chunk < o->num_chunks; chunk++)
+    if (probe >= 0 || chunk_touched(o, chunk))
+      o->units[n++] = chunk;
+  flush_t f = {.probe = probe};
+  ooc_pass_t pass = {o, o->units, n, -1, compute_flush, &f};
+  int rc = run_pass(&pass);
+  o->num_pending = 0;
+  o->norms_valid = probe >= 0 && rc == 0;
+  if (probs) {
+    probs[0] = f.probs[0];
+    probs[1] = f.probs[1];
+  }
+  return rc;
+}
+
+static int queue(ooc_t *o, const ooc_op_t *op) {
+  if (o->num_pending == OOC_MAX_PENDING && flush(o, -1, NULL) != 0)
+    return -1;
+  o->pending[o->num_pending++] = *op;
+  o->norms_valid = 0;
+  return 0;
+}
+
+// Split a form on physical bits into chunk conditions and local bits
+static int queue_form(ooc_t *o, const qvm_gate_form_t *form) {
+  uint64_t local = ((uint64_t)1 << o->c) - 1;
+  ooc_op_t op = {.is_form = 1, .form = *form};
+  op.form.mask &= local;
+  switch (form->kind) {
+  case QVM_FORM_PHASE:
+    op.need_mask = op.need_val = form->mask >> o->c;
+    if (op.form.mask == 0)
+      op.form.d[0] = form->d[1];
+    break;
+  case QVM_FORM_DIAG:
+    op.parity = form->mask >> o->c;
+    break;
+  case QVM_FORM_PERMUTE:
+    op.need_mask = form->mask >> o->c;
+    op.need_val = form->set >> o->c;
+    op.form.set &= local;
+    break;
+  }
+  return queue(o, &op);
+}
+
+// --- Qubit reordering ---
+
+// Chunk pairs that differ in the global bit are drained of the queue and
+// swapped as one (c + 1)-qubit statevector whose top bit is the global one
+static int compute_swap(ooc_pass_t *pass, size_t unit, double _Complex *amps) {
+  ooc_t *o = pass->o;
+  size_t chunk = pass->units[unit];
+  apply_pending(o, chunk, amps);
+  apply_pending(o, chunk | ((size_t)1 << pass->pair_bit),
+                amps + o->chunk_amps);
+  qvm_state_t view = chunk_view(amps, o->c + 1);
+  qvm_gate_t swap = {GATE_SWAP, o->c, *(const int *)pass->ctx};
+  qvm_apply_unitary(&view, &swap);
+  return 1;
+}
+
+static int swap_in(ooc_t *o, int global, int local) {
+  size_t bit = (size_t)1 << (global - o->c), n = 0;
+  for (size_t chunk = 0; chunk < o->num_chunks; chunk++)
+    if (!(chunk & bit))
+      o->units[n++] = chunk;
+  ooc_pass_t pass = {o, o->units, n, global - o->c, compute_swap, &local};
+  int rc = run_pass(&pass);
+  o->num_pending = 0;
+  o->norms_valid = 0;
+  o->stats.swaps++;
+
+  int a = o->qubit_at[global], b = o->qubit_at[local];
+  o->qubit_at[global] = b;
+  o->qubit_at[local] = a;
+  o->pos[a] = local;
+  o->pos[b] = global;
+  o->last_use[local] = o->clock;
+  return rc;
+}
+
+// Least recently used local bit not held by the gate
+static int pick_victim(const ooc_t *o, const int *wires, int num_wires) {
+  int victim = -1;
+  for (int p = 0; p < o->c; p++) {
+    int busy = 0;
+    for (int w = 0; w < num_wires; w++)
+      busy |= o->pos[wires[w]] == p;
+    if (!busy && (victim < 0 || o->last_use[p] < o->last_use[victim]))
+      victim = p;
+  }
+  return victim;
+}
+
+static qvm_gate_t physical_gate(ooc_t *o, const qvm_gate_t *gate,
+                                const int *wires, int num_wires) {
+  qvm_gate_t g = *gate;
+  g.target = o->pos[gate->target];
+  if (num_wires >= 2)
+    g.control = o->pos[gate->control];
+  if (num_wires == 3)
+    g.control2 = o->pos[gate->control2];
+  for (int w = 0; w < num_wires; w++)
+    if (o->pos[wires[w]] < o->c)
+      o->last_use[o->pos[wires[w]]] = o->clock;
+  return g;
+}
+
+// --- Backend table ---
+
+static void ooc_release(ooc_t *o) {
+  if (o->fd >= 0)
+    close(o->fd);
+  for (int s = 0; s < OOC_SLOTS; s++)
+    free(o->slot[s]);
+  free(o->units);
+  free(o->norms);
+  free(o->dir);
+  free(o);
+}
+
+static int ooc_init(qvm_state_t *state, int num_qubits) {
+  ooc_t *o = (ooc_t *)calloc(1, sizeof(ooc_t));
+  if (!o)
+    return -1;
+  qvm_kernels_select();
+  o->fd = -1;
+  o->n = num_qubits;
+  o->c = chunk_qubits() < num_qubits ? chunk_qubits() : num_qubits;
+  o->chunk_amps = (size_t)1 << o->c;
+  o->num_chunks = (size_t)1 << (num_qubits - o->c);
+  o->stats.chunk_qubits = o->c;
+  for (int q = 0; q < num_qubits; q++)
+    o->pos[q] = o->qubit_at[q] = q;
+
+  const char *dir = qvm_ooc_dir() ? qvm_ooc_dir() : OOC_DEFAULT_DIR;
+  size_t chunk_bytes = o->chunk_amps * sizeof(double _Complex);
+  uint64_t bytes = (uint64_t)chunk_bytes * o->num_chunks;
+  struct statvfs fs;
+  uint64_t avail = 0;
+  if (statvfs(dir, &fs) == 0)
+    avail = (uint64_t)fs.f_bavail * fs.f_frsize;
+  if (avail > 0 && avail < bytes) {
+    printf("[QVM] Out-of-core: %s has %llu MB free, the state needs %llu MB\n",
+           dir, (unsigned long long)(avail >> 20),
+           (unsigned long long)(bytes >> 20));
+    ooc_release(o);
+    return -1;
+  }
+
+  // The file is unlinked at once: it disappears with the process
+  char path[sizeof(ooc_dir_path) + 32];
+  snprintf(path, sizeof(path), "%s/qvm-ooc-XXXXXX", dir);
+  o->fd = mkstemp(path);
+  if (o->fd >= 0)
+    unlink(path);
+  o->dir = strdup(dir);
+  o->units = (size_t *)malloc(o->num_chunks * sizeof(size_t));
+  o->norms = (double *)calloc(o->num_chunks, sizeof(double));
+  int ok = o->fd >= 0 && o->dir && o->units && o->norms &&
+           ftruncate(o->fd, (off_t)bytes) == 0;
+  for (int s = 0; s < OOC_SLOTS && ok; s++)
+    ok = (o->slot[s] = (double _Complex *)malloc(2 * chunk_bytes)) != NULL;
+  // Sparse file: every amplitude reads as zero until written
+  double _Complex one = 1.0;
+  if (!ok || transfer(o->fd, (char *)&one, sizeof(one), 0, 1) != 0) {
+    printf("[QVM] Out-of-core: cannot create a scratch file in %s\n", dir);
+    ooc_release(o);
+    return -1;
+  }
+  state->backend_state = o;
+  return 0;
+}
+
+static void ooc_free(qvm_state_t *state) {
+  ooc_release((ooc_t *)state->backend_state);
+  state->backend_state = NULL;
+}
+
+static int ooc_apply_gate(qvm_state_t *state, const qvm_gate_t *gate) {
+  ooc_t *o = (ooc_t *)state->backend_state;
+  int wires[3] = {gate->target, gate->control, gate->control2};
+  int num_wires = gate->type == GATE_CCX                 ? 3
+                  : qvm_gate_is_two_qubit(gate->type) ? 2
+                                                         : 1;
+  double _Complex m[2][2];
+  if (num_wires == 1 && qvm_gate_unitary(gate, m) != 0)
+    return -1;
+  o->clock++;
+
+  // Diagonal gates, and permutations within chunks, need no reordering
+  qvm_gate_t g = physical_gate(o, gate, wires, num_wires);
+  qvm_gate_form_t form;
+  if (qvm_gate_form(&g, &form) == 0 &&
+      (form.kind != QVM_FORM_PERMUTE || (form.flip >> o->c) == 0))
+    return queue_form(o, &form);
+
+  for (int w = 0; w < num_wires; w++) {
+    if (o->pos[wires[w]] < o->c)
+      continue;
+    int victim = pick_victim(o, wires, num_wires);
+    if (swap_in(o, o->pos[wires[w]], victim) != 0)
+      return -1;
+  }
+  ooc_op_t op = {.gate = physical_gate(o, gate, wires, num_wires)};
+  return queue(o, &op);
+}
+
+static int ooc_measure(qvm_state_t *state, int qubit) {
+  ooc_t *o = (ooc_t *)state->backend_state;
+  int p = o->pos[qubit];
+  double probs[2] = {0.0, 0.0};
+  if (flush(o, p, probs) != 0)
+    return 0;
+  double r = qvm_rng_uniform(qvm_state_rng(state));
+  int result = r * (probs[0] + probs[1]) < probs[0] ? 0 : 1;
+  if (probs[result] <= 0.0)
+    result ^= 1;
+
+  // The collapse rides along with the next pass
+  double scale = 1.0 / sqrt(probs[result]);
+  qvm_gate_form_t collapse = {.kind = QVM_FORM_DIAG,
+                              .mask = (uint64_t)1 << p};
+  collapse.d[result] = scale;
+  queue_form(o, &collapse);
+  return result;
+}
+
+typedef struct {
+  const double *u;
+  int shots;
+  int next;          // First unassigned uniform
+  const double *cum; // Mass before each chunk (+inf past the last)
+  uint64_t *index;   // Physical basis index per uniform
+} select_t;
+
+static int compute_select(ooc_pass_t *pass, size_t unit,
+                          double _Complex *amps) {
+  const ooc_t *o = pass->o;
+  select_t *s = (select_t *)pass->ctx;
+  size_t chunk = pass->units[unit];
+  double acc = s->cum[chunk], end = s->cum[chunk + 1];
+  uint64_t base = (uint64_t)chunk << o->c;
+  size_t last_nz = 0;
+  for (size_t i = 0;
+       i < o->chunk_amps && s->next < s->shots && s->u[s->next] < end; i++) {
+    double p =
+        creal(amps[i]) * creal(amps[i]) + cimag(amps[i]) * cimag(amps[i]);
+    if (p == 0.0)
+      continue;
+    acc += p;
+    last_nz = i;
+    while (s->next < s->shots && s->u[s->next] < acc && s->u[s->next] < end)
+      s->index[s->next++] = base | i;
+  }
+  // Rounding between the chunk norm and this running sum
+  while (s->next < s->shots && s->u[s->next] < end)
+    s->index[s->next++] = base | last_nz;
+  return 0;
+}
+
+// Chunk norms from a probing pass, then a read-only pass over the chunks
+// that hold at least one of the sorted uniforms
+static int ooc_sample(qvm_state_t *state, int shots, uint64_t mask,
+                      qvm_counts_t *out_counts) {
+  ooc_t *o = (ooc_t *)state->backend_state;
+  memset(out_counts, 0, sizeof(*out_counts));
+  double probs[2];
+  if (shots <= 0 || flush(o, 0, probs) != 0)
+    return -1;
+  double *cum = (double *)malloc((o->num_chunks + 1) * sizeof(double));
+  double *u = (double *)malloc(shots * sizeof(double));
+  uint64_t *index = (uint64_t *)malloc(shots * sizeof(uint64_t));
+  int rc = -1;
+  if (cum && u && index) {
+    cum[0] = 0.0;
+    for (size_t chunk = 0; chunk < o->num_chunks; chunk++)
+      cum[chunk + 1] = cum[chunk] + o->norms[chunk];
+    qvm_sorted_uniforms(qvm_state_rng(state), u, shots, cum[o->num_chunks]);
+    cum[o->num_chunks] = INFINITY;
+
+    size_t n = 0;
+    int k = 0;
+    for (size_t chunk = 0; chunk < o->num_chunks && k < shots; chunk++) {
+      if (u[k] >= cum[chunk + 1])
+        continue;
+      o->units[n++] = chunk;
+      while (k < shots && u[k] < cum[chunk + 1])
+        k++;
+    }
+    select_t s = {u, shots, 0, cum, index};
+    ooc_pass_t pass = {o, o->units, n, -1, compute_select, &s};
+    rc = run_pass(&pass);
+    for (int j = 0; j < shots && rc == 0; j++)
+      index[j] = to_logical(o, index[j]) & mask;
+    if (rc == 0)
+      rc = qvm_counts_from_outcomes(index, shots, o->n, mask, out_counts);
+  }
+  free(cum);
+  free(u);
+  free(index);
+  return rc;
+}
+
+static int compute_read(ooc_pass_t *pass, size_t unit, double _Complex *amps) {
+  const ooc_t *o = pass->o;
+  double _Complex *out = (double _Complex *)pass->ctx;
+  uint64_t base = (uint64_t)pass->units[unit] << o->c;
+  for (size_t i = 0; i < o->chunk_amps; i++)
+    out[to_logical(o, base | i)] = amps[i];
+  return 0;
+}
+
+int qvm_ooc_read(qvm_state_t *state, double _Complex *out) {
+  if (state->backend != QVM_BACKEND_OUT_OF_CORE || !state->backend_state)
+    return -1;
+  ooc_t *o = (ooc_t *)state->backend_state;
+  if (flush(o, -1, NULL) != 0)
+    return -1;
+  for (size_t chunk = 0; chunk < o->num_chunks; chunk++)
+    o->units[chunk] = chunk;
+  ooc_pass_t pass = {o, o->units, o->num_chunks, -1, compute_read, out};
+  return run_pass(&pass);
+}
+
+static void ooc_print(const qvm_state_t *state) {
+  const ooc_t *o = (const ooc_t *)state->backend_state;
+  const qvm_ooc_stats_t *st = &o->stats;
+  size_t chunk_bytes = o->chunk_amps * sizeof(double _Complex);
+  printf("\n--- Quantum State (out-of-core, %zu MB in %s) ---\n",
+         (chunk_bytes * o->num_chunks) >> 20, o->dir);
+  printf("Chunks: %zu x %zu KB, %d local qubits\n", o->num_chunks,
+         chunk_bytes >> 10, o->c);
+  printf("Traffic: %.2f GB in %ld passes (%ld swaps), %.2f GB/s, %.0f%% "
+         "waiting on reads\n",
+         (st->bytes_read + st->bytes_written) / 1e9, st->passes, st->swaps,
+         st->gbps, st->seconds > 0.0 ? 100.0 * st->io_wait / st->seconds : 0.0);
+  double _Complex *amps =
+      state->num_qubits <= OOC_PRINT_MAX_QUBITS
+          ? (double _Complex *)malloc(((size_t)1 << state->num_qubits) *
+                                      sizeof(double _Complex))
+          : NULL;
+  if (!amps || qvm_ooc_read((qvm_state_t *)state, amps) != 0) {
+    printf("(amplitudes hidden above %d qubits)\n", OOC_PRINT_MAX_QUBITS);
+    printf("---------------------\n");
+    free(amps);
+    return;
+  }
+  size_t size = (size_t)1 << state->num_qubits;
+  for (size_t i = 0; i < size; i++) {
+    double prob = creal(amps[i]) * creal(amps[i]) +
+                  cimag(amps[i]) * cimag(amps[i]);
+    if (prob > 0.001) {
+      printf("|");
+      for (int j = state->num_qubits - 1; j >= 0; j--)
+        printf("%d", (int)((i >> j) & 1));
+      printf(">: %.4f\n", prob);
+    }
+  }
+  printf("---------------------\n");
+  free(amps);
+}
+
+const qvm_backend_ops_t qvm_backend_ooc = {
+    .name = "out-of-core statevector",
+    .max_qubits = QVM_OOC_MAX_QUBITS,
+    .init = ooc_init,
+    .free = ooc_free,
+    .apply_gate = ooc_apply_gate,
+    .measure = ooc_measure,
+    .sample = ooc_sample,
+    .print = ooc_print,
+};
+
+// --- Public API ---
+
+int qvm_ooc_stats(const qvm_state_t *state, qvm_ooc_stats_t *out) {
+  if (state->backend != QVM_BACKEND_OUT_OF_CORE || !state->backend_state)
+    return -1;
+  *out = ((const ooc_t *)state->backend_state)->stats;
+  return 0;
+}
@@ -0,0 +1,273 @@
+/*
+ * NexusQ-AI - Compiled Circuit Format (.qcb)
+ * File: modules/quantum/qvm_qcb.c
+ *
+ * A parsed circuit, stored so it can be executed again without parsing.
+ * All fields are little-endian:
+ *
+ *   0  char[4] magic "NQCB"
+ *   4  u16     version (QVM_QCB_VERSION)
+ *   6  u16     gate record size (48)
+ *   8  i32     num_qubits
+ *  12  i32     shots
+ *  16  u32     num_gates
+ *  20  u32     num_angles (symbolic angles)
+ *  24  u64     source hash: qvm_qcb_hash() of the text it came from
+ *  32  u64     checksum: FNV-1a of bytes [0, 32) and everything after 40
+ *  40  gates   {i32 type, i32 target, i32 control, u32 0, f64 theta[3],
+ *               i32 control2, u32 0}
+ *  ..  angles  {i32 gate, i32 slot, i32 symbol, u32 0, f64 scale,
+ *               f64 offset} per symbolic angle
+ *
+ * Gate records have the layout of qvm_gate_t on little-endian hosts, so
+ * qvm_qcb_load() points the circuit straight at them (a LedgerFS buffer
+ * or an mmap of the file) instead of copying. The few angle records are
+ * always decoded; binding parameters copies the gates out first.
+ */
+
+#include "include/qvm.h"
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define QCB_MAGIC "NQCB"
+#define QCB_GATE_SIZE 48
+#define QCB_ANGLE_SIZE 32
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static uint64_t fnv1a(uint64_t h, const unsigned char *p, size_t size) {
+  for (size_t i = 0; i < size; i++)
+    h = (h ^ p[i]) * FNV_PRIME;
+  return h;
+}
+
+uint64_t qvm_qcb_hash(const void *data, size_t size) {
+  return fnv1a(FNV_OFFSET, (const unsigned char *)data, size);
+}
+
+static void put_u16(unsigned char *p, uint16_t v) {
+  p[0] = (unsigned char)v;
+  p[1] = (unsigned char)(v >> 8);
+}
+
+static void put_u32(unsigned char *p, uint32_t v) {
+  for (int i = 0; i < 4; i++)
+    p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_u64(unsigned char *p, uint64_t v) {
+  for (int i = 0; i < 8; i++)
+    p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_f64(unsigned char *p, double v) {
+  uint64_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  put_u64(p, bits);
+}
+
+static uint16_t get_u16(const unsigned char *p) {
+  return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+         (uint32_t)p[3] << 24;
+}
+
+static uint64_t get_u64(const unsigned char *p) {
+  return (uint64_t)get_u32(p) | (uint64_t)get_u32(p + 4) << 32;
+}
+
+static double get_f64(const unsigned char *p) {
+  uint64_t bits = get_u64(p);
+  double v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+static uint64_t checksum(const unsigned char *qcb, size_t size) {
+  uint64_t h = fnv1a(FNV_OFFSET, qcb, 32);
+  return fnv1a(h, qcb + QVM_QCB_HEADER_SIZE, size - QVM_QCB_HEADER_SIZE);
+}
+
+// Whether gate records can be used in place as qvm_gate_t
+static int native_layout(const void *gates) {
+  const uint16_t probe = 1;
+  return *(const unsigned char *)&probe == 1 &&
+         sizeof(qvm_gate_t) == QCB_GATE_SIZE &&
+         offsetof(qvm_gate_t, target) == 4 &&
+         offsetof(qvm_gate_t, control) == 8 &&
+         offsetof(qvm_gate_t, theta) == 16 && sizeof(double) == 8 &&
+         offsetof(qvm_gate_t, control2) == 40 &&
+         (uintptr_t)gates % _Alignof(qvm_gate_t) == 0;
+}
+
+int qvm_qcb_encode(const qvm_circuit_t *circuit, uint64_t source_hash,
+                   void **out, size_t *out_size) {
+  size_t angles_at =
+      QVM_QCB_HEADER_SIZE + (size_t)circuit->num_gates * QCB_GATE_SIZE;
+  size_t size = angles_at + (size_t)circuit->num_angles * QCB_ANGLE_SIZE;
+  unsigned char *qcb = (unsigned char *)calloc(1, size);
+  if (!qcb)
+    return -1;
+
+  memcpy(qcb, QCB_MAGIC, 4);
+  put_u16(qcb + 4, QVM_QCB_VERSION);
+  put_u16(qcb + 6, QCB_GATE_SIZE);
+  put_u32(qcb + 8, (uint32_t)circuit->num_qubits);
+  put_u32(qcb + 12, (uint32_t)circuit->shots);
+  put_u32(qcb + 16, (uint32_t)circuit->num_gates);
+  put_u32(qcb + 20, (uint32_t)circuit->num_angles);
+  put_u64(qcb + 24, source_hash);
+  for (int i = 0; i < circuit->num_gates; i++) {
+    const qvm_gate_t *g = &circuit->gates[i];
+    unsigned char *r = qcb + QVM_QCB_HEADER_SIZE + (size_t)i * QCB_GATE_SIZE;
+    put_u32(r, (uint32_t)g->type);
+    put_u32(r + 4, (uint32_t)g->target);
+    put_u32(r + 8, (uint32_t)g->control);
+    for (int a = 0; a < QVM_GATE_MAX_ANGLES; a++)
+      put_f64(r + 16 + 8 * a, g->theta[a]);
+    put_u32(r + 40, (uint32_t)g->control2);
+  }
+  for (int i = 0; i < circuit->num_angles; i++) {
+    const qvm_angle_t *a = &circuit->angles[i];
+    unsigned char *r = qcb + angles_at + (size_t)i * QCB_ANGLE_SIZE;
+    put_u32(r, (uint32_t)a->gate);
+    put_u32(r + 4, (uint32_t)a->slot);
+    put_u32(r + 8, (uint32_t)a->symbol);
+    put_f64(r + 16, a->scale);
+    put_f64(r + 24, a->offset);
+  }
+  put_u64(qcb + 32, checksum(qcb, size));
+
+  *out = qcb;
+  *out_size = size;
+  return 0;
+}
+
+// Header checks shared by load and source_hash; number of gates or -1
+static long validate(const unsigned char *qcb, size_t size) {
+  if (size < QVM_QCB_HEADER_SIZE || memcmp(qcb, QCB_MAGIC, 4) != 0)
+    return -1;
+  if (get_u16(qcb + 4) != QVM_QCB_VERSION ||
+      get_u16(qcb + 6) != QCB_GATE_SIZE)
+    return -1;
+  uint32_t num_gates = get_u32(qcb + 16), num_angles = get_u32(qcb + 20);
+  if (num_gates > INT32_MAX || num_angles > INT32_MAX ||
+      size != QVM_QCB_HEADER_SIZE + (size_t)num_gates * QCB_GATE_SIZE +
+                  (size_t)num_angles * QCB_ANGLE_SIZE)
+    return -1;
+  if (get_u64(qcb + 32) != checksum(qcb, size))
+    return -1;
+  return (long)num_gates;
+}
+
+uint64_t qvm_qcb_source_hash(const void *data, size_t size) {
+  const unsigned char *qcb = (const unsigned char *)data;
+  return validate(qcb, size) < 0 ? 0 : get_u64(qcb + 24);
+}
+
+int qvm_qcb_load(const void *data, size_t size, qvm_circuit_t *circuit) {
+  const unsigned char *qcb = (const unsigned char *)data;
+  long num_gates = validate(qcb, size);
+  if (num_gates < 0) {
+    printf("[QVM] Invalid or corrupted compiled circuit\n");
+    return -1;
+  }
+
+  const unsigned char *records = qcb + QVM_QCB_HEADER_SIZE;
+  for (long i = 0; i < num_gates; i++) {
+    uint32_t type = get_u32(records + i * QCB_GATE_SIZE);
+    if (type > GATE_DIFFUSE) {
+      printf("[QVM] Compiled circuit: unknown gate type %u\n", type);
+      return -1;
+    }
+  }
+
+  qvm_circuit_init(circuit, (int)get_u32(qcb + 8));
+  circuit->shots = (int)get_u32(qcb + 12);
+  if (native_layout(records)) {
+    // Borrowed: capacity 0 tells qvm_circuit_free/append not to own it
+    circuit->gates = (qvm_gate_t *)records;
+    circuit->num_gates = (int)num_gates;
+  } else {
+    for (long i = 0; i < num_gates; i++) {
+      const unsigned char *r = records + i * QCB_GATE_SIZE;
+      qvm_gate_t g = {(qvm_gate_type_t)get_u32(r), (int)get_u32(r + 4),
+                      (int)get_u32(r + 8),
+                      {get_f64(r + 16), get_f64(r + 24), get_f64(r + 32)},
+                      (int)get_u32(r + 40)};
+      if (qvm_circuit_append(circuit, &g) != 0) {
+        qvm_circuit_free(circuit);
+        return -1;
+      }
+    }
+  }
+
+  // add_angle rejects out-of-range gates, slots and symbols
+  const unsigned char *angles = records + num_gates * QCB_GATE_SIZE;
+  uint32_t num_angles = get_u32(qcb + 20);
+  for (uint32_t i = 0; i < num_angles; i++) {
+    const unsigned char *r = angles + (size_t)i * QCB_ANGLE_SIZE;
+    if (qvm_circuit_add_angle(circuit, (int)get_u32(r), (int)get_u32(r + 4),
+                              (int)get_u32(r + 8), get_f64(r + 16),
+                              get_f64(r + 24)) != 0) {
+      printf("[QVM] Compiled circuit: bad angle record %u\n", i);
+      qvm_circuit_free(circuit);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int qvm_compile(const char *circuit_text, void **out, size_t *out_size) {
+  qvm_circuit_t circuit;
+  if (qvm_parse_circuit(circuit_text, &circuit) != 0)
+    return -1;
+  int rc = qvm_qcb_encode(&circuit,
+                          qvm_qcb_hash(circuit_text, strlen(circuit_text)),
+                          out, out_size);
+  qvm_circuit_free(&circuit);
+  return rc;
+}
+
+// --- Files ---
+
+int qvm_qcb_save(const char *path, const void *qcb, size_t size) {
+  FILE *fp = fopen(path, "wb");
+  if (!fp) {
+    printf("[QVM] Cannot write '%s'\n", path);
+    return -1;
+  }
+  int rc = fwrite(qcb, 1, size, fp) == size ? 0 : -1;
+  if (fclose(fp) != 0)
+    rc = -1;
+  return rc;
+}
+
+void *qvm_qcb_map(const char *path, size_t *size) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  void *p = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0)
+    p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED)
+    return NULL;
+  *size = (size_t)st.st_size;
+  return p;
+}
+
+void qvm_qcb_unmap(void *qcb, size_t size) {
+  if (qcb)
+    munmap(qcb, size);
+}
@@ -0,0 +1,196 @@
+/*
+ * NexusQ-AI - Counter-Based Random Numbers
+ * File: modules/quantum/qvm_rng.c
+ *
+ * Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+ * 3", SC'11): ten rounds of a keyed bijection on a 128-bit counter. Block
+ * k of a stream is philox((k, stream), seed), so:
+ *  - every state, thread and trajectory gets its own stream under one
+ *    global seed, with no shared generator to lock or to correlate;
+ *  - bulk fills compute disjoint block ranges on the worker pool and still
+ *    produce exactly the sequence a serial caller would draw.
+ */
+
+#include "include/qvm.h"
+#include "include/qvm_threads.h"
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u // Key schedule: golden ratio
+#define PHILOX_W1 0xBB67AE85u // and sqrt(3) - 1
+#define RNG_PARALLEL_BLOCKS 65536 // Fills shorter than this stay serial
+
+static uint64_t global_seed = 0;
+static uint64_t seed_epoch = 0; // Bumped by qvm_rng_seed()
+static uint64_t next_stream[256];
+
+// --- Philox4x32-10 ---
+
+static inline void philox_round(uint32_t c[4], const uint32_t k[2]) {
+  uint64_t p0 = (uint64_t)PHILOX_M0 * c[0];
+  uint64_t p1 = (uint64_t)PHILOX_M1 * c[2];
+  uint32_t out[4] = {(uint32_t)(p1 >> 32) ^ c[1] ^ k[0], (uint32_t)p1,
+                     (uint32_t)(p0 >> 32) ^ c[3] ^ k[1], (uint32_t)p0};
+  c[0] = out[0];
+  c[1] = out[1];
+  c[2] = out[2];
+  c[3] = out[3];
+}
+
+static void philox(uint32_t out[4], uint64_t counter, uint64_t stream,
+                   uint64_t key) {
+  uint32_t c[4] = {(uint32_t)counter, (uint32_t)(counter >> 32),
+                   (uint32_t)stream, (uint32_t)(stream >> 32)};
+  uint32_t k[2] = {(uint32_t)key, (uint32_t)(key >> 32)};
+  for (int r = 0; r < 10; r++) {
+    philox_round(c, k);
+    k[0] += PHILOX_W0;
+    k[1] += PHILOX_W1;
+  }
+  for (int i = 0; i < 4; i++)
+    out[i] = c[i];
+}
+
+static inline double to_uniform(uint64_t x) {
+  return ((double)(x >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+// --- Seeding ---
+
+static uint64_t default_seed(void) {
+  const char *env = getenv("QVM_SEED");
+  if (env && strtoull(env, NULL, 0) != 0)
+    return strtoull(env, NULL, 0);
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  uint64_t s = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+  return s ^ ((uint64_t)getpid() << 32) ^ 0x9E3779B97F4A7C15ULL;
+}
+
+void qvm_rng_seed(uint64_t seed) {
+  __atomic_store_n(&global_seed, seed ? seed : default_seed(),
+                   __ATOMIC_RELEASE);
+  for (int f = 0; f < 256; f++)
+    __atomic_store_n(&next_stream[f], 0, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&seed_epoch, 1, __ATOMIC_RELEASE);
+}
+
+uint64_t qvm_rng_get_seed(void) {
+  uint64_t seed = __atomic_load_n(&global_seed, __ATOMIC_ACQUIRE);
+  if (seed == 0) {
+    uint64_t fresh = default_seed(), expected = 0;
+    __atomic_compare_exchange_n(&global_seed, &expected, fresh, 0,
+                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    seed = __atomic_load_n(&global_seed, __ATOMIC_ACQUIRE);
+  }
+  return seed;
+}
+
+uint64_t qvm_rng_streams(uint64_t family, uint64_t count) {
+  uint64_t first =
+      __atomic_fetch_add(&next_stream[family >> 56], count, __ATOMIC_RELAXED);
+  return family | first;
+}
+
+void qvm_rng_init(qvm_rng_t *rng, uint64_t seed, uint64_t stream) {
+  rng->key = seed;
+  rng->stream = stream;
+  rng->counter = 0;
+  rng->used = 4;
+  rng->seeded = 1;
+}
+
+// --- Draws ---
+
+static inline uint32_t next_word(qvm_rng_t *rng) {
+  if (rng->used == 4) {
+    philox(rng->block, rng->counter++, rng->stream, rng->key);
+    rng->used = 0;
+  }
+  return rng->block[rng->used++];
+}
+
+uint64_t qvm_rng_next(qvm_rng_t *rng) {
+  uint64_t lo = next_word(rng);
+  return lo | (uint64_t)next_word(rng) << 32;
+}
+
+double qvm_rng_uniform(qvm_rng_t *rng) { return to_uniform(qvm_rng_next(rng)); }
+
+// Lemire's multiply-and-reject: unbiased without a division per draw
+uint32_t qvm_rng_below(qvm_rng_t *rng, uint32_t n) {
+  if (n <= 1)
+    return 0;
+  uint64_t m = (uint64_t)next_word(rng) * n;
+  if ((uint32_t)m < n) {
+    uint32_t threshold = -n % n;
+    while ((uint32_t)m < threshold)
+      m = (uint64_t)next_word(rng) * n;
+  }
+  return (uint32_t)(m >> 32);
+}
+
+typedef struct {
+  const qvm_rng_t *rng;
+  uint64_t first_block;
+  uint64_t *out; // Two 64-bit values per block
+} fill_sweep_t;
+
+static void sweep_fill(void *arg, size_t chunk, size_t b, size_t e) {
+  const fill_sweep_t *sw = (const fill_sweep_t *)arg;
+  uint32_t w[4];
+  for (size_t i = b; i < e; i++) {
+    philox(w, sw->first_block + i, sw->rng->stream, sw->rng->key);
+    sw->out[2 * i] = w[0] | (uint64_t)w[1] << 32;
+    sw->out[2 * i + 1] = w[2] | (uint64_t)w[3] << 32;
+  }
+}
+
+void qvm_rng_fill_bits(qvm_rng_t *rng, uint64_t *out, size_t words) {
+  if (!rng->seeded)
+    qvm_rng_init(rng, qvm_rng_get_seed(), qvm_rng_streams(QVM_RNG_STATES, 1));
+  // Leftover words of the current block first, then whole blocks
+  size_t i = 0;
+  while (i < words && rng->used != 4 && rng->used != 0)
+    out[i++] = qvm_rng_next(rng);
+  size_t blocks = (words - i) / 2;
+  fill_sweep_t sw = {rng, rng->counter, out + i};
+  if (blocks >= RNG_PARALLEL_BLOCKS)
+    qvm_parallel_for(blocks, qvm_threads_grain(2 * sizeof(uint64_t)),
+                     sweep_fill, &sw);
+  else
+    sweep_fill(&sw, 0, 0, blocks);
+  rng->counter += blocks;
+  for (i += 2 * blocks; i < words; i++)
+    out[i] = qvm_rng_next(rng);
+}
+
+void qvm_rng_fill_uniform(qvm_rng_t *rng, double *out, size_t n) {
+  // Same storage, converted in place
+  qvm_rng_fill_bits(rng, (uint64_t *)out, n);
+  for (size_t i = 0; i < n; i++)
+    out[i] = to_uniform(((uint64_t *)out)[i]);
+}
+
+// --- Stream owners ---
+
+qvm_rng_t *qvm_state_rng(qvm_state_t *state) {
+  if (!state->rng.seeded)
+    qvm_rng_init(&state->rng, qvm_rng_get_seed(),
+                 qvm_rng_streams(QVM_RNG_STATES, 1));
+  return &state->rng;
+}
+
+qvm_rng_t *qvm_rng_thread(void) {
+  static __thread qvm_rng_t rng;
+  static __thread uint64_t epoch = 0;
+  uint64_t now = __atomic_load_n(&seed_epoch, __ATOMIC_ACQUIRE);
+  if (!rng.seeded || epoch != now) {
+    qvm_rng_init(&rng, qvm_rng_get_seed(), qvm_rng_streams(QVM_RNG_THREADS, 1));
+    epoch = now;
+  }
+  return &rng;
+}
@@ -0,0 +1,411 @@
+/*
+ * NexusQ-AI - Multi-Shot Sampling
+ * File: modules/quantum/qvm_sample.c
+ *
+ * When every measurement is terminal (nothing touches a measured qubit
+ * afterwards), the circuit is a unitary followed by a readout. The unitary
+ * part is evolved once and all shots are drawn from |amp|^2:
+ *  - N sorted uniforms are generated in O(N) from exponential spacings;
+ *  - one pass builds the cumulative distribution chunk by chunk and maps
+ *    each uniform to its basis index.
+ * The cumulative table is never materialized, so sampling needs no memory
+ * proportional to the state, only to the number of shots. The same sweeps
+ * read complex-float amplitudes for the single-precision backend.
+ */
+
+#include "include/qvm_backend.h"
+#include "include/qvm_kernels.h"
+#include "include/qvm_threads.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define QVM_COUNTS_PRINT_MAX 16
+
+// shots sorted uniforms in [0, total): normalized partial sums of
+// shots + 1 exponential variates (order statistics of the uniform law).
+// The uniforms are drawn in one bulk fill and turned into spacings in place.
+void qvm_sorted_uniforms(qvm_rng_t *rng, double *u, int shots, double total) {
+  qvm_rng_fill_uniform(rng, u, (size_t)shots);
+  double sum = 0.0;
+  for (int j = 0; j < shots; j++) {
+    sum += -log(u[j]);
+    u[j] = sum;
+  }
+  sum += -log(qvm_rng_uniform(rng));
+  double scale = total / sum;
+  for (int j = 0; j < shots; j++)
+    u[j] *= scale;
+}
+
+// --- Cumulative sweep ---
+
+typedef struct {
+  const qvm_kernel_ops_t *k;
+  const double _Complex *amps;
+  const float _Complex *amps32; // Instead of amps for single precision
+  double (*partial)[2];
+  const double *cum; // Probability mass before each chunk
+  const double *u;
+  int shots;
+  uint64_t *index; // Sampled basis index per uniform
+} sample_sweep_t;
+
+static void sweep_mass(void *arg, size_t chunk, size_t b, size_t e) {
+  sample_sweep_t *sw = (sample_sweep_t *)arg;
+  if (sw->amps32)
+    sw->k->f32->probs(sw->amps32, 0, b, e, sw->partial[chunk]);
+  else
+    sw->k->probs(sw->amps, 0, b, e, sw->partial[chunk]);
+}
+
+static inline double amp_prob(const sample_sweep_t *sw, size_t i) {
+  if (sw->amps32) {
+    double re = crealf(sw->amps32[i]), im = cimagf(sw->amps32[i]);
+    return re * re + im * im;
+  }
+  return creal(sw->amps[i]) * creal(sw->amps[i]) +
+         cimag(sw->amps[i]) * cimag(sw->amps[i]);
+}
+
+// First uniform >= x
+static int lower_bound(const double *u, int n, double x) {
+  int lo = 0, hi = n;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (u[mid] < x)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+// Chunk c owns the uniforms in [cum[c], cum[c+1]); they are written to
+// disjoint slots of sw->index, so chunks run independently.
+static void sweep_select(void *arg, size_t chunk, size_t b, size_t e) {
+  sample_sweep_t *sw = (sample_sweep_t *)arg;
+  int j = lower_bound(sw->u, sw->shots, sw->cum[chunk]);
+  int end = lower_bound(sw->u, sw->shots, sw->cum[chunk + 1]);
+  if (j == end)
+    return;
+
+  double acc = sw->cum[chunk];
+  size_t last_nz = 2 * b;
+  for (size_t i = 2 * b; i < 2 * e && j < end; i++) {
+    double p = amp_prob(sw, i);
+    if (p == 0.0)
+      continue;
+    acc += p;
+    last_nz = i;
+    while (j < end && sw->u[j] < acc)
+      sw->index[j++] = i;
+  }
+  // Rounding between the kernel's partial sum and this running sum
+  while (j < end)
+    sw->index[j++] = last_nz;
+}
+
+typedef struct {
+  uint64_t outcome;
+  int count;
+} sample_bin_t;
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static int cmp_bin(const void *a, const void *b) {
+  uint64_t x = ((const sample_bin_t *)a)->outcome;
+  uint64_t y = ((const sample_bin_t *)b)->outcome;
+  return x < y ? -1 : x > y;
+}
+
+// Run-length encode sorted outcomes; weights may be NULL (one shot each)
+static int counts_from_sorted(const uint64_t *idx, const int *weights, int n,
+                              int num_qubits, uint64_t mask,
+                              qvm_counts_t *out) {
+  out->num_qubits = num_qubits;
+  out->mask = mask;
+  out->shots = 0;
+  out->num_outcomes = 0;
+  out->outcomes = (uint64_t *)malloc(n * sizeof(uint64_t));
+  out->counts = (int *)malloc(n * sizeof(int));
+  if (!out->outcomes || !out->counts) {
+    qvm_counts_free(out);
+    return -1;
+  }
+
+  for (int j = 0; j < n; j++) {
+    int w = weights ? weights[j] : 1;
+    int k = out->num_outcomes;
+    if (k > 0 && out->outcomes[k - 1] == idx[j]) {
+      out->counts[k - 1] += w;
+    } else {
+      out->outcomes[k] = idx[j];
+      out->counts[k] = w;
+      out->num_outcomes++;
+    }
+    out->shots += w;
+  }
+  return 0;
+}
+
+// --- Public API ---
+
+int qvm_terminal_measurements(const qvm_circuit_t *circuit, uint64_t *mask) {
+  int n = circuit->num_qubits;
+  unsigned char *measured = (unsigned char *)calloc(n > 0 ? n : 1, 1);
+  int count = 0, terminal = 1;
+  *mask = 0;
+  if (!measured)
+    return -1;
+
+  for (int i = 0; i < circuit->num_gates; i++) {
+    const qvm_gate_t *g = &circuit->gates[i];
+    if (g->target < 0 || g->target >= n)
+      continue;
+    if (g->type == GATE_MEASURE) {
+      measured[g->target] = 1;
+      if (g->target < 64)
+        *mask |= (uint64_t)1 << g->target;
+      count++;
+      continue;
+    }
+    if (measured[g->target])
+      terminal = 0;
+    if (g->control >= 0 && g->control < n && measured[g->control])
+      terminal = 0;
+    if (g->type == GATE_CCX && g->control2 >= 0 && g->control2 < n &&
+        measured[g->control2])
+      terminal = 0;
+    if (qvm_gate_is_range(g->type))
+      for (int q = g->control; q <= g->target && q < n; q++)
+        if (q >= 0 && measured[q])
+          terminal = 0;
+  }
+
+  free(measured);
+  return terminal ? count : -1;
+}
+
+// All qubits of 2^n amplitudes in either precision (one of amps, amps32)
+static int sample_amplitudes(qvm_state_t *state, const double _Complex *amps,
+                             const float _Complex *amps32, int shots,
+                             qvm_counts_t *out_counts) {
+  size_t pairs = (size_t)1 << (state->num_qubits - 1);
+  size_t grain = qvm_threads_grain(2 * sizeof(double _Complex));
+  if (qvm_parallel_chunks(pairs, grain) > QVM_REDUCE_CHUNKS)
+    grain = (pairs + QVM_REDUCE_CHUNKS - 1) / QVM_REDUCE_CHUNKS;
+  size_t chunks = qvm_parallel_chunks(pairs, grain);
+
+  double partial[QVM_REDUCE_CHUNKS][2];
+  double cum[QVM_REDUCE_CHUNKS + 1];
+  memset(partial, 0, chunks * sizeof(partial[0]));
+
+  double *u = (double *)malloc(shots * sizeof(double));
+  uint64_t *index = (uint64_t *)malloc(shots * sizeof(uint64_t));
+  if (!u || !index) {
+    printf("[QVM] Sampling: cannot allocate %d shots\n", shots);
+    free(u);
+    free(index);
+    return -1;
+  }
+
+  // Pass 1: probability mass per chunk, prefix-summed in chunk order
+  sample_sweep_t sw = {.k = qvm_kernels_get(),
+                       .amps = amps,
+                       .amps32 = amps32,
+                       .partial = partial,
+                       .cum = cum,
+                       .u = u,
+                       .shots = shots,
+                       .index = index};
+  qvm_parallel_for(pairs, grain, sweep_mass, &sw);
+  cum[0] = 0.0;
+  for (size_t c = 0; c < chunks; c++)
+    cum[c + 1] = cum[c] + partial[c][0] + partial[c][1];
+
+  // Pass 2: map sorted uniforms to basis indices
+  qvm_sorted_uniforms(qvm_state_rng(state), u, shots, cum[chunks]);
+  qvm_parallel_for(pairs, grain, sweep_select, &sw);
+  free(u);
+
+  uint64_t full = ((uint64_t)1 << state->num_qubits) - 1;
+  int rc = counts_from_sorted(index, NULL, shots, state->num_qubits, full,
+                              out_counts);
+  free(index);
+  return rc;
+}
+
+// Marginalize full-register counts onto the measured qubits: sort the
+// (few) distinct outcomes, not the shots
+static int marginalize(const qvm_counts_t *full, int num_qubits,
+                       uint64_t mask, qvm_counts_t *out_counts) {
+  int n = full->num_outcomes;
+  sample_bin_t *bins = (sample_bin_t *)malloc(n * sizeof(sample_bin_t));
+  uint64_t *keys = (uint64_t *)malloc(n * sizeof(uint64_t));
+  int *weights = (int *)malloc(n * sizeof(int));
+  int rc = -1;
+  if (bins && keys && weights) {
+    for (int o = 0; o < n; o++) {
+      bins[o].outcome = full->outcomes[o] & mask;
+      bins[o].count = full->counts[o];
+    }
+    qsort(bins, n, sizeof(sample_bin_t), cmp_bin);
+    for (int o = 0; o < n; o++) {
+      keys[o] = bins[o].outcome;
+      weights[o] = bins[o].count;
+    }
+    rc = counts_from_sorted(keys, weights, n, num_qubits, mask, out_counts);
+  }
+  free(bins);
+  free(keys);
+  free(weights);
+  return rc;
+}
+
+int qvm_sample(qvm_state_t *state, int shots, qvm_counts_t *out_counts) {
+  memset(out_counts, 0, sizeof(*out_counts));
+  if (shots <= 0 || state->num_qubits < 1)
+    return -1;
+  const qvm_backend_ops_t *ops = qvm_backend_ops(state);
+  if (ops) {
+    uint64_t all = state->num_qubits >= 64
+                       ? ~(uint64_t)0
+                       : ((uint64_t)1 << state->num_qubits) - 1;
+    return ops->sample(state, shots, all, out_counts);
+  }
+  if (!state->amplitudes)
+    return -1;
+  return sample_amplitudes(state, state->amplitudes, NULL, shots, out_counts);
+}
+
+int qvm_sample_f32(qvm_state_t *state, const float _Complex *amps, int shots,
+                   uint64_t mask, qvm_counts_t *out_counts) {
+  memset(out_counts, 0, sizeof(*out_counts));
+  if (shots <= 0 || state->num_qubits < 1 || !amps)
+    return -1;
+  uint64_t full_mask = ((uint64_t)1 << state->num_qubits) - 1;
+  if ((mask & full_mask) == full_mask)
+    return sample_amplitudes(state, NULL, amps, shots, out_counts);
+
+  qvm_counts_t full;
+  if (sample_amplitudes(state, NULL, amps, shots, &full) != 0)
+    return -1;
+  int rc = marginalize(&full, state->num_qubits, mask, out_counts);
+  qvm_counts_free(&full);
+  return rc;
+}
+
+int qvm_sample_circuit(qvm_state_t *state, const qvm_circuit_t *circuit,
+                       int shots, qvm_counts_t *out_counts) {
+  memset(out_counts, 0, sizeof(*out_counts));
+  uint64_t mask;
+  if (qvm_terminal_measurements(circuit, &mask) < 0) {
+    printf("[QVM] Sampling: circuit measures mid-circuit\n");
+    return -1;
+  }
+  if (mask == 0)
+    mask = circuit->num_qubits >= 64 ? ~(uint64_t)0
+                                     : ((uint64_t)1 << circuit->num_qubits) - 1;
+
+  // Unitary part only: terminal measurements commute with what follows
+  qvm_circuit_t unitary;
+  qvm_circuit_init(&unitary, circuit->num_qubits);
+  unitary.shots = circuit->shots;
+  for (int i = 0; i < circuit->num_gates; i++) {
+    if (circuit->gates[i].type != GATE_MEASURE &&
+        qvm_circuit_append(&unitary, &circuit->gates[i]) != 0) {
+      qvm_circuit_free(&unitary);
+      return -1;
+    }
+  }
+  int rc = qvm_execute_circuit(state, &unitary, 0);
+  qvm_circuit_free(&unitary);
+  if (rc != 0)
+    return -1;
+  return qvm_sample_marginal(state, shots, mask, out_counts);
+}
+
+int qvm_sample_marginal(qvm_state_t *state, int shots, uint64_t mask,
+                        qvm_counts_t *out_counts) {
+  memset(out_counts, 0, sizeof(*out_counts));
+  // Other backends sample the measured qubits directly
+  const qvm_backend_ops_t *ops = qvm_backend_ops(state);
+  if (ops)
+    return ops->sample(state, shots, mask, out_counts);
+
+  qvm_counts_t full;
+  if (qvm_sample(state, shots, &full) != 0)
+    return -1;
+  int rc = marginalize(&full, state->num_qubits, mask, out_counts);
+  qvm_counts_free(&full);
+  return rc;
+}
+
+int qvm_counts_from_outcomes(uint64_t *outcomes, int shots, int num_qubits,
+                             uint64_t mask, qvm_counts_t *out_counts) {
+  qsort(outcomes, shots, sizeof(uint64_t), cmp_u64);
+  return counts_from_sorted(outcomes, NULL, shots, num_qubits, mask,
+                            out_counts);
+}
+
+int qvm_counts_from_measured(const qvm_state_t *state, uint64_t mask,
+                             qvm_counts_t *out_counts) {
+  uint64_t outcome = state->measured_bits & mask;
+  return counts_from_sorted(&outcome, NULL, 1, state->num_qubits, mask,
+                            out_counts);
+}
+
+void qvm_counts_free(qvm_counts_t *counts) {
+  free(counts->outcomes);
+  free(counts->counts);
+  counts->outcomes = NULL;
+  counts->counts = NULL;
+  counts->num_outcomes = 0;
+  counts->shots = 0;
+}
+
+void qvm_counts_bitstring(const qvm_counts_t *counts, uint64_t outcome,
+                          char *buf, size_t len) {
+  size_t n = 0;
+  int top = counts->num_qubits < QVM_COUNTS_MAX_BITS ? counts->num_qubits
+                                                     : QVM_COUNTS_MAX_BITS;
+  for (int q = top - 1; q >= 0 && n + 1 < len; q--) {
+    if ((counts->mask >> q) & 1)
+      buf[n++] = ((outcome >> q) & 1) ? '1' : '0';
+  }
+  buf[n] = '\0';
+}
+
+void qvm_counts_print(const qvm_counts_t *counts) {
+  printf("\n--- Counts (%d shots) ---\n", counts->shots);
+  for (int o = 0; o < counts->num_outcomes && o < QVM_COUNTS_PRINT_MAX; o++) {
+    char bits[QVM_COUNTS_MAX_BITS + 1];
+    qvm_counts_bitstring(counts, counts->outcomes[o], bits, sizeof(bits));
+    printf("|%s>: %d (%.4f)\n", bits, counts->counts[o],
+           (double)counts->counts[o] / counts->shots);
+  }
+  if (counts->num_outcomes > QVM_COUNTS_PRINT_MAX)
+    printf("... %d more outcomes\n",
+           counts->num_outcomes - QVM_COUNTS_PRINT_MAX);
+  printf("---------------------\n");
+}
+
+// --- Last execution ---
+
+static qvm_counts_t last_counts;
+
+const qvm_counts_t *qvm_last_counts(void) {
+  return last_counts.shots > 0 ? &last_counts : NULL;
+}
+
+void qvm_counts_record(qvm_counts_t *counts) {
+  qvm_counts_free(&last_counts);
+  last_counts = *counts;
+  counts->outcomes = NULL;
+  counts->counts = NULL;
+}
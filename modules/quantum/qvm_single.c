@@ -0,0 +1,303 @@
+/*
+ * NexusQ-AI - Single-Precision Statevector Backend
+ * File: modules/quantum/qvm_single.c
+ *
+ * The statevector with complex float amplitudes: 8 bytes instead of 16,
+ * so one more qubit fits in the same RAM and every memory-bound sweep
+ * moves half the bytes. Gates go through the ->f32 kernels of the active
+ * ISA table (the same range template as the double kernels), with the
+ * gate matrices computed in double and rounded once per sweep.
+ *
+ * Rounding makes the norm drift by about one float ulp per gate. Every
+ * SINGLE_NORM_INTERVAL gates the norm is recomputed (accumulated in
+ * double) and the state rescaled once it is off by more than
+ * SINGLE_NORM_TOLERANCE; measurement renormalizes as a side effect.
+ * No noise channels: noisy circuits select the double statevector.
+ */
+
+#include "include/qvm_backend.h"
+#include "include/qvm_kernels.h"
+#include "include/qvm_threads.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SINGLE_NORM_INTERVAL 64    // Gates between norm checks
+#define SINGLE_NORM_TOLERANCE 1e-6 // |norm - 1| left uncorrected
+#define SINGLE_PRINT_MAX_QUBITS 20
+
+typedef struct {
+  float _Complex *amps;
+  int gates_since_check;
+  int corrections; // Rescales applied so far
+  double drift;    // Largest |norm - 1| seen at a check
+} single_t;
+
+// Arguments of one sweep, shared by all worker chunks
+typedef struct {
+  const qvm_kernel_f32_ops_t *k;
+  float _Complex *amps;
+  int control;
+  int target;
+  const double _Complex (*matrix)[2];
+  const double _Complex (*matrix4)[4];
+  int result;
+  double scale;
+  double (*partial)[2];
+  const qvm_gate_form_t *form;
+} single_sweep_t;
+
+static void sweep_2x2(void *arg, size_t chunk, size_t b, size_t e) {
+  single_sweep_t *sw = (single_sweep_t *)arg;
+  sw->k->apply_2x2(sw->amps, sw->target, b, e, sw->matrix);
+}
+
+static void sweep_phase(void *arg, size_t chunk, size_t b, size_t e) {
+  single_sweep_t *sw = (single_sweep_t *)arg;
+  sw->k->phase(sw->amps, sw->form->mask, b, e, sw->form->d[1]);
+}
+
+static void sweep_diag(void *arg, size_t chunk, size_t b, size_t e) {
+  single_sweep_t *sw = (single_sweep_t *)arg;
+  sw->k->diag(sw->amps, sw->form->mask, b, e, sw->form->d);
+}
+
+static void sweep_permute(void *arg, size_t chunk, size_t b, size_t e) {
+  single_sweep_t *sw = (single_sweep_t *)arg;
+  const qvm_gate_form_t *f = sw->form;
+  sw->k->permute(sw->amps, f->mask, f->set, f->flip, b, e);
+}
+
+static void sweep_4x4(void *arg, size_t chunk, size_t b, size_t e) {
+  single_sweep_t *sw = (single_sweep_t *)arg;
+  sw->k->apply_4x4(sw->amps, sw->control, sw->target, b, e, sw->matrix4);
+}
+
+static void sweep_probs(void *arg, size_t chunk, size_t b, size_t e) {
+  single_sweep_t *sw = (single_sweep_t *)arg;
+  sw->k->probs(sw->amps, sw->target, b, e, sw->partial[chunk]);
+}
+
+static void sweep_collapse(void *arg, size_t chunk, size_t b, size_t e) {
+  single_sweep_t *sw = (single_sweep_t *)arg;
+  sw->k->collapse(sw->amps, sw->target, b, e, sw->result, sw->scale);
+}
+
+// --- Sweeps ---
+
+static void apply_2x2(qvm_state_t *state, int target,
+                      const double _Complex m[2][2]) {
+  single_t *s = (single_t *)state->backend_state;
+  size_t pairs = (size_t)1 << (state->num_qubits - 1);
+  single_sweep_t sw = {.k = qvm_kernels_get()->f32,
+                       .amps = s->amps,
+                       .target = target,
+                       .matrix = m};
+  qvm_parallel_for(pairs, qvm_threads_grain(2 * sizeof(float _Complex)),
+                   sweep_2x2, &sw);
+}
+
+// Diagonal and permutation gates, as in qvm.c's apply_form
+static void apply_form(qvm_state_t *state, const qvm_gate_form_t *form) {
+  single_t *s = (single_t *)state->backend_state;
+  size_t size = (size_t)1 << state->num_qubits;
+  int fixed = __builtin_popcountll(form->mask);
+  size_t grain = qvm_threads_grain(sizeof(float _Complex) << fixed);
+  single_sweep_t sw = {
+      .k = qvm_kernels_get()->f32, .amps = s->amps, .form = form};
+  switch (form->kind) {
+  case QVM_FORM_PHASE:
+    qvm_parallel_for(size >> fixed, grain, sweep_phase, &sw);
+    break;
+  case QVM_FORM_DIAG:
+    qvm_parallel_for(size, qvm_threads_grain(sizeof(float _Complex)),
+                     sweep_diag, &sw);
+    break;
+  case QVM_FORM_PERMUTE:
+    qvm_parallel_for(size >> fixed, grain, sweep_permute, &sw);
+    break;
+  }
+}
+
+// P(0) and P(1) of one qubit; per-chunk partial sums added in order
+static void qubit_probs(qvm_state_t *state, int qubit, double probs[2]) {
+  single_t *s = (single_t *)state->backend_state;
+  size_t pairs = (size_t)1 << (state->num_qubits - 1);
+  size_t grain = qvm_threads_grain(2 * sizeof(float _Complex));
+  if (qvm_parallel_chunks(pairs, grain) > QVM_REDUCE_CHUNKS)
+    grain = (pairs + QVM_REDUCE_CHUNKS - 1) / QVM_REDUCE_CHUNKS;
+  size_t chunks = qvm_parallel_chunks(pairs, grain);
+
+  double partial[QVM_REDUCE_CHUNKS][2];
+  memset(partial, 0, chunks * sizeof(partial[0]));
+  single_sweep_t sw = {.k = qvm_kernels_get()->f32,
+                       .amps = s->amps,
+                       .target = qubit,
+                       .partial = partial};
+  qvm_parallel_for(pairs, grain, sweep_probs, &sw);
+
+  probs[0] = probs[1] = 0.0;
+  for (size_t c = 0; c < chunks; c++) {
+    probs[0] += partial[c][0];
+    probs[1] += partial[c][1];
+  }
+}
+
+// Periodic drift check: one read pass, plus a write pass when it rescales
+static void check_norm(qvm_state_t *state) {
+  single_t *s = (single_t *)state->backend_state;
+  if (++s->gates_since_check < SINGLE_NORM_INTERVAL)
+    return;
+  s->gates_since_check = 0;
+
+  double probs[2];
+  qubit_probs(state, 0, probs);
+  double norm = probs[0] + probs[1];
+  double drift = fabs(norm - 1.0);
+  if (drift > s->drift)
+    s->drift = drift;
+  if (drift <= SINGLE_NORM_TOLERANCE || norm <= 0.0)
+    return;
+  double scale = 1.0 / sqrt(norm);
+  const double _Complex m[2][2] = {{scale, 0}, {0, scale}};
+  apply_2x2(state, 0, m);
+  s->corrections++;
+}
+
+// --- Backend table ---
+
+static int single_init(qvm_state_t *state, int num_qubits) {
+  single_t *s = (single_t *)calloc(1, sizeof(single_t));
+  if (!s)
+    return -1;
+  qvm_kernels_select();
+  s->amps =
+      (float _Complex *)calloc((size_t)1 << num_qubits, sizeof(float _Complex));
+  if (!s->amps) {
+    free(s);
+    return -1;
+  }
+  s->amps[0] = 1.0f;
+  state->backend_state = s;
+  return 0;
+}
+
+static void single_free(qvm_state_t *state) {
+  single_t *s = (single_t *)state->backend_state;
+  free(s->amps);
+  free(s);
+  state->backend_state = NULL;
+}
+
+static int single_apply_gate(qvm_state_t *state, const qvm_gate_t *gate) {
+  single_t *s = (single_t *)state->backend_state;
+  qvm_gate_form_t form;
+  double _Complex m2[2][2], m4[4][4];
+  if (qvm_gate_form(gate, &form) == 0) {
+    apply_form(state, &form);
+  } else if (qvm_gate_unitary(gate, m2) == 0) {
+    apply_2x2(state, gate->target, m2);
+  } else if (!qvm_gate_is_two_qubit(gate->type)) {
+    return -1;
+  } else {
+    int lo = gate->control < gate->target ? gate->control : gate->target;
+    int hi = gate->control < gate->target ? gate->target : gate->control;
+    if (qvm_gate_matrix2(gate, lo, m4) != 0)
+      return -1;
+    size_t quads = (size_t)1 << (state->num_qubits - 2);
+    single_sweep_t sw = {.k = qvm_kernels_get()->f32,
+                         .amps = s->amps,
+                         .control = lo,
+                         .target = hi,
+                         .matrix4 = m4};
+    qvm_parallel_for(quads, qvm_threads_grain(4 * sizeof(float _Complex)),
+                     sweep_4x4, &sw);
+  }
+  check_norm(state);
+  return 0;
+}
+
+static int single_measure(qvm_state_t *state, int qubit) {
+  single_t *s = (single_t *)state->backend_state;
+  double probs[2];
+  qubit_probs(state, qubit, probs);
+  double r = qvm_rng_uniform(qvm_state_rng(state));
+  int result = r * (probs[0] + probs[1]) < probs[0] ? 0 : 1;
+  if (probs[result] <= 0.0)
+    result ^= 1;
+
+  // Collapse and renormalize in one pass; this also clears the drift
+  size_t pairs = (size_t)1 << (state->num_qubits - 1);
+  single_sweep_t sw = {.k = qvm_kernels_get()->f32,
+                       .amps = s->amps,
+                       .target = qubit,
+                       .result = result,
+                       .scale = 1.0 / sqrt(probs[result])};
+  qvm_parallel_for(pairs, qvm_threads_grain(2 * sizeof(float _Complex)),
+                   sweep_collapse, &sw);
+  s->gates_since_check = 0;
+  return result;
+}
+
+static int single_sample(qvm_state_t *state, int shots, uint64_t mask,
+                         qvm_counts_t *out_counts) {
+  single_t *s = (single_t *)state->backend_state;
+  return qvm_sample_f32(state, s->amps, shots, mask, out_counts);
+}
+
+static void single_print(const qvm_state_t *state) {
+  const single_t *s = (const single_t *)state->backend_state;
+  printf("\n--- Quantum State (single precision, %zu MB) ---\n",
+         (((size_t)1 << state->num_qubits) * sizeof(float _Complex)) >> 20);
+  printf("Norm drift: max %.2e, %d correction(s)\n", s->drift,
+         s->corrections);
+  if (state->num_qubits > SINGLE_PRINT_MAX_QUBITS) {
+    printf("(amplitudes hidden above %d qubits)\n", SINGLE_PRINT_MAX_QUBITS);
+    printf("---------------------\n");
+    return;
+  }
+  size_t size = (size_t)1 << state->num_qubits;
+  for (size_t i = 0; i < size; i++) {
+    double re = crealf(s->amps[i]), im = cimagf(s->amps[i]);
+    double prob = re * re + im * im;
+    if (prob > 0.001) {
+      printf("|");
+      for (int j = state->num_qubits - 1; j >= 0; j--)
+        printf("%d", (int)((i >> j) & 1));
+      printf(">: %.4f\n", prob);
+    }
+  }
+  printf("---------------------\n");
+}
+
+const qvm_backend_ops_t qvm_backend_single = {
+    .name = "single-precision statevector",
+    .max_qubits = QVM_MAX_QUBITS,
+    .init = single_init,
+    .free = single_free,
+    .apply_gate = single_apply_gate,
+    .measure = single_measure,
+    .sample = single_sample,
+    .print = single_print,
+};
+
+// --- Public API ---
+
+int qvm_get_amplitudes(const qvm_state_t *state, double _Complex *out) {
+  size_t size = (size_t)1 << state->num_qubits;
+  if (state->backend == QVM_BACKEND_STATEVECTOR && state->amplitudes) {
+    memcpy(out, state->amplitudes, size * sizeof(double _Complex));
+    return 0;
+  }
+  if (state->backend == QVM_BACKEND_OUT_OF_CORE)
+    return qvm_ooc_read((qvm_state_t *)state, out);
+  if (state->backend == QVM_BACKEND_SPARSE && state->backend_state)
+    return qvm_sparse_read(state, out);
+  if (state->backend != QVM_BACKEND_SINGLE || !state->backend_state)
+    return -1;
+  const single_t *s = (const single_t *)state->backend_state;
+  for (size_t i = 0; i < size; i++)
+    out[i] = s->amps[i];
+  return 0;
+}
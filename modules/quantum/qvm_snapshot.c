@@ -0,0 +1,120 @@
+/*
+ * NexusQ-AI - Statevector Snapshots
+ * File: modules/quantum/qvm_snapshot.c
+ *
+ * A snapshot splits the amplitudes into pages of SNAPSHOT_PAGE_AMPS and
+ * keeps one refcounted copy per page:
+ *  - an all-zero page is a NULL pointer and takes no memory, so early
+ *    states of a circuit (and anything near a basis state) are tiny;
+ *  - a page equal to the same page of the `base` snapshot is shared with
+ *    it instead of copied, so a chain of snapshots taken a few gates apart
+ *    stores only the pages those gates wrote (a delta log at page grain).
+ * The RNG stream and measurement record are saved with the amplitudes:
+ * restoring and re-running the same gates draws the same outcomes.
+ *
+ * Pages are shared only between snapshots, never with the live state, so
+ * restoring copies 2^n amplitudes and the state stays writable in place.
+ * Refcounts are not atomic: snapshots sharing pages belong to one thread.
+ */
+
+#include "include/qvm.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SNAPSHOT_PAGE_AMPS 512 // 8 KB of double _Complex
+
+struct qvm_snapshot_page {
+  int refs;
+  double _Complex amps[];
+};
+
+static size_t page_amps(int num_qubits) {
+  size_t size = (size_t)1 << num_qubits;
+  return size < SNAPSHOT_PAGE_AMPS ? size : SNAPSHOT_PAGE_AMPS;
+}
+
+static int page_is_zero(const double _Complex *amps, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    if (amps[i] != 0.0)
+      return 0;
+  return 1;
+}
+
+int qvm_snapshot_take(const qvm_state_t *state, const qvm_snapshot_t *base,
+                      qvm_snapshot_t *out) {
+  memset(out, 0, sizeof(*out));
+  if (state->backend != QVM_BACKEND_STATEVECTOR || !state->amplitudes)
+    return -1;
+  int n = state->num_qubits;
+  size_t page = page_amps(n);
+  size_t bytes = page * sizeof(double _Complex);
+  if (base && base->num_qubits != n)
+    base = NULL;
+
+  out->num_qubits = n;
+  out->num_pages = ((size_t)1 << n) / page;
+  out->pages = (qvm_snapshot_page_t **)calloc(out->num_pages,
+                                              sizeof(qvm_snapshot_page_t *));
+  if (!out->pages)
+    return -1;
+  memcpy(out->measured, state->measured, sizeof(out->measured));
+  out->measured_bits = state->measured_bits;
+  out->rng = state->rng;
+
+  for (size_t p = 0; p < out->num_pages; p++) {
+    const double _Complex *src = state->amplitudes + p * page;
+    if (page_is_zero(src, page))
+      continue;
+    qvm_snapshot_page_t *shared = base ? base->pages[p] : NULL;
+    if (shared && memcmp(shared->amps, src, bytes) == 0) {
+      shared->refs++;
+      out->pages[p] = shared;
+      continue;
+    }
+    qvm_snapshot_page_t *copy =
+        (qvm_snapshot_page_t *)malloc(sizeof(qvm_snapshot_page_t) + bytes);
+    if (!copy) {
+      qvm_snapshot_free(out);
+      return -1;
+    }
+    copy->refs = 1;
+    memcpy(copy->amps, src, bytes);
+    out->pages[p] = copy;
+    out->bytes += bytes;
+  }
+  return 0;
+}
+
+int qvm_snapshot_restore(const qvm_snapshot_t *snap, qvm_state_t *state) {
+  if (!snap->pages || state->backend != QVM_BACKEND_STATEVECTOR ||
+      !state->amplitudes || state->num_qubits != snap->num_qubits)
+    return -1;
+  size_t page = page_amps(snap->num_qubits);
+  for (size_t p = 0; p < snap->num_pages; p++) {
+    double _Complex *dst = state->amplitudes + p * page;
+    if (snap->pages[p])
+      memcpy(dst, snap->pages[p]->amps, page * sizeof(double _Complex));
+    else
+      memset(dst, 0, page * sizeof(double _Complex));
+  }
+  memcpy(state->measured, snap->measured, sizeof(state->measured));
+  state->measured_bits = snap->measured_bits;
+  state->rng = snap->rng;
+  return 0;
+}
+
+size_t qvm_snapshot_free(qvm_snapshot_t *snap) {
+  size_t released = 0;
+  if (snap->pages) {
+    size_t bytes = page_amps(snap->num_qubits) * sizeof(double _Complex);
+    for (size_t p = 0; p < snap->num_pages; p++) {
+      if (snap->pages[p] && --snap->pages[p]->refs == 0) {
+        free(snap->pages[p]);
+        released += bytes;
+      }
+    }
+    free(snap->pages);
+  }
+  memset(snap, 0, sizeof(*snap));
+  return released;
+}
@@ -0,0 +1,479 @@
+/*
+ * NexusQ-AI - Sparse Statevector Backend
+ * File: modules/quantum/qvm_sparse.c
+ *
+ * Only the non-zero amplitudes: a compact array of (basis index,
+ * amplitude) entries, with an open-addressing index from basis index to
+ * entry that is rebuilt only when a gate needs it. Every gate is O(nnz):
+ *  - diagonal gates scale the entries in place, permutation gates rewrite
+ *    their keys (see qvm_gate_form), neither touches the index;
+ *  - other 1-qubit gates pair each entry with its partner across the
+ *    target bit and write a fresh entry array, dropping the amplitudes
+ *    under SPARSE_EPSILON.
+ * Basis indices are 64-bit, so low-support circuits run well past the
+ * dense statevector's qubit limit.
+ *
+ * Past 2^n >> QVM_SPARSE_DENSE_SHIFT entries the amplitudes are scattered
+ * into a dense statevector (when one fits) and gates take its kernels.
+ * The support is counted again every SPARSE_CHECK_INTERVAL gates and after
+ * each measurement; under 2^n >> SPARSE_SPARSE_SHIFT it goes back to
+ * entries.
+ */
+
+#include "include/qvm_backend.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPARSE_SPARSE_SHIFT (QVM_SPARSE_DENSE_SHIFT + 2) // Hysteresis
+#define SPARSE_CHECK_INTERVAL 16 // Dense gates between support counts
+#define SPARSE_EPSILON 1e-15     // Smallest |amplitude| kept
+#define SPARSE_MIN_CAPACITY 16
+#define SPARSE_PRINT_MAX 64 // Entries listed by qvm_print_state
+#define SPARSE_PRINT_MAX_QUBITS 20
+#define SPARSE_NONE SIZE_MAX
+
+typedef struct {
+  int n;
+  size_t nnz;
+  size_t capacity;
+  uint64_t *keys;
+  double _Complex *amps;
+  uint64_t *next_keys; // Output of a mixing gate, swapped in after it
+  double _Complex *next_amps;
+  size_t *slots; // Entry + 1 per slot, 0 = empty
+  int slot_bits;
+  int index_valid;
+  double _Complex *dense; // Dense mode while non-NULL
+  size_t dense_limit;     // Support that switches to dense, SIZE_MAX = never
+  int gates_since_check;
+  int switches;
+  size_t peak;
+} sparse_t;
+
+static int negligible(double _Complex a) {
+  return creal(a) * creal(a) + cimag(a) * cimag(a) <=
+         SPARSE_EPSILON * SPARSE_EPSILON;
+}
+
+static double norm2(double _Complex a) {
+  return creal(a) * creal(a) + cimag(a) * cimag(a);
+}
+
+// --- Entries and index ---
+
+static int reserve(sparse_t *s, size_t count) {
+  if (count <= s->capacity)
+    return 0;
+  size_t capacity = s->capacity ? s->capacity : SPARSE_MIN_CAPACITY;
+  while (capacity < count)
+    capacity *= 2;
+  uint64_t *keys[2] = {s->keys, s->next_keys};
+  double _Complex *amps[2] = {s->amps, s->next_amps};
+  for (int b = 0; b < 2; b++) {
+    uint64_t *k = (uint64_t *)realloc(keys[b], capacity * sizeof(uint64_t));
+    if (k)
+      keys[b] = k;
+    double _Complex *a = (double _Complex *)realloc(
+        amps[b], capacity * sizeof(double _Complex));
+    if (a)
+      amps[b] = a;
+    if (!k || !a) {
+      s->keys = keys[0];
+      s->next_keys = keys[1];
+      s->amps = amps[0];
+      s->next_amps = amps[1];
+      return -1;
+    }
+  }
+  s->keys = keys[0];
+  s->next_keys = keys[1];
+  s->amps = amps[0];
+  s->next_amps = amps[1];
+  s->capacity = capacity;
+  return 0;
+}
+
+static size_t slot_of(uint64_t key, int bits) {
+  return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+}
+
+// Load factor at most 1/2
+static int build_index(sparse_t *s) {
+  int bits = 4;
+  while (((size_t)1 << bits) < 2 * s->nnz)
+    bits++;
+  if (bits != s->slot_bits) {
+    size_t *slots = (size_t *)realloc(s->slots, sizeof(size_t) << bits);
+    if (!slots)
+      return -1;
+    s->slots = slots;
+    s->slot_bits = bits;
+  }
+  size_t mask = ((size_t)1 << bits) - 1;
+  memset(s->slots, 0, sizeof(size_t) << bits);
+  for (size_t e = 0; e < s->nnz; e++) {
+    size_t i = slot_of(s->keys[e], bits);
+    while (s->slots[i])
+      i = (i + 1) & mask;
+    s->slots[i] = e + 1;
+  }
+  s->index_valid = 1;
+  return 0;
+}
+
+static size_t find(const sparse_t *s, uint64_t key) {
+  size_t mask = ((size_t)1 << s->slot_bits) - 1;
+  for (size_t i = slot_of(key, s->slot_bits); s->slots[i];
+       i = (i + 1) & mask)
+    if (s->keys[s->slots[i] - 1] == key)
+      return s->slots[i] - 1;
+  return SPARSE_NONE;
+}
+
+// --- Sparse gates ---
+
+static void apply_form(sparse_t *s, const qvm_gate_form_t *f) {
+  for (size_t e = 0; e < s->nnz; e++) {
+    uint64_t k = s->keys[e];
+    switch (f->kind) {
+    case QVM_FORM_PHASE:
+      if ((k & f->mask) == f->mask)
+        s->amps[e] *= f->d[1];
+      break;
+    case QVM_FORM_DIAG:
+      s->amps[e] *= f->d[__builtin_parityll(k & f->mask)];
+      break;
+    case QVM_FORM_PERMUTE:
+      // Both sides of each swapped pair move
+      if ((k & f->mask) == f->set || ((k ^ f->flip) & f->mask) == f->set)
+        s->keys[e] = k ^ f->flip;
+      break;
+    }
+  }
+  if (f->kind == QVM_FORM_PERMUTE)
+    s->index_valid = 0;
+}
+
+// Each pair (k, k ^ bit) is handled once, by its first entry
+static int apply_mixing(sparse_t *s, int target,
+                        const double _Complex m[2][2]) {
+  if ((!s->index_valid && build_index(s) != 0) ||
+      reserve(s, 2 * s->nnz) != 0)
+    return -1;
+  uint64_t bit = (uint64_t)1 << target;
+  size_t out = 0;
+  for (size_t e = 0; e < s->nnz; e++) {
+    uint64_t k = s->keys[e];
+    size_t p = find(s, k ^ bit);
+    if (p != SPARSE_NONE && p < e)
+      continue;
+    double _Complex a[2] = {0, 0};
+    int b = (int)((k >> target) & 1);
+    a[b] = s->amps[e];
+    if (p != SPARSE_NONE)
+      a[!b] = s->amps[p];
+    for (int r = 0; r < 2; r++) {
+      double _Complex v = m[r][0] * a[0] + m[r][1] * a[1];
+      if (negligible(v))
+        continue;
+      s->next_keys[out] = r ? k | bit : k & ~bit;
+      s->next_amps[out++] = v;
+    }
+  }
+  uint64_t *keys = s->keys;
+  double _Complex *amps = s->amps;
+  s->keys = s->next_keys;
+  s->amps = s->next_amps;
+  s->next_keys = keys;
+  s->next_amps = amps;
+  s->nnz = out;
+  s->index_valid = 0;
+  return 0;
+}
+
+// --- Dense mode ---
+
+static qvm_state_t dense_view(const sparse_t *s) {
+  qvm_state_t view = {.num_qubits = s->n,
+                      .amplitudes = s->dense,
+                      .backend = QVM_BACKEND_STATEVECTOR};
+  return view;
+}
+
+static void release_entries(sparse_t *s) {
+  free(s->keys);
+  free(s->amps);
+  free(s->next_keys);
+  free(s->next_amps);
+  free(s->slots);
+  s->keys = s->next_keys = NULL;
+  s->amps = s->next_amps = NULL;
+  s->slots = NULL;
+  s->capacity = 0;
+  s->slot_bits = 0;
+  s->index_valid = 0;
+}
+
+static void to_dense(sparse_t *s) {
+  s->dense = (double _Complex *)calloc((size_t)1 << s->n,
+                                       sizeof(double _Complex));
+  if (!s->dense) {
+    s->dense_limit = SPARSE_NONE; // Stay sparse
+    return;
+  }
+  for (size_t e = 0; e < s->nnz; e++)
+    s->dense[s->keys[e]] = s->amps[e];
+  release_entries(s);
+  s->gates_since_check = 0;
+  s->switches++;
+}
+
+// Count the support; gather it back into entries once it is small
+static void check_support(sparse_t *s) {
+  s->gates_since_check = 0;
+  size_t size = (size_t)1 << s->n, count = 0;
+  for (size_t i = 0; i < size; i++)
+    count += !negligible(s->dense[i]);
+  s->nnz = count;
+  if (count > s->peak)
+    s->peak = count;
+  if (count >= size >> SPARSE_SPARSE_SHIFT ||
+      reserve(s, count > 0 ? count : 1) != 0)
+    return;
+  size_t e = 0;
+  for (size_t i = 0; i < size; i++) {
+    if (negligible(s->dense[i]))
+      continue;
+    s->keys[e] = i;
+    s->amps[e++] = s->dense[i];
+  }
+  free(s->dense);
+  s->dense = NULL;
+  s->index_valid = 0;
+  s->switches++;
+}
+
+// --- Backend table ---
+
+static int sparse_init(qvm_state_t *state, int num_qubits) {
+  sparse_t *s = (sparse_t *)calloc(1, sizeof(sparse_t));
+  if (!s || reserve(s, SPARSE_MIN_CAPACITY) != 0) {
+    free(s);
+    return -1;
+  }
+  s->n = num_qubits;
+  s->keys[0] = 0;
+  s->amps[0] = 1.0;
+  s->nnz = 1;
+  s->peak = 1;
+  s->dense_limit = num_qubits <= QVM_MAX_QUBITS &&
+                           qvm_state_fits(num_qubits, sizeof(double _Complex))
+                       ? ((size_t)1 << num_qubits) >> QVM_SPARSE_DENSE_SHIFT
+                       : SPARSE_NONE;
+  state->backend_state = s;
+  return 0;
+}
+
+static void sparse_free(qvm_state_t *state) {
+  sparse_t *s = (sparse_t *)state->backend_state;
+  release_entries(s);
+  free(s->dense);
+  free(s);
+  state->backend_state = NULL;
+}
+
+static int sparse_apply_gate(qvm_state_t *state, const qvm_gate_t *gate) {
+  sparse_t *s = (sparse_t *)state->backend_state;
+  // Macro-ops run as gate sequences (qvm_backend_macro) in either form
+  if (qvm_gate_is_range(gate->type))
+    return -1;
+  if (s->dense) {
+    qvm_state_t view = dense_view(s);
+    if (qvm_apply_unitary(&view, gate) != 0)
+      return -1;
+    if (++s->gates_since_check >= SPARSE_CHECK_INTERVAL)
+      check_support(s);
+    return 0;
+  }
+
+  qvm_gate_form_t form;
+  double _Complex m[2][2];
+  if (qvm_gate_form(gate, &form) == 0)
+    apply_form(s, &form);
+  else if (qvm_gate_unitary(gate, m) != 0 ||
+           apply_mixing(s, gate->target, m) != 0)
+    return -1;
+  if (s->nnz > s->peak)
+    s->peak = s->nnz;
+  if (s->nnz > s->dense_limit)
+    to_dense(s);
+  return 0;
+}
+
+static int sparse_measure(qvm_state_t *state, int qubit) {
+  sparse_t *s = (sparse_t *)state->backend_state;
+  double probs[2] = {0.0, 0.0};
+  qvm_state_t view = dense_view(s);
+  if (s->dense) {
+    qvm_qubit_probs(&view, qubit, probs);
+  } else {
+    for (size_t e = 0; e < s->nnz; e++)
+      probs[(s->keys[e] >> qubit) & 1] += norm2(s->amps[e]);
+  }
+  double r = qvm_rng_uniform(qvm_state_rng(state));
+  int result = r * (probs[0] + probs[1]) < probs[0] ? 0 : 1;
+  if (probs[result] <= 0.0)
+    result ^= 1;
+  double scale = 1.0 / sqrt(probs[result]);
+
+  if (s->dense) {
+    // Collapse and renormalize as one diagonal
+    qvm_gate_form_t collapse = {.kind = QVM_FORM_DIAG,
+                                .mask = (uint64_t)1 << qubit};
+    collapse.d[result] = scale;
+    qvm_apply_form(&view, &collapse);
+    check_support(s);
+    return result;
+  }
+  size_t kept = 0;
+  for (size_t e = 0; e < s->nnz; e++) {
+    if ((int)((s->keys[e] >> qubit) & 1) != result)
+      continue;
+    s->keys[kept] = s->keys[e];
+    s->amps[kept++] = s->amps[e] * scale;
+  }
+  s->nnz = kept;
+  s->index_valid = 0;
+  return result;
+}
+
+// Sorted uniforms against the running sum of the entries, in O(nnz + shots)
+static int sparse_sample(qvm_state_t *state, int shots, uint64_t mask,
+                         qvm_counts_t *out_counts) {
+  sparse_t *s = (sparse_t *)state->backend_state;
+  if (s->dense) {
+    qvm_state_t view = dense_view(s);
+    view.rng = *qvm_state_rng(state);
+    int rc = qvm_sample_marginal(&view, shots, mask, out_counts);
+    state->rng = view.rng;
+    return rc;
+  }
+
+  double total = 0.0;
+  for (size_t e = 0; e < s->nnz; e++)
+    total += norm2(s->amps[e]);
+  uint64_t *outcomes = (uint64_t *)malloc(shots * sizeof(uint64_t));
+  double *u = (double *)malloc(shots * sizeof(double));
+  if (!outcomes || !u || s->nnz == 0) {
+    free(outcomes);
+    free(u);
+    return -1;
+  }
+  qvm_sorted_uniforms(qvm_state_rng(state), u, shots, total);
+  size_t e = 0;
+  double acc = norm2(s->amps[0]);
+  for (int i = 0; i < shots; i++) {
+    while (u[i] >= acc && e + 1 < s->nnz)
+      acc += norm2(s->amps[++e]);
+    outcomes[i] = s->keys[e] & mask;
+  }
+  free(u);
+  int rc = qvm_counts_from_outcomes(outcomes, shots, s->n, mask, out_counts);
+  free(outcomes);
+  return rc;
+}
+
+typedef struct {
+  uint64_t key;
+  double prob;
+} sparse_line_t;
+
+static int cmp_line(const void *a, const void *b) {
+  uint64_t ka = ((const sparse_line_t *)a)->key;
+  uint64_t kb = ((const sparse_line_t *)b)->key;
+  return ka < kb ? -1 : ka > kb;
+}
+
+static void print_basis(uint64_t index, int n, double prob) {
+  printf("|");
+  for (int j = n - 1; j >= 0; j--)
+    printf("%d", (int)((index >> j) & 1));
+  printf(">: %.4f\n", prob);
+}
+
+static void sparse_print(const qvm_state_t *state) {
+  const sparse_t *s = (const sparse_t *)state->backend_state;
+  printf("\n--- Quantum State (sparse, %zu non-zero of 2^%d%s) ---\n", s->nnz,
+         s->n, s->dense ? ", held dense" : "");
+  if (s->dense) {
+    if (s->n > SPARSE_PRINT_MAX_QUBITS) {
+      printf("(amplitudes hidden above %d qubits)\n",
+             SPARSE_PRINT_MAX_QUBITS);
+    } else {
+      for (size_t i = 0; i < (size_t)1 << s->n; i++)
+        if (norm2(s->dense[i]) > 0.001)
+          print_basis(i, s->n, norm2(s->dense[i]));
+    }
+    printf("---------------------\n");
+    return;
+  }
+
+  // Basis states in index order, like the dense listing
+  sparse_line_t *lines =
+      (sparse_line_t *)malloc(s->nnz * sizeof(sparse_line_t));
+  size_t count = 0;
+  for (size_t e = 0; lines && e < s->nnz; e++) {
+    double prob = norm2(s->amps[e]);
+    if (prob > 0.001)
+      lines[count++] = (sparse_line_t){s->keys[e], prob};
+  }
+  if (lines) {
+    qsort(lines, count, sizeof(sparse_line_t), cmp_line);
+    for (size_t i = 0; i < count && i < SPARSE_PRINT_MAX; i++)
+      print_basis(lines[i].key, s->n, lines[i].prob);
+    if (count > SPARSE_PRINT_MAX)
+      printf("(%zu more basis states)\n", count - SPARSE_PRINT_MAX);
+    free(lines);
+  }
+  printf("---------------------\n");
+}
+
+const qvm_backend_ops_t qvm_backend_sparse = {
+    .name = "sparse statevector",
+    .max_qubits = QVM_SPARSE_MAX_QUBITS,
+    .init = sparse_init,
+    .free = sparse_free,
+    .apply_gate = sparse_apply_gate,
+    .measure = sparse_measure,
+    .sample = sparse_sample,
+    .print = sparse_print,
+};
+
+// --- Public API ---
+
+int qvm_sparse_read(const qvm_state_t *state, double _Complex *out) {
+  const sparse_t *s = (const sparse_t *)state->backend_state;
+  size_t size = (size_t)1 << s->n;
+  if (s->dense) {
+    memcpy(out, s->dense, size * sizeof(double _Complex));
+    return 0;
+  }
+  memset(out, 0, size * sizeof(double _Complex));
+  for (size_t e = 0; e < s->nnz; e++)
+    out[s->keys[e]] = s->amps[e];
+  return 0;
+}
+
+int qvm_sparse_stats(const qvm_state_t *state, qvm_sparse_stats_t *out) {
+  memset(out, 0, sizeof(*out));
+  if (state->backend != QVM_BACKEND_SPARSE || !state->backend_state)
+    return -1;
+  const sparse_t *s = (const sparse_t *)state->backend_state;
+  out->support = s->nnz;
+  out->peak = s->peak;
+  out->dense = s->dense != NULL;
+  out->switches = s->switches;
+  return 0;
+}
@@ -0,0 +1,338 @@
+/*
+ * NexusQ-AI - Stabilizer Tableau Backend
+ * File: modules/quantum/qvm_stabilizer.c
+ *
+ * Aaronson-Gottesman (CHP) simulation of Clifford circuits in O(n^2) bits.
+ * Rows 0..n-1 are destabilizers, n..2n-1 stabilizers and 2n is scratch.
+ * Each row stores its X and Z bits packed in 64-bit words plus a sign, so
+ * the row product (rowsum) runs a word at a time: the phase of the product
+ * comes from popcounts of the positions contributing +i and -i.
+ *
+ * Gates are O(n) column updates; a measurement is O(n^2 / 64).
+ */
+
+#include "include/qvm_backend.h"
+#include "include/qvm_threads.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TABLEAU_PRINT_MAX_QUBITS 16
+
+typedef struct {
+  int n;
+  int words;  // 64-bit words per row
+  uint64_t *x; // (2n + 1) rows of `words`
+  uint64_t *z;
+  unsigned char *r; // Sign bit per row
+} tableau_t;
+
+static inline uint64_t *row_x(const tableau_t *t, int i) {
+  return t->x + (size_t)i * t->words;
+}
+
+static inline uint64_t *row_z(const tableau_t *t, int i) {
+  return t->z + (size_t)i * t->words;
+}
+
+static inline int get_bit(const uint64_t *row, int q) {
+  return (row[q >> 6] >> (q & 63)) & 1;
+}
+
+static tableau_t *tableau_alloc(int n) {
+  tableau_t *t = (tableau_t *)malloc(sizeof(tableau_t));
+  if (!t)
+    return NULL;
+  t->n = n;
+  t->words = (n + 63) / 64;
+  size_t cells = (size_t)(2 * n + 1) * t->words;
+  t->x = (uint64_t *)calloc(cells, sizeof(uint64_t));
+  t->z = (uint64_t *)calloc(cells, sizeof(uint64_t));
+  t->r = (unsigned char *)calloc(2 * n + 1, 1);
+  if (!t->x || !t->z || !t->r) {
+    free(t->x);
+    free(t->z);
+    free(t->r);
+    free(t);
+    return NULL;
+  }
+  return t;
+}
+
+static void tableau_release(tableau_t *t) {
+  if (!t)
+    return;
+  free(t->x);
+  free(t->z);
+  free(t->r);
+  free(t);
+}
+
+static void tableau_copy(tableau_t *dst, const tableau_t *src) {
+  size_t cells = (size_t)(2 * src->n + 1) * src->words;
+  memcpy(dst->x, src->x, cells * sizeof(uint64_t));
+  memcpy(dst->z, src->z, cells * sizeof(uint64_t));
+  memcpy(dst->r, src->r, 2 * src->n + 1);
+}
+
+// Row h <- row h * row i. Per qubit, the product of the two Paulis picks
+// up a factor of +i, -i or 1; the masks below select the +i and -i cases
+// (XY, YZ, ZX and the reverse), and the sign follows from the total mod 4.
+static void rowsum(tableau_t *t, int h, int i) {
+  uint64_t *xh = row_x(t, h), *zh = row_z(t, h);
+  const uint64_t *xi = row_x(t, i), *zi = row_z(t, i);
+  int phase = 2 * t->r[h] + 2 * t->r[i];
+
+  for (int w = 0; w < t->words; w++) {
+    uint64_t x1 = xi[w], z1 = zi[w], x2 = xh[w], z2 = zh[w];
+    uint64_t plus = (x1 & z1 & ~x2 & z2) | (x1 & ~z1 & x2 & z2) |
+                    (~x1 & z1 & x2 & ~z2);
+    uint64_t minus = (x1 & z1 & x2 & ~z2) | (x1 & ~z1 & ~x2 & z2) |
+                     (~x1 & z1 & x2 & z2);
+    phase += __builtin_popcountll(plus) - __builtin_popcountll(minus);
+    xh[w] = x2 ^ x1;
+    zh[w] = z2 ^ z1;
+  }
+  t->r[h] = (unsigned char)((((phase % 4) + 4) % 4) == 2);
+}
+
+// --- Clifford gates (column updates over all 2n rows) ---
+
+static void tableau_h(tableau_t *t, int a) {
+  int w = a >> 6;
+  uint64_t m = (uint64_t)1 << (a & 63);
+  for (int i = 0; i < 2 * t->n; i++) {
+    uint64_t *xw = row_x(t, i) + w, *zw = row_z(t, i) + w;
+    uint64_t xb = *xw & m, zb = *zw & m;
+    t->r[i] ^= (xb && zb);
+    *xw = (*xw & ~m) | zb;
+    *zw = (*zw & ~m) | xb;
+  }
+}
+
+static void tableau_s(tableau_t *t, int a) {
+  int w = a >> 6;
+  uint64_t m = (uint64_t)1 << (a & 63);
+  for (int i = 0; i < 2 * t->n; i++) {
+    uint64_t *xw = row_x(t, i) + w, *zw = row_z(t, i) + w;
+    t->r[i] ^= ((*xw & m) && (*zw & m));
+    *zw ^= *xw & m;
+  }
+}
+
+// Paulis only flip signs: X anticommutes with Z, Z with X, Y with both
+static void tableau_pauli(tableau_t *t, int a, int flip_on_x, int flip_on_z) {
+  for (int i = 0; i < 2 * t->n; i++) {
+    int xb = get_bit(row_x(t, i), a), zb = get_bit(row_z(t, i), a);
+    t->r[i] ^= (flip_on_x & xb) ^ (flip_on_z & zb);
+  }
+}
+
+static void tableau_cnot(tableau_t *t, int c, int tg) {
+  int wc = c >> 6, wt = tg >> 6;
+  int bc = c & 63, bt = tg & 63;
+  for (int i = 0; i < 2 * t->n; i++) {
+    uint64_t *x = row_x(t, i), *z = row_z(t, i);
+    int xc = (x[wc] >> bc) & 1, zc = (z[wc] >> bc) & 1;
+    int xt = (x[wt] >> bt) & 1, zt = (z[wt] >> bt) & 1;
+    t->r[i] ^= xc & zt & (xt ^ zc ^ 1);
+    x[wt] ^= (uint64_t)xc << bt;
+    z[wc] ^= (uint64_t)zt << bc;
+  }
+}
+
+static void tableau_swap(tableau_t *t, int a, int b) {
+  for (int i = 0; i < 2 * t->n; i++) {
+    uint64_t *x = row_x(t, i), *z = row_z(t, i);
+    int xa = get_bit(x, a), za = get_bit(z, a);
+    int xb = get_bit(x, b), zb = get_bit(z, b);
+    if (xa != xb) {
+      x[a >> 6] ^= (uint64_t)1 << (a & 63);
+      x[b >> 6] ^= (uint64_t)1 << (b & 63);
+    }
+    if (za != zb) {
+      z[a >> 6] ^= (uint64_t)1 << (a & 63);
+      z[b >> 6] ^= (uint64_t)1 << (b & 63);
+    }
+  }
+}
+
+// --- Measurement ---
+
+typedef struct {
+  tableau_t *t;
+  int a;
+  int p;
+} measure_sweep_t;
+
+// Rows are independent here: each one only reads row p
+static void sweep_rowsum(void *arg, size_t chunk, size_t b, size_t e) {
+  measure_sweep_t *sw = (measure_sweep_t *)arg;
+  for (size_t i = b; i < e; i++) {
+    if ((int)i != sw->p && get_bit(row_x(sw->t, i), sw->a))
+      rowsum(sw->t, (int)i, sw->p);
+  }
+}
+
+static int tableau_measure(tableau_t *t, int a, qvm_rng_t *rng) {
+  int n = t->n;
+
+  // A stabilizer with X or Y on qubit a makes the outcome random
+  int p = -1;
+  for (int i = n; i < 2 * n; i++) {
+    if (get_bit(row_x(t, i), a)) {
+      p = i;
+      break;
+    }
+  }
+
+  if (p >= 0) {
+    measure_sweep_t sw = {.t = t, .a = a, .p = p};
+    size_t grain = qvm_threads_grain(2 * t->words * sizeof(uint64_t));
+    qvm_parallel_for(2 * n, grain, sweep_rowsum, &sw);
+
+    // Old stabilizer becomes the destabilizer, new stabilizer is +-Z_a
+    memcpy(row_x(t, p - n), row_x(t, p), t->words * sizeof(uint64_t));
+    memcpy(row_z(t, p - n), row_z(t, p), t->words * sizeof(uint64_t));
+    t->r[p - n] = t->r[p];
+    memset(row_x(t, p), 0, t->words * sizeof(uint64_t));
+    memset(row_z(t, p), 0, t->words * sizeof(uint64_t));
+    row_z(t, p)[a >> 6] = (uint64_t)1 << (a & 63);
+    t->r[p] = (unsigned char)(qvm_rng_next(rng) >> 63);
+    return t->r[p];
+  }
+
+  // Deterministic: Z_a is the product of the stabilizers whose paired
+  // destabilizer anticommutes with it
+  int s = 2 * n;
+  memset(row_x(t, s), 0, t->words * sizeof(uint64_t));
+  memset(row_z(t, s), 0, t->words * sizeof(uint64_t));
+  t->r[s] = 0;
+  for (int i = 0; i < n; i++) {
+    if (get_bit(row_x(t, i), a))
+      rowsum(t, s, i + n);
+  }
+  return t->r[s];
+}
+
+// --- Backend table ---
+
+static int stab_init(qvm_state_t *state, int num_qubits) {
+  tableau_t *t = tableau_alloc(num_qubits);
+  if (!t)
+    return -1;
+  // |0...0>: destabilizers X_i, stabilizers Z_i
+  for (int i = 0; i < num_qubits; i++) {
+    row_x(t, i)[i >> 6] |= (uint64_t)1 << (i & 63);
+    row_z(t, i + num_qubits)[i >> 6] |= (uint64_t)1 << (i & 63);
+  }
+  state->backend_state = t;
+  return 0;
+}
+
+static void stab_free(qvm_state_t *state) {
+  tableau_release((tableau_t *)state->backend_state);
+  state->backend_state = NULL;
+}
+
+static int stab_apply_gate(qvm_state_t *state, const qvm_gate_t *gate) {
+  tableau_t *t = (tableau_t *)state->backend_state;
+  int a = gate->target;
+
+  switch (gate->type) {
+  case GATE_H:
+    tableau_h(t, a);
+    break;
+  case GATE_S:
+    tableau_s(t, a);
+    break;
+  case GATE_X:
+    tableau_pauli(t, a, 0, 1);
+    break;
+  case GATE_Z:
+    tableau_pauli(t, a, 1, 0);
+    break;
+  case GATE_Y:
+    tableau_pauli(t, a, 1, 1);
+    break;
+  case GATE_CNOT:
+    tableau_cnot(t, gate->control, a);
+    break;
+  case GATE_CZ:
+    tableau_h(t, a);
+    tableau_cnot(t, gate->control, a);
+    tableau_h(t, a);
+    break;
+  case GATE_SWAP:
+    tableau_swap(t, gate->control, a);
+    break;
+  default:
+    return -1; // T is not a Clifford gate
+  }
+  return 0;
+}
+
+static int stab_measure(qvm_state_t *state, int qubit) {
+  return tableau_measure((tableau_t *)state->backend_state, qubit,
+                         qvm_state_rng(state));
+}
+
+// Each shot measures a copy of the tableau
+static int stab_sample(qvm_state_t *state, int shots, uint64_t mask,
+                       qvm_counts_t *out_counts) {
+  tableau_t *t = (tableau_t *)state->backend_state;
+  tableau_t *work = tableau_alloc(t->n);
+  qvm_rng_t *rng = qvm_state_rng(state);
+  uint64_t *outcomes = (uint64_t *)malloc(shots * sizeof(uint64_t));
+  if (!work || !outcomes) {
+    tableau_release(work);
+    free(outcomes);
+    return -1;
+  }
+
+  for (int s = 0; s < shots; s++) {
+    tableau_copy(work, t);
+    uint64_t outcome = 0;
+    for (int q = 0; q < t->n && q < 64; q++) {
+      if ((mask >> q) & 1)
+        outcome |= (uint64_t)tableau_measure(work, q, rng) << q;
+    }
+    outcomes[s] = outcome;
+  }
+  tableau_release(work);
+
+  int rc = qvm_counts_from_outcomes(outcomes, shots, t->n, mask, out_counts);
+  free(outcomes);
+  return rc;
+}
+
+static void stab_print(const qvm_state_t *state) {
+  const tableau_t *t = (const tableau_t *)state->backend_state;
+  printf("\n--- Stabilizer State (%d qubits, %zu KB tableau) ---\n", t->n,
+         ((size_t)(2 * t->n + 1) * t->words * 2 * sizeof(uint64_t)) >> 10);
+  if (t->n > TABLEAU_PRINT_MAX_QUBITS) {
+    printf("(generators hidden above %d qubits)\n", TABLEAU_PRINT_MAX_QUBITS);
+  } else {
+    static const char pauli[4] = {'I', 'X', 'Z', 'Y'};
+    for (int i = t->n; i < 2 * t->n; i++) {
+      printf("%c", t->r[i] ? '-' : '+');
+      for (int q = t->n - 1; q >= 0; q--) {
+        int xb = get_bit(row_x(t, i), q), zb = get_bit(row_z(t, i), q);
+        printf("%c", pauli[xb | (zb << 1)]);
+      }
+      printf("\n");
+    }
+  }
+  printf("---------------------\n");
+}
+
+const qvm_backend_ops_t qvm_backend_stabilizer = {
+    .name = "stabilizer",
+    .max_qubits = QVM_STABILIZER_MAX_QUBITS,
+    .init = stab_init,
+    .free = stab_free,
+    .apply_gate = stab_apply_gate,
+    .measure = stab_measure,
+    .sample = stab_sample,
+    .print = stab_print,
+};
@@ -0,0 +1,204 @@
+/*
+ * NexusQ-AI - QVM Worker Pool
+ * File: modules/quantum/qvm_threads.c
+ *
+ * A small persistent pthread pool. Workers sleep on a condition variable
+ * between sweeps and pull chunks from a shared atomic counter, so uneven
+ * chunks (e.g. controlled gates) still balance across cores. The caller
+ * thread takes part in every sweep.
+ */
+
+#include "include/qvm_threads.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define QVM_THREADS_MAX 256
+#define QVM_DEFAULT_L2 (256 * 1024)
+
+typedef struct {
+  qvm_range_fn fn;
+  void *ctx;
+  size_t n;
+  size_t grain;
+  size_t num_chunks;
+  size_t next_chunk; // atomic
+} qvm_job_t;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t submit_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t workers[QVM_THREADS_MAX];
+static int num_workers = 0;    // spawned helper threads
+static int target_threads = 0; // requested total (0 = default)
+static unsigned long generation = 0;
+static int busy_workers = 0;
+static int shutting_down = 0;
+static qvm_job_t *current_job = NULL;
+
+static __thread int in_pool_worker = 0;
+
+static void run_chunks(qvm_job_t *job) {
+  for (;;) {
+    size_t c = __atomic_fetch_add(&job->next_chunk, 1, __ATOMIC_RELAXED);
+    if (c >= job->num_chunks)
+      break;
+    size_t begin = c * job->grain;
+    size_t end = begin + job->grain;
+    if (end > job->n)
+      end = job->n;
+    job->fn(job->ctx, c, begin, end);
+  }
+}
+
+// arg is the generation current when the worker was created: a worker
+// started after earlier sweeps must not mistake the last one for new work
+static void *worker_main(void *arg) {
+  unsigned long seen = (unsigned long)(uintptr_t)arg;
+  in_pool_worker = 1;
+
+  pthread_mutex_lock(&pool_lock);
+  for (;;) {
+    while (generation == seen && !shutting_down)
+      pthread_cond_wait(&pool_wake, &pool_lock);
+    if (shutting_down)
+      break;
+    seen = generation;
+    qvm_job_t *job = current_job;
+    if (!job)
+      continue;
+    pthread_mutex_unlock(&pool_lock);
+
+    run_chunks(job);
+
+    pthread_mutex_lock(&pool_lock);
+    if (--busy_workers == 0)
+      pthread_cond_signal(&pool_done);
+  }
+  pthread_mutex_unlock(&pool_lock);
+  return NULL;
+}
+
+// Resolved once: every multi-chunk sweep asks for the thread count
+static int default_threads(void) {
+  static int threads = 0;
+  if (threads == 0) {
+    const char *env = getenv("QVM_THREADS");
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = env && atoi(env) > 0 ? atoi(env) : cpus > 0 ? (int)cpus : 1;
+  }
+  return threads;
+}
+
+static void pool_stop(void) {
+  pthread_mutex_lock(&pool_lock);
+  shutting_down = 1;
+  pthread_cond_broadcast(&pool_wake);
+  pthread_mutex_unlock(&pool_lock);
+
+  for (int i = 0; i < num_workers; i++)
+    pthread_join(workers[i], NULL);
+
+  num_workers = 0;
+  shutting_down = 0;
+}
+
+// Bring the helper count in line with the requested thread total.
+// Called with submit_lock held.
+static void pool_resize(void) {
+  int want = qvm_threads_get() - 1;
+  if (want == num_workers)
+    return;
+
+  if (num_workers > 0)
+    pool_stop();
+
+  pthread_mutex_lock(&pool_lock);
+  void *start = (void *)(uintptr_t)generation;
+  pthread_mutex_unlock(&pool_lock);
+  for (int i = 0; i < want; i++) {
+    if (pthread_create(&workers[i], NULL, worker_main, start) != 0) {
+      printf("[QVM] Warning: only %d worker threads started\n", i + 1);
+      break;
+    }
+    num_workers++;
+  }
+}
+
+void qvm_threads_set(int num_threads) {
+  if (num_threads > QVM_THREADS_MAX)
+    num_threads = QVM_THREADS_MAX;
+  target_threads = num_threads > 0 ? num_threads : 0;
+}
+
+int qvm_threads_get(void) {
+  int n = target_threads > 0 ? target_threads : default_threads();
+  return n > QVM_THREADS_MAX ? QVM_THREADS_MAX : n;
+}
+
+size_t qvm_threads_grain(size_t bytes_per_item) {
+  static long l2 = 0;
+  if (l2 == 0) {
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+    if (l2 <= 0)
+      l2 = QVM_DEFAULT_L2;
+  }
+  size_t grain = (size_t)l2 / 2 / (bytes_per_item ? bytes_per_item : 1);
+  return grain > 0 ? grain : 1;
+}
+
+size_t qvm_parallel_chunks(size_t n, size_t grain) {
+  if (grain == 0)
+    grain = 1;
+  return (n + grain - 1) / grain;
+}
+
+void qvm_parallel_for(size_t n, size_t grain, qvm_range_fn fn, void *ctx) {
+  if (grain == 0)
+    grain = 1;
+
+  qvm_job_t job = {.fn = fn,
+                   .ctx = ctx,
+                   .n = n,
+                   .grain = grain,
+                   .num_chunks = qvm_parallel_chunks(n, grain),
+                   .next_chunk = 0};
+
+  // Inline: tiny loops, serial pool, nested calls from a worker, or another
+  // thread already owns the pool (batch execution, trajectories...)
+  if (job.num_chunks <= 1 || in_pool_worker || qvm_threads_get() <= 1 ||
+      pthread_mutex_trylock(&submit_lock) != 0) {
+    run_chunks(&job);
+    return;
+  }
+
+  pool_resize();
+  if (num_workers == 0) {
+    pthread_mutex_unlock(&submit_lock);
+    run_chunks(&job);
+    return;
+  }
+
+  pthread_mutex_lock(&pool_lock);
+  current_job = &job;
+  busy_workers = num_workers;
+  generation++;
+  pthread_cond_broadcast(&pool_wake);
+  pthread_mutex_unlock(&pool_lock);
+
+  run_chunks(&job);
+
+  pthread_mutex_lock(&pool_lock);
+  while (busy_workers > 0)
+    pthread_cond_wait(&pool_done, &pool_lock);
+  current_job = NULL;
+  pthread_mutex_unlock(&pool_lock);
+
+  pthread_mutex_unlock(&submit_lock);
+}
@@ -0,0 +1,363 @@
+/*
+ * NexusQ-AI - Cache-Blocked Execution
+ * File: modules/quantum/qvm_tile.c
+ *
+ * Past the L2 size, every fused block is a pass over DRAM. The tile
+ * scheduler turns a fused program into steps that each make one pass:
+ *  - TILE: a group of blocks whose qubits all sit below tile_qubits runs
+ *    back to back on one 2^tile_qubits-amplitude tile before the next, so
+ *    the group costs one pass instead of one per block;
+ *  - SWEEP: a block on a high qubit, run over the whole statevector;
+ *  - SWAP: exchanges a high physical qubit with a low one so the blocks
+ *    that follow can join tiles (a permutation touching half the state).
+ * Blocks that share no qubit commute, so a group also takes later blocks
+ * past the ones left out, as long as they avoid those blocks' qubits.
+ * Swapped qubits are put back before a measurement and at the end, so
+ * the caller always sees the logical qubit order.
+ */
+
+#include "include/qvm.h"
+#include "include/qvm_threads.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TILE_MIN_QUBITS 3 // CCX needs three local qubits
+#define TILE_MAX_QUBITS 24
+#define TILE_WINDOW 4096  // Blocks scanned past the first pending one
+#define TILE_LOOKAHEAD 64 // Blocks weighed when choosing a swap
+#define TILE_SWAP_GAIN 2  // Sweeps saved before a swap pays for itself
+
+// --- Configuration ---
+
+static int tile_width = -2; // -2 = not read from the environment yet
+
+static int clamp_width(int k) {
+  if (k < 0)
+    return -1;
+  if (k == 0)
+    return 0;
+  return k < TILE_MIN_QUBITS ? TILE_MIN_QUBITS
+                             : (k > TILE_MAX_QUBITS ? TILE_MAX_QUBITS : k);
+}
+
+static int configured_width(void) {
+  if (tile_width == -2) {
+    const char *env = getenv("QVM_TILE_QUBITS");
+    tile_width = clamp_width(env ? atoi(env) : 0);
+  }
+  return tile_width;
+}
+
+void qvm_tile_configure(int tile_qubits) {
+  configured_width();
+  tile_width = clamp_width(tile_qubits);
+}
+
+int qvm_tile_qubits(int num_qubits) {
+  int k = configured_width();
+  if (k < 0)
+    return 0;
+  if (k == 0) {
+    // Half of L2, and at least one tile per thread
+    size_t amps = qvm_threads_grain(sizeof(double _Complex));
+    while (k < TILE_MAX_QUBITS && ((size_t)2 << k) <= amps)
+      k++;
+    int threads = qvm_threads_get();
+    while (k > TILE_MIN_QUBITS && num_qubits > k &&
+           ((size_t)1 << (num_qubits - k)) < (size_t)threads)
+      k--;
+    k = clamp_width(k);
+  }
+  return num_qubits > k ? k : 0;
+}
+
+// --- Planning ---
+
+typedef struct {
+  const qvm_fused_program_t *prog;
+  qvm_tile_plan_t *plan;
+  int k;
+  int phys[QVM_MAX_QUBITS];  // Physical position of each logical qubit
+  int logic[QVM_MAX_QUBITS]; // Logical qubit at each physical position
+  uint64_t *qubits;          // Logical qubits of each program block
+  int *next;                 // Pending blocks, in program order
+  int head;
+  int step_capacity;
+} tile_ctx_t;
+
+static uint64_t block_qubits(const qvm_fused_block_t *b) {
+  uint64_t m = (uint64_t)1 << b->q0;
+  if (b->kind == QVM_BLOCK_2Q)
+    m |= (uint64_t)1 << b->q1;
+  else if (b->kind == QVM_BLOCK_OP && b->op.type == GATE_CCX)
+    m |= (uint64_t)1 << b->op.control | (uint64_t)1 << b->op.control2;
+  return m;
+}
+
+// MEASURE writes `measured` by logical qubit and QFT/DIFFUSE need their
+// range contiguous: both run over the whole state in the logical order
+static int is_barrier(const qvm_fused_block_t *b) {
+  return b->kind == QVM_BLOCK_OP && b->op.type != GATE_CCX;
+}
+
+static int is_local(const tile_ctx_t *t, uint64_t qubits) {
+  for (int q = 0; q < t->prog->num_qubits; q++)
+    if (((qubits >> q) & 1) && t->phys[q] >= t->k)
+      return 0;
+  return 1;
+}
+
+static int map_qubit(const tile_ctx_t *t, int q) {
+  return q >= 0 && q < t->prog->num_qubits ? t->phys[q] : q;
+}
+
+// Copy a block onto the physical qubits of the current layout
+static void emit_block(tile_ctx_t *t, int i) {
+  const qvm_fused_block_t *in = &t->prog->blocks[i];
+  qvm_fused_block_t *out = &t->plan->blocks[t->plan->num_blocks++];
+  *out = *in;
+  out->q0 = map_qubit(t, in->q0);
+  if (in->kind == QVM_BLOCK_1Q)
+    return;
+  out->op.target = map_qubit(t, in->op.target);
+  out->op.control = map_qubit(t, in->op.control);
+  out->op.control2 = map_qubit(t, in->op.control2);
+  if (in->kind != QVM_BLOCK_2Q)
+    return;
+  out->q1 = map_qubit(t, in->q1);
+  if (out->q0 > out->q1) {
+    // The pair changed order: swap the two bits of the 4x4 basis
+    int tmp = out->q0;
+    out->q0 = out->q1;
+    out->q1 = tmp;
+    for (int r = 0; r < 4; r++)
+      for (int c = 0; c < 4; c++)
+        out->u4[(r & 1) << 1 | r >> 1][(c & 1) << 1 | c >> 1] = in->u4[r][c];
+  }
+}
+
+static qvm_tile_step_t *new_step(tile_ctx_t *t, qvm_step_kind_t kind) {
+  qvm_tile_plan_t *plan = t->plan;
+  if (plan->num_steps == t->step_capacity) {
+    int capacity = t->step_capacity ? 2 * t->step_capacity : 64;
+    qvm_tile_step_t *steps = (qvm_tile_step_t *)realloc(
+        plan->steps, (size_t)capacity * sizeof(qvm_tile_step_t));
+    if (!steps)
+      return NULL;
+    plan->steps = steps;
+    t->step_capacity = capacity;
+  }
+  qvm_tile_step_t *s = &plan->steps[plan->num_steps++];
+  memset(s, 0, sizeof(*s));
+  s->kind = kind;
+  s->first = plan->num_blocks;
+  return s;
+}
+
+static int swap_physical(tile_ctx_t *t, int p0, int p1) {
+  qvm_tile_step_t *s = new_step(t, QVM_STEP_SWAP);
+  if (!s)
+    return -1;
+  s->q0 = p0 < p1 ? p0 : p1;
+  s->q1 = p0 < p1 ? p1 : p0;
+  int l0 = t->logic[p0], l1 = t->logic[p1];
+  t->logic[p0] = l1;
+  t->logic[p1] = l0;
+  t->phys[l0] = p1;
+  t->phys[l1] = p0;
+  t->plan->passes += 0.5;
+  return 0;
+}
+
+static int restore_layout(tile_ctx_t *t) {
+  for (int p = 0; p < t->prog->num_qubits; p++)
+    if (t->logic[p] != p && swap_physical(t, p, t->phys[p]) != 0)
+      return -1;
+  return 0;
+}
+
+// The longest run of blocks that can execute tile by tile from here
+static int take_group(tile_ctx_t *t) {
+  uint64_t all = ((uint64_t)1 << t->prog->num_qubits) - 1;
+  uint64_t blocked = 0;
+  int taken = 0, scanned = 0;
+  int *link = &t->head;
+  while (*link >= 0 && scanned++ < TILE_WINDOW && blocked != all) {
+    int i = *link;
+    if (is_barrier(&t->prog->blocks[i]))
+      break;
+    if (!(t->qubits[i] & blocked) && is_local(t, t->qubits[i])) {
+      emit_block(t, i);
+      *link = t->next[i];
+      taken++;
+      continue;
+    }
+    blocked |= t->qubits[i];
+    link = &t->next[i];
+  }
+  return taken;
+}
+
+// Bring the high qubits of the first pending block down when enough of
+// the blocks ahead use them. The victims are the low qubits not in that
+// block that the blocks ahead use least, from the top of the tile down:
+// the kernels run fastest on the higher bits.
+static int swap_in(tile_ctx_t *t) {
+  int n = t->prog->num_qubits;
+  int uses[QVM_MAX_QUBITS] = {0};
+  int seen = 0;
+  for (int i = t->head; i >= 0 && seen < TILE_LOOKAHEAD; i = t->next[i]) {
+    if (is_barrier(&t->prog->blocks[i]))
+      break;
+    for (int q = 0; q < n; q++)
+      uses[q] += (t->qubits[i] >> q) & 1;
+    seen++;
+  }
+
+  uint64_t held = t->qubits[t->head];
+  for (int q = 0; q < n; q++) {
+    if (!((held >> q) & 1) || t->phys[q] < t->k)
+      continue;
+    int victim = -1;
+    for (int p = t->k - 1; p >= 0; p--) {
+      int l = t->logic[p];
+      if (!((held >> l) & 1) && (victim < 0 || uses[l] < uses[victim]))
+        victim = l;
+    }
+    if (victim < 0 || uses[q] - uses[victim] < TILE_SWAP_GAIN)
+      continue;
+    if (swap_physical(t, t->phys[q], t->phys[victim]) != 0)
+      return -1;
+  }
+  return 0;
+}
+
+int qvm_tile_plan(const qvm_fused_program_t *prog, int tile_qubits,
+                  qvm_tile_plan_t *plan) {
+  memset(plan, 0, sizeof(*plan));
+  int n = prog->num_qubits;
+  if (tile_qubits < TILE_MIN_QUBITS || tile_qubits >= n)
+    return -1;
+  plan->num_qubits = n;
+  plan->tile_qubits = tile_qubits;
+  plan->num_source_gates = prog->num_source_gates;
+
+  tile_ctx_t t = {.prog = prog, .plan = plan, .k = tile_qubits, .head = -1};
+  for (int q = 0; q < n; q++)
+    t.phys[q] = t.logic[q] = q;
+  size_t nb = (size_t)prog->num_blocks + 1;
+  plan->blocks = (qvm_fused_block_t *)malloc(nb * sizeof(qvm_fused_block_t));
+  t.qubits = (uint64_t *)malloc(nb * sizeof(uint64_t));
+  t.next = (int *)malloc(nb * sizeof(int));
+  int status = plan->blocks && t.qubits && t.next ? 0 : -1;
+  for (int i = prog->num_blocks - 1; status == 0 && i >= 0; i--) {
+    t.qubits[i] = block_qubits(&prog->blocks[i]);
+    t.next[i] = t.head;
+    t.head = i;
+  }
+
+  while (status == 0 && t.head >= 0) {
+    int first = plan->num_blocks;
+    int taken = take_group(&t);
+    if (taken > 0) {
+      qvm_tile_step_t *s = new_step(&t, QVM_STEP_TILE);
+      if (!s) {
+        status = -1;
+        break;
+      }
+      s->first = first;
+      s->count = taken;
+      plan->passes += 1.0;
+      continue;
+    }
+
+    int i = t.head;
+    if (is_barrier(&prog->blocks[i])) {
+      status = restore_layout(&t);
+    } else {
+      status = swap_in(&t);
+      if (status == 0 && is_local(&t, t.qubits[i]))
+        continue;
+    }
+    qvm_tile_step_t *s = status == 0 ? new_step(&t, QVM_STEP_SWEEP) : NULL;
+    if (!s) {
+      status = -1;
+      break;
+    }
+    s->count = 1;
+    emit_block(&t, i);
+    t.head = t.next[i];
+    plan->passes += 1.0;
+  }
+  if (status == 0)
+    status = restore_layout(&t);
+
+  free(t.qubits);
+  free(t.next);
+  if (status != 0)
+    qvm_tile_plan_free(plan);
+  return status;
+}
+
+void qvm_tile_plan_free(qvm_tile_plan_t *plan) {
+  free(plan->steps);
+  free(plan->blocks);
+  memset(plan, 0, sizeof(*plan));
+}
+
+// Every pass reads and writes the statevector once
+double qvm_tile_bytes(const qvm_tile_plan_t *plan) {
+  return plan->passes * 2.0 * sizeof(double _Complex) *
+         (double)((size_t)1 << plan->num_qubits);
+}
+
+// --- Execution ---
+
+typedef struct {
+  qvm_state_t *state;
+  const qvm_tile_plan_t *plan;
+  const qvm_tile_step_t *step;
+} tile_job_t;
+
+// Each tile is a tile_qubits-wide statevector of its own; the sweeps
+// inside it stay on this thread (nested parallel loops run inline)
+static void run_tiles(void *ctx, size_t chunk, size_t begin, size_t end) {
+  tile_job_t *job = (tile_job_t *)ctx;
+  int k = job->plan->tile_qubits;
+  for (size_t tile = begin; tile < end; tile++) {
+    qvm_state_t view = {.num_qubits = k,
+                        .amplitudes = job->state->amplitudes + (tile << k),
+                        .backend = QVM_BACKEND_STATEVECTOR};
+    for (int i = 0; i < job->step->count; i++)
+      qvm_execute_block(&view, &job->plan->blocks[job->step->first + i]);
+  }
+}
+
+void qvm_execute_tiled(qvm_state_t *state, const qvm_tile_plan_t *plan) {
+  if (state->backend != QVM_BACKEND_STATEVECTOR || !state->amplitudes ||
+      state->num_qubits != plan->num_qubits) {
+    printf("[QVM] Error: Tile plan does not match the statevector\n");
+    return;
+  }
+  for (int s = 0; s < plan->num_steps; s++) {
+    const qvm_tile_step_t *step = &plan->steps[s];
+    switch (step->kind) {
+    case QVM_STEP_TILE: {
+      tile_job_t job = {state, plan, step};
+      qvm_parallel_for((size_t)1 << (plan->num_qubits - plan->tile_qubits), 1,
+                       run_tiles, &job);
+      break;
+    }
+    case QVM_STEP_SWEEP:
+      qvm_execute_block(state, &plan->blocks[step->first]);
+      break;
+    case QVM_STEP_SWAP: {
+      qvm_gate_t swap = {.type = GATE_SWAP, .target = step->q0,
+                         .control = step->q1};
+      qvm_apply_unitary(state, &swap);
+      break;
+    }
+    }
+  }
+}
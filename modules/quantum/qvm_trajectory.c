@@ -0,0 +1,250 @@
+/*
+ * NexusQ-AI - Monte-Carlo Trajectory Engine
+ * File: modules/quantum/qvm_trajectory.c
+ *
+ * Noisy circuits beyond density-matrix range are estimated by averaging
+ * independent noisy statevector runs (Monte-Carlo wavefunction method):
+ * after every gate, noise.c draws one Kraus operator per touched qubit.
+ *
+ * Trajectories run in fixed-size batches, one trajectory per work item on
+ * the worker pool. Trajectory i draws from Philox stream i of the
+ * trajectory family under the run's seed, so results depend only on the
+ * seed, not on the thread count or scheduling. After each batch the
+ * standard errors of the outcome frequencies and of the observable are
+ * checked, and the run stops early once they are all below the target.
+ */
+
+#include "include/qvm_backend.h"
+#include "include/qvm_kernels.h"
+#include "include/qvm_threads.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TRAJ_BATCH 64
+#define TRAJ_Z95 1.959964 // Two-sided 95% normal quantile
+
+// --- One trajectory ---
+
+typedef struct {
+  const qvm_circuit_t *circuit;
+  uint64_t seed;
+  int first; // Index of the batch's first trajectory
+  int has_observable;
+  qvm_pauli_t observable;
+  uint64_t *outcomes; // Per trajectory of the batch
+  double *values;
+  int failed;
+} traj_batch_t;
+
+static int traj_measure(qvm_state_t *state, int qubit) {
+  extern int qnoise_readout_flip(qvm_state_t *state);
+  double probs[2];
+  qvm_qubit_probs(state, qubit, probs);
+  double u = qvm_rng_uniform(&state->rng);
+  int result = u * (probs[0] + probs[1]) < probs[0] ? 0 : 1;
+  if (probs[result] <= 0.0)
+    result ^= 1;
+
+  // Projector onto the outcome, renormalized, as a 2x2 sweep
+  double s = 1.0 / sqrt(probs[result]);
+  double _Complex proj[2][2] = {{result ? 0 : s, 0}, {0, result ? s : 0}};
+  qvm_apply_matrix(state, qubit, proj);
+  return result ^ qnoise_readout_flip(state);
+}
+
+// Gates go straight to the matrix sweeps: no per-gate logging or
+// telemetry from inside the workers
+static void traj_run(traj_batch_t *b, qvm_state_t *state, int index) {
+  extern void qnoise_apply(qvm_state_t *state, int qubit_idx);
+  const qvm_circuit_t *c = b->circuit;
+  uint64_t outcome = 0;
+
+  memset(state->amplitudes, 0,
+         ((size_t)1 << state->num_qubits) * sizeof(double _Complex));
+  state->amplitudes[0] = 1.0;
+  qvm_rng_init(&state->rng, b->seed, QVM_RNG_TRAJECTORIES | (uint64_t)index);
+
+  for (int i = 0; i < c->num_gates; i++) {
+    const qvm_gate_t *g = &c->gates[i];
+    if (g->type == GATE_MEASURE) {
+      int bit = traj_measure(state, g->target);
+      if (g->target < 64)
+        outcome = (outcome & ~((uint64_t)1 << g->target)) |
+                  ((uint64_t)bit << g->target);
+      continue;
+    }
+    if (qvm_apply_unitary(state, g) != 0) {
+      b->failed = 1;
+      break;
+    }
+    if (qvm_gate_is_range(g->type)) {
+      for (int q = g->control; q < g->target; q++)
+        qnoise_apply(state, q);
+    } else if (qvm_gate_is_two_qubit(g->type) || g->type == GATE_CCX) {
+      qnoise_apply(state, g->control);
+    }
+    if (g->type == GATE_CCX)
+      qnoise_apply(state, g->control2);
+    qnoise_apply(state, g->target);
+  }
+
+  b->outcomes[index - b->first] = outcome;
+  b->values[index - b->first] =
+      b->has_observable ? qvm_pauli_expectation(state, &b->observable) : 0.0;
+}
+
+// Parallel mode: every work item is a whole trajectory with its own
+// statevector; the inner sweeps run inline on the worker.
+static void sweep_trajectories(void *arg, size_t chunk, size_t begin,
+                               size_t end) {
+  traj_batch_t *b = (traj_batch_t *)arg;
+  int n = b->circuit->num_qubits;
+  qvm_state_t state = {.num_qubits = n, .backend = QVM_BACKEND_STATEVECTOR};
+  state.amplitudes =
+      (double _Complex *)malloc(((size_t)1 << n) * sizeof(double _Complex));
+  if (!state.amplitudes) {
+    b->failed = 1;
+    return;
+  }
+  for (size_t t = begin; t < end; t++)
+    traj_run(b, &state, b->first + (int)t);
+  free(state.amplitudes);
+}
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+// Largest standard error of an outcome frequency
+static double counts_error(const uint64_t *outcomes, int n) {
+  uint64_t *sorted = (uint64_t *)malloc(n * sizeof(uint64_t));
+  if (!sorted)
+    return 1.0;
+  memcpy(sorted, outcomes, n * sizeof(uint64_t));
+  qsort(sorted, n, sizeof(uint64_t), cmp_u64);
+  double worst = 0.0;
+  for (int i = 0; i < n;) {
+    int j = i;
+    while (j < n && sorted[j] == sorted[i])
+      j++;
+    double p = (double)(j - i) / n;
+    double se = sqrt(p * (1.0 - p) / n);
+    if (se > worst)
+      worst = se;
+    i = j;
+  }
+  free(sorted);
+  return worst;
+}
+
+int qvm_run_trajectories(const qvm_circuit_t *circuit,
+                         const qvm_traj_config_t *config,
+                         qvm_traj_result_t *out) {
+  memset(out, 0, sizeof(*out));
+  int n = circuit->num_qubits;
+  if (n < 1 || n > QVM_MAX_QUBITS) {
+    printf("[QVM] Trajectories: 1 to %d qubits supported\n", QVM_MAX_QUBITS);
+    return -1;
+  }
+
+  int max = config->max_trajectories > 0 ? config->max_trajectories
+                                         : QVM_DEFAULT_SHOTS;
+  for (int i = 0; i < circuit->num_gates; i++) {
+    const qvm_gate_t *g = &circuit->gates[i];
+    if (!qvm_gate_valid(g, n)) {
+      printf("[QVM] Trajectories: invalid qubit in gate %d\n", i);
+      return -1;
+    }
+  }
+
+  uint64_t seed = config->seed ? config->seed : qvm_rng_get_seed();
+  uint64_t mask;
+  qvm_terminal_measurements(circuit, &mask);
+
+  traj_batch_t b = {.circuit = circuit, .seed = seed};
+  if (config->observable) {
+    if (qvm_pauli_parse(config->observable, n, &b.observable) != 0) {
+      printf("[QVM] Trajectories: bad observable '%s'\n", config->observable);
+      return -1;
+    }
+    b.has_observable = 1;
+  }
+
+  uint64_t *outcomes = (uint64_t *)malloc(max * sizeof(uint64_t));
+  double *values = (double *)malloc(max * sizeof(double));
+  if (!outcomes || !values) {
+    free(outcomes);
+    free(values);
+    return -1;
+  }
+  qvm_kernels_select();
+
+  // One statevector per thread when they all fit in half of RAM;
+  // otherwise trajectories run one at a time on the whole pool
+  size_t bytes = ((size_t)1 << n) * sizeof(double _Complex);
+  long pages = sysconf(_SC_PHYS_PAGES), page_size = sysconf(_SC_PAGESIZE);
+  size_t ram = pages > 0 && page_size > 0 ? (size_t)pages * page_size : 0;
+  int threads = qvm_threads_get();
+  int parallel = threads > 1 && (ram == 0 || bytes * threads <= ram / 2);
+  qvm_state_t serial = {.num_qubits = n, .backend = QVM_BACKEND_STATEVECTOR};
+  if (!parallel) {
+    serial.amplitudes = (double _Complex *)malloc(bytes);
+    if (!serial.amplitudes) {
+      free(outcomes);
+      free(values);
+      return -1;
+    }
+  }
+
+  double sum = 0.0, sum_sq = 0.0;
+  int done = 0;
+  while (done < max && !b.failed) {
+    // Batches grow with the run so convergence checks stay cheap
+    int batch = done / 4 > TRAJ_BATCH ? done / 4 : TRAJ_BATCH;
+    if (batch > max - done)
+      batch = max - done;
+    b.first = done;
+    b.outcomes = outcomes + done;
+    b.values = values + done;
+    if (parallel) {
+      qvm_parallel_for(batch, 1, sweep_trajectories, &b);
+    } else {
+      for (int t = 0; t < batch; t++)
+        traj_run(&b, &serial, done + t);
+    }
+
+    for (int t = done; t < done + batch; t++) {
+      sum += values[t];
+      sum_sq += values[t] * values[t];
+    }
+    done += batch;
+
+    double mean = sum / done;
+    double var = done > 1 ? (sum_sq - done * mean * mean) / (done - 1) : 0.0;
+    out->std_error = sqrt(var > 0.0 ? var / done : 0.0);
+    out->counts_error = mask ? counts_error(outcomes, done) : 0.0;
+    out->expectation = mean;
+    if (config->target_error > 0.0 && done >= config->min_trajectories &&
+        out->std_error <= config->target_error &&
+        out->counts_error <= config->target_error) {
+      out->converged = 1;
+      break;
+    }
+  }
+  free(serial.amplitudes);
+
+  int rc = b.failed ? -1 : 0;
+  out->trajectories = done;
+  out->ci95 = TRAJ_Z95 * out->std_error;
+  if (!b.has_observable)
+    out->expectation = out->std_error = out->ci95 = 0.0;
+  if (rc == 0 && mask)
+    rc = qvm_counts_from_outcomes(outcomes, done, n, mask, &out->counts);
+  free(outcomes);
+  free(values);
+  return rc;
+}
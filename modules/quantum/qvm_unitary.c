@@ -0,0 +1,405 @@
+/*
+ * NexusQ-AI - Compiled Circuit Unitaries
+ * File: modules/quantum/qvm_unitary.c
+ *
+ * A k-qubit circuit without measurements compiles to its 2^k x 2^k
+ * unitary, which then runs as one dense k-qubit gate on any k qubits of a
+ * larger statevector. Subcircuits that run many times on different inputs
+ * (ansatz layers, teleport corrections, QEC encoders) pay for their gates
+ * once.
+ *
+ * Compiling reads the row-major matrix as a 2k-qubit statevector whose
+ * high k qubits are the row index: column c starts as the basis state |c>
+ * and the fused circuit, shifted up by k qubits, runs over every column in
+ * the same sweeps. A gate costs O(4^k) through the statevector kernels,
+ * where multiplying dense per-gate factors would cost O(8^k).
+ *
+ * Applying is a blocked complex GEMM: the 2^k amplitudes of up to
+ * UNITARY_PANEL groups are gathered into a panel (real and imaginary parts
+ * split so the inner loop vectorizes), multiplied by U in slabs of
+ * UNITARY_BLOCK rows and columns, and scattered back. Zero entries of U
+ * are skipped, so permutation-heavy unitaries stay cheap.
+ *
+ * The cache keys compiled unitaries by qvm_circuit_hash(). It keeps at most
+ * QVM_UNITARY_CACHE_SIZE of them within QVM_UNITARY_CACHE_BYTES, evicting
+ * the least recently used. Entries are refcounted: one reference belongs
+ * to the cache, one to each qvm_unitary_get() caller, so an evicted
+ * unitary still in use is freed by its last qvm_unitary_release().
+ */
+
+#include "include/qvm.h"
+#include "include/qvm_threads.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNITARY_PANEL 16 // Groups gathered per GEMM
+#define UNITARY_BLOCK 64 // Rows and columns of U per slab
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static uint64_t fnv1a(uint64_t h, const void *data, size_t size) {
+  const unsigned char *p = (const unsigned char *)data;
+  for (size_t i = 0; i < size; i++)
+    h = (h ^ p[i]) * FNV_PRIME;
+  return h;
+}
+
+// Fields are hashed one by one: qvm_gate_t has padding, and qubits a
+// gate does not use may hold anything
+uint64_t qvm_circuit_hash(const qvm_circuit_t *circuit) {
+  uint64_t h = fnv1a(FNV_OFFSET, &circuit->num_qubits, sizeof(int));
+  for (int i = 0; i < circuit->num_gates; i++) {
+    const qvm_gate_t *g = &circuit->gates[i];
+    int two = qvm_gate_is_two_qubit(g->type) || g->type == GATE_CCX ||
+              qvm_gate_is_range(g->type);
+    int fields[4] = {(int)g->type, g->target, two ? g->control : -1,
+                     g->type == GATE_CCX ? g->control2 : -1};
+    h = fnv1a(h, fields, sizeof(fields));
+    h = fnv1a(h, g->theta, sizeof(g->theta));
+  }
+  return h;
+}
+
+int qvm_compile_unitary(const qvm_circuit_t *circuit, qvm_unitary_t *out) {
+  memset(out, 0, sizeof(*out));
+  int k = circuit->num_qubits;
+  if (k < 1 || k > QVM_UNITARY_MAX_QUBITS)
+    return -1;
+
+  // Every gate moves up to the row qubits k .. 2k-1
+  qvm_circuit_t shifted;
+  qvm_circuit_init(&shifted, 2 * k);
+  for (int i = 0; i < circuit->num_gates; i++) {
+    qvm_gate_t g = circuit->gates[i];
+    if (g.type == GATE_MEASURE || !qvm_gate_valid(&g, k)) {
+      qvm_circuit_free(&shifted);
+      return -1;
+    }
+    g.target += k;
+    if (qvm_gate_is_two_qubit(g.type) || g.type == GATE_CCX ||
+        qvm_gate_is_range(g.type))
+      g.control += k;
+    if (g.type == GATE_CCX)
+      g.control2 += k;
+    if (qvm_circuit_append(&shifted, &g) != 0) {
+      qvm_circuit_free(&shifted);
+      return -1;
+    }
+  }
+  qvm_fused_program_t prog;
+  if (qvm_fuse_circuit(&shifted, &prog) != 0) {
+    qvm_circuit_free(&shifted);
+    return -1;
+  }
+  qvm_circuit_free(&shifted);
+
+  size_t dim = (size_t)1 << k;
+  out->matrix = (double _Complex *)calloc(dim * dim, sizeof(double _Complex));
+  if (!out->matrix) {
+    qvm_fused_free(&prog);
+    return -1;
+  }
+  for (size_t c = 0; c < dim; c++)
+    out->matrix[c * dim + c] = 1.0;
+
+  qvm_state_t view = {.num_qubits = 2 * k,
+                      .amplitudes = out->matrix,
+                      .backend = QVM_BACKEND_STATEVECTOR};
+  qvm_execute_fused(&view, &prog);
+  qvm_fused_free(&prog);
+
+  out->num_qubits = k;
+  out->num_gates = circuit->num_gates;
+  out->hash = qvm_circuit_hash(circuit);
+  out->refs = 1;
+  return 0;
+}
+
+void qvm_unitary_free(qvm_unitary_t *u) {
+  free(u->matrix);
+  u->matrix = NULL;
+  u->num_qubits = 0;
+}
+
+// --- Application ---
+
+typedef struct {
+  const qvm_unitary_t *u;
+  double _Complex *amps;
+  size_t dim;
+  const size_t *offset; // Statevector offset of local index l
+  int sorted[QVM_UNITARY_MAX_QUBITS]; // Target qubits, ascending
+} apply_ctx_t;
+
+// Base index of group g: g's bits with a zero inserted at each target
+static size_t group_base(const apply_ctx_t *a, size_t g) {
+  for (int j = 0; j < a->u->num_qubits; j++) {
+    int p = a->sorted[j];
+    g = ((g >> p) << (p + 1)) | (g & (((size_t)1 << p) - 1));
+  }
+  return g;
+}
+
+// y = U x over one panel; x and y are [l][UNITARY_PANEL], split. The
+// fixed panel width lets the compiler vectorize and unroll the inner loop.
+static void panel_gemm(const apply_ctx_t *a, const double *xr,
+                       const double *xi, double *yr, double *yi) {
+  size_t dim = a->dim;
+  const double _Complex *m = a->u->matrix;
+  memset(yr, 0, dim * UNITARY_PANEL * sizeof(double));
+  memset(yi, 0, dim * UNITARY_PANEL * sizeof(double));
+  for (size_t r0 = 0; r0 < dim; r0 += UNITARY_BLOCK) {
+    size_t r1 = r0 + UNITARY_BLOCK < dim ? r0 + UNITARY_BLOCK : dim;
+    for (size_t c0 = 0; c0 < dim; c0 += UNITARY_BLOCK) {
+      size_t c1 = c0 + UNITARY_BLOCK < dim ? c0 + UNITARY_BLOCK : dim;
+      for (size_t r = r0; r < r1; r++) {
+        double *outr = yr + r * UNITARY_PANEL, *outi = yi + r * UNITARY_PANEL;
+        for (size_t c = c0; c < c1; c++) {
+          double ur = creal(m[r * dim + c]), ui = cimag(m[r * dim + c]);
+          if (ur == 0.0 && ui == 0.0)
+            continue;
+          const double *inr = xr + c * UNITARY_PANEL;
+          const double *ini = xi + c * UNITARY_PANEL;
+          for (int b = 0; b < UNITARY_PANEL; b++) {
+            outr[b] += ur * inr[b] - ui * ini[b];
+            outi[b] += ur * ini[b] + ui * inr[b];
+          }
+        }
+      }
+    }
+  }
+}
+
+static void apply_range(void *arg, size_t chunk, size_t begin, size_t end) {
+  apply_ctx_t *a = (apply_ctx_t *)arg;
+  size_t dim = a->dim, span = dim * UNITARY_PANEL;
+  double *buf = (double *)calloc(4 * span, sizeof(double));
+  if (!buf)
+    return;
+  double *xr = buf, *xi = xr + span, *yr = xi + span, *yi = yr + span;
+  size_t base[UNITARY_PANEL];
+
+  // A short last panel multiplies stale columns too but never stores them
+  for (size_t g0 = begin; g0 < end; g0 += UNITARY_PANEL) {
+    size_t cols = end - g0 < UNITARY_PANEL ? end - g0 : UNITARY_PANEL;
+    for (size_t b = 0; b < cols; b++)
+      base[b] = group_base(a, g0 + b);
+    for (size_t l = 0; l < dim; l++) {
+      for (size_t b = 0; b < cols; b++) {
+        double _Complex v = a->amps[base[b] + a->offset[l]];
+        xr[l * UNITARY_PANEL + b] = creal(v);
+        xi[l * UNITARY_PANEL + b] = cimag(v);
+      }
+    }
+    panel_gemm(a, xr, xi, yr, yi);
+    for (size_t l = 0; l < dim; l++)
+      for (size_t b = 0; b < cols; b++)
+        a->amps[base[b] + a->offset[l]] =
+            yr[l * UNITARY_PANEL + b] + I * yi[l * UNITARY_PANEL + b];
+  }
+  free(buf);
+}
+
+int qvm_apply_compiled(qvm_state_t *state, const qvm_unitary_t *u,
+                       const int *qubits) {
+  int k = u->num_qubits;
+  if (state->backend != QVM_BACKEND_STATEVECTOR || !state->amplitudes ||
+      !u->matrix || k < 1 || k > state->num_qubits)
+    return -1;
+  uint64_t seen = 0;
+  for (int j = 0; j < k; j++) {
+    if (qubits[j] < 0 || qubits[j] >= state->num_qubits ||
+        (seen >> qubits[j] & 1))
+      return -1;
+    seen |= (uint64_t)1 << qubits[j];
+  }
+
+  size_t dim = (size_t)1 << k;
+  const double _Complex(*m)[2] = (const double _Complex(*)[2])u->matrix;
+  if (k == 1) {
+    qvm_apply_matrix(state, qubits[0], m);
+    return 0;
+  }
+  if (k == 2) {
+    // The 4x4 kernel wants q0 < q1: swap the local bits otherwise
+    double _Complex m4[4][4];
+    int swap = qubits[0] > qubits[1];
+    for (int r = 0; r < 4; r++) {
+      for (int c = 0; c < 4; c++) {
+        int rr = swap ? (r >> 1) | (r & 1) << 1 : r;
+        int cc = swap ? (c >> 1) | (c & 1) << 1 : c;
+        m4[r][c] = u->matrix[rr * 4 + cc];
+      }
+    }
+    qvm_apply_matrix2(state, swap ? qubits[1] : qubits[0],
+                      swap ? qubits[0] : qubits[1], m4);
+    return 0;
+  }
+
+  size_t *offset = (size_t *)malloc(dim * sizeof(size_t));
+  if (!offset)
+    return -1;
+  for (size_t l = 0; l < dim; l++) {
+    offset[l] = 0;
+    for (int j = 0; j < k; j++)
+      if (l >> j & 1)
+        offset[l] |= (size_t)1 << qubits[j];
+  }
+
+  apply_ctx_t a = {.u = u, .amps = state->amplitudes, .dim = dim};
+  a.offset = offset;
+  int num = 0;
+  for (int q = 0; q < state->num_qubits; q++)
+    if (seen >> q & 1)
+      a.sorted[num++] = q;
+
+  size_t groups = (size_t)1 << (state->num_qubits - k);
+  size_t grain = qvm_threads_grain(dim * sizeof(double _Complex));
+  qvm_parallel_for(groups, grain < UNITARY_PANEL ? UNITARY_PANEL : grain,
+                   apply_range, &a);
+  free(offset);
+  return 0;
+}
+
+// --- Cache ---
+
+typedef struct {
+  qvm_unitary_t *u; // NULL = free slot
+  uint64_t last_use;
+} cache_slot_t;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static cache_slot_t cache[QVM_UNITARY_CACHE_SIZE];
+static uint64_t cache_clock = 0;
+static qvm_unitary_cache_stats_t cache_stats;
+
+static size_t unitary_bytes(const qvm_unitary_t *u) {
+  return sizeof(double _Complex) << (2 * u->num_qubits);
+}
+
+// Drops one reference; caller holds cache_lock
+static void unref(qvm_unitary_t *u) {
+  if (--u->refs > 0)
+    return;
+  qvm_unitary_free(u);
+  free(u);
+}
+
+static void evict(int slot) {
+  cache_stats.entries--;
+  cache_stats.bytes -= unitary_bytes(cache[slot].u);
+  cache_stats.evictions++;
+  unref(cache[slot].u);
+  cache[slot].u = NULL;
+}
+
+static int lookup(const qvm_circuit_t *circuit, uint64_t hash) {
+  for (int i = 0; i < QVM_UNITARY_CACHE_SIZE; i++) {
+    qvm_unitary_t *u = cache[i].u;
+    if (u && u->hash == hash && u->num_qubits == circuit->num_qubits &&
+        u->num_gates == circuit->num_gates)
+      return i;
+  }
+  return -1;
+}
+
+// Room for `bytes` more: LRU entries go until both limits hold
+static int make_room(size_t bytes) {
+  for (;;) {
+    int free_slot = -1, oldest = -1;
+    for (int i = 0; i < QVM_UNITARY_CACHE_SIZE; i++) {
+      if (!cache[i].u)
+        free_slot = i;
+      else if (oldest < 0 || cache[i].last_use < cache[oldest].last_use)
+        oldest = i;
+    }
+    if (free_slot >= 0 &&
+        cache_stats.bytes + bytes <= QVM_UNITARY_CACHE_BYTES)
+      return free_slot;
+    if (oldest < 0)
+      return -1;
+    evict(oldest);
+  }
+}
+
+const qvm_unitary_t *qvm_unitary_get(const qvm_circuit_t *circuit) {
+  uint64_t hash = qvm_circuit_hash(circuit);
+  pthread_mutex_lock(&cache_lock);
+  int slot = lookup(circuit, hash);
+  if (slot >= 0) {
+    qvm_unitary_t *u = cache[slot].u;
+    cache[slot].last_use = ++cache_clock;
+    u->refs++;
+    cache_stats.hits++;
+    pthread_mutex_unlock(&cache_lock);
+    return u;
+  }
+  cache_stats.misses++;
+  pthread_mutex_unlock(&cache_lock);
+
+  // Compiled outside the lock; a racing thread may insert it first
+  qvm_unitary_t *u = (qvm_unitary_t *)malloc(sizeof(qvm_unitary_t));
+  if (!u)
+    return NULL;
+  if (qvm_compile_unitary(circuit, u) != 0) {
+    free(u);
+    return NULL;
+  }
+
+  pthread_mutex_lock(&cache_lock);
+  slot = lookup(circuit, hash);
+  if (slot >= 0) {
+    qvm_unitary_t *won = cache[slot].u;
+    won->refs++;
+    pthread_mutex_unlock(&cache_lock);
+    qvm_unitary_free(u);
+    free(u);
+    return won;
+  }
+  size_t bytes = unitary_bytes(u);
+  slot = bytes <= QVM_UNITARY_CACHE_BYTES ? make_room(bytes) : -1;
+  if (slot >= 0) {
+    cache[slot].u = u;
+    cache[slot].last_use = ++cache_clock;
+    u->refs++;
+    cache_stats.entries++;
+    cache_stats.bytes += bytes;
+  }
+  pthread_mutex_unlock(&cache_lock);
+  return u;
+}
+
+void qvm_unitary_release(const qvm_unitary_t *u) {
+  if (!u)
+    return;
+  pthread_mutex_lock(&cache_lock);
+  unref((qvm_unitary_t *)u);
+  pthread_mutex_unlock(&cache_lock);
+}
+
+int qvm_apply_subcircuit(qvm_state_t *state, const qvm_circuit_t *circuit,
+                         const int *qubits) {
+  const qvm_unitary_t *u = qvm_unitary_get(circuit);
+  if (!u)
+    return -1;
+  int rc = qvm_apply_compiled(state, u, qubits);
+  qvm_unitary_release(u);
+  return rc;
+}
+
+void qvm_unitary_cache_stats(qvm_unitary_cache_stats_t *out) {
+  pthread_mutex_lock(&cache_lock);
+  *out = cache_stats;
+  pthread_mutex_unlock(&cache_lock);
+}
+
+void qvm_unitary_cache_clear(void) {
+  pthread_mutex_lock(&cache_lock);
+  for (int i = 0; i < QVM_UNITARY_CACHE_SIZE; i++)
+    if (cache[i].u)
+      evict(i);
+  memset(&cache_stats, 0, sizeof(cache_stats));
+  pthread_mutex_unlock(&cache_lock);
+}
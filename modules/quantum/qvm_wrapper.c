@@ -16,11 +16,12 @@ void qvm_execute_from_text(const char *circuit_text) {
   qvm_init(&state, circuit.num_qubits);
 
   // Execute
-  qvm_execute_circuit(&state, &circuit);
+  qvm_execute_circuit(&state, &circuit, 0);
 
   // Print results
   qvm_print_state(&state);
 
   // Cleanup
   qvm_free(&state);
+  qvm_circuit_free(&circuit);
 }
@@ -3,6 +3,7 @@
  * File: modules/quantum/repeater.c
  */
 
+#include "include/qvm.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -17,7 +18,7 @@ int repeater_swap_entanglement(int pair_id_left, int pair_id_right) {
   // 1. Bell State Measurement (BSM)
   printf("[REPEATER] Performing BSM on local qubits...\n");
   // Simulate probabilistic outcome of BSM
-  int bsm_outcome = rand() % 4; // 00, 01, 10, 11
+  int bsm_outcome = qvm_rng_below(qvm_rng_thread(), 4); // 00, 01, 10, 11
 
   // 2. Classical Communication (Corrections)
   printf("[REPEATER] BSM Outcome: %d. Sending corrections to end nodes...\n",
@@ -27,7 +28,7 @@ int repeater_swap_entanglement(int pair_id_left, int pair_id_right) {
   // In a real simulation, we'd calculate the new fidelity.
   // F_new approx F_left * F_right
 
-  int new_pair_id = 300 + (rand() % 100);
+  int new_pair_id = 300 + qvm_rng_below(qvm_rng_thread(), 100);
   printf("[REPEATER] Swapping Complete. New Virtual Link Established: Pair ID "
          "%d.\n",
          new_pair_id);
@@ -3,6 +3,7 @@
  * File: modules/quantum/tomography.c
  */
 
+#include "include/qvm.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -31,7 +32,7 @@ double tomography_measure_fidelity(int target_node) {
   int correct_measurements = 0;
   for (int i = 0; i < probes; i++) {
     // Random chance of error
-    double r = (double)rand() / RAND_MAX;
+    double r = qvm_rng_uniform(qvm_rng_thread());
     if (r > error_rate) {
       correct_measurements++;
     }
@@ -42,7 +43,7 @@ double tomography_measure_fidelity(int target_node) {
   double fidelity = (double)correct_measurements / probes;
 
   // Add some quantum fluctuation
-  fidelity += ((rand() % 100) - 50) / 10000.0;
+  fidelity += ((int)qvm_rng_below(qvm_rng_thread(), 100) - 50) / 10000.0;
   if (fidelity > 1.0)
     fidelity = 1.0;
   if (fidelity < 0.0)
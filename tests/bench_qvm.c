@@ -0,0 +1,1416 @@
+/*
+ * NexusQ-AI - QVM Gate Throughput Benchmark
+ * File: tests/bench_qvm.c
+ *
+ * Measures single-qubit gate throughput (gates/sec) from 10 to 16 qubits.
+ * The "before" column is the original scratch-buffer kernel (calloc a 2^n
+ * vector, branch per element, memcpy back), kept here as the regression
+ * reference. The remaining columns go through qvm_apply_gate with each
+ * kernel table the CPU supports (scalar, AVX2, AVX-512). A second table
+ * shows thread scaling of the same sweep at BENCH_MT_QUBITS, and the last
+ * one compares BENCH_SHOTS shots drawn by qvm_sample() with re-running the
+ * circuit once per shot. The stabilizer table times GHZ preparation and a
+ * full readout on the tableau backend at sizes no statevector can hold.
+ * The MPS table runs a shallow nearest-neighbour brickwork circuit (H/T
+ * layers and CNOTs) at 25-100 qubits and reports bond dimension and memory.
+ * The density table compares n-qubit density-matrix gates under
+ * depolarizing noise with ideal gates on a 2n-qubit statevector, which
+ * holds the same number of amplitudes. The trajectory table times noisy
+ * Monte-Carlo trajectories at BENCH_TRAJ_QUBITS against the thread count.
+ * The parser table reports circuit-text throughput in MB/s for the
+ * original line-copy + sscanf parser (kept here as the reference), the
+ * in-place tokenizer, and loading the same circuit from its .qcb form.
+ * The variational, gradient and batch tables time optimizer-style loops:
+ * re-binding a parsed QAOA circuit, adjoint versus parameter-shift
+ * gradients, and BENCH_BATCH bound circuits submitted one at a time
+ * through qvm_execute_from_text versus one qvm_execute_batch() call.
+ * The RNG table compares 53-bit uniforms built from two rand() calls (the
+ * former sampler source) with Philox draws, one at a time and in bulk.
+ * The precision table runs the same U3/CNOT sequence on double and
+ * single-precision statevectors and reports gates/sec and the fidelity
+ * |<double|single>|^2 (normalized) at the end. The gate-form table times
+ * diagonal and permutation gates at BENCH_FORM_QUBITS through the generic
+ * matrix kernels (SWAP as three CNOTs, CCX as its 15-gate decomposition)
+ * and through their phase and index-swap kernels. The out-of-core table
+ * runs H/CNOT/RZ layers at BENCH_OOC_QUBITS from a scratch file for
+ * several chunk sizes and reports passes, reordering swaps and amplitude
+ * traffic in GB/s (a file that fits the page cache is served from RAM).
+ * The expectation table evaluates Ising-style Hamiltonians at
+ * BENCH_EXPECT_QUBITS one term per sweep and fused by qvm_expectation(),
+ * and times the BENCH_SHOTS-shot sample a Z-only estimate would need.
+ */
+
+#include "../modules/quantum/include/qvm.h"
+#include "../modules/quantum/include/qvm_kernels.h"
+#include <complex.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_MIN_QUBITS 10
+#define BENCH_MAX_QUBITS 16
+#define BENCH_MIN_SECONDS 0.25
+#define BENCH_MT_QUBITS 22
+#define BENCH_SHOTS 10000
+#define BENCH_MPS_LAYERS 4
+#define BENCH_TRAJ_QUBITS 16
+#define BENCH_TRAJECTORIES 128
+#define BENCH_PARSE_GATES 500000
+#define BENCH_QAOA_QUBITS 8
+#define BENCH_GRAD_QUBITS 12
+#define BENCH_BATCH 256
+#define BENCH_RNG_DRAWS (1 << 22)
+#define BENCH_SINGLE_MIN_QUBITS 16
+#define BENCH_SINGLE_MAX_QUBITS 24
+#define BENCH_FORM_QUBITS 22
+#define BENCH_OOC_QUBITS 26
+#define BENCH_OOC_LAYERS 2
+#define BENCH_EXPECT_QUBITS 22
+#define BENCH_TILE_MIN_QUBITS 20
+#define BENCH_TILE_MAX_QUBITS 24
+#define BENCH_TILE_LAYERS 4
+#define BENCH_SPARSE_QUBITS 24
+#define BENCH_UNITARY_QUBITS 20
+#define BENCH_UNITARY_LAYERS 8
+#define BENCH_MACRO_MIN_QUBITS 16
+#define BENCH_MACRO_MAX_QUBITS 22
+#define BENCH_HSF_LAYERS 6
+#define BENCH_HSF_AMPLITUDES 1024
+
+static double now_sec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Reference: the pre-in-place kernel
+static void legacy_single_gate(qvm_state_t *state, int target,
+                               double _Complex matrix[2][2]) {
+  int size = 1 << state->num_qubits;
+  double _Complex *new_amps =
+      (double _Complex *)calloc(size, sizeof(double _Complex));
+
+  for (int i = 0; i < size; i++) {
+    int bit = (i >> target) & 1;
+    int i0 = i & ~(1 << target);
+    int i1 = i | (1 << target);
+
+    if (bit == 0) {
+      new_amps[i] = matrix[0][0] * state->amplitudes[i0] +
+                    matrix[0][1] * state->amplitudes[i1];
+    } else {
+      new_amps[i] = matrix[1][0] * state->amplitudes[i0] +
+                    matrix[1][1] * state->amplitudes[i1];
+    }
+  }
+
+  memcpy(state->amplitudes, new_amps, size * sizeof(double _Complex));
+  free(new_amps);
+}
+
+static double bench_legacy(qvm_state_t *state) {
+  double _Complex H[2][2] = {{1.0 / sqrt(2), 1.0 / sqrt(2)},
+                             {1.0 / sqrt(2), -1.0 / sqrt(2)}};
+  long gates = 0;
+  double start = now_sec(), elapsed;
+  do {
+    for (int q = 0; q < state->num_qubits; q++)
+      legacy_single_gate(state, q, H);
+    gates += state->num_qubits;
+    elapsed = now_sec() - start;
+  } while (elapsed < BENCH_MIN_SECONDS);
+  return gates / elapsed;
+}
+
+static double bench_inplace(qvm_state_t *state) {
+  long gates = 0;
+  double start = now_sec(), elapsed;
+  do {
+    for (int q = 0; q < state->num_qubits; q++) {
+      qvm_gate_t h = {.type = GATE_H, .target = q, .control = -1};
+      qvm_apply_gate(state, &h);
+    }
+    gates += state->num_qubits;
+    elapsed = now_sec() - start;
+  } while (elapsed < BENCH_MIN_SECONDS);
+  return gates / elapsed;
+}
+
+// Layers of H on every qubit, then one CNOT ladder
+static void build_sample_circuit(qvm_circuit_t *c, int n) {
+  qvm_circuit_init(c, n);
+  c->shots = BENCH_SHOTS;
+  for (int q = 0; q < n; q++)
+    qvm_circuit_append(c, &(qvm_gate_t){GATE_H, q, -1});
+  for (int q = 0; q + 1 < n; q++)
+    qvm_circuit_append(c, &(qvm_gate_t){GATE_CNOT, q + 1, q});
+}
+
+static void bench_sampling() {
+  printf("\nSampling %d shots (one evolution vs one run per shot)\n",
+         BENCH_SHOTS);
+  printf("%-7s | %12s | %12s | %9s\n", "Qubits", "Rerun (s)", "Sample (s)",
+         "Speedup");
+  printf("────────┼──────────────┼──────────────┼──────────\n");
+
+  for (int n = BENCH_MIN_QUBITS; n <= BENCH_MAX_QUBITS; n += 2) {
+    qvm_circuit_t c;
+    build_sample_circuit(&c, n);
+    qvm_state_t state;
+
+    // Per-shot reruns, extrapolated from a few runs
+    int runs = 0;
+    double start = now_sec(), elapsed;
+    do {
+      qvm_init(&state, n);
+      for (int i = 0; i < c.num_gates; i++)
+        qvm_apply_gate(&state, &c.gates[i]);
+      qvm_free(&state);
+      runs++;
+      elapsed = now_sec() - start;
+    } while (elapsed < BENCH_MIN_SECONDS);
+    double rerun = elapsed / runs * BENCH_SHOTS;
+
+    qvm_counts_t counts;
+    qvm_init(&state, n);
+    start = now_sec();
+    qvm_sample_circuit(&state, &c, BENCH_SHOTS, &counts);
+    double sampled = now_sec() - start;
+    qvm_counts_free(&counts);
+    qvm_free(&state);
+    qvm_circuit_free(&c);
+
+    printf("%-7d | %12.3f | %12.4f | %8.0fx\n", n, rerun, sampled,
+           rerun / sampled);
+  }
+}
+
+static void bench_stabilizer() {
+  printf("\nStabilizer backend: GHZ + measure all qubits\n");
+  printf("%-7s | %12s | %12s | %12s\n", "Qubits", "Gates (ms)", "Measure (ms)",
+         "Tableau (KB)");
+  printf("────────┼──────────────┼──────────────┼─────────────\n");
+
+  for (int n = 500; n <= 4000; n *= 2) {
+    qvm_state_t state;
+    qvm_init_backend(&state, n, QVM_BACKEND_STABILIZER);
+    double start = now_sec();
+    qvm_gate_t h = {GATE_H, 0, -1};
+    qvm_apply_gate(&state, &h);
+    for (int q = 1; q < n; q++) {
+      qvm_gate_t cx = {GATE_CNOT, q, q - 1};
+      qvm_apply_gate(&state, &cx);
+    }
+    double gates = now_sec() - start;
+    start = now_sec();
+    for (int q = 0; q < n; q++)
+      qvm_measure(&state, q);
+    double measure = now_sec() - start;
+    qvm_free(&state);
+
+    size_t words = (n + 63) / 64;
+    printf("%-7d | %12.2f | %12.2f | %12zu\n", n, gates * 1e3, measure * 1e3,
+           ((size_t)(2 * n + 1) * words * 16) >> 10);
+  }
+}
+
+static void bench_mps() {
+  printf("\nMPS backend: %d-layer brickwork + %d shots\n", BENCH_MPS_LAYERS,
+         BENCH_SHOTS);
+  printf("%-7s | %12s | %12s | %8s | %12s\n", "Qubits", "Gates (ms)",
+         "Sample (ms)", "Bond", "MPS (KB)");
+  printf("────────┼──────────────┼──────────────┼──────────┼─────────────\n");
+
+  for (int n = 25; n <= 100; n *= 2) {
+    qvm_state_t state;
+    qvm_init_backend(&state, n, QVM_BACKEND_MPS);
+    double start = now_sec();
+    for (int layer = 0; layer < BENCH_MPS_LAYERS; layer++) {
+      for (int q = 0; q < n; q++) {
+        qvm_gate_t g = {(q + layer) % 2 ? GATE_T : GATE_H, q, -1};
+        qvm_apply_gate(&state, &g);
+      }
+      for (int q = layer % 2; q + 1 < n; q += 2) {
+        qvm_gate_t cx = {GATE_CNOT, q + 1, q};
+        qvm_apply_gate(&state, &cx);
+      }
+    }
+    double gates = now_sec() - start;
+    qvm_counts_t counts;
+    start = now_sec();
+    qvm_sample(&state, BENCH_SHOTS, &counts);
+    double sample = now_sec() - start;
+    qvm_counts_free(&counts);
+
+    qvm_mps_stats_t st;
+    qvm_mps_stats(&state, &st);
+    qvm_free(&state);
+    printf("%-7d | %12.2f | %12.2f | %8d | %12zu\n", n, gates * 1e3,
+           sample * 1e3, st.max_bond, st.bytes >> 10);
+  }
+}
+
+static void bench_density() {
+  extern void qnoise_set(int type, float probability);
+
+  printf("\nDensity matrix + depolarizing noise vs 2n-qubit statevector\n");
+  printf("%-7s | %12s | %12s | %9s\n", "Qubits", "Ideal 2n",
+         "Noisy n", "Slowdown");
+  printf("────────┼──────────────┼──────────────┼──────────\n");
+
+  for (int n = 6; n <= 12; n += 2) {
+    qvm_state_t sv, dm;
+    qvm_init(&sv, 2 * n);
+    double ideal = bench_inplace(&sv);
+    qvm_free(&sv);
+
+    qnoise_set(3, 0.01f);
+    qvm_init_backend(&dm, n, QVM_BACKEND_DENSITY);
+    double noisy = bench_inplace(&dm);
+    qvm_free(&dm);
+    qnoise_set(0, 0.0f);
+
+    printf("%-7d | %12.0f | %12.0f | %8.1fx\n", n, ideal, noisy,
+           ideal / noisy);
+  }
+}
+
+static void bench_trajectories() {
+  extern void qnoise_set(int type, float probability);
+  int n = BENCH_TRAJ_QUBITS;
+  qvm_circuit_t c;
+  qvm_circuit_init(&c, n);
+  for (int layer = 0; layer < 4; layer++) {
+    qvm_gate_type_t type = layer % 2 ? GATE_T : GATE_H;
+    for (int q = 0; q < n; q++)
+      qvm_circuit_append(&c, &(qvm_gate_t){type, q, -1});
+    for (int q = layer % 2; q + 1 < n; q += 2)
+      qvm_circuit_append(&c, &(qvm_gate_t){GATE_CNOT, q + 1, q});
+  }
+  for (int q = 0; q < n; q++)
+    qvm_circuit_append(&c, &(qvm_gate_t){GATE_MEASURE, q, -1});
+
+  printf("\nTrajectories: %d qubits, %d gates, depolarizing p=0.01\n", n,
+         c.num_gates);
+  printf("%-7s | %12s | %7s\n", "Threads", "Traj/s", "Speedup");
+  printf("────────┼──────────────┼────────\n");
+  qnoise_set(3, 0.01f);
+  qvm_traj_config_t config = {.max_trajectories = BENCH_TRAJECTORIES,
+                              .seed = 1};
+  int max_threads = qvm_threads_get();
+  double base = 0.0;
+  for (int t = 1; t <= max_threads; t *= 2) {
+    qvm_threads_set(t);
+    qvm_traj_result_t result;
+    double start = now_sec();
+    qvm_run_trajectories(&c, &config, &result);
+    double rate = result.trajectories / (now_sec() - start);
+    qvm_counts_free(&result.counts);
+    if (t == 1)
+      base = rate;
+    printf("%-7d | %12.1f | %6.2fx\n", t, rate, rate / base);
+  }
+  qvm_threads_set(0);
+  qnoise_set(0, 0.0f);
+  qvm_circuit_free(&c);
+}
+
+// Reference: the pre-tokenizer parser (line copy, sscanf, strcmp chain)
+static void legacy_parse(const char *text, qvm_circuit_t *circuit) {
+  qvm_circuit_init(circuit, 0);
+  char line[256];
+  const char *ptr = text;
+  while (*ptr) {
+    while (*ptr == '#' || *ptr == '\n' || *ptr == ' ') {
+      if (*ptr == '#') {
+        while (*ptr && *ptr != '\n')
+          ptr++;
+      }
+      if (*ptr)
+        ptr++;
+    }
+    if (!*ptr)
+      break;
+    int i = 0;
+    while (*ptr && *ptr != '\n' && i < 255)
+      line[i++] = *ptr++;
+    line[i] = '\0';
+
+    char name[32];
+    qvm_gate_t g = {GATE_H, 0, -1};
+    if (sscanf(line, "QUBITS %d", &circuit->num_qubits) == 1 ||
+        sscanf(line, "SHOTS %d", &circuit->shots) == 1)
+      continue;
+    if (sscanf(line, "CNOT %d %d", &g.control, &g.target) == 2) {
+      g.type = GATE_CNOT;
+    } else if (sscanf(line, "%31s %d", name, &g.target) == 2) {
+      if (strcmp(name, "H") == 0)
+        g.type = GATE_H;
+      else if (strcmp(name, "X") == 0)
+        g.type = GATE_X;
+      else if (strcmp(name, "Y") == 0)
+        g.type = GATE_Y;
+      else if (strcmp(name, "Z") == 0)
+        g.type = GATE_Z;
+      else if (strcmp(name, "T") == 0)
+        g.type = GATE_T;
+      else if (strcmp(name, "S") == 0)
+        g.type = GATE_S;
+      else if (strcmp(name, "MEASURE") == 0 || strcmp(name, "M") == 0)
+        g.type = GATE_MEASURE;
+      else
+        continue;
+    } else {
+      continue;
+    }
+    qvm_circuit_append(circuit, &g);
+  }
+}
+
+static void bench_parser() {
+  const char *names[] = {"H", "X", "Y", "Z", "T", "S"};
+  size_t cap = 32 + (size_t)BENCH_PARSE_GATES * 16;
+  char *text = (char *)malloc(cap);
+  size_t len = (size_t)sprintf(text, "# bench\nQUBITS 20\n");
+  for (int i = 0; i < BENCH_PARSE_GATES; i++) {
+    if (i % 4 == 3)
+      len += (size_t)sprintf(text + len, "CNOT %d %d\n", i % 20,
+                             (i + 7) % 20);
+    else
+      len += (size_t)sprintf(text + len, "%s %d\n", names[i % 6], i % 20);
+  }
+  double mb = len / 1e6;
+
+  qvm_circuit_t c;
+  double start = now_sec();
+  legacy_parse(text, &c);
+  double legacy = now_sec() - start;
+  int legacy_gates = c.num_gates;
+  qvm_circuit_free(&c);
+
+  start = now_sec();
+  qvm_parse_circuit(text, &c);
+  double tokenized = now_sec() - start;
+
+  void *qcb;
+  size_t size;
+  qvm_qcb_encode(&c, qvm_qcb_hash(text, len), &qcb, &size);
+  qvm_circuit_free(&c);
+  start = now_sec();
+  qvm_qcb_load(qcb, size, &c);
+  double loaded = now_sec() - start;
+  int ok = c.num_gates == legacy_gates && legacy_gates == BENCH_PARSE_GATES;
+  qvm_circuit_free(&c);
+  free(qcb);
+  free(text);
+
+  printf("\nCircuit loading: %d gates, %.1f MB of text (.qcb %.1f MB)%s\n",
+         BENCH_PARSE_GATES, mb, size / 1e6, ok ? "" : " MISMATCH");
+  printf("%-10s | %12s | %9s\n", "Path", "MB/s", "Speedup");
+  printf("───────────┼──────────────┼──────────\n");
+  printf("%-10s | %12.1f | %8.1fx\n", "sscanf", mb / legacy, 1.0);
+  printf("%-10s | %12.1f | %8.1fx\n", "tokenizer", mb / tokenized,
+         legacy / tokenized);
+  printf("%-10s | %12.1f | %8.1fx\n", ".qcb", mb / loaded, legacy / loaded);
+}
+
+// Depth-1 QAOA on a ring; angles are "%s" formats filled per iteration
+static size_t qaoa_text(char *buf, const char *gamma, const char *beta) {
+  size_t len = (size_t)sprintf(buf, "QUBITS %d\n", BENCH_QAOA_QUBITS);
+  for (int q = 0; q < BENCH_QAOA_QUBITS; q++)
+    len += (size_t)sprintf(buf + len, "H %d\n", q);
+  for (int q = 0; q < BENCH_QAOA_QUBITS; q++)
+    len += (size_t)sprintf(buf + len, "RZZ(-%s) %d %d\n", gamma, q,
+                           (q + 1) % BENCH_QAOA_QUBITS);
+  for (int q = 0; q < BENCH_QAOA_QUBITS; q++)
+    len += (size_t)sprintf(buf + len, "RX(2*%s) %d\n", beta, q);
+  return len;
+}
+
+// Optimizer iterations per second: text regenerated and parsed for each
+// parameter point, versus one parse and a re-bind per point
+static void bench_variational() {
+  char text[4096], gamma[32], beta[32];
+  qvm_state_t state;
+  qvm_init(&state, BENCH_QAOA_QUBITS);
+
+  int iters = 0;
+  double start = now_sec(), elapsed;
+  do {
+    snprintf(gamma, sizeof(gamma), "%.17g", 0.1 + 1e-6 * iters);
+    snprintf(beta, sizeof(beta), "%.17g", 0.2 - 1e-6 * iters);
+    qaoa_text(text, gamma, beta);
+    qvm_circuit_t c;
+    qvm_fused_program_t prog;
+    qvm_parse_circuit(text, &c);
+    qvm_reset(&state);
+    if (qvm_fuse_circuit(&c, &prog) == 0) {
+      qvm_execute_fused(&state, &prog);
+      qvm_fused_free(&prog);
+    }
+    qvm_circuit_free(&c);
+    iters++;
+  } while ((elapsed = now_sec() - start) < BENCH_MIN_SECONDS);
+  double reparse = iters / elapsed;
+  double _Complex reparsed = state.amplitudes[1];
+
+  qvm_circuit_t c;
+  qaoa_text(text, "p0", "p1");
+  qvm_parse_circuit(text, &c);
+  iters = 0;
+  start = now_sec();
+  do {
+    double params[2] = {0.1 + 1e-6 * iters, 0.2 - 1e-6 * iters};
+    qvm_execute_bound(&state, &c, params, 2);
+    iters++;
+  } while ((elapsed = now_sec() - start) < BENCH_MIN_SECONDS);
+  double rebind = iters / elapsed;
+
+  int binds = 0;
+  start = now_sec();
+  do {
+    double params[2] = {0.1 + 1e-6 * binds, 0.2};
+    qvm_bind_parameters(&c, params, 2);
+    binds++;
+  } while ((elapsed = now_sec() - start) < BENCH_MIN_SECONDS);
+
+  // Same final parameter point reached both ways?
+  double params[2] = {0.1 + 1e-6 * (iters - 1), 0.2 - 1e-6 * (iters - 1)};
+  snprintf(gamma, sizeof(gamma), "%.17g", params[0]);
+  snprintf(beta, sizeof(beta), "%.17g", params[1]);
+  qaoa_text(text, gamma, beta);
+  qvm_circuit_t ref;
+  qvm_parse_circuit(text, &ref);
+  qvm_execute_bound(&state, &ref, NULL, 0);
+  double _Complex expected = state.amplitudes[1];
+  qvm_execute_bound(&state, &c, params, 2);
+  int ok = cabs(state.amplitudes[1] - expected) < 1e-12 && reparsed != 0.0;
+  qvm_circuit_free(&ref);
+  qvm_circuit_free(&c);
+  qvm_free(&state);
+
+  printf("\nVariational loop: %d-qubit QAOA ring, %d gates%s\n",
+         BENCH_QAOA_QUBITS, 3 * BENCH_QAOA_QUBITS, ok ? "" : " MISMATCH");
+  printf("%-10s | %12s | %9s\n", "Path", "Iter/s", "Speedup");
+  printf("───────────┼──────────────┼──────────\n");
+  printf("%-10s | %12.1f | %8.1fx\n", "re-parse", reparse, 1.0);
+  printf("%-10s | %12.1f | %8.1fx\n", "re-bind", rebind, rebind / reparse);
+  printf("Binding alone: %.2f M/s\n", binds / elapsed / 1e6);
+}
+
+// Layered RY + CNOT-chain ansatz, one parameter per rotation
+static void grad_ansatz(qvm_circuit_t *c, int layers) {
+  qvm_circuit_init(c, BENCH_GRAD_QUBITS);
+  for (int l = 0; l < layers; l++) {
+    for (int q = 0; q < BENCH_GRAD_QUBITS; q++) {
+      qvm_gate_t ry = {GATE_RY, q, -1};
+      qvm_circuit_append(c, &ry);
+      qvm_circuit_add_angle(c, c->num_gates - 1, 0, c->num_params, 1.0, 0.0);
+    }
+    for (int q = 0; q + 1 < BENCH_GRAD_QUBITS; q++) {
+      qvm_gate_t cx = {GATE_CNOT, q + 1, q};
+      qvm_circuit_append(c, &cx);
+    }
+  }
+}
+
+// Seconds per call of one forward pass and of a full gradient each way:
+// the adjoint cost should stay a small multiple of the forward pass while
+// parameter shift grows with the parameter count
+static void bench_gradient() {
+  const int layer_counts[] = {1, 2, 4, 8};
+  qvm_state_t state;
+  qvm_init(&state, BENCH_GRAD_QUBITS);
+
+  printf("\nGradients: %d-qubit RY + CNOT ansatz, <Z...Z>\n",
+         BENCH_GRAD_QUBITS);
+  printf("%6s | %6s | %11s | %11s | %11s | %7s\n", "Layers", "Params",
+         "Forward ms", "Adjoint ms", "Shift ms", "Adj/Fwd");
+  printf("───────┼────────┼─────────────┼─────────────┼─────────────┼────────\n");
+  char obs[BENCH_GRAD_QUBITS + 1];
+  memset(obs, 'Z', BENCH_GRAD_QUBITS);
+  obs[BENCH_GRAD_QUBITS] = '\0';
+  for (size_t i = 0; i < sizeof(layer_counts) / sizeof(layer_counts[0]); i++) {
+    qvm_circuit_t c;
+    grad_ansatz(&c, layer_counts[i]);
+    int n = c.num_params;
+    double *params = (double *)malloc(n * sizeof(double));
+    double *adj = (double *)malloc(n * sizeof(double));
+    double *shift = (double *)malloc(n * sizeof(double));
+    for (int k = 0; k < n; k++)
+      params[k] = 0.1 * (k % 7) - 0.25;
+
+    double t[3], value;
+    for (int m = 0; m < 3; m++) {
+      int iters = 0;
+      double start = now_sec(), elapsed;
+      do {
+        if (m == 0)
+          qvm_execute_bound(&state, &c, params, n);
+        else
+          qvm_gradient(&c, params, n, obs,
+                       m == 1 ? QVM_GRAD_ADJOINT : QVM_GRAD_SHIFT, &value,
+                       m == 1 ? adj : shift);
+        iters++;
+      } while ((elapsed = now_sec() - start) < BENCH_MIN_SECONDS);
+      t[m] = elapsed / iters * 1e3;
+    }
+    double err = 0.0;
+    for (int k = 0; k < n; k++)
+      err = fmax(err, fabs(adj[k] - shift[k]));
+
+    printf("%6d | %6d | %11.3f | %11.3f | %11.3f | %6.1fx%s\n",
+           layer_counts[i], n, t[0], t[1], t[2], t[1] / t[0],
+           err < 1e-9 ? "" : " MISMATCH");
+    free(params);
+    free(adj);
+    free(shift);
+    qvm_circuit_free(&c);
+  }
+  qvm_free(&state);
+}
+
+// QAOA bindings per second: each one as its own qvm_execute_from_text
+// call (stdout silenced), versus one batch of the parsed circuit
+static void bench_batch() {
+  char text[4096], gamma[32], beta[32];
+  double(*bindings)[2] = malloc(BENCH_BATCH * sizeof(*bindings));
+  const qvm_circuit_t **circuits = malloc(BENCH_BATCH * sizeof(*circuits));
+  const double **params = malloc(BENCH_BATCH * sizeof(*params));
+  qvm_batch_result_t *results = malloc(BENCH_BATCH * sizeof(*results));
+  qvm_circuit_t c;
+  qaoa_text(text, "p0", "p1");
+  strcat(text, "MEASURE 0\nMEASURE 1\n");
+  qvm_parse_circuit(text, &c);
+  for (int i = 0; i < BENCH_BATCH; i++) {
+    bindings[i][0] = 0.01 * i;
+    bindings[i][1] = 0.3 - 0.001 * i;
+    circuits[i] = &c;
+    params[i] = bindings[i];
+  }
+
+  fflush(stdout);
+  int saved = dup(STDOUT_FILENO);
+  FILE *null = fopen("/dev/null", "w");
+  dup2(fileno(null), STDOUT_FILENO);
+  double start = now_sec();
+  for (int i = 0; i < BENCH_BATCH; i++) {
+    snprintf(gamma, sizeof(gamma), "%.17g", bindings[i][0]);
+    snprintf(beta, sizeof(beta), "%.17g", bindings[i][1]);
+    qaoa_text(text, gamma, beta);
+    strcat(text, "MEASURE 0\nMEASURE 1\n");
+    qvm_execute_from_text(text);
+  }
+  double single = BENCH_BATCH / (now_sec() - start);
+  fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+  fclose(null);
+
+  printf("\nBatch: %d bindings of the %d-qubit QAOA ring, %d shots each\n",
+         BENCH_BATCH, BENCH_QAOA_QUBITS, QVM_DEFAULT_SHOTS);
+  printf("%-14s | %12s | %9s\n", "Path", "Circuits/s", "Speedup");
+  printf("───────────────┼──────────────┼──────────\n");
+  printf("%-14s | %12.1f | %8.1fx\n", "one at a time", single, 1.0);
+  int max_threads = qvm_threads_get();
+  for (int t = 1; t <= max_threads; t *= 2) {
+    qvm_threads_set(t);
+    qvm_execute_batch(circuits, params, results, BENCH_BATCH, NULL); // Warm
+    for (int i = 0; i < BENCH_BATCH; i++)
+      qvm_counts_free(&results[i].counts);
+    int batches = 0;
+    double elapsed;
+    start = now_sec();
+    do {
+      qvm_execute_batch(circuits, params, results, BENCH_BATCH, NULL);
+      for (int i = 0; i < BENCH_BATCH; i++)
+        qvm_counts_free(&results[i].counts);
+      batches++;
+    } while ((elapsed = now_sec() - start) < BENCH_MIN_SECONDS);
+    double rate = batches * BENCH_BATCH / elapsed;
+    char label[32];
+    snprintf(label, sizeof(label), "batch, %d thr", t);
+    printf("%-14s | %12.1f | %8.1fx\n", label, rate, rate / single);
+  }
+  qvm_threads_set(0);
+  qvm_circuit_free(&c);
+  free(bindings);
+  free(circuits);
+  free(params);
+  free(results);
+}
+
+static void bench_rng() {
+  double *u = malloc(BENCH_RNG_DRAWS * sizeof(double));
+  volatile double sink = 0.0;
+  srand(1);
+  double start = now_sec();
+  for (int i = 0; i < BENCH_RNG_DRAWS; i++) {
+    double hi = (double)(rand() & 0x3FFFFFF);
+    double lo = (double)(rand() & 0x7FFFFFF);
+    u[i] = (hi * 134217728.0 + lo + 0.5) / 9007199254740992.0;
+  }
+  double legacy = BENCH_RNG_DRAWS / (now_sec() - start) / 1e6;
+  sink += u[BENCH_RNG_DRAWS - 1];
+
+  qvm_rng_t rng;
+  qvm_rng_init(&rng, 1, 0);
+  start = now_sec();
+  for (int i = 0; i < BENCH_RNG_DRAWS; i++)
+    u[i] = qvm_rng_uniform(&rng);
+  double single = BENCH_RNG_DRAWS / (now_sec() - start) / 1e6;
+  sink += u[BENCH_RNG_DRAWS - 1];
+
+  printf("\nRNG: %d uniforms in (0, 1)\n", BENCH_RNG_DRAWS);
+  printf("%-14s | %12s | %9s\n", "Source", "M draws/s", "Speedup");
+  printf("───────────────┼──────────────┼──────────\n");
+  printf("%-14s | %12.1f | %8.1fx\n", "rand() x2", legacy, 1.0);
+  printf("%-14s | %12.1f | %8.1fx\n", "philox, 1 by 1", single,
+         single / legacy);
+  int max_threads = qvm_threads_get();
+  for (int t = 1; t <= max_threads; t *= 2) {
+    qvm_threads_set(t);
+    start = now_sec();
+    qvm_rng_fill_uniform(&rng, u, BENCH_RNG_DRAWS);
+    double bulk = BENCH_RNG_DRAWS / (now_sec() - start) / 1e6;
+    sink += u[BENCH_RNG_DRAWS - 1];
+    char label[32];
+    snprintf(label, sizeof(label), "fill, %d thr", t);
+    printf("%-14s | %12.1f | %8.1fx\n", label, bulk, bulk / legacy);
+  }
+  qvm_threads_set(0);
+  free(u);
+  (void)sink;
+}
+
+// Gate g of the precision workload: U3 layers with a CNOT ladder
+static qvm_gate_t single_bench_gate(int g, int n) {
+  qvm_gate_t gate = {GATE_U3, g % n, -1, {0.3 + 1e-3 * g, 0.7, -0.4}};
+  if ((g / n) % 2) {
+    gate.type = GATE_CNOT;
+    gate.control = g % n;
+    gate.target = (g + 1) % n;
+  }
+  return gate;
+}
+
+static void bench_single() {
+  printf("\nPrecision: U3 + CNOT layers, double vs single statevector\n");
+  printf("%-7s | %12s | %12s | %7s | %12s\n", "Qubits", "double g/s",
+         "single g/s", "Speedup", "1 - fidelity");
+  printf("────────┼──────────────┼──────────────┼─────────┼─────────────\n");
+  for (int n = BENCH_SINGLE_MIN_QUBITS; n <= BENCH_SINGLE_MAX_QUBITS;
+       n += 4) {
+    size_t size = (size_t)1 << n;
+    double _Complex *a = malloc(size * sizeof(double _Complex));
+    double _Complex *b = malloc(size * sizeof(double _Complex));
+    qvm_state_t ref, sp;
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    FILE *null = fopen("/dev/null", "w");
+    dup2(fileno(null), STDOUT_FILENO);
+    qvm_init(&ref, n);
+    qvm_init_precision(&sp, n, QVM_PRECISION_SINGLE);
+
+    // Double sets the gate count, single replays the same gates
+    int gates = 0;
+    double start = now_sec(), t_double, t_single;
+    do {
+      for (int i = 0; i < n; i++, gates++) {
+        qvm_gate_t g = single_bench_gate(gates, n);
+        qvm_apply_gate(&ref, &g);
+      }
+    } while ((t_double = now_sec() - start) < BENCH_MIN_SECONDS);
+    start = now_sec();
+    for (int i = 0; i < gates; i++) {
+      qvm_gate_t g = single_bench_gate(i, n);
+      qvm_apply_gate(&sp, &g);
+    }
+    t_single = now_sec() - start;
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    fclose(null);
+
+    double infidelity = -1.0;
+    if (a && b && qvm_get_amplitudes(&ref, a) == 0 &&
+        qvm_get_amplitudes(&sp, b) == 0) {
+      double _Complex overlap = 0;
+      double na = 0.0, nb = 0.0;
+      for (size_t i = 0; i < size; i++) {
+        overlap += conj(a[i]) * b[i];
+        na += creal(a[i] * conj(a[i]));
+        nb += creal(b[i] * conj(b[i]));
+      }
+      double f = cabs(overlap) * cabs(overlap) / (na * nb);
+      infidelity = f < 1.0 ? 1.0 - f : 0.0; // Rounding can push f past 1
+    }
+    printf("%-7d | %12.0f | %12.0f | %6.2fx | %12.2e\n", n, gates / t_double,
+           gates / t_single, t_double / t_single, infidelity);
+    qvm_free(&ref);
+    qvm_free(&sp);
+    free(a);
+    free(b);
+  }
+}
+
+// One gate through the generic kernels: 2x2 on the target, CNOT as a
+// controlled X, other 2-qubit gates as a 4x4
+static void matrix_sweep(qvm_state_t *state, const qvm_gate_t *g) {
+  static const double _Complex x[2][2] = {{0, 1}, {1, 0}};
+  const qvm_kernel_ops_t *k = qvm_kernels_get();
+  size_t pairs = (size_t)1 << (state->num_qubits - 1);
+  double _Complex m2[2][2], m4[4][4];
+  int lo = g->control < g->target ? g->control : g->target;
+  int hi = g->control < g->target ? g->target : g->control;
+  if (qvm_gate_unitary(g, m2) == 0) {
+    k->apply_2x2(state->amplitudes, g->target, 0, pairs, m2);
+  } else if (g->type == GATE_CNOT) {
+    k->apply_ctrl_2x2(state->amplitudes, g->control, g->target, 0,
+                      pairs / 2, x);
+  } else if (g->type == GATE_SWAP) {
+    qvm_gate_t cx[3] = {{GATE_CNOT, hi, lo}, {GATE_CNOT, lo, hi},
+                        {GATE_CNOT, hi, lo}};
+    for (int i = 0; i < 3; i++)
+      matrix_sweep(state, &cx[i]);
+  } else if (g->type == GATE_CCX) {
+    // Same sequence as qvm_backend_ccx
+    int a = g->control, b = g->control2, c = g->target;
+    qvm_gate_t seq[15] = {{GATE_H, c, -1},
+                          {GATE_CNOT, c, b},
+                          {GATE_U3, c, -1, {0, 0, -M_PI_4}},
+                          {GATE_CNOT, c, a},
+                          {GATE_T, c, -1},
+                          {GATE_CNOT, c, b},
+                          {GATE_U3, c, -1, {0, 0, -M_PI_4}},
+                          {GATE_CNOT, c, a},
+                          {GATE_T, b, -1},
+                          {GATE_T, c, -1},
+                          {GATE_H, c, -1},
+                          {GATE_CNOT, b, a},
+                          {GATE_T, a, -1},
+                          {GATE_U3, b, -1, {0, 0, -M_PI_4}},
+                          {GATE_CNOT, b, a}};
+    for (int i = 0; i < 15; i++)
+      matrix_sweep(state, &seq[i]);
+  } else if (qvm_gate_matrix2(g, lo, m4) == 0) {
+    k->apply_4x4(state->amplitudes, lo, hi, 0, pairs / 2, m4);
+  }
+}
+
+static void bench_forms() {
+  const int n = BENCH_FORM_QUBITS;
+  const struct {
+    const char *name;
+    qvm_gate_t gate;
+  } cases[] = {
+      {"Z", {GATE_Z, 7, -1}},
+      {"T", {GATE_T, 7, -1}},
+      {"RZ", {GATE_RZ, 7, -1, {0.3}}},
+      {"CZ", {GATE_CZ, 7, 15}},
+      {"CPHASE", {GATE_CPHASE, 7, 15, {0.3}}},
+      {"RZZ", {GATE_RZZ, 7, 15, {0.3}}},
+      {"X", {GATE_X, 7, -1}},
+      {"CNOT", {GATE_CNOT, 7, 15}},
+      {"SWAP", {GATE_SWAP, 7, 15}},
+      {"CCX", {GATE_CCX, 7, 15, {0}, 3}},
+  };
+  const int num_cases = sizeof(cases) / sizeof(cases[0]);
+  printf("\nGate forms at %d qubits: generic matrix kernels vs "
+         "phase/permutation\n",
+         n);
+  printf("%-7s | %12s | %12s | %7s\n", "Gate", "Matrix g/s", "Native g/s",
+         "Speedup");
+  printf("────────┼──────────────┼──────────────┼────────\n");
+  qvm_state_t state;
+  qvm_init(&state, n);
+  for (int i = 0; i < num_cases; i++) {
+    long reps = 0;
+    double start = now_sec(), t_matrix, t_native;
+    do {
+      matrix_sweep(&state, &cases[i].gate);
+      reps++;
+    } while ((t_matrix = now_sec() - start) < BENCH_MIN_SECONDS);
+    start = now_sec();
+    for (long r = 0; r < reps; r++) {
+      qvm_gate_t g = cases[i].gate;
+      qvm_apply_gate(&state, &g);
+    }
+    t_native = now_sec() - start;
+    printf("%-7s | %12.1f | %12.1f | %6.2fx\n", cases[i].name, reps / t_matrix,
+           reps / t_native, t_matrix / t_native);
+  }
+  qvm_free(&state);
+}
+
+// H, CNOT ladder and RZ over every qubit
+static int ooc_layers(qvm_state_t *state) {
+  int n = state->num_qubits, gates = 0;
+  for (int layer = 0; layer < BENCH_OOC_LAYERS; layer++) {
+    for (int q = 0; q < n; q++, gates++) {
+      qvm_gate_t h = {GATE_H, q, -1};
+      qvm_apply_gate(state, &h);
+    }
+    for (int q = 1; q < n; q++, gates++) {
+      qvm_gate_t cx = {GATE_CNOT, q, q - 1};
+      qvm_apply_gate(state, &cx);
+    }
+    for (int q = 0; q < n; q++, gates++) {
+      qvm_gate_t rz = {GATE_RZ, q, -1, {0.1 * (q + 1)}};
+      qvm_apply_gate(state, &rz);
+    }
+  }
+  return gates;
+}
+
+static void bench_ooc() {
+  const int n = BENCH_OOC_QUBITS;
+  const int chunks[] = {18, 20, 22};
+  printf("\nOut-of-core statevector at %d qubits (%d MB scratch file)\n", n,
+         (int)((((size_t)1 << n) * sizeof(double _Complex)) >> 20));
+  printf("%-7s | %12s | %6s | %5s | %8s | %6s | %9s\n", "Chunk", "Gates/s",
+         "Passes", "Swaps", "GB moved", "GB/s", "Read wait");
+  printf("────────┼──────────────┼────────┼───────┼──────────┼────────┼──────"
+         "─────\n");
+  qvm_state_t state;
+  qvm_init(&state, n);
+  double start = now_sec();
+  int gates = ooc_layers(&state);
+  double t = now_sec() - start;
+  qvm_free(&state);
+  printf("%-7s | %12.1f | %6s | %5s | %8s | %6s | %9s\n", "in RAM",
+         gates / t, "-", "-", "-", "-", "-");
+
+  for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+    qvm_ooc_configure(NULL, chunks[i]);
+    qvm_init_backend(&state, n, QVM_BACKEND_OUT_OF_CORE);
+    if (state.num_qubits == 0)
+      return;
+    start = now_sec();
+    gates = ooc_layers(&state);
+    // Drain the queue: sampling reads every chunk once more
+    qvm_counts_t counts;
+    if (qvm_sample(&state, 16, &counts) == 0)
+      qvm_counts_free(&counts);
+    t = now_sec() - start;
+    qvm_ooc_stats_t st;
+    qvm_ooc_stats(&state, &st);
+    printf("%-7d | %12.1f | %6ld | %5ld | %8.2f | %6.2f | %8.0f%%\n",
+           chunks[i], gates / t, st.passes, st.swaps,
+           (st.bytes_read + st.bytes_written) / 1e9, st.gbps,
+           st.seconds > 0.0 ? 100.0 * st.io_wait / st.seconds : 0.0);
+    qvm_free(&state);
+  }
+  qvm_ooc_configure(NULL, QVM_OOC_DEFAULT_CHUNK);
+}
+
+static double expect_ms(const qvm_state_t *state, const char *const *terms,
+                        int num_terms, int fused) {
+  long reps = 0;
+  double value, t, start = now_sec();
+  do {
+    if (fused) {
+      qvm_expectation(state, terms, NULL, num_terms, &value);
+    } else {
+      for (int k = 0; k < num_terms; k++)
+        qvm_expectation(state, &terms[k], NULL, 1, &value);
+    }
+    reps++;
+  } while ((t = now_sec() - start) < BENCH_MIN_SECONDS);
+  return 1000.0 * t / reps;
+}
+
+static void bench_expectation() {
+  const int n = BENCH_EXPECT_QUBITS;
+  // Z_i Z_i+1 ring plus Z_i fields, then X_i fields
+  char(*strings)[BENCH_EXPECT_QUBITS + 1] = calloc(3 * n, sizeof(*strings));
+  const char **terms = malloc(3 * n * sizeof(char *));
+  for (int i = 0; i < 3 * n; i++) {
+    memset(strings[i], 'I', n);
+    int q = i % n;
+    if (i < n) {
+      strings[i][q] = strings[i][(q + 1) % n] = 'Z';
+    } else {
+      strings[i][q] = i < 2 * n ? 'Z' : 'X';
+    }
+    terms[i] = strings[i];
+  }
+  const struct {
+    const char *name;
+    int first, count;
+  } cases[] = {{"ZZ ring + Z", 0, 2 * n}, {"X field", 2 * n, n},
+               {"All terms", 0, 3 * n}};
+
+  printf("\nPauli expectation at %d qubits: one sweep per term vs fused\n",
+         n);
+  printf("%-11s | %5s | %11s | %11s | %7s\n", "Hamiltonian", "Terms",
+         "Per-term ms", "Fused ms", "Speedup");
+  printf("────────────┼───────┼─────────────┼─────────────┼────────\n");
+  qvm_state_t state;
+  qvm_init(&state, n);
+  for (int q = 0; q < n; q++) {
+    qvm_gate_t ry = {GATE_RY, q, -1, {0.1 * (q + 1)}};
+    qvm_apply_gate(&state, &ry);
+  }
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    const char *const *t = terms + cases[i].first;
+    double single = expect_ms(&state, t, cases[i].count, 0);
+    double fused = expect_ms(&state, t, cases[i].count, 1);
+    printf("%-11s | %5d | %11.2f | %11.2f | %6.1fx\n", cases[i].name,
+           cases[i].count, single, fused, single / fused);
+  }
+
+  // The sampled alternative for the Z terms
+  long reps = 0;
+  double t, start = now_sec();
+  do {
+    qvm_counts_t counts;
+    if (qvm_sample(&state, BENCH_SHOTS, &counts) == 0)
+      qvm_counts_free(&counts);
+    reps++;
+  } while ((t = now_sec() - start) < BENCH_MIN_SECONDS);
+  printf("%d-shot sample (estimate only): %.2f ms\n", BENCH_SHOTS,
+         1000.0 * t / reps);
+  qvm_free(&state);
+  free(terms);
+  free(strings);
+}
+
+// RY layer, CNOT ladder and RZ layer: every fused block is one pass
+// unless it runs inside a tile
+static void tile_circuit(qvm_circuit_t *c, int n) {
+  qvm_circuit_init(c, n);
+  for (int layer = 0; layer < BENCH_TILE_LAYERS; layer++) {
+    for (int q = 0; q < n; q++) {
+      qvm_gate_t ry = {GATE_RY, q, -1, {0.1 * (q + layer + 1)}};
+      qvm_circuit_append(c, &ry);
+    }
+    for (int q = 1; q < n; q++) {
+      qvm_gate_t cx = {GATE_CNOT, q, q - 1};
+      qvm_circuit_append(c, &cx);
+    }
+    for (int q = 0; q < n; q++) {
+      qvm_gate_t rz = {GATE_RZ, q, -1, {0.2 * (q + 1)}};
+      qvm_circuit_append(c, &rz);
+    }
+  }
+}
+
+static double fused_ms(qvm_state_t *state, const qvm_fused_program_t *prog) {
+  long reps = 0;
+  double t, start = now_sec();
+  do {
+    qvm_execute_fused(state, prog);
+    reps++;
+  } while ((t = now_sec() - start) < BENCH_MIN_SECONDS);
+  return 1000.0 * t / reps;
+}
+
+static void bench_tiles() {
+  printf("\nCache-blocked execution (%d layers of RY, CNOT ladder, RZ)\n",
+         BENCH_TILE_LAYERS);
+  printf("%-7s | %4s | %13s | %16s | %9s | %9s | %7s\n", "Qubits", "Tile",
+         "Passes", "MB/gate", "Fused ms", "Tiled ms", "Speedup");
+  printf("────────┼──────┼───────────────┼──────────────────┼───────────┼────"
+         "───────┼────────\n");
+  for (int n = BENCH_TILE_MIN_QUBITS; n <= BENCH_TILE_MAX_QUBITS; n += 2) {
+    qvm_circuit_t c;
+    qvm_fused_program_t prog;
+    qvm_tile_plan_t plan;
+    tile_circuit(&c, n);
+    int k = qvm_tile_qubits(n);
+    if (k == 0 || qvm_fuse_circuit(&c, &prog) != 0) {
+      qvm_circuit_free(&c);
+      continue;
+    }
+    if (qvm_tile_plan(&prog, k, &plan) != 0) {
+      qvm_fused_free(&prog);
+      qvm_circuit_free(&c);
+      continue;
+    }
+    qvm_state_t state;
+    qvm_init(&state, n);
+    qvm_tile_configure(-1);
+    double untiled = fused_ms(&state, &prog);
+    qvm_tile_configure(0);
+    double tiled = fused_ms(&state, &prog);
+    double pass_mb = 2.0 * sizeof(double _Complex) * ((size_t)1 << n) / 1e6;
+    printf("%-7d | %4d | %4d -> %5.1f | %6.2f -> %6.2f | %9.2f | %9.2f | "
+           "%6.1fx\n",
+           n, k, prog.num_blocks, plan.passes,
+           pass_mb * prog.num_blocks / c.num_gates,
+           qvm_tile_bytes(&plan) / 1e6 / c.num_gates, untiled, tiled,
+           untiled / tiled);
+    qvm_free(&state);
+    qvm_tile_plan_free(&plan);
+    qvm_fused_free(&prog);
+    qvm_circuit_free(&c);
+  }
+}
+
+// GHZ ladder with T phases and an RX every 6 qubits: support 2^5
+static void sparse_circuit(qvm_circuit_t *c, int n) {
+  qvm_circuit_init(c, n);
+  qvm_gate_t h = {GATE_H, 0, -1};
+  qvm_circuit_append(c, &h);
+  for (int q = 1; q < n; q++) {
+    qvm_gate_t cx = {GATE_CNOT, q, q - 1};
+    qvm_gate_t t = {GATE_T, q, -1};
+    qvm_gate_t rx = {GATE_RX, q, -1, {0.3 * q}};
+    qvm_circuit_append(c, &cx);
+    qvm_circuit_append(c, &t);
+    if (q % 6 == 0)
+      qvm_circuit_append(c, &rx);
+  }
+}
+
+static double circuit_ms(qvm_backend_t backend, const qvm_circuit_t *c) {
+  long reps = 0;
+  double t, start = now_sec();
+  do {
+    qvm_state_t state;
+    qvm_init_backend(&state, c->num_qubits, backend);
+    for (int i = 0; i < c->num_gates; i++)
+      qvm_apply_gate(&state, &c->gates[i]);
+    qvm_free(&state);
+    reps++;
+  } while ((t = now_sec() - start) < BENCH_MIN_SECONDS);
+  return 1000.0 * t / reps;
+}
+
+static void bench_sparse() {
+  const int n = BENCH_SPARSE_QUBITS;
+  qvm_circuit_t c;
+  sparse_circuit(&c, n);
+  qvm_state_t state;
+  qvm_init_backend(&state, n, QVM_BACKEND_SPARSE);
+  for (int i = 0; i < c.num_gates; i++)
+    qvm_apply_gate(&state, &c.gates[i]);
+  qvm_sparse_stats_t st;
+  qvm_sparse_stats(&state, &st);
+  qvm_free(&state);
+
+  printf("\nLow-support circuit at %d qubits (%d gates, support %zu)\n", n,
+         c.num_gates, st.support);
+  printf("%-11s | %10s | %7s\n", "Backend", "Run ms", "Speedup");
+  printf("────────────┼────────────┼────────\n");
+  double dense = circuit_ms(QVM_BACKEND_STATEVECTOR, &c);
+  double sparse = circuit_ms(QVM_BACKEND_SPARSE, &c);
+  printf("%-11s | %10.2f | %6.1fx\n", "statevector", dense, 1.0);
+  printf("%-11s | %10.3f | %6.0fx\n", "sparse", sparse, dense / sparse);
+  qvm_circuit_free(&c);
+}
+
+// Ansatz layers: RY and RZ on every qubit, then a CNOT ring
+static void ansatz_circuit(qvm_circuit_t *c, int k) {
+  qvm_circuit_init(c, k);
+  for (int layer = 0; layer < BENCH_UNITARY_LAYERS; layer++) {
+    for (int q = 0; q < k; q++) {
+      qvm_gate_t ry = {GATE_RY, q, -1, {0.1 * (q + layer)}};
+      qvm_gate_t rz = {GATE_RZ, q, -1, {0.2 * (q + layer)}};
+      qvm_circuit_append(c, &ry);
+      qvm_circuit_append(c, &rz);
+    }
+    for (int q = 0; q < k; q++) {
+      qvm_gate_t cx = {GATE_CNOT, (q + 1) % k, q};
+      qvm_circuit_append(c, &cx);
+    }
+  }
+}
+
+static void bench_unitary() {
+  const int n = BENCH_UNITARY_QUBITS;
+  printf("\nCompiled subcircuits on a %d-qubit state (%d ansatz layers)\n",
+         n, BENCH_UNITARY_LAYERS);
+  printf("%-6s | %5s | %10s | %10s | %11s | %10s | %7s\n", "Qubits",
+         "Gates", "Gates ms", "Fused ms", "Compiled ms", "Compile ms",
+         "Speedup");
+  printf("───────┼───────┼────────────┼────────────┼─────────────┼───────────"
+         "─┼────────\n");
+  qvm_state_t state;
+  qvm_init(&state, n);
+  for (int k = 3; k <= 6; k++) {
+    qvm_circuit_t sub, wide;
+    ansatz_circuit(&sub, k);
+    // Every other qubit of the state
+    int qubits[6];
+    for (int j = 0; j < k; j++)
+      qubits[j] = 2 * j + 1;
+    qvm_circuit_init(&wide, n);
+    for (int i = 0; i < sub.num_gates; i++) {
+      qvm_gate_t g = sub.gates[i];
+      g.target = qubits[g.target];
+      if (g.type == GATE_CNOT)
+        g.control = qubits[g.control];
+      qvm_circuit_append(&wide, &g);
+    }
+    qvm_fused_program_t prog;
+    qvm_fuse_circuit(&wide, &prog);
+
+    long reps = 0;
+    double t, start = now_sec();
+    do {
+      for (int i = 0; i < wide.num_gates; i++)
+        qvm_apply_unitary(&state, &wide.gates[i]);
+      reps++;
+    } while ((t = now_sec() - start) < BENCH_MIN_SECONDS);
+    double gates = 1000.0 * t / reps;
+    double fused = fused_ms(&state, &prog);
+
+    qvm_unitary_t u;
+    reps = 0;
+    start = now_sec();
+    do {
+      qvm_compile_unitary(&sub, &u);
+      qvm_unitary_free(&u);
+      reps++;
+    } while ((t = now_sec() - start) < BENCH_MIN_SECONDS);
+    double compile = 1000.0 * t / reps;
+
+    reps = 0;
+    start = now_sec();
+    do {
+      qvm_apply_subcircuit(&state, &sub, qubits);
+      reps++;
+    } while ((t = now_sec() - start) < BENCH_MIN_SECONDS);
+    double compiled = 1000.0 * t / reps;
+
+    printf("%-6d | %5d | %10.2f | %10.2f | %11.2f | %10.3f | %6.1fx\n", k,
+           sub.num_gates, gates, fused, compiled, compile, fused / compiled);
+    qvm_fused_free(&prog);
+    qvm_circuit_free(&wide);
+    qvm_circuit_free(&sub);
+  }
+  qvm_free(&state);
+  qvm_unitary_cache_clear();
+}
+
+// QFT and diffusion over the whole register as gate sequences
+static void qft_gates(qvm_circuit_t *c, int n) {
+  qvm_circuit_init(c, n);
+  for (int j = n - 1; j >= 0; j--) {
+    qvm_gate_t h = {GATE_H, j, -1};
+    qvm_circuit_append(c, &h);
+    for (int k = j - 1; k >= 0; k--) {
+      qvm_gate_t cp = {GATE_CPHASE, j, k, {M_PI / ldexp(1.0, j - k)}};
+      qvm_circuit_append(c, &cp);
+    }
+  }
+  for (int j = 0; j < n / 2; j++) {
+    qvm_gate_t sw = {GATE_SWAP, n - 1 - j, j};
+    qvm_circuit_append(c, &sw);
+  }
+}
+
+static double macro_ms(qvm_state_t *state, const qvm_gate_t *gates, int n,
+                       int diffuse) {
+  long reps = 0;
+  double t, start = now_sec();
+  do {
+    for (int i = 0; i < n; i++)
+      qvm_apply_unitary(state, &gates[i]);
+    if (diffuse) // H X on every qubit, then the MCZ, then X H
+      qvm_apply_mcphase(state, ((uint64_t)1 << state->num_qubits) - 1, -1);
+    for (int i = 0; diffuse && i < n; i++)
+      qvm_apply_unitary(state, &gates[n - 1 - i]);
+    reps++;
+  } while ((t = now_sec() - start) < BENCH_MIN_SECONDS);
+  return 1000.0 * t / reps;
+}
+
+static void bench_macro() {
+  printf("\nQFT and Grover diffusion over the whole register\n");
+  printf("%-6s | %11s | %11s | %9s | %7s | %13s | %10s | %7s\n", "Qubits",
+         "QFT gates", "QFT fused", "QFT op", "Speedup", "Diffuse gates",
+         "Diffuse op", "Speedup");
+  printf("───────┼─────────────┼─────────────┼───────────┼─────────┼──────────"
+         "─────┼────────────┼────────\n");
+  for (int n = BENCH_MACRO_MIN_QUBITS; n <= BENCH_MACRO_MAX_QUBITS;
+       n += 2) {
+    qvm_state_t state;
+    qvm_init(&state, n);
+    qvm_circuit_t c;
+    qft_gates(&c, n);
+    qvm_fused_program_t prog;
+    qvm_fuse_circuit(&c, &prog);
+    double gates = macro_ms(&state, c.gates, c.num_gates, 0);
+    double fused = fused_ms(&state, &prog);
+    qvm_gate_t qft = {GATE_QFT, n - 1, 0};
+    double op = macro_ms(&state, &qft, 1, 0);
+    qvm_fused_free(&prog);
+    qvm_circuit_free(&c);
+
+    qvm_gate_t hx[2 * QVM_MAX_QUBITS];
+    for (int q = 0; q < n; q++) {
+      hx[2 * q] = (qvm_gate_t){GATE_H, q, -1};
+      hx[2 * q + 1] = (qvm_gate_t){GATE_X, q, -1};
+    }
+    double diff_gates = macro_ms(&state, hx, 2 * n, 1);
+    qvm_gate_t diffuse = {GATE_DIFFUSE, n - 1, 0};
+    double diff_op = macro_ms(&state, &diffuse, 1, 0);
+    qvm_free(&state);
+
+    printf("%-6d | %11.2f | %11.2f | %9.2f | %6.1fx | %13.2f | %10.2f | "
+           "%6.1fx\n",
+           n, gates, fused, op, fused / op, diff_gates, diff_op,
+           diff_gates / diff_op);
+  }
+}
+
+// Two brickwork halves, RY and RZ on every qubit and a CNOT chain per
+// layer, joined by one CZ across the middle after each of the first
+// cut_gates layers
+static void split_circuit(qvm_circuit_t *c, int n, int cut_gates) {
+  int cut = n / 2;
+  qvm_circuit_init(c, n);
+  for (int layer = 0; layer < BENCH_HSF_LAYERS; layer++) {
+    for (int q = 0; q < n; q++) {
+      qvm_gate_t ry = {GATE_RY, q, -1, {0.1 * (q + layer) + 0.3}};
+      qvm_gate_t rz = {GATE_RZ, q, -1, {0.2 * (q + layer)}};
+      qvm_circuit_append(c, &ry);
+      qvm_circuit_append(c, &rz);
+    }
+    for (int q = 1; q < n; q++) {
+      qvm_gate_t cx = {GATE_CNOT, q, q - 1};
+      if (q != cut)
+        qvm_circuit_append(c, &cx);
+    }
+    qvm_gate_t cz = {GATE_CZ, cut, cut - 1};
+    if (layer < cut_gates)
+      qvm_circuit_append(c, &cz);
+  }
+}
+
+static void bench_hsf() {
+  const struct {
+    int n, cut_gates;
+  } rows[] = {{18, 2}, {20, 2}, {20, 4}, {22, 4}, {40, 2}};
+  uint64_t bits[BENCH_HSF_AMPLITUDES];
+  double _Complex amps[BENCH_HSF_AMPLITUDES];
+  printf("\nHybrid Schrödinger-Feynman, %d amplitudes of a split circuit\n",
+         BENCH_HSF_AMPLITUDES);
+  printf("%-6s | %9s | %5s | %14s | %9s | %7s\n", "Qubits", "Cut gates",
+         "Paths", "Statevector ms", "HSF ms", "Speedup");
+  printf("───────┼───────────┼───────┼────────────────┼───────────┼────────\n");
+  for (size_t r = 0; r < sizeof(rows) / sizeof(rows[0]); r++) {
+    int n = rows[r].n;
+    qvm_circuit_t c;
+    split_circuit(&c, n, rows[r].cut_gates);
+    qvm_hsf_stats_t stats;
+    qvm_hsf_plan(&c, 0, &stats);
+    for (int i = 0; i < BENCH_HSF_AMPLITUDES; i++)
+      bits[i] = (0x9e3779b97f4a7c15ULL * (i + 1)) >> (64 - n);
+
+    double dense = 0.0;
+    if (n <= QVM_MAX_QUBITS) {
+      qvm_fused_program_t prog;
+      qvm_fuse_circuit(&c, &prog);
+      long reps = 0;
+      double start = now_sec();
+      do {
+        qvm_state_t state;
+        qvm_init(&state, n);
+        qvm_execute_fused(&state, &prog);
+        for (int i = 0; i < BENCH_HSF_AMPLITUDES; i++)
+          amps[i] = state.amplitudes[bits[i]];
+        qvm_free(&state);
+        reps++;
+      } while ((dense = now_sec() - start) < BENCH_MIN_SECONDS);
+      dense = 1000.0 * dense / reps;
+      qvm_fused_free(&prog);
+    }
+    long reps = 0;
+    double hsf, start = now_sec();
+    do {
+      qvm_hsf_amplitudes(&c, 0, bits, BENCH_HSF_AMPLITUDES, amps);
+      reps++;
+    } while ((hsf = now_sec() - start) < BENCH_MIN_SECONDS);
+    hsf = 1000.0 * hsf / reps;
+
+    if (dense > 0.0)
+      printf("%-6d | %9d | %5llu | %14.2f | %9.2f | %6.1fx\n", n,
+             stats.cut_gates, (unsigned long long)stats.paths, dense, hsf,
+             dense / hsf);
+    else
+      printf("%-6d | %9d | %5llu | %14s | %9.2f | %7s\n", n, stats.cut_gates,
+             (unsigned long long)stats.paths, "-", hsf, "-");
+    qvm_circuit_free(&c);
+  }
+}
+
+int main() {
+  const char *isas[] = {"scalar", "avx2", "avx512"};
+  const qvm_kernel_ops_t *best = qvm_kernels_get();
+
+  printf("\n╔═══════════════════════════════════╗\n");
+  printf("║   QVM Gate Throughput Benchmark   ║\n");
+  printf("╚═══════════════════════════════════╝\n\n");
+
+  printf("%-7s | %12s | %12s | %12s | %12s | %7s\n", "Qubits",
+         "Before (g/s)", "scalar", "avx2", "avx512", "Speedup");
+  printf("────────┼──────────────┼──────────────┼──────────────┼──────────"
+         "────┼────────\n");
+
+  for (int n = BENCH_MIN_QUBITS; n <= BENCH_MAX_QUBITS; n++) {
+    qvm_state_t state;
+    qvm_init(&state, n);
+    double before = bench_legacy(&state);
+    double rate[3] = {0, 0, 0};
+    double best_rate = 0.0;
+    for (int k = 0; k < 3; k++) {
+      if (qvm_kernels_force(isas[k]) != 0)
+        continue;
+      rate[k] = bench_inplace(&state);
+      if (rate[k] > best_rate)
+        best_rate = rate[k];
+    }
+    qvm_kernels_force(best->name);
+    qvm_free(&state);
+
+    printf("%-7d | %12.0f | %12.0f | %12.0f | %12.0f | %6.2fx\n", n, before,
+           rate[0], rate[1], rate[2], best_rate / before);
+  }
+
+  qvm_state_t state;
+  qvm_init(&state, BENCH_MT_QUBITS);
+
+  printf("\nThread scaling at %d qubits (%s kernels)\n", BENCH_MT_QUBITS,
+         best->name);
+  printf("%-7s | %12s | %7s\n", "Threads", "Gates/s", "Speedup");
+  printf("────────┼──────────────┼────────\n");
+  int max_threads = qvm_threads_get();
+  double base = 0.0;
+  for (int t = 1; t <= max_threads; t *= 2) {
+    qvm_threads_set(t);
+    double rate = bench_inplace(&state);
+    if (t == 1)
+      base = rate;
+    printf("%-7d | %12.1f | %6.2fx\n", t, rate, rate / base);
+  }
+  qvm_threads_set(0);
+  qvm_free(&state);
+
+  bench_sampling();
+  bench_stabilizer();
+  bench_mps();
+  bench_density();
+  bench_trajectories();
+  bench_parser();
+  bench_variational();
+  bench_gradient();
+  bench_batch();
+  bench_rng();
+  bench_single();
+  bench_forms();
+  bench_ooc();
+  bench_expectation();
+  bench_tiles();
+  bench_sparse();
+  bench_unitary();
+  bench_macro();
+  bench_hsf();
+  return 0;
+}
@@ -6,11 +6,13 @@
  */
 
 #include "../modules/quantum/include/qvm.h"
+#include "../modules/quantum/include/qvm_kernels.h"
 #include <complex.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #define EPSILON 0.0001
 #define TEST_PASS "\033[32m✓\033[0m"
@@ -216,6 +218,19 @@ void test_parser() {
     tests_failed++;
     return;
   }
+  qvm_circuit_free(&parsed);
+
+  // Operands past the int range are rejected, not wrapped to a qubit
+  if (qvm_parse_circuit("QUBITS 2\nX 4294967296\nCNOT 0 -2147483649\n"
+                        "SHOTS 2147483647\nX 1\n",
+                        &parsed) != 0 ||
+      parsed.num_gates != 1 || parsed.gates[0].target != 1 ||
+      parsed.shots != 2147483647) {
+    printf("%s FAIL: Out-of-range operand accepted\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+  qvm_circuit_free(&parsed);
 
   printf("%s PASS\n", TEST_PASS);
   tests_passed++;
@@ -274,7 +289,8 @@ void test_multigate_circuit() {
   }
 
   qvm_init(&state, parsed.num_qubits);
-  qvm_execute_circuit(&state, &parsed);
+  qvm_execute_circuit(&state, &parsed, 0);
+  qvm_circuit_free(&parsed);
 
   // Check normalization after execution
   double total_prob = 0.0;
@@ -295,7 +311,2153 @@ void test_multigate_circuit() {
   qvm_free(&state);
 }
 
+// Test 9: In-place kernels on high qubits
+void test_high_qubit_gates() {
+  printf("[TEST] High-Qubit In-Place Gates... ");
+
+  qvm_state_t state;
+  qvm_init(&state, 3);
+
+  // X 2 -> |100>, CNOT 2 0 -> |101>, H 1 -> (|101> + |111>)/sqrt(2)
+  qvm_gate_t x2 = {.type = GATE_X, .target = 2, .control = -1};
+  qvm_gate_t cnot = {.type = GATE_CNOT, .control = 2, .target = 0};
+  qvm_gate_t h1 = {.type = GATE_H, .target = 1, .control = -1};
+  qvm_apply_gate(&state, &x2);
+  qvm_apply_gate(&state, &cnot);
+  qvm_apply_gate(&state, &h1);
+
+  double expected = 1.0 / sqrt(2);
+  for (int i = 0; i < 8; i++) {
+    double _Complex want = (i == 5 || i == 7) ? expected : 0.0;
+    if (!complex_equal(state.amplitudes[i], want)) {
+      printf("%s FAIL: |%d> amplitude incorrect\n", TEST_FAIL, i);
+      tests_failed++;
+      qvm_free(&state);
+      return;
+    }
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+  qvm_free(&state);
+}
+
+// Helper: run a fixed gate sequence touching every target/control pairing
+static void run_kernel_workload(qvm_state_t *state) {
+  qvm_gate_type_t singles[] = {GATE_H, GATE_T, GATE_Y, GATE_S};
+  for (int q = 0; q < state->num_qubits; q++) {
+    qvm_gate_t g = {.type = singles[q % 4], .target = q, .control = -1};
+    qvm_apply_gate(state, &g);
+  }
+  for (int c = 0; c < state->num_qubits; c++) {
+    for (int t = 0; t < state->num_qubits; t++) {
+      if (c == t)
+        continue;
+      qvm_gate_t cnot = {.type = GATE_CNOT, .control = c, .target = t};
+      qvm_gate_t h = {.type = GATE_H, .target = t, .control = -1};
+      qvm_apply_gate(state, &cnot);
+      qvm_apply_gate(state, &h);
+    }
+  }
+}
+
+// Test 10: SIMD kernels agree with the scalar reference
+void test_simd_kernels() {
+  printf("[TEST] SIMD Kernels vs Scalar... ");
+
+  const qvm_kernel_ops_t *saved = qvm_kernels_get();
+  const char *isas[] = {"avx2", "avx512"};
+  const int n = 7;
+  int size = 1 << n;
+
+  qvm_state_t ref, vec;
+  qvm_kernels_force("scalar");
+  qvm_init(&ref, n);
+  run_kernel_workload(&ref);
+
+  for (int k = 0; k < 2; k++) {
+    if (qvm_kernels_force(isas[k]) != 0)
+      continue; // CPU lacks this ISA
+
+    qvm_init(&vec, n);
+    run_kernel_workload(&vec);
+
+    for (int i = 0; i < size; i++) {
+      if (!complex_equal(ref.amplitudes[i], vec.amplitudes[i])) {
+        printf("%s FAIL: %s amplitude %d differs\n", TEST_FAIL, isas[k], i);
+        tests_failed++;
+        goto out;
+      }
+    }
+
+    for (int q = 0; q < n; q++) {
+      double p_ref[2] = {0, 0}, p_vec[2] = {0, 0};
+      qvm_kernels_scalar.probs(ref.amplitudes, q, 0, size / 2, p_ref);
+      qvm_kernels_get()->probs(vec.amplitudes, q, 0, size / 2, p_vec);
+      if (!prob_equal(p_ref[0], p_vec[0]) || !prob_equal(p_ref[1], p_vec[1])) {
+        printf("%s FAIL: %s probability on qubit %d\n", TEST_FAIL, isas[k], q);
+        tests_failed++;
+        goto out;
+      }
+    }
+    qvm_free(&vec);
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+  qvm_free(&ref);
+  qvm_kernels_force(saved->name);
+  return;
+
+out:
+  qvm_free(&vec);
+  qvm_free(&ref);
+  qvm_kernels_force(saved->name);
+}
+
+// Test 11: Multi-threaded sweeps match the serial result
+void test_threaded_sweeps() {
+  printf("[TEST] Multi-Threaded Sweeps... ");
+
+  // Large enough to span several L2-sized chunks
+  const int n = 18;
+  size_t size = (size_t)1 << n;
+  int saved = qvm_threads_get();
+
+  qvm_state_t serial, parallel;
+  qvm_threads_set(1);
+  qvm_init(&serial, n);
+  run_kernel_workload(&serial);
+
+  qvm_threads_set(4);
+  qvm_init(&parallel, n);
+  run_kernel_workload(&parallel);
+
+  // Resizing the pool between sweeps: new workers must wait for the next
+  // sweep rather than rerun the last one
+  qvm_state_t resized;
+  qvm_init(&resized, n);
+  run_kernel_workload(&resized);
+  for (int i = 0; i < 4 * n; i++) {
+    int q = i % n;
+    qvm_gate_t h = {.type = GATE_H, .target = q, .control = -1};
+    qvm_gate_t cnot = {.type = GATE_CNOT, .control = q, .target = (q + 1) % n};
+    qvm_threads_set(i % 2 ? 2 : 4);
+    qvm_apply_gate(&resized, &h);
+    qvm_apply_gate(&resized, &cnot);
+    qvm_threads_set(1);
+    qvm_apply_gate(&serial, &h);
+    qvm_apply_gate(&serial, &cnot);
+    qvm_apply_gate(&parallel, &h);
+    qvm_apply_gate(&parallel, &cnot);
+  }
+  qvm_threads_set(saved);
+
+  for (size_t i = 0; i < size; i++) {
+    if (serial.amplitudes[i] != parallel.amplitudes[i] ||
+        serial.amplitudes[i] != resized.amplitudes[i]) {
+      printf("%s FAIL: amplitude %zu differs\n", TEST_FAIL, i);
+      tests_failed++;
+      qvm_free(&serial);
+      qvm_free(&parallel);
+      qvm_free(&resized);
+      return;
+    }
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+  qvm_free(&serial);
+  qvm_free(&parallel);
+  qvm_free(&resized);
+}
+
+// Test 12: Fused execution matches gate-by-gate execution
+void test_gate_fusion() {
+  printf("[TEST] Gate Fusion... ");
+
+  const char *circuit = "QUBITS 4\n"
+                        "H 0\nS 0\nT 0\n"
+                        "H 1\nS 1\n"
+                        "CNOT 0 1\nT 1\nH 0\nCNOT 1 0\n"
+                        "Y 2\nCNOT 3 2\nH 3\nT 2\n"
+                        "CNOT 1 3\nH 1\nX 3\nZ 2\nH 2\nH 2\n";
+
+  qvm_circuit_t parsed;
+  qvm_parse_circuit(circuit, &parsed);
+
+  qvm_fused_program_t prog;
+  if (qvm_fuse_circuit(&parsed, &prog) != 0 ||
+      prog.num_blocks >= parsed.num_gates) {
+    printf("%s FAIL: Fusion did not reduce sweeps\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  qvm_state_t ref, fused;
+  qvm_init(&ref, parsed.num_qubits);
+  qvm_init(&fused, parsed.num_qubits);
+  for (int i = 0; i < parsed.num_gates; i++)
+    qvm_apply_gate(&ref, &parsed.gates[i]);
+  qvm_execute_fused(&fused, &prog);
+
+  int ok = 1;
+  for (int i = 0; i < (1 << parsed.num_qubits); i++) {
+    if (!complex_equal(ref.amplitudes[i], fused.amplitudes[i]))
+      ok = 0;
+  }
+  qvm_fused_free(&prog);
+  qvm_circuit_free(&parsed);
+  qvm_free(&ref);
+  qvm_free(&fused);
+
+  if (!ok) {
+    printf("%s FAIL: Fused state differs\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+// Test 13: Multi-shot sampling from one evolution
+void test_sampling() {
+  printf("[TEST] Multi-Shot Sampling... ");
+
+  const char *bell = "QUBITS 3\nH 0\nCNOT 0 1\nM 0\nM 1\nX 2\n";
+  qvm_circuit_t parsed;
+  qvm_parse_circuit(bell, &parsed);
+
+  uint64_t mask;
+  qvm_circuit_t mid;
+  qvm_parse_circuit("QUBITS 2\nM 0\nCNOT 0 1\n", &mid);
+  if (qvm_terminal_measurements(&parsed, &mask) != 2 || mask != 3 ||
+      qvm_terminal_measurements(&mid, &mask) != -1) {
+    printf("%s FAIL: Terminal measurement detection\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  qvm_state_t state;
+  qvm_counts_t counts;
+  qvm_circuit_free(&mid);
+  qvm_init(&state, parsed.num_qubits);
+  if (qvm_sample_circuit(&state, &parsed, 10000, &counts) != 0) {
+    printf("%s FAIL: Sampling failed\n", TEST_FAIL);
+    tests_failed++;
+    qvm_free(&state);
+    return;
+  }
+
+  // Only |00> and |11> on the measured qubits, roughly 50/50, and the
+  // state itself is left uncollapsed
+  int ok = counts.shots == 10000 && counts.num_outcomes == 2 &&
+           counts.outcomes[0] == 0 && counts.outcomes[1] == 3 &&
+           fabs(counts.counts[0] / 10000.0 - 0.5) < 0.03 &&
+           complex_equal(state.amplitudes[4], 1.0 / sqrt(2)) &&
+           complex_equal(state.amplitudes[7], 1.0 / sqrt(2));
+  qvm_counts_free(&counts);
+  qvm_circuit_free(&parsed);
+  qvm_free(&state);
+
+  if (!ok) {
+    printf("%s FAIL: Unexpected counts\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+// Test 14: Stabilizer tableau backend
+void test_stabilizer_backend() {
+  printf("[TEST] Stabilizer Backend... ");
+
+  // Random-looking Clifford circuit: the tableau must reach exactly the
+  // outcomes the statevector gives nonzero probability
+  const char *text = "QUBITS 5\nH 0\nH 3\nS 3\nCNOT 0 1\nCNOT 3 2\nY 4\n"
+                     "H 1\nS 1\nCNOT 1 4\nZ 2\nH 2\nCNOT 2 0\nX 3\n"
+                     "S 0\nH 4\nCNOT 4 3\n";
+  qvm_circuit_t c;
+  qvm_parse_circuit(text, &c);
+  if (qvm_select_backend(&c) != QVM_BACKEND_STABILIZER) {
+    printf("%s FAIL: Clifford circuit not detected\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  qvm_state_t sv, tab;
+  qvm_init(&sv, 5);
+  qvm_init_backend(&tab, 5, QVM_BACKEND_STABILIZER);
+  for (int i = 0; i < c.num_gates; i++) {
+    qvm_apply_gate(&sv, &c.gates[i]);
+    qvm_apply_gate(&tab, &c.gates[i]);
+  }
+  qvm_circuit_free(&c);
+
+  qvm_counts_t counts;
+  int ok = qvm_sample(&tab, 4000, &counts) == 0;
+  int support = 0;
+  for (int i = 0; i < 32; i++) {
+    double p = creal(sv.amplitudes[i]) * creal(sv.amplitudes[i]) +
+               cimag(sv.amplitudes[i]) * cimag(sv.amplitudes[i]);
+    support += p > EPSILON;
+  }
+  for (int o = 0; ok && o < counts.num_outcomes; o++) {
+    double _Complex a = sv.amplitudes[counts.outcomes[o]];
+    if (creal(a) * creal(a) + cimag(a) * cimag(a) < EPSILON)
+      ok = 0;
+  }
+  ok = ok && counts.num_outcomes == support;
+  qvm_counts_free(&counts);
+  qvm_free(&sv);
+  qvm_free(&tab);
+
+  // 1000-qubit GHZ: far beyond the statevector, trivial for the tableau
+  qvm_state_t ghz;
+  qvm_init_backend(&ghz, 1000, QVM_BACKEND_STABILIZER);
+  qvm_gate_t h = {GATE_H, 0, -1};
+  qvm_apply_gate(&ghz, &h);
+  for (int q = 1; q < 1000; q++) {
+    qvm_gate_t cx = {GATE_CNOT, q, q - 1};
+    qvm_apply_gate(&ghz, &cx);
+  }
+  qvm_measure(&ghz, 0);
+  int first = ghz.measured[0];
+  qvm_counts_t gc;
+  ok = ok && qvm_sample(&ghz, 8, &gc) == 0 && gc.num_outcomes == 1 &&
+       gc.outcomes[0] == (first ? ~(uint64_t)0 : 0);
+  qvm_counts_free(&gc);
+  qvm_free(&ghz);
+
+  // 40 measured qubits: the printed outcome keeps every bit, not just 32
+  qvm_init_backend(&ghz, 40, QVM_BACKEND_STABILIZER);
+  qvm_apply_gate(&ghz, &h);
+  for (int q = 1; q < 40; q++) {
+    qvm_gate_t cx = {GATE_CNOT, q, q - 1};
+    qvm_apply_gate(&ghz, &cx);
+  }
+  ok = ok && qvm_sample(&ghz, 64, &gc) == 0 && gc.num_outcomes == 2;
+  for (int o = 0; ok && o < gc.num_outcomes; o++) {
+    char bits[QVM_COUNTS_MAX_BITS + 1];
+    qvm_counts_bitstring(&gc, gc.outcomes[o], bits, sizeof(bits));
+    ok = strlen(bits) == 40 &&
+         strspn(bits, gc.outcomes[o] ? "1" : "0") == 40;
+  }
+  qvm_counts_free(&gc);
+
+  // Measured one by one: qubits 32..39 are recorded too, not read as 0
+  uint64_t all = ((uint64_t)1 << 40) - 1, top = (uint64_t)1 << 39;
+  qvm_gate_t x = {GATE_X, 39, -1};
+  qvm_apply_gate(&ghz, &x);
+  for (int q = 39; q >= 0; q--)
+    qvm_measure(&ghz, q);
+  first = ghz.measured[0];
+  ok = ok && qvm_counts_from_measured(&ghz, all, &gc) == 0 &&
+       gc.num_outcomes == 1 && gc.outcomes[0] == ((first ? all : 0) ^ top);
+  qvm_counts_free(&gc);
+  qvm_free(&ghz);
+
+  if (!ok) {
+    printf("%s FAIL: Tableau disagrees with statevector\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+// <P> on the statevector: apply the Paulis to a copy and take <psi|P psi>
+static double sv_expectation(qvm_state_t *sv, const char *paulis) {
+  qvm_state_t tmp;
+  qvm_init(&tmp, sv->num_qubits);
+  size_t size = (size_t)1 << sv->num_qubits;
+  memcpy(tmp.amplitudes, sv->amplitudes, size * sizeof(double _Complex));
+  for (int q = 0; paulis[q]; q++) {
+    qvm_gate_t g = {GATE_X, q, -1};
+    if (paulis[q] == 'I')
+      continue;
+    g.type = paulis[q] == 'X' ? GATE_X : paulis[q] == 'Y' ? GATE_Y : GATE_Z;
+    qvm_apply_gate(&tmp, &g);
+  }
+  double _Complex e = 0;
+  for (size_t i = 0; i < size; i++)
+    e += conj(sv->amplitudes[i]) * tmp.amplitudes[i];
+  qvm_free(&tmp);
+  return creal(e);
+}
+
+void test_mps_backend() {
+  printf("[TEST] MPS Backend... ");
+
+  // Non-Clifford circuit with long-range CNOTs (routed through SWAPs)
+  const char *text = "QUBITS 6\nH 0\nH 3\nT 3\nCNOT 0 4\nCNOT 3 1\nY 5\n"
+                     "H 1\nT 1\nCNOT 5 0\nS 2\nH 2\nCNOT 2 5\nT 0\n"
+                     "CNOT 4 2\nH 4\nT 5\nCNOT 1 3\n";
+  qvm_circuit_t c;
+  qvm_parse_circuit(text, &c);
+
+  qvm_state_t sv, mps;
+  qvm_init(&sv, 6);
+  qvm_init_backend(&mps, 6, QVM_BACKEND_MPS);
+  for (int i = 0; i < c.num_gates; i++) {
+    qvm_apply_gate(&sv, &c.gates[i]);
+    qvm_apply_gate(&mps, &c.gates[i]);
+  }
+  qvm_circuit_free(&c);
+
+  const char *strings[] = {"ZIIIII", "IXIIIY", "ZZIIIZ", "XYZXYZ", "IIYXII"};
+  int ok = 1;
+  for (int k = 0; k < 5; k++) {
+    double e;
+    ok = ok && qvm_mps_expectation(&mps, strings[k], &e) == 0 &&
+         fabs(e - sv_expectation(&sv, strings[k])) < 1e-9;
+  }
+
+  // Sampling only reaches outcomes the statevector allows
+  qvm_counts_t counts;
+  ok = ok && qvm_sample(&mps, 2000, &counts) == 0;
+  for (int o = 0; ok && o < counts.num_outcomes; o++) {
+    double _Complex a = sv.amplitudes[counts.outcomes[o]];
+    if (creal(a) * creal(a) + cimag(a) * cimag(a) < EPSILON)
+      ok = 0;
+  }
+  qvm_counts_free(&counts);
+  qvm_free(&sv);
+  qvm_free(&mps);
+
+  // 80-qubit GHZ with T gates: bond dimension 2, far past the statevector
+  qvm_circuit_t wide;
+  qvm_circuit_init(&wide, 80);
+  qvm_circuit_append(&wide, &(qvm_gate_t){GATE_H, 0, -1});
+  for (int q = 1; q < 80; q++)
+    qvm_circuit_append(&wide, &(qvm_gate_t){GATE_CNOT, q, q - 1});
+  for (int q = 0; q < 80; q += 8)
+    qvm_circuit_append(&wide, &(qvm_gate_t){GATE_T, q, -1});
+  ok = ok && qvm_select_backend(&wide) == QVM_BACKEND_MPS;
+
+  qvm_state_t ghz;
+  qvm_mps_stats_t st;
+  double zz;
+  qvm_init_backend(&ghz, 80, QVM_BACKEND_MPS);
+  qvm_execute_circuit(&ghz, &wide, 0);
+  qvm_circuit_free(&wide);
+  ok = ok && qvm_mps_stats(&ghz, &st) == 0 && st.max_bond == 2 &&
+       fabs(st.fidelity - 1.0) < 1e-12;
+  char zz_string[81];
+  memset(zz_string, 'I', 80);
+  zz_string[80] = '\0';
+  zz_string[0] = zz_string[79] = 'Z';
+  ok = ok && qvm_mps_expectation(&ghz, zz_string, &zz) == 0 &&
+       fabs(zz - 1.0) < 1e-9;
+  qvm_counts_t gc;
+  ok = ok && qvm_sample(&ghz, 64, &gc) == 0 && gc.num_outcomes <= 2;
+  for (int o = 0; ok && o < gc.num_outcomes; o++)
+    ok = gc.outcomes[o] == 0 || gc.outcomes[o] == ~(uint64_t)0;
+  qvm_counts_free(&gc);
+  qvm_free(&ghz);
+
+  // A bond cap of 1 turns a Bell pair into a product state
+  qvm_mps_configure(1, -1.0);
+  qvm_state_t bell;
+  qvm_init_backend(&bell, 2, QVM_BACKEND_MPS);
+  qvm_gate_t h = {GATE_H, 0, -1}, cx = {GATE_CNOT, 1, 0};
+  qvm_apply_gate(&bell, &h);
+  qvm_apply_gate(&bell, &cx);
+  ok = ok && qvm_mps_stats(&bell, &st) == 0 && st.max_bond == 1 &&
+       fabs(st.fidelity - 0.5) < 1e-9;
+  qvm_free(&bell);
+  qvm_mps_configure(QVM_MPS_DEFAULT_BOND, QVM_MPS_DEFAULT_CUTOFF);
+
+  if (!ok) {
+    printf("%s FAIL: MPS disagrees with statevector\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+extern void qnoise_set(int type, float probability);
+
+void test_density_noise() {
+  printf("[TEST] Density Matrix + Noise... ");
+
+  // Without noise rho must equal |psi><psi| of the statevector run
+  const char *text = "QUBITS 4\nH 0\nT 0\nCNOT 0 2\nH 3\nS 3\nCNOT 3 1\n"
+                     "Y 2\nH 1\nT 1\nCNOT 1 0\n";
+  qvm_circuit_t c;
+  qvm_parse_circuit(text, &c);
+  qvm_state_t sv, dm;
+  qvm_init(&sv, 4);
+  qvm_init_backend(&dm, 4, QVM_BACKEND_DENSITY);
+  for (int i = 0; i < c.num_gates; i++) {
+    qvm_apply_gate(&sv, &c.gates[i]);
+    qvm_apply_gate(&dm, &c.gates[i]);
+  }
+  qvm_circuit_free(&c);
+  int ok = 1;
+  for (size_t r = 0; r < 16; r++)
+    for (size_t col = 0; col < 16; col++)
+      ok = ok && complex_equal(qvm_density_element(&dm, r, col),
+                               sv.amplitudes[r] * conj(sv.amplitudes[col]));
+  qvm_free(&sv);
+  qvm_free(&dm);
+
+  // Amplitude damping after X: |1> survives with 1 - p
+  qvm_gate_t x = {GATE_X, 0, -1}, h = {GATE_H, 0, -1};
+  qnoise_set(4, 0.3f);
+  qvm_init_backend(&dm, 1, QVM_BACKEND_DENSITY);
+  qvm_apply_gate(&dm, &x);
+  ok = ok && prob_equal(creal(qvm_density_element(&dm, 1, 1)), 0.7) &&
+       prob_equal(creal(qvm_density_element(&dm, 0, 0)), 0.3);
+  qvm_free(&dm);
+
+  // Depolarizing shrinks the Bloch vector of |+> by 1 - 4p/3
+  qnoise_set(3, 0.15f);
+  qvm_init_backend(&dm, 1, QVM_BACKEND_DENSITY);
+  qvm_apply_gate(&dm, &h);
+  ok = ok && prob_equal(creal(qvm_density_element(&dm, 0, 1)),
+                        0.5 * (1.0 - 4.0 * 0.15 / 3.0));
+  qvm_free(&dm);
+
+  // Readout error: |0> reports 1 about 20% of the time
+  qnoise_set(5, 0.2f);
+  qvm_counts_t counts;
+  qvm_init_backend(&dm, 1, QVM_BACKEND_DENSITY);
+  ok = ok && qvm_sample(&dm, 20000, &counts) == 0 &&
+       counts.num_outcomes == 2 &&
+       fabs(counts.counts[1] / 20000.0 - 0.2) < 0.02;
+  qvm_counts_free(&counts);
+  qvm_free(&dm);
+
+  // Statevector trajectory: a certain bit flip undoes X
+  qnoise_set(1, 1.0f);
+  qvm_init(&sv, 1);
+  qvm_apply_gate(&sv, &x);
+  ok = ok && complex_equal(sv.amplitudes[0], 1.0);
+  qvm_free(&sv);
+  qnoise_set(0, 0.0f);
+
+  if (!ok) {
+    printf("%s FAIL: Density matrix or channel mismatch\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+void test_trajectories() {
+  printf("[TEST] Monte-Carlo Trajectories... ");
+
+  // Bit flip after X: P(0) = p
+  qvm_circuit_t c;
+  qvm_parse_circuit("QUBITS 2\nX 0\nH 1\nMEASURE 0\n", &c);
+  qvm_traj_config_t config = {.max_trajectories = 4000, .seed = 42};
+  qvm_traj_result_t r1, r4;
+  qnoise_set(1, 0.1f);
+  qvm_threads_set(1);
+  int ok = qvm_run_trajectories(&c, &config, &r1) == 0 &&
+           r1.trajectories == 4000 && r1.counts.num_outcomes == 2 &&
+           fabs(r1.counts.counts[0] / 4000.0 - 0.1) < 0.02;
+
+  // Same seed, same counts, whatever the thread count
+  qvm_threads_set(4);
+  ok = ok && qvm_run_trajectories(&c, &config, &r4) == 0 &&
+       r4.counts.num_outcomes == r1.counts.num_outcomes;
+  for (int o = 0; ok && o < r1.counts.num_outcomes; o++)
+    ok = r1.counts.outcomes[o] == r4.counts.outcomes[o] &&
+         r1.counts.counts[o] == r4.counts.counts[o];
+  qvm_counts_free(&r1.counts);
+  qvm_counts_free(&r4.counts);
+  qvm_circuit_free(&c);
+
+  // Depolarizing after X: <Z> = -(1 - 4p/3), within the reported CI
+  qvm_parse_circuit("QUBITS 1\nX 0\n", &c);
+  config.observable = "Z";
+  qnoise_set(3, 0.15f);
+  ok = ok && qvm_run_trajectories(&c, &config, &r1) == 0 &&
+       r1.ci95 > 0.0 &&
+       fabs(r1.expectation + (1.0 - 4.0 * 0.15 / 3.0)) < 2.0 * r1.ci95;
+
+  // A loose target stops well before the cap
+  config.max_trajectories = 100000;
+  config.min_trajectories = 200;
+  config.target_error = 0.02;
+  ok = ok && qvm_run_trajectories(&c, &config, &r1) == 0 && r1.converged &&
+       r1.trajectories >= 200 && r1.trajectories < 100000 &&
+       r1.std_error <= 0.02;
+  qvm_circuit_free(&c);
+
+  // Noisy CCX: the density matrix takes the channel once per qubit, as
+  // the trajectories do, not after each gate of the decomposition
+  qvm_parse_circuit("QUBITS 3\nX 0\nX 1\nCCX 0 1 2\n", &c);
+  config = (qvm_traj_config_t){
+      .max_trajectories = 20000, .seed = 7, .observable = "IIZ"};
+  qnoise_set(1, 0.05f);
+  qvm_state_t dm;
+  double exact;
+  qvm_init_backend(&dm, 3, QVM_BACKEND_DENSITY);
+  for (int i = 0; i < c.num_gates; i++)
+    qvm_apply_gate(&dm, &c.gates[i]);
+  ok = ok && qvm_density_expectation(&dm, "IIZ", &exact) == 0 &&
+       qvm_run_trajectories(&c, &config, &r1) == 0 &&
+       fabs(r1.expectation - exact) < 2.0 * r1.ci95;
+  qvm_counts_free(&r1.counts);
+  qvm_free(&dm);
+  qvm_circuit_free(&c);
+
+  // Same for a noisy QFT: once per qubit of the range, not per gate of
+  // its H / CPHASE / SWAP sequence. QFT|000> = |+++>, so each phase flip
+  // scales <XXX> by 1 - 2p.
+  qvm_parse_circuit("QUBITS 3\nQFT 0 2\n", &c);
+  config.observable = "XXX";
+  qnoise_set(2, 0.05f);
+  qvm_init_backend(&dm, 3, QVM_BACKEND_DENSITY);
+  for (int i = 0; i < c.num_gates; i++)
+    qvm_apply_gate(&dm, &c.gates[i]);
+  ok = ok && qvm_density_expectation(&dm, "XXX", &exact) == 0 &&
+       prob_equal(exact, pow(0.9, 3)) &&
+       qvm_run_trajectories(&c, &config, &r1) == 0 &&
+       fabs(r1.expectation - exact) < 2.0 * r1.ci95;
+  qvm_counts_free(&r1.counts);
+  qvm_free(&dm);
+  qvm_circuit_free(&c);
+  qvm_threads_set(0);
+  qnoise_set(0, 0.0f);
+
+  if (!ok) {
+    printf("%s FAIL: Trajectory estimates off\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+// Stream source: QUBITS 2, then H 0 / CNOT 0 1 pairs generated on the fly
+typedef struct {
+  long pairs_left;
+  int header_sent;
+} gen_stream_t;
+
+static size_t gen_read(void *ctx, char *buf, size_t size) {
+  gen_stream_t *g = (gen_stream_t *)ctx;
+  static const char pair[] = "H 0\nCNOT 0 1\n";
+  size_t n = 0;
+  if (!g->header_sent) {
+    n = (size_t)sprintf(buf, "QUBITS 2\n");
+    g->header_sent = 1;
+  }
+  while (g->pairs_left > 0 && n + sizeof(pair) - 1 <= size) {
+    memcpy(buf + n, pair, sizeof(pair) - 1);
+    n += sizeof(pair) - 1;
+    g->pairs_left--;
+  }
+  return n;
+}
+
+static size_t text_read(void *ctx, char *buf, size_t size) {
+  const char **text = (const char **)ctx;
+  size_t n = strlen(*text) < size ? strlen(*text) : size;
+  memcpy(buf, *text, n);
+  *text += n;
+  return n;
+}
+
+void test_circuit_stream() {
+  printf("[TEST] Growable Circuit + Streaming... ");
+
+  // Well past the old 256-gate array
+  char *text = (char *)malloc(16 + 4 * 5000);
+  int len = sprintf(text, "QUBITS 1\n");
+  for (int i = 0; i < 5000; i++)
+    len += sprintf(text + len, "%s 0\n", i % 2 ? "X" : "H");
+  qvm_circuit_t c;
+  int ok = qvm_parse_circuit(text, &c) == 0 && c.num_gates == 5000 &&
+           c.gates[4999].type == GATE_X && c.capacity >= 5000;
+  qvm_circuit_free(&c);
+  free(text);
+  ok = ok && c.gates == NULL && c.num_gates == 0;
+
+  // One million (H, CNOT) pairs in bounded memory: an even number of pairs
+  // returns to |00>
+  gen_stream_t gen = {.pairs_left = 1000000};
+  qvm_state_t state;
+  ok = ok && qvm_execute_stream(gen_read, &gen, &state) == 2000000 &&
+       state.num_qubits == 2 && complex_equal(state.amplitudes[0], 1.0) &&
+       complex_equal(state.amplitudes[3], 0.0);
+  qvm_free(&state);
+
+  // A last line without a newline still runs; gates before QUBITS fail
+  const char *bell = "QUBITS 2\nH 0\nCNOT 0 1";
+  ok = ok && qvm_execute_stream(text_read, &bell, &state) == 2 &&
+       complex_equal(state.amplitudes[3], 1.0 / sqrt(2));
+  qvm_free(&state);
+  const char *headless = "H 0\nQUBITS 1\n";
+  ok = ok && qvm_execute_stream(text_read, &headless, &state) == -1;
+  qvm_free(&state);
+
+  // A line spanning several reads is carried over whole, not cut at 255
+  text = (char *)malloc(32 + 10000);
+  len = sprintf(text, "QUBITS 1\n");
+  memset(text + len, ' ', 10000);
+  strcpy(text + len + 10000, "X 0\n");
+  const char *spread = text;
+  ok = ok && qvm_execute_stream(text_read, &spread, &state) == 1 &&
+       complex_equal(state.amplitudes[1], 1.0);
+  qvm_free(&state);
+  free(text);
+
+  if (!ok) {
+    printf("%s FAIL: Circuit buffer or stream mismatch\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+void test_compiled_circuit() {
+  printf("[TEST] Tokenizer + Compiled Circuits... ");
+
+  // Every keyword, CRLF, tabs, comments, bad lines
+  const char *text = "# header\r\nQUBITS 3\r\nSHOTS 77\n\tH 0\nX 1 # note\n"
+                     "Y 2\nZ 0\nT 1\nS 2\nCNOT 0 2\nMEASURE 1\nM 2\n"
+                     "CNOT 1\nFOO 1\nno operands\n  \n";
+  const qvm_gate_type_t types[] = {GATE_H, GATE_X, GATE_Y,    GATE_Z,
+                                   GATE_T, GATE_S, GATE_CNOT, GATE_MEASURE,
+                                   GATE_MEASURE};
+  qvm_circuit_t c;
+  int ok = qvm_parse_circuit(text, &c) == 0 && c.num_qubits == 3 &&
+           c.shots == 77 && c.num_gates == 9 && c.gates[6].control == 0 &&
+           c.gates[6].target == 2 && c.gates[8].target == 2;
+  for (int i = 0; ok && i < 9; i++)
+    ok = c.gates[i].type == types[i];
+
+  // Round trip through .qcb; on this host the gates load in place
+  void *qcb;
+  size_t size;
+  qvm_circuit_t loaded;
+  ok = ok && qvm_compile(text, &qcb, &size) == 0 &&
+       size == QVM_QCB_HEADER_SIZE + 9 * sizeof(qvm_gate_t) &&
+       qvm_qcb_source_hash(qcb, size) == qvm_qcb_hash(text, strlen(text)) &&
+       qvm_qcb_load(qcb, size, &loaded) == 0 && loaded.num_qubits == 3 &&
+       loaded.shots == 77 && loaded.num_gates == 9 &&
+       loaded.gates == (qvm_gate_t *)((char *)qcb + QVM_QCB_HEADER_SIZE) &&
+       memcmp(loaded.gates, c.gates, 9 * sizeof(qvm_gate_t)) == 0;
+
+  // Appending to a borrowed circuit copies it out first
+  qvm_gate_t h = {GATE_H, 1, -1};
+  ok = ok && qvm_circuit_append(&loaded, &h) == 0 && loaded.capacity > 0 &&
+       loaded.num_gates == 10 && loaded.gates[6].type == GATE_CNOT;
+  qvm_circuit_free(&loaded);
+
+  // Corruption, truncation and version skew are rejected
+  unsigned char *bytes = (unsigned char *)qcb;
+  bytes[QVM_QCB_HEADER_SIZE + 4] ^= 1;
+  ok = ok && qvm_qcb_load(qcb, size, &loaded) == -1;
+  bytes[QVM_QCB_HEADER_SIZE + 4] ^= 1;
+  ok = ok && qvm_qcb_load(qcb, size - 1, &loaded) == -1;
+  bytes[4]++;
+  ok = ok && qvm_qcb_load(qcb, size, &loaded) == -1 &&
+       qvm_qcb_source_hash(qcb, size) == 0;
+  bytes[4]--;
+
+  // Saved, then mapped back read-only
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/qvm_test_%d.qcb", (int)getpid());
+  size_t mapped_size = 0;
+  void *mapped = NULL;
+  ok = ok && qvm_qcb_save(path, qcb, size) == 0 &&
+       (mapped = qvm_qcb_map(path, &mapped_size)) != NULL &&
+       qvm_qcb_load(mapped, mapped_size, &loaded) == 0 &&
+       memcmp(loaded.gates, c.gates, 9 * sizeof(qvm_gate_t)) == 0;
+  qvm_circuit_free(&loaded);
+  qvm_qcb_unmap(mapped, mapped_size);
+  remove(path);
+  free(qcb);
+  qvm_circuit_free(&c);
+
+  if (!ok) {
+    printf("%s FAIL: Tokenizer or .qcb mismatch\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+void test_parameterized_gates() {
+  printf("[TEST] Rotation Gates + Parameter Binding... ");
+
+  // Matrices: RX(pi) = -iX, U3 = RZ(phi) RY(theta) RZ(lambda) up to the
+  // phase e^(i (phi + lambda) / 2), CPHASE(pi) = CZ
+  double _Complex m[2][2], rz1[2][2], ry[2][2], rz2[2][2];
+  qvm_gate_t rx = {GATE_RX, 0, -1, {M_PI, 0, 0}};
+  int ok = qvm_gate_unitary(&rx, m) == 0 && complex_equal(m[0][0], 0) &&
+           complex_equal(m[0][1], -I) && complex_equal(m[1][0], -I);
+  qvm_gate_t u3 = {GATE_U3, 0, -1, {0.7, 1.1, -0.4}};
+  qvm_gate_t g1 = {GATE_RZ, 0, -1, {1.1, 0, 0}};
+  qvm_gate_t g2 = {GATE_RY, 0, -1, {0.7, 0, 0}};
+  qvm_gate_t g3 = {GATE_RZ, 0, -1, {-0.4, 0, 0}};
+  ok = ok && qvm_gate_unitary(&u3, m) == 0 && qvm_gate_unitary(&g1, rz1) == 0 &&
+       qvm_gate_unitary(&g2, ry) == 0 && qvm_gate_unitary(&g3, rz2) == 0;
+  double _Complex phase = cexp(I * (1.1 - 0.4) / 2);
+  for (int r = 0; ok && r < 2; r++) {
+    for (int c = 0; ok && c < 2; c++) {
+      double _Complex v = 0;
+      for (int k = 0; k < 2; k++)
+        for (int l = 0; l < 2; l++)
+          v += rz1[r][k] * ry[k][l] * rz2[l][c];
+      ok = complex_equal(m[r][c], phase * v);
+    }
+  }
+  double _Complex m4[4][4], cz[4][4];
+  qvm_gate_t cphase = {GATE_CPHASE, 1, 0, {M_PI, 0, 0}};
+  qvm_gate_t czg = {GATE_CZ, 1, 0};
+  ok = ok && qvm_gate_matrix2(&cphase, 0, m4) == 0 &&
+       qvm_gate_matrix2(&czg, 0, cz) == 0;
+  for (int i = 0; ok && i < 16; i++)
+    ok = complex_equal(m4[i / 4][i % 4], cz[i / 4][i % 4]);
+
+  // Depth-1 QAOA on one edge, parsed once and re-bound:
+  // <cut> = 1/2 + sin(4 beta) sin(gamma) / 2
+  const char *text = "QUBITS 2\nH 0\nH 1\nRZZ(-p0) 0 1\n"
+                     "RX(2*p1) 0\nRX(2 * p1) 1\n";
+  qvm_circuit_t c;
+  qvm_state_t state;
+  ok = ok && qvm_parse_circuit(text, &c) == 0 && c.num_params == 2 &&
+       c.num_angles == 3 && c.gates[2].type == GATE_RZZ;
+  qvm_init(&state, 2);
+  const double bindings[3][2] = {{0.3, 0.2}, {M_PI / 2, M_PI / 8}, {1.9, -0.6}};
+  for (int b = 0; ok && b < 3; b++) {
+    double cut = 0.5 + sin(4 * bindings[b][1]) * sin(bindings[b][0]) / 2;
+    ok = qvm_execute_bound(&state, &c, bindings[b], 2) == 0 &&
+         prob_equal(cabs(state.amplitudes[1]) * cabs(state.amplitudes[1]) +
+                        cabs(state.amplitudes[2]) * cabs(state.amplitudes[2]),
+                    cut);
+  }
+  ok = ok && qvm_bind_parameters(&c, bindings[0], 1) == -1;
+
+  // Expressions: linear in one parameter; others are rejected
+  qvm_circuit_t e;
+  ok = ok &&
+       qvm_parse_circuit("QUBITS 1\nRY(pi/2 - 2*p3) 0\n"
+                         "U3(1e-1, -(p0)/2, 3*(p0 + 1)) 0\nRY(p0*p1) 0\n"
+                         "RY(p0 + p1) 0\nRX 0\nH(1) 0\nRZ(pi) 0\n",
+                         &e) == 0 &&
+       e.num_gates == 3 && e.num_params == 4 && e.num_angles == 3 &&
+       e.angles[0].symbol == 3 && prob_equal(e.angles[0].scale, -2) &&
+       prob_equal(e.angles[0].offset, M_PI / 2) &&
+       prob_equal(e.gates[1].theta[0], 0.1) &&
+       prob_equal(e.angles[1].scale, -0.5) &&
+       prob_equal(e.angles[2].scale, 3) && prob_equal(e.angles[2].offset, 3) &&
+       prob_equal(e.gates[2].theta[0], M_PI);
+  qvm_circuit_free(&e);
+
+  // .qcb keeps the angle table; binding copies borrowed gates out and
+  // leaves the compiled bytes alone
+  void *qcb;
+  size_t size;
+  qvm_circuit_t loaded;
+  ok = ok && qvm_compile(text, &qcb, &size) == 0 &&
+       qvm_qcb_load(qcb, size, &loaded) == 0 && loaded.capacity == 0 &&
+       loaded.num_params == 2 && loaded.num_angles == 3 &&
+       qvm_execute_bound(&state, &loaded, bindings[1], 2) == 0 &&
+       loaded.capacity > 0 && prob_equal(loaded.gates[2].theta[0], -M_PI / 2) &&
+       qvm_qcb_source_hash(qcb, size) != 0 &&
+       prob_equal(cabs(state.amplitudes[1]) * cabs(state.amplitudes[1]) * 2,
+                  1.0);
+  qvm_circuit_free(&loaded);
+  free(qcb);
+  qvm_circuit_free(&c);
+  qvm_free(&state);
+
+  // Streams cannot bind parameters
+  const char *stream = "QUBITS 1\nRY(p0) 0\n";
+  ok = ok && qvm_execute_stream(text_read, &stream, &state) == -1;
+  qvm_free(&state);
+
+  if (!ok) {
+    printf("%s FAIL: Rotation or binding mismatch\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+// Finite-difference d<P>/dp of qvm_gradient's value
+static int gradient_fd(qvm_circuit_t *c, const double *params, int n,
+                       const char *obs, double *fd) {
+  double shifted[8], plus, minus, scratch[8];
+  for (int k = 0; k < n; k++) {
+    memcpy(shifted, params, n * sizeof(double));
+    shifted[k] = params[k] + 1e-5;
+    if (qvm_gradient(c, shifted, n, obs, QVM_GRAD_SHIFT, &plus, scratch) != 0)
+      return -1;
+    shifted[k] = params[k] - 1e-5;
+    if (qvm_gradient(c, shifted, n, obs, QVM_GRAD_SHIFT, &minus, scratch) != 0)
+      return -1;
+    fd[k] = (plus - minus) / 2e-5;
+  }
+  return 0;
+}
+
+void test_gradients() {
+  printf("[TEST] Adjoint + Parameter-Shift Gradients... ");
+
+  // Every rotation type, parameters shared across gates with scale/offset
+  const char *text = "QUBITS 3\nH 0\nRX(p0) 0\nRY(2*p1 + 0.3) 1\nCNOT 0 1\n"
+                     "RZ(-p0) 1\nH 1\nU3(p2, p1, 0.5 - p3) 2\n"
+                     "CPHASE(p3) 1 2\nRZZ(p2/2) 0 2\nH 2\nRY(p1) 0\n";
+  const double params[4] = {0.7, -0.4, 1.3, 2.1};
+  qvm_circuit_t c;
+  double adj[4], shift[4], fd[4], v_adj, v_shift;
+  int ok = qvm_parse_circuit(text, &c) == 0 && c.num_params == 4 &&
+           qvm_gradient(&c, params, 4, "XYZ", QVM_GRAD_ADJOINT, &v_adj,
+                        adj) == 0 &&
+           qvm_gradient(&c, params, 4, "XYZ", QVM_GRAD_SHIFT, &v_shift,
+                        shift) == 0 &&
+           gradient_fd(&c, params, 4, "XYZ", fd) == 0 &&
+           prob_equal(v_adj, v_shift);
+  for (int k = 0; ok && k < 4; k++)
+    ok = fabs(adj[k] - shift[k]) < 1e-9 && fabs(adj[k] - fd[k]) < 1e-6;
+
+  // Under noise AUTO falls back to shifts on the density matrix, which
+  // still match finite differences of the noisy expectation
+  qnoise_set(3, 0.05f);
+  ok = ok &&
+       qvm_gradient(&c, params, 4, "ZIZ", QVM_GRAD_AUTO, &v_shift, shift) ==
+           0 &&
+       gradient_fd(&c, params, 4, "ZIZ", fd) == 0 &&
+       qvm_gradient(&c, params, 4, "ZIZ", QVM_GRAD_ADJOINT, &v_adj, adj) ==
+           0 &&
+       fabs(v_adj - v_shift) > 1e-3;
+  for (int k = 0; ok && k < 4; k++)
+    ok = fabs(shift[k] - fd[k]) < 1e-6;
+  qnoise_set(0, 0.0f);
+  qvm_circuit_free(&c);
+
+  // Range gates: shifts on the density matrix (noisy) and on the MPS
+  // (34 qubits, the last 31 idle) run the QFT like a plain run does
+  const char *qft = "RY(p0) 0\nRX(p1) 2\nQFT 0 2\nRY(p0) 1\n";
+  char wide_text[128], wide_obs[35];
+  sprintf(wide_text, "QUBITS 34\n%s", qft);
+  memset(wide_obs, 'I', 34);
+  memcpy(wide_obs, "ZXZ", 3);
+  wide_obs[34] = '\0';
+  double wide[2];
+  ok = ok && qvm_parse_circuit(wide_text, &c) == 0 &&
+       qvm_gradient(&c, params, 2, wide_obs, QVM_GRAD_AUTO, &v_shift,
+                    wide) == 0;
+  qvm_circuit_free(&c);
+  sprintf(wide_text, "QUBITS 3\n%s", qft);
+  ok = ok && qvm_parse_circuit(wide_text, &c) == 0 &&
+       qvm_gradient(&c, params, 2, "ZXZ", QVM_GRAD_ADJOINT, &v_adj, adj) ==
+           0 &&
+       prob_equal(v_adj, v_shift) && fabs(adj[0] - wide[0]) < 1e-9 &&
+       fabs(adj[1] - wide[1]) < 1e-9;
+  qnoise_set(2, 0.05f);
+  ok = ok &&
+       qvm_gradient(&c, params, 2, "ZXZ", QVM_GRAD_AUTO, &v_shift, shift) ==
+           0 &&
+       gradient_fd(&c, params, 2, "ZXZ", fd) == 0 &&
+       fabs(shift[0] - fd[0]) < 1e-6 && fabs(shift[1] - fd[1]) < 1e-6;
+  qnoise_set(0, 0.0f);
+  qvm_circuit_free(&c);
+
+  // Mid-circuit measurement has no gradient
+  ok = ok && qvm_parse_circuit("QUBITS 1\nRY(p0) 0\nMEASURE 0\n", &c) == 0 &&
+       qvm_gradient(&c, params, 1, "Z", QVM_GRAD_AUTO, &v_adj, adj) == -1;
+  qvm_circuit_free(&c);
+
+  if (!ok) {
+    printf("%s FAIL: Gradient mismatch\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+void test_batch_execution() {
+  printf("[TEST] Batched Execution... ");
+
+  // One QAOA edge bound 16 ways: <Z0 Z1> = 1 - 2 <cut>, in submission order
+  qvm_circuit_t qaoa, meas, mid, wide;
+  int ok = qvm_parse_circuit("QUBITS 2\nH 0\nH 1\nRZZ(-p0) 0 1\n"
+                             "RX(2*p1) 0\nRX(2*p1) 1\n",
+                             &qaoa) == 0 &&
+           qvm_parse_circuit("QUBITS 3\nSHOTS 200\nX 0\nH 1\nMEASURE 0\n"
+                             "MEASURE 1\n",
+                             &meas) == 0 &&
+           qvm_parse_circuit("QUBITS 2\nMEASURE 0\nX 0\n", &mid) == 0;
+
+  // Wide enough to run alone on the whole pool
+  qvm_circuit_init(&wide, 18);
+  qvm_gate_t h = {GATE_H, 0, -1};
+  ok = ok && qvm_circuit_append(&wide, &h) == 0;
+  for (int q = 1; ok && q < 18; q++) {
+    qvm_gate_t cx = {GATE_CNOT, q, q - 1};
+    ok = qvm_circuit_append(&wide, &cx) == 0;
+  }
+
+  enum { N = 19 };
+  const qvm_circuit_t *circuits[N];
+  const double *params[N];
+  double bindings[16][2];
+  for (int i = 0; i < 16; i++) {
+    bindings[i][0] = 0.2 * i;
+    bindings[i][1] = 0.1 - 0.05 * i;
+    circuits[i] = &qaoa;
+    params[i] = bindings[i];
+  }
+  circuits[16] = &meas;
+  circuits[17] = &mid;
+  circuits[18] = &wide;
+  params[16] = params[17] = params[18] = NULL;
+
+  qvm_batch_result_t results[N];
+  qvm_threads_set(4);
+  ok = ok && qvm_execute_batch(circuits, params, results, N, "ZZ") == 1;
+  for (int i = 0; ok && i < 16; i++) {
+    double cut = 0.5 + sin(4 * bindings[i][1]) * sin(bindings[i][0]) / 2;
+    ok = results[i].status == 0 &&
+         prob_equal(results[i].expectation, 1 - 2 * cut);
+  }
+  // X 0 H 1 measured on (0, 1): outcomes 01 and 11, 200 shots
+  ok = ok && results[16].status == 0 && results[16].counts.shots == 200 &&
+       results[16].counts.num_outcomes == 2 &&
+       results[16].counts.outcomes[0] == 1 &&
+       results[16].counts.outcomes[1] == 3 &&
+       prob_equal(results[16].expectation, 0.0);
+  ok = ok && results[17].status == -1 && results[18].status == 0 &&
+       prob_equal(results[18].expectation, 1.0);
+  for (int i = 0; i < N; i++)
+    qvm_counts_free(&results[i].counts);
+
+  // The caller's circuits are left unbound
+  ok = ok && qaoa.gates[2].theta[0] == 0.0;
+  qvm_threads_set(0);
+  qvm_circuit_free(&qaoa);
+  qvm_circuit_free(&meas);
+  qvm_circuit_free(&mid);
+  qvm_circuit_free(&wide);
+
+  if (!ok) {
+    printf("%s FAIL: Batch results mismatch\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+// Measures 8 qubits of H^8 |0> under a fresh global seed
+static void rng_measure_all(uint64_t seed, int out[8]) {
+  qvm_rng_seed(seed);
+  qvm_state_t state;
+  qvm_init(&state, 8);
+  for (int q = 0; q < 8; q++) {
+    qvm_gate_t h = {GATE_H, q, -1};
+    qvm_apply_gate(&state, &h);
+  }
+  for (int q = 0; q < 8; q++) {
+    qvm_measure(&state, q);
+    out[q] = state.measured[q];
+  }
+  qvm_free(&state);
+}
+
+void test_rng() {
+  printf("[TEST] Counter-Based RNG... ");
+
+  // Philox4x32-10 known-answer vectors (Random123 kat_vectors)
+  qvm_rng_t r;
+  qvm_rng_init(&r, 0, 0);
+  int ok = qvm_rng_next(&r) == 0xe169c58d6627e8d5ULL &&
+           qvm_rng_next(&r) == 0x9b00dbd8bc57ac4cULL;
+  qvm_rng_init(&r, ~0ULL, ~0ULL);
+  r.counter = ~0ULL;
+  ok = ok && qvm_rng_next(&r) == 0x41c83b0e408f276dULL &&
+       qvm_rng_next(&r) == 0x6d5451fda20bc7c6ULL;
+
+  // Bulk fills (serial and on the pool) continue the sequential stream
+  enum { FILL = 140001 };
+  double *u = (double *)malloc(FILL * sizeof(double));
+  qvm_rng_t a, b;
+  qvm_rng_init(&a, 42, 7);
+  qvm_rng_init(&b, 42, 7);
+  qvm_threads_set(4);
+  for (int pass = 0; u && pass < 2; pass++) {
+    size_t n = pass ? FILL : 1001;
+    (void)qvm_rng_below(&a, 10); // Leave half a block behind
+    (void)qvm_rng_below(&b, 10);
+    qvm_rng_fill_uniform(&a, u, n);
+    for (size_t i = 0; ok && i < n; i++) {
+      ok = u[i] == qvm_rng_uniform(&b) && u[i] > 0.0 && u[i] < 1.0;
+    }
+    ok = ok && qvm_rng_next(&a) == qvm_rng_next(&b);
+  }
+  qvm_threads_set(0);
+  free(u);
+  ok = ok && u != NULL;
+
+  for (int i = 0; ok && i < 1000; i++)
+    ok = qvm_rng_below(&a, 6) < 6;
+
+  // Same global seed, same measurement record; another seed differs
+  int m1[8], m2[8], m3[8];
+  rng_measure_all(1234, m1);
+  rng_measure_all(1234, m2);
+  rng_measure_all(4321, m3);
+  ok = ok && memcmp(m1, m2, sizeof(m1)) == 0 && qvm_rng_get_seed() == 4321;
+  int same = memcmp(m1, m3, sizeof(m1)) == 0;
+  qvm_rng_seed(0);
+
+  if (!ok || same) {
+    printf("%s FAIL: RNG stream mismatch\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+// Same gates on a double and a single-precision statevector, per ISA
+static double single_workload_fidelity(int n, double *max_err) {
+  qvm_state_t ref, sp;
+  qvm_init(&ref, n);
+  qvm_init_precision(&sp, n, QVM_PRECISION_SINGLE);
+  for (int layer = 0; layer < 4; layer++) {
+    run_kernel_workload(&ref);
+    run_kernel_workload(&sp);
+    for (int q = 0; q + 1 < n; q++) {
+      qvm_gate_t g[3] = {{GATE_RZZ, q + 1, q, {0.3 * q + 0.1}},
+                         {GATE_U3, q, -1, {0.7, -0.2 * q, 1.1}},
+                         {GATE_SWAP, q, q + 1}};
+      for (int i = 0; i < 3; i++) {
+        qvm_apply_gate(&ref, &g[i]);
+        qvm_apply_gate(&sp, &g[i]);
+      }
+    }
+  }
+  size_t size = (size_t)1 << n;
+  double _Complex *a = malloc(size * sizeof(double _Complex));
+  double _Complex *b = malloc(size * sizeof(double _Complex));
+  double fidelity = -1.0;
+  if (a && b && qvm_get_amplitudes(&ref, a) == 0 &&
+      qvm_get_amplitudes(&sp, b) == 0) {
+    double _Complex overlap = 0;
+    *max_err = 0.0;
+    for (size_t i = 0; i < size; i++) {
+      overlap += conj(a[i]) * b[i];
+      if (cabs(a[i] - b[i]) > *max_err)
+        *max_err = cabs(a[i] - b[i]);
+    }
+    fidelity = cabs(overlap) * cabs(overlap);
+  }
+  free(a);
+  free(b);
+  qvm_free(&ref);
+  qvm_free(&sp);
+  return fidelity;
+}
+
+void test_single_precision() {
+  printf("[TEST] Single-Precision Statevector... ");
+
+  const qvm_kernel_ops_t *saved = qvm_kernels_get();
+  const char *isas[] = {"scalar", "avx2", "avx512"};
+  int ok = 1;
+  for (int k = 0; ok && k < 3; k++) {
+    if (qvm_kernels_force(isas[k]) != 0)
+      continue;
+    double err = 1.0;
+    double f = single_workload_fidelity(9, &err);
+    ok = f > 1.0 - 1e-5 && f < 1.0 + 1e-5 && err < 1e-4;
+  }
+  qvm_kernels_force(saved->name);
+
+  // GHZ: sampled and measured outcomes are all-zeros or all-ones
+  qvm_state_t ghz;
+  qvm_init_precision(&ghz, 12, QVM_PRECISION_SINGLE);
+  ok = ok && ghz.backend == QVM_BACKEND_SINGLE;
+  qvm_gate_t h = {GATE_H, 0, -1};
+  qvm_apply_gate(&ghz, &h);
+  for (int q = 1; q < 12; q++) {
+    qvm_gate_t cx = {GATE_CNOT, q, q - 1};
+    qvm_apply_gate(&ghz, &cx);
+  }
+  qvm_counts_t counts;
+  ok = ok && qvm_sample(&ghz, 500, &counts) == 0 &&
+       counts.num_outcomes == 2 && counts.outcomes[0] == 0 &&
+       counts.outcomes[1] == 0xFFF && counts.shots == 500;
+  qvm_counts_free(&counts);
+  qvm_measure(&ghz, 5);
+  int bit = ghz.measured[5];
+  for (int q = 0; ok && q < 12; q++) {
+    qvm_measure(&ghz, q);
+    ok = ghz.measured[q] == bit;
+  }
+  qvm_free(&ghz);
+
+  // A long rotation sequence keeps its norm
+  qvm_state_t sp;
+  qvm_init_precision(&sp, 6, QVM_PRECISION_SINGLE);
+  for (int i = 0; i < 5000; i++) {
+    qvm_gate_t g = {i % 3 ? GATE_RX : GATE_RZZ, i % 6, (i + 1) % 6,
+                    {0.1 + 1e-4 * i}};
+    qvm_apply_gate(&sp, &g);
+  }
+  double amps[64 * 2];
+  double norm = 0.0;
+  ok = ok && qvm_get_amplitudes(&sp, (double _Complex *)amps) == 0;
+  for (int i = 0; i < 128; i++)
+    norm += amps[i] * amps[i];
+  ok = ok && fabs(norm - 1.0) < 2e-6;
+  qvm_free(&sp);
+
+  if (!ok) {
+    printf("%s FAIL: Single precision diverges from double\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+// Reference for the fast gate paths: a brute-force matrix-vector product
+static void dense_apply(double _Complex *a, int n, const qvm_gate_t *g) {
+  size_t size = (size_t)1 << n;
+  double _Complex *out = calloc(size, sizeof(double _Complex));
+  double _Complex m2[2][2], m4[4][4];
+  int t = g->target;
+  int q0 = g->control < t ? g->control : t;
+  int q1 = g->control < t ? t : g->control;
+  int single = qvm_gate_unitary(g, m2) == 0;
+  if (!single && g->type != GATE_CCX)
+    qvm_gate_matrix2(g, q0, m4);
+  for (size_t i = 0; i < size; i++) {
+    if (single) {
+      for (int r = 0; r < 2; r++)
+        out[(i & ~((size_t)1 << t)) | (size_t)r << t] +=
+            m2[r][(i >> t) & 1] * a[i];
+    } else if (g->type == GATE_CCX) {
+      int on = ((i >> g->control) & 1) && ((i >> g->control2) & 1);
+      out[on ? i ^ ((size_t)1 << t) : i] = a[i];
+    } else {
+      size_t rest = i & ~(((size_t)1 << q0) | ((size_t)1 << q1));
+      int l = (int)((i >> q0) & 1) | (int)((i >> q1) & 1) << 1;
+      for (int r = 0; r < 4; r++)
+        out[rest | (size_t)(r & 1) << q0 | (size_t)(r >> 1) << q1] +=
+            m4[r][l] * a[i];
+    }
+  }
+  memcpy(a, out, size * sizeof(double _Complex));
+  free(out);
+}
+
+void test_special_gates() {
+  printf("[TEST] Diagonal + Permutation Gates... ");
+
+  const int n = 6;
+  const qvm_gate_t gates[] = {
+      {GATE_Z, 0, -1},
+      {GATE_S, 3, -1},
+      {GATE_T, 5, -1},
+      {GATE_RZ, 0, -1, {0.7}},
+      {GATE_RZ, 4, -1, {-1.3}},
+      {GATE_CZ, 5, 0},
+      {GATE_CZ, 2, 3},
+      {GATE_CPHASE, 0, 1, {0.9}},
+      {GATE_RZZ, 4, 0, {0.5}},
+      {GATE_X, 0, -1},
+      {GATE_X, 5, -1},
+      {GATE_CNOT, 3, 0},
+      {GATE_CNOT, 0, 5},
+      {GATE_SWAP, 5, 0},
+      {GATE_SWAP, 2, 3},
+      {GATE_CCX, 5, 0, {0}, 1},
+      {GATE_CCX, 0, 4, {0}, 5},
+  };
+  const int num_gates = sizeof(gates) / sizeof(gates[0]);
+  const qvm_kernel_ops_t *saved = qvm_kernels_get();
+  const char *isas[] = {"scalar", "avx2", "avx512"};
+  double _Complex ref[64];
+  int ok = 1;
+  for (int k = 0; ok && k < 3; k++) {
+    if (qvm_kernels_force(isas[k]) != 0)
+      continue;
+    qvm_state_t state;
+    qvm_init(&state, n);
+    run_kernel_workload(&state);
+    memcpy(ref, state.amplitudes, sizeof(ref));
+    for (int i = 0; ok && i < num_gates; i++) {
+      qvm_gate_t g = gates[i];
+      qvm_apply_gate(&state, &g);
+      dense_apply(ref, n, &g);
+      for (int j = 0; ok && j < 64; j++)
+        ok = cabs(ref[j] - state.amplitudes[j]) < 1e-12;
+    }
+    // Three controls as a mask; CCZ-style phase on three qubits
+    qvm_apply_mcx(&state, 0x07, 4);
+    qvm_apply_mcphase(&state, 0x31, I);
+    for (int j = 0; j < 64; j++) {
+      if ((j & 0x07) == 0x07 && !(j & 0x10)) {
+        double _Complex t = ref[j];
+        ref[j] = ref[j | 0x10];
+        ref[j | 0x10] = t;
+      }
+    }
+    for (int j = 0; j < 64; j++) {
+      if ((j & 0x31) == 0x31)
+        ref[j] *= I;
+      ok = ok && cabs(ref[j] - state.amplitudes[j]) < 1e-12;
+    }
+    qvm_free(&state);
+  }
+  qvm_kernels_force(saved->name);
+
+  // Parser keywords, the fused path and the other backends
+  const char *text = "QUBITS 3\nX 0\nX 1\nCCX 0 1 2\nSWAP 0 2\nCZ 1 2\n";
+  qvm_circuit_t c;
+  ok = ok && qvm_parse_circuit(text, &c) == 0 && c.num_gates == 5 &&
+       c.gates[2].type == GATE_CCX && c.gates[2].control == 0 &&
+       c.gates[2].control2 == 1 && c.gates[2].target == 2 &&
+       c.gates[3].type == GATE_SWAP && c.gates[4].type == GATE_CZ;
+  qvm_state_t sv, sp, mps;
+  qvm_init(&sv, 3);
+  ok = ok && qvm_execute_bound(&sv, &c, NULL, 0) == 0 &&
+       complex_equal(sv.amplitudes[7], -1.0);
+  qvm_free(&sv);
+  double _Complex amps[8];
+  qvm_init_precision(&sp, 3, QVM_PRECISION_SINGLE);
+  qvm_init_backend(&mps, 3, QVM_BACKEND_MPS);
+  for (int i = 0; i < c.num_gates; i++) {
+    qvm_apply_gate(&sp, &c.gates[i]);
+    qvm_apply_gate(&mps, &c.gates[i]);
+  }
+  ok = ok && qvm_get_amplitudes(&sp, amps) == 0 &&
+       complex_equal(amps[7], -1.0);
+  for (int q = 0; ok && q < 3; q++) {
+    qvm_measure(&mps, q);
+    ok = mps.measured[q] == 1;
+  }
+  qvm_free(&sp);
+  qvm_free(&mps);
+
+  // Second control survives a .qcb round trip
+  void *qcb;
+  size_t size;
+  qvm_circuit_t loaded;
+  ok = ok && qvm_compile(text, &qcb, &size) == 0;
+  if (ok) {
+    ok = qvm_qcb_load(qcb, size, &loaded) == 0 &&
+         loaded.gates[2].type == GATE_CCX && loaded.gates[2].control2 == 1;
+    qvm_circuit_free(&loaded);
+    free(qcb);
+  }
+  qvm_circuit_free(&c);
+
+  if (!ok) {
+    printf("%s FAIL: Fast gate paths disagree with matrices\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+// Out-of-core statevector in 8-amplitude chunks: five of eight qubits
+// live across chunks, so gates on them go through reordering passes
+void test_out_of_core() {
+  printf("[TEST] Out-of-Core Statevector... ");
+
+  const int n = 8;
+  qvm_ooc_configure("/tmp", 3);
+  qvm_state_t ref, oc;
+  qvm_init(&ref, n);
+  qvm_init_backend(&oc, n, QVM_BACKEND_OUT_OF_CORE);
+  int ok = oc.num_qubits == n;
+  for (int layer = 0; ok && layer < 2; layer++) {
+    run_kernel_workload(&ref);
+    run_kernel_workload(&oc);
+    qvm_gate_t g[] = {
+        {GATE_CCX, 7, 6, {0}, 0}, {GATE_SWAP, 0, 7},
+        {GATE_CPHASE, 6, 7, {0.4}}, {GATE_RZZ, 3, 7, {0.9}},
+        {GATE_RY, 5, -1, {1.3}}, {GATE_CZ, 2, 6},
+        {GATE_X, 7, -1}, {GATE_CNOT, 1, 6},
+        {GATE_CCX, 0, 4, {0}, 7}, {GATE_RZ, 6, -1, {0.2}},
+    };
+    for (size_t i = 0; i < sizeof(g) / sizeof(g[0]); i++) {
+      qvm_apply_gate(&ref, &g[i]);
+      qvm_apply_gate(&oc, &g[i]);
+    }
+  }
+  double _Complex amps[256];
+  ok = ok && qvm_get_amplitudes(&oc, amps) == 0;
+  for (int i = 0; ok && i < 1 << n; i++)
+    ok = cabs(amps[i] - ref.amplitudes[i]) < 1e-10;
+  qvm_ooc_stats_t st;
+  ok = ok && qvm_ooc_stats(&oc, &st) == 0 && st.chunk_qubits == 3 &&
+       st.swaps > 0 && st.passes > st.swaps && st.bytes_read > 0;
+  qvm_free(&ref);
+  qvm_free(&oc);
+
+  // GHZ: sampled and measured outcomes are all-zeros or all-ones
+  qvm_init_backend(&oc, n, QVM_BACKEND_OUT_OF_CORE);
+  qvm_gate_t h = {GATE_H, 0, -1};
+  qvm_apply_gate(&oc, &h);
+  for (int q = 1; q < n; q++) {
+    qvm_gate_t cx = {GATE_CNOT, q, q - 1};
+    qvm_apply_gate(&oc, &cx);
+  }
+  qvm_counts_t counts;
+  ok = ok && qvm_sample(&oc, 500, &counts) == 0 && counts.num_outcomes == 2 &&
+       counts.outcomes[0] == 0 && counts.outcomes[1] == 0xFF &&
+       counts.shots == 500;
+  qvm_counts_free(&counts);
+  qvm_measure(&oc, 6);
+  int bit = oc.measured[6];
+  for (int q = 0; ok && q < n; q++) {
+    qvm_measure(&oc, q);
+    ok = oc.measured[q] == bit;
+  }
+  qvm_free(&oc);
+  qvm_ooc_configure("", QVM_OOC_DEFAULT_CHUNK);
+
+  if (!ok) {
+    printf("%s FAIL: Out-of-core state differs from the statevector\n",
+           TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+void test_snapshots() {
+  printf("[TEST] Statevector Snapshots... ");
+
+  // 12 qubits = 8 pages of 512 amplitudes; |0> is one non-zero page
+  const int n = 12;
+  const size_t page = 512 * sizeof(double _Complex);
+  qvm_state_t state, fork, stab;
+  qvm_init(&state, n);
+  qvm_snapshot_t s0, s1, s2;
+  int ok = qvm_snapshot_take(&state, NULL, &s0) == 0 && s0.bytes == page;
+
+  // Z on the top qubit only rewrites the upper half: page 0 is shared
+  qvm_gate_t h0 = {GATE_H, 0, -1}, h11 = {GATE_H, 11, -1};
+  qvm_gate_t z11 = {GATE_Z, 11, -1};
+  qvm_apply_gate(&state, &h0);
+  qvm_apply_gate(&state, &h11);
+  ok = ok && qvm_snapshot_take(&state, &s0, &s1) == 0 && s1.bytes == 2 * page;
+  qvm_apply_gate(&state, &z11);
+  ok = ok && qvm_snapshot_take(&state, &s1, &s2) == 0 && s2.bytes == page;
+  ok = ok && qvm_snapshot_restore(&s1, &state) == 0 &&
+       cabs(state.amplitudes[2048] - 0.5) < 1e-12;
+  ok = ok && qvm_snapshot_free(&s1) == page &&
+       qvm_snapshot_free(&s2) == 2 * page && qvm_snapshot_free(&s0) == page;
+
+  // Restoring replays the same measurement outcomes; a fork matches
+  for (int q = 0; q < n; q++) {
+    qvm_gate_t h = {GATE_H, q, -1};
+    qvm_apply_gate(&state, &h);
+  }
+  ok = ok && qvm_snapshot_take(&state, NULL, &s0) == 0;
+  int first[12];
+  for (int q = 0; q < n; q++) {
+    qvm_measure(&state, q);
+    first[q] = state.measured[q];
+  }
+  ok = ok && qvm_snapshot_restore(&s0, &state) == 0;
+  qvm_init(&fork, n);
+  ok = ok && qvm_snapshot_restore(&s0, &fork) == 0;
+  for (int i = 0; ok && i < 1 << n; i++)
+    ok = state.amplitudes[i] == fork.amplitudes[i];
+  for (int q = 0; ok && q < n; q++) {
+    qvm_measure(&state, q);
+    qvm_measure(&fork, q);
+    ok = state.measured[q] == first[q] && fork.measured[q] == first[q];
+  }
+
+  // Only same-sized statevectors
+  qvm_init_backend(&stab, n, QVM_BACKEND_STABILIZER);
+  ok = ok && qvm_snapshot_take(&stab, NULL, &s1) != 0 &&
+       qvm_snapshot_restore(&s0, &stab) != 0;
+  qvm_snapshot_free(&s0);
+  qvm_free(&stab);
+  qvm_free(&fork);
+  qvm_free(&state);
+
+  if (!ok) {
+    printf("%s FAIL: Snapshot pages or replay mismatch\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+// <psi|P|psi> with P applied gate by gate to a copy of the amplitudes
+static double pauli_reference(const qvm_state_t *state, const char *term) {
+  size_t size = (size_t)1 << state->num_qubits;
+  qvm_state_t copy = {.num_qubits = state->num_qubits,
+                      .backend = QVM_BACKEND_STATEVECTOR};
+  copy.amplitudes = malloc(size * sizeof(double _Complex));
+  memcpy(copy.amplitudes, state->amplitudes, size * sizeof(double _Complex));
+  for (int q = 0; term[q]; q++) {
+    qvm_gate_t g = {term[q] == 'X'   ? GATE_X
+                    : term[q] == 'Y' ? GATE_Y
+                                     : GATE_Z,
+                    q, -1};
+    if (term[q] != 'I')
+      qvm_apply_gate(&copy, &g);
+  }
+  double _Complex sum = 0.0;
+  for (size_t i = 0; i < size; i++)
+    sum += conj(state->amplitudes[i]) * copy.amplitudes[i];
+  free(copy.amplitudes);
+  return creal(sum);
+}
+
+// RY layer, CNOT chain, RX layer: correlations at every range
+static void prepare_correlated(qvm_state_t *state) {
+  int n = state->num_qubits;
+  for (int q = 0; q < n; q++) {
+    qvm_gate_t ry = {GATE_RY, q, -1, {0.3 + 0.2 * q}};
+    qvm_apply_gate(state, &ry);
+  }
+  for (int q = 0; q + 1 < n; q++) {
+    qvm_gate_t cx = {GATE_CNOT, q + 1, q};
+    qvm_apply_gate(state, &cx);
+  }
+  for (int q = 0; q < n; q++) {
+    qvm_gate_t rx = {GATE_RX, q, -1, {0.5 + 0.1 * q}};
+    qvm_apply_gate(state, &rx);
+  }
+}
+
+void test_expectation() {
+  printf("[TEST] Pauli Expectation Values... ");
+
+  // Z-only, shared-X groups, a lone X/Y term, 12 Z bits (parity sweep)
+  const int n = 12;
+  const char *terms[] = {"ZZ",           "IZIZ",         "ZIIIIIIIIIIZ",
+                         "XX",           "YY",           "XYZ",
+                         "IIIIIIIIIIIX", "YIIIIIIIIIIZ", "ZZZZZZZZZZZZ",
+                         "",             "IIIIIZZZIIII", "XXZ"};
+  const int num_terms = sizeof(terms) / sizeof(terms[0]);
+  double coeffs[12];
+  for (int t = 0; t < num_terms; t++)
+    coeffs[t] = 0.5 - 0.1 * t;
+
+  qvm_state_t state;
+  qvm_init(&state, n);
+  prepare_correlated(&state);
+
+  const qvm_kernel_ops_t *saved = qvm_kernels_get();
+  const char *isas[] = {"scalar", "avx2", "avx512"};
+  int ok = 1;
+  for (int k = 0; ok && k < 3; k++) {
+    if (qvm_kernels_force(isas[k]) != 0)
+      continue;
+    double values[12], energy, expected = 0.0;
+    ok = qvm_expectation_terms(&state, terms, num_terms, values) == 0 &&
+         qvm_expectation(&state, terms, coeffs, num_terms, &energy) == 0;
+    for (int t = 0; ok && t < num_terms; t++) {
+      double ref = pauli_reference(&state, terms[t]);
+      expected += coeffs[t] * ref;
+      ok = fabs(values[t] - ref) < 1e-10;
+    }
+    ok = ok && fabs(energy - expected) < 1e-10 && fabs(values[9] - 1.0) < 1e-12;
+  }
+  qvm_kernels_force(saved->name);
+
+  // MPS agrees; bad terms and unsupported backends are rejected
+  double mps_value, sv_value, value;
+  const char *zz[] = {"YZX"}, *bad[] = {"ZQ"}, *wide[] = {"IIIIIIIIIIIIZ"};
+  qvm_state_t mps, stab;
+  qvm_init_backend(&mps, n, QVM_BACKEND_MPS);
+  prepare_correlated(&mps);
+  ok = ok && qvm_expectation(&mps, zz, NULL, 1, &mps_value) == 0 &&
+       qvm_expectation(&state, zz, NULL, 1, &sv_value) == 0 &&
+       fabs(mps_value - sv_value) < 1e-8;
+  qvm_init_backend(&stab, n, QVM_BACKEND_STABILIZER);
+  ok = ok && qvm_expectation(&state, bad, NULL, 1, &value) != 0 &&
+       qvm_expectation(&state, wide, NULL, 1, &value) != 0 &&
+       qvm_expectation(&stab, zz, NULL, 1, &value) != 0;
+  qvm_free(&stab);
+  qvm_free(&mps);
+  qvm_free(&state);
+
+  if (!ok) {
+    printf("%s FAIL: Expectation differs from the reference\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
 // Run all tests
+// Cache-blocked execution in 16-amplitude tiles: gates on the six high
+// qubits either sweep or are brought into the tiles by SWAP passes
+void test_tiled_execution() {
+  printf("[TEST] Cache-Blocked Tiles... ");
+
+  const int n = 10;
+  qvm_circuit_t c;
+  qvm_circuit_init(&c, n);
+  qvm_gate_t x9 = {GATE_X, 9, -1};
+  qvm_circuit_append(&c, &x9);
+  for (int layer = 0; layer < 3; layer++) {
+    for (int q = 0; q < n - 1; q++) {
+      qvm_gate_t ry = {GATE_RY, q, -1, {0.3 + 0.17 * q + 0.5 * layer}};
+      qvm_circuit_append(&c, &ry);
+    }
+    for (int q = 0; q + 1 < n - 1; q++) {
+      qvm_gate_t cx = {GATE_CNOT, q + 1, q};
+      qvm_circuit_append(&c, &cx);
+    }
+    // q9 stays |1>: only phases touch it until it is measured
+    qvm_gate_t g[] = {
+        {GATE_CZ, 9, layer},        {GATE_CZ, 9, 6},
+        {GATE_CPHASE, 2, 9, {0.8}}, {GATE_CCX, 8, 0, {0}, 5},
+        {GATE_RZZ, 7, 2, {0.6}},    {GATE_SWAP, 6, 1},
+        {GATE_U3, 8, -1, {0.4, 0.2, 1.1}},
+    };
+    for (size_t i = 0; i < sizeof(g) / sizeof(g[0]); i++)
+      qvm_circuit_append(&c, &g[i]);
+  }
+  qvm_gate_t m9 = {GATE_MEASURE, 9, -1};
+  qvm_gate_t h8 = {GATE_H, 8, -1};
+  qvm_circuit_append(&c, &m9);
+  qvm_circuit_append(&c, &h8);
+
+  qvm_fused_program_t prog;
+  qvm_tile_plan_t plan;
+  int ok = qvm_fuse_circuit(&c, &prog) == 0 &&
+           qvm_tile_plan(&prog, 4, &plan) == 0;
+  int swaps = 0;
+  for (int s = 0; ok && s < plan.num_steps; s++)
+    swaps += plan.steps[s].kind == QVM_STEP_SWAP;
+  ok = ok && swaps > 0 && plan.passes < prog.num_blocks &&
+       plan.num_blocks == prog.num_blocks;
+
+  qvm_state_t ref, tiled, fused;
+  qvm_init(&ref, n);
+  qvm_init(&tiled, n);
+  qvm_init(&fused, n);
+  for (int i = 0; i < c.num_gates; i++)
+    qvm_apply_gate(&ref, &c.gates[i]);
+  if (ok)
+    qvm_execute_tiled(&tiled, &plan);
+  qvm_tile_configure(4);
+  qvm_execute_fused(&fused, &prog);
+  qvm_tile_configure(0);
+  for (int i = 0; ok && i < 1 << n; i++)
+    ok = cabs(tiled.amplitudes[i] - ref.amplitudes[i]) < 1e-12 &&
+         cabs(fused.amplitudes[i] - ref.amplitudes[i]) < 1e-12;
+  ok = ok && tiled.measured[9] == 1 && fused.measured[9] == 1;
+  qvm_tile_plan_free(&plan);
+  qvm_fused_free(&prog);
+  qvm_circuit_free(&c);
+  qvm_free(&ref);
+  qvm_free(&tiled);
+  qvm_free(&fused);
+
+  if (!ok) {
+    printf("%s FAIL: Tiled state differs from gate-by-gate\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+// Sparse backend against the statevector, through a dense excursion:
+// six Hadamards pass the 2^8 >> 4 threshold, measurements bring it back
+void test_sparse_backend() {
+  printf("[TEST] Sparse Statevector... ");
+
+  const int n = 8;
+  const qvm_gate_t gates[] = {
+      {GATE_H, 0, -1},
+      {GATE_T, 0, -1},
+      {GATE_CNOT, 3, 0},
+      {GATE_RY, 1, -1, {0.7}},
+      {GATE_CCX, 6, 0, {0}, 1},
+      {GATE_Y, 2, -1},
+      {GATE_S, 3, -1},
+      {GATE_CZ, 6, 3},
+      {GATE_SWAP, 1, 7},
+      {GATE_RZ, 7, -1, {1.1}},
+      {GATE_CPHASE, 0, 7, {0.3}},
+      {GATE_RZZ, 6, 2, {0.5}},
+      {GATE_Z, 6, -1},
+      {GATE_X, 4, -1},
+      {GATE_H, 4, -1},
+      {GATE_H, 4, -1},
+      {GATE_RX, 5, -1, {0.9}},
+      {GATE_U3, 2, -1, {0.4, 0.2, 1.3}},
+      {GATE_H, 1, -1},
+      {GATE_H, 4, -1},
+      {GATE_CNOT, 5, 4},
+  };
+  qvm_state_t sv, sp;
+  qvm_init(&sv, n);
+  qvm_init_backend(&sp, n, QVM_BACKEND_SPARSE);
+  qvm_rng_init(&sv.rng, 42, 1);
+  sp.rng = sv.rng;
+  int ok = sp.num_qubits == n;
+  double _Complex amps[256];
+  for (size_t i = 0; ok && i < sizeof(gates) / sizeof(gates[0]); i++) {
+    qvm_gate_t g = gates[i];
+    qvm_apply_gate(&sv, &g);
+    qvm_apply_gate(&sp, &g);
+    ok = qvm_get_amplitudes(&sp, amps) == 0;
+    for (int j = 0; ok && j < 1 << n; j++)
+      ok = cabs(amps[j] - sv.amplitudes[j]) < 1e-12;
+  }
+  qvm_sparse_stats_t st;
+  ok = ok && qvm_sparse_stats(&sp, &st) == 0 && st.dense && st.switches == 1;
+  for (int q = 0; ok && q < 6; q++) {
+    qvm_measure(&sv, q);
+    qvm_measure(&sp, q);
+    ok = sv.measured[q] == sp.measured[q];
+  }
+  ok = ok && qvm_get_amplitudes(&sp, amps) == 0;
+  for (int j = 0; ok && j < 1 << n; j++)
+    ok = cabs(amps[j] - sv.amplitudes[j]) < 1e-12;
+  ok = ok && qvm_sparse_stats(&sp, &st) == 0 && !st.dense &&
+       st.switches == 2 && st.support <= 2 && st.peak >= 32;
+  qvm_free(&sv);
+  qvm_free(&sp);
+
+  // 40-qubit GHZ with T phases: past the statevector, two amplitudes
+  qvm_circuit_t c;
+  qvm_circuit_init(&c, 40);
+  qvm_gate_t h = {GATE_H, 0, -1};
+  qvm_circuit_append(&c, &h);
+  for (int q = 1; q < 40; q++) {
+    qvm_gate_t cx = {GATE_CNOT, q, q - 1};
+    qvm_gate_t t = {GATE_T, q, -1};
+    qvm_circuit_append(&c, &cx);
+    qvm_circuit_append(&c, &t);
+  }
+  ok = ok && qvm_select_backend(&c) == QVM_BACKEND_SPARSE;
+  qvm_init_backend(&sp, 40, QVM_BACKEND_SPARSE);
+  for (int i = 0; i < c.num_gates; i++)
+    qvm_apply_gate(&sp, &c.gates[i]);
+  qvm_counts_t counts;
+  uint64_t all = ((uint64_t)1 << 40) - 1;
+  ok = qvm_sample(&sp, 500, &counts) == 0 && ok && counts.num_outcomes == 2 &&
+       counts.outcomes[0] == 0 && counts.outcomes[1] == all;
+  qvm_counts_free(&counts);
+  ok = ok && qvm_sparse_stats(&sp, &st) == 0 && st.support == 2 &&
+       st.switches == 0;
+  qvm_free(&sp);
+  qvm_circuit_free(&c);
+
+  if (!ok) {
+    printf("%s FAIL: Sparse state differs from the statevector\n",
+           TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+// Compiled subcircuit on scattered qubits of a larger state against its
+// gates applied one by one; the GEMM path (4 qubits) and the 4x4 and 2x2
+// shortcuts, then cache hits, misses and eviction refcounts
+static void map_gate(qvm_gate_t *g, const int *qubits) {
+  g->target = qubits[g->target];
+  if (qvm_gate_is_two_qubit(g->type) || g->type == GATE_CCX)
+    g->control = qubits[g->control];
+  if (g->type == GATE_CCX)
+    g->control2 = qubits[g->control2];
+}
+
+static int compiled_matches(const qvm_gate_t *gates, int num_gates, int k,
+                            const int *qubits) {
+  const int n = 9;
+  qvm_circuit_t sub;
+  qvm_circuit_init(&sub, k);
+  for (int i = 0; i < num_gates; i++)
+    qvm_circuit_append(&sub, &gates[i]);
+  qvm_state_t ref, st;
+  qvm_init(&ref, n);
+  for (int q = 0; q < n; q++) {
+    qvm_gate_t prep = {GATE_U3, q, -1, {0.3 * q + 0.1, 0.7 * q, 0.2}};
+    qvm_apply_unitary(&ref, &prep);
+  }
+  qvm_init(&st, n);
+  memcpy(st.amplitudes, ref.amplitudes, sizeof(double _Complex) << n);
+  for (int i = 0; i < num_gates; i++) {
+    qvm_gate_t g = gates[i];
+    map_gate(&g, qubits);
+    qvm_apply_unitary(&ref, &g);
+  }
+  int ok = qvm_apply_subcircuit(&st, &sub, qubits) == 0;
+  for (int j = 0; ok && j < 1 << n; j++)
+    ok = cabs(st.amplitudes[j] - ref.amplitudes[j]) < 1e-12;
+  qvm_free(&ref);
+  qvm_free(&st);
+  qvm_circuit_free(&sub);
+  return ok;
+}
+
+void test_compiled_unitary() {
+  printf("[TEST] Compiled Unitaries... ");
+
+  const qvm_gate_t gates[] = {
+      {GATE_H, 0, -1},
+      {GATE_CNOT, 1, 0},
+      {GATE_RY, 2, -1, {0.7}},
+      {GATE_CCX, 3, 0, {0}, 2},
+      {GATE_CPHASE, 1, 3, {0.4}},
+      {GATE_SWAP, 0, 2},
+      {GATE_U3, 3, -1, {0.4, 0.2, 1.3}},
+      {GATE_RZZ, 0, 1, {0.5}},
+      {GATE_T, 1, -1},
+      {GATE_RX, 0, -1, {1.1}},
+  };
+  const qvm_gate_t pair[] = {
+      {GATE_H, 0, -1}, {GATE_CNOT, 1, 0}, {GATE_RY, 1, -1, {0.3}}};
+  const int wide[4] = {6, 1, 4, 3}, swapped[2] = {5, 2}, one[1] = {7};
+
+  qvm_unitary_cache_clear();
+  int ok = compiled_matches(gates, 10, 4, wide) &&
+           compiled_matches(pair, 3, 2, swapped) &&
+           compiled_matches(pair, 1, 1, one);
+
+  // U^dagger U = I
+  qvm_circuit_t c;
+  qvm_circuit_init(&c, 4);
+  for (int i = 0; i < 10; i++)
+    qvm_circuit_append(&c, &gates[i]);
+  qvm_unitary_t u;
+  ok = ok && qvm_compile_unitary(&c, &u) == 0;
+  for (int r = 0; ok && r < 16; r++) {
+    for (int col = 0; ok && col < 16; col++) {
+      double _Complex dot = 0;
+      for (int i = 0; i < 16; i++)
+        dot += conj(u.matrix[i * 16 + r]) * u.matrix[i * 16 + col];
+      ok = cabs(dot - (r == col)) < 1e-12;
+    }
+  }
+  qvm_unitary_free(&u);
+
+  // The gates compiled above hit; a new angle misses; a referenced entry
+  // outlives a clear
+  qvm_unitary_cache_stats_t cs;
+  const qvm_unitary_t *a = qvm_unitary_get(&c);
+  const qvm_unitary_t *b = qvm_unitary_get(&c);
+  qvm_unitary_cache_stats(&cs);
+  ok = ok && a && a == b && cs.hits == 2 && cs.misses == 3 &&
+       cs.entries == 3;
+  c.gates[2].theta[0] = 0.8;
+  const qvm_unitary_t *other = qvm_unitary_get(&c);
+  qvm_unitary_cache_stats(&cs);
+  ok = ok && other && other != a && cs.misses == 4;
+  qvm_unitary_cache_clear();
+  ok = ok && a->matrix && a->num_qubits == 4;
+  qvm_unitary_release(a);
+  qvm_unitary_release(b);
+  qvm_unitary_release(other);
+
+  // Measurements have no unitary
+  qvm_gate_t m = {GATE_MEASURE, 0, -1};
+  qvm_circuit_append(&c, &m);
+  ok = ok && qvm_compile_unitary(&c, &u) != 0 && !qvm_unitary_get(&c);
+  qvm_circuit_free(&c);
+  qvm_unitary_cache_clear();
+
+  if (!ok) {
+    printf("%s FAIL: Compiled unitary differs from its gates\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+// Reference QFT (sign +1) or diffusion of the range first..last: every
+// group of amplitudes sharing the other qubits, transformed directly
+static void macro_reference(double _Complex *a, int n, int first, int last,
+                            qvm_gate_type_t type) {
+  int m = last - first + 1;
+  size_t M = (size_t)1 << m, size = (size_t)1 << n;
+  size_t range = (M - 1) << first;
+  double _Complex *in = malloc(M * sizeof(double _Complex));
+  for (size_t base = 0; base < size; base++) {
+    if (base & range)
+      continue;
+    double _Complex mean = 0;
+    for (size_t x = 0; x < M; x++) {
+      in[x] = a[base | x << first];
+      mean += in[x] / (double)M;
+    }
+    for (size_t y = 0; y < M; y++) {
+      double _Complex v = 0;
+      for (size_t x = 0; type == GATE_QFT && x < M; x++)
+        v += in[x] * cexp(2 * M_PI * I * (double)(x * y % M) / (double)M);
+      a[base | y << first] =
+          type == GATE_QFT ? v / sqrt((double)M) : 2 * mean - in[y];
+    }
+  }
+  free(in);
+}
+
+// Native QFT and DIFFUSE passes against their definitions, the gate
+// sequences other backends run, and the parser
+void test_macro_ops() {
+  printf("[TEST] QFT and Diffusion Macro-ops... ");
+
+  const int n = 8;
+  // QFT over a middle range and the whole register; diffusion over many
+  // groups (1..3), few groups (0..5) and one group (0..7)
+  const struct {
+    qvm_gate_type_t type;
+    int first, last;
+  } cases[] = {{GATE_QFT, 2, 5},     {GATE_QFT, 0, 7},
+               {GATE_DIFFUSE, 1, 3}, {GATE_DIFFUSE, 0, 5},
+               {GATE_DIFFUSE, 0, 7}, {GATE_QFT, 6, 6}};
+  int ok = 1;
+  double _Complex start[256], ref[256], amps[256];
+  for (size_t c = 0; ok && c < sizeof(cases) / sizeof(cases[0]); c++) {
+    qvm_state_t st;
+    qvm_init(&st, n);
+    prepare_correlated(&st);
+    memcpy(start, st.amplitudes, sizeof(start));
+    memcpy(ref, start, sizeof(ref));
+    macro_reference(ref, n, cases[c].first, cases[c].last, cases[c].type);
+    qvm_gate_t g = {cases[c].type, cases[c].last, cases[c].first};
+    qvm_apply_gate(&st, &g);
+    for (int j = 0; ok && j < 1 << n; j++)
+      ok = cabs(st.amplitudes[j] - ref[j]) < 1e-12;
+
+    // The inverse brings the state back
+    qvm_gate_t inv = g;
+    inv.type = g.type == GATE_QFT ? GATE_IQFT : GATE_DIFFUSE;
+    qvm_apply_gate(&st, &inv);
+    for (int j = 0; ok && j < 1 << n; j++)
+      ok = cabs(st.amplitudes[j] - start[j]) < 1e-12;
+    qvm_free(&st);
+
+    // Gate sequences on the sparse backend; a DIFFUSE past 3 qubits is
+    // refused rather than skipped
+    qvm_init_backend(&st, n, QVM_BACKEND_SPARSE);
+    prepare_correlated(&st);
+    if (g.type == GATE_DIFFUSE && g.target - g.control >= 3) {
+      ok = ok && qvm_apply_gate(&st, &g) == -1;
+      qvm_free(&st);
+      continue;
+    }
+    qvm_apply_gate(&st, &g);
+    ok = ok && qvm_get_amplitudes(&st, amps) == 0;
+    for (int j = 0; ok && j < 1 << n; j++)
+      ok = cabs(amps[j] - ref[j]) < 1e-10;
+    qvm_apply_gate(&st, &inv);
+    ok = ok && qvm_get_amplitudes(&st, amps) == 0;
+    for (int j = 0; ok && j < 1 << n; j++)
+      ok = cabs(amps[j] - start[j]) < 1e-10;
+    qvm_free(&st);
+  }
+
+  // QFT of a basis state, parsed with its range reversed: flat magnitudes
+  qvm_circuit_t circuit;
+  ok = qvm_parse_circuit("QUBITS 3\nX 0\nQFT 2 0\n", &circuit) == 0 && ok &&
+       circuit.num_gates == 2 && circuit.gates[1].type == GATE_QFT &&
+       circuit.gates[1].control == 0 && circuit.gates[1].target == 2;
+  if (ok) {
+    qvm_state_t st;
+    qvm_init(&st, 3);
+    qvm_execute_circuit(&st, &circuit, 0);
+    for (int j = 0; ok && j < 8; j++)
+      ok = cabs(st.amplitudes[j] - cexp(2 * M_PI * I * j / 8) / sqrt(8)) <
+           1e-12;
+    qvm_free(&st);
+  }
+  qvm_circuit_free(&circuit);
+
+  // A wide DIFFUSE keeps a low-support circuit on the statevector, and a
+  // backend that cannot run it fails the run instead of sampling
+  ok = qvm_parse_circuit("QUBITS 12\nX 11\nDIFFUSE 0 5\nMEASURE 0\n"
+                         "MEASURE 1\n",
+                         &circuit) == 0 &&
+       ok && qvm_select_backend(&circuit) == QVM_BACKEND_STATEVECTOR;
+  if (ok) {
+    qvm_state_t st;
+    qvm_counts_t counts;
+    qvm_init_backend(&st, 12, QVM_BACKEND_SPARSE);
+    ok = qvm_sample_circuit(&st, &circuit, 16, &counts) == -1;
+    qvm_free(&st);
+  }
+  qvm_circuit_free(&circuit);
+
+  if (!ok) {
+    printf("%s FAIL: Macro-op differs from its definition\n", TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
+// Hybrid Schrödinger-Feynman: every kind of cut gate (both orientations,
+// CCX split 2 + 1 either way) against the statevector, path slices adding
+// up, the cut chosen for a 40-qubit GHZ and samples of it and of a
+// 10-qubit circuit against the exact marginals
+void test_hybrid_feynman() {
+  printf("[TEST] Hybrid Schrödinger-Feynman... ");
+
+  const int n = 10, cut = 5;
+  const qvm_gate_t gates[] = {
+      {GATE_CNOT, 7, 2},           {GATE_CNOT, 1, 8},
+      {GATE_QFT, 3, 0},            {GATE_CZ, 6, 3},
+      {GATE_CPHASE, 9, 0, {0.7}},  {GATE_RZZ, 5, 4, {0.9}},
+      {GATE_DIFFUSE, 9, 6},        {GATE_SWAP, 5, 4},
+      {GATE_CCX, 3, 1, {0}, 6},    {GATE_T, 2, -1},
+      {GATE_CCX, 8, 0, {0}, 2},    {GATE_RX, 7, -1, {1.3}},
+      {GATE_CCX, 2, 7, {0}, 9},    {GATE_H, 4, -1},
+  };
+  const int num_gates = sizeof(gates) / sizeof(gates[0]);
+  qvm_circuit_t c;
+  qvm_circuit_init(&c, n);
+  for (int q = 0; q < n; q++) {
+    qvm_gate_t prep = {GATE_U3, q, -1, {0.3 * q + 0.1, 0.7 * q, 0.2}};
+    qvm_circuit_append(&c, &prep);
+  }
+  for (int i = 0; i < num_gates; i++)
+    qvm_circuit_append(&c, &gates[i]);
+
+  qvm_state_t ref;
+  qvm_init(&ref, n);
+  for (int i = 0; i < c.num_gates; i++)
+    qvm_apply_unitary(&ref, &c.gates[i]);
+  uint64_t bits[1024];
+  double _Complex amps[1024], part[1024];
+  for (int j = 0; j < 1 << n; j++)
+    bits[j] = j;
+
+  // Rank 2 for every cut gate but the SWAP's 4
+  qvm_hsf_stats_t stats;
+  int ok = qvm_hsf_plan(&c, cut, &stats) == 0 && stats.cut == cut &&
+           stats.cut_gates == 9 && stats.paths == 1024;
+  ok = ok && qvm_hsf_amplitudes(&c, cut, bits, 1 << n, amps) == 0;
+  for (int j = 0; ok && j < 1 << n; j++)
+    ok = cabs(amps[j] - ref.amplitudes[j]) < 1e-10;
+  ok = ok && qvm_hsf_amplitudes_paths(&c, cut, 0, 300, bits, 1 << n, part) ==
+                 0;
+  for (int j = 0; ok && j < 1 << n; j++)
+    amps[j] = part[j];
+  ok = ok && qvm_hsf_amplitudes_paths(&c, cut, 300, UINT64_MAX, bits, 1 << n,
+                                      part) == 0;
+  for (int j = 0; ok && j < 1 << n; j++)
+    ok = cabs(amps[j] + part[j] - ref.amplitudes[j]) < 1e-10;
+
+  // Samples of qubits 1, 4, 6, 8 within 0.03 of the exact distribution
+  const int measured[4] = {1, 4, 6, 8}, unitary_gates = c.num_gates;
+  uint64_t mask = 0;
+  for (int i = 0; i < 4; i++) {
+    qvm_gate_t m = {GATE_MEASURE, measured[i], -1};
+    qvm_circuit_append(&c, &m);
+    mask |= (uint64_t)1 << measured[i];
+  }
+  double exact[1024] = {0};
+  for (int j = 0; j < 1 << n; j++)
+    exact[j & mask] += cabs(ref.amplitudes[j]) * cabs(ref.amplitudes[j]);
+  qvm_counts_t counts;
+  const int shots = 20000;
+  ok = ok && qvm_hsf_sample(&c, cut, shots, &counts) == 0 &&
+       counts.mask == mask && counts.shots == shots;
+  double tvd = 0.0;
+  for (int o = 0; ok && o < counts.num_outcomes; o++) {
+    tvd += fabs((double)counts.counts[o] / shots - exact[counts.outcomes[o]]);
+    exact[counts.outcomes[o]] = 0.0;
+  }
+  for (int j = 0; j < 1 << n; j++)
+    tvd += exact[j];
+  ok = ok && tvd / 2 < 0.03;
+  qvm_counts_free(&counts);
+  qvm_free(&ref);
+
+  // No split at qubit 5 past a mid-circuit measurement or a macro-op
+  // across it; the cheapest split then avoids every macro-op
+  qvm_gate_t across = {GATE_QFT, 5, 4}, after = {GATE_H, 1, -1};
+  qvm_circuit_append(&c, &after);
+  ok = ok && qvm_hsf_plan(&c, cut, &stats) != 0;
+  c.num_gates = unitary_gates;
+  qvm_circuit_append(&c, &across);
+  ok = ok && qvm_hsf_plan(&c, cut, &stats) != 0 &&
+       qvm_hsf_plan(&c, 0, &stats) == 0 && (stats.cut == 4 || stats.cut == 6);
+  qvm_circuit_free(&c);
+
+  // 40-qubit GHZ: one CNOT across the balanced cut, two outcomes
+  qvm_circuit_t ghz;
+  qvm_circuit_init(&ghz, 40);
+  qvm_gate_t h = {GATE_H, 0, -1};
+  qvm_circuit_append(&ghz, &h);
+  for (int q = 1; q < 40; q++) {
+    qvm_gate_t cx = {GATE_CNOT, q, q - 1};
+    qvm_circuit_append(&ghz, &cx);
+  }
+  uint64_t ends[2] = {0, ((uint64_t)1 << 40) - 1};
+  ok = ok && qvm_hsf_plan(&ghz, 0, &stats) == 0 && stats.cut == 20 &&
+       stats.cut_gates == 1 && stats.paths == 2 &&
+       qvm_hsf_amplitudes(&ghz, 0, ends, 2, amps) == 0 &&
+       cabs(amps[0] - M_SQRT1_2) < 1e-12 && cabs(amps[1] - M_SQRT1_2) < 1e-12;
+  qvm_gate_t m0 = {GATE_MEASURE, 0, -1}, m39 = {GATE_MEASURE, 39, -1};
+  qvm_circuit_append(&ghz, &m0);
+  qvm_circuit_append(&ghz, &m39);
+  ok = ok && qvm_hsf_sample(&ghz, 0, 2000, &counts) == 0 &&
+       counts.num_outcomes == 2 && counts.outcomes[0] == 0 &&
+       counts.outcomes[1] == (1 | (uint64_t)1 << 39) &&
+       abs(counts.counts[0] - 1000) < 150;
+  qvm_counts_free(&counts);
+  qvm_circuit_free(&ghz);
+
+  if (!ok) {
+    printf("%s FAIL: Hybrid simulation differs from the statevector\n",
+           TEST_FAIL);
+    tests_failed++;
+    return;
+  }
+
+  printf("%s PASS\n", TEST_PASS);
+  tests_passed++;
+}
+
 void run_all_tests() {
   printf("\n╔═══════════════════════════════════╗\n");
   printf("║     QVM Unit Test Suite v1.0      ║\n");
@@ -309,6 +2471,31 @@ void run_all_tests() {
   test_parser();
   test_normalization();
   test_multigate_circuit();
+  test_high_qubit_gates();
+  test_simd_kernels();
+  test_threaded_sweeps();
+  test_gate_fusion();
+  test_sampling();
+  test_stabilizer_backend();
+  test_mps_backend();
+  test_density_noise();
+  test_trajectories();
+  test_circuit_stream();
+  test_compiled_circuit();
+  test_parameterized_gates();
+  test_gradients();
+  test_batch_execution();
+  test_rng();
+  test_single_precision();
+  test_special_gates();
+  test_out_of_core();
+  test_snapshots();
+  test_expectation();
+  test_tiled_execution();
+  test_sparse_backend();
+  test_compiled_unitary();
+  test_macro_ops();
+  test_hybrid_feynman();
 
   printf("\n┌─── Test Results ───┐\n");
   printf("│ Passed: %d\n", tests_passed);